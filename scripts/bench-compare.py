@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+PathSteer Microbenchmark Comparison
+Compares two pathsteer-bench result files (JSONL from bench-micro.sh):
+per benchmark the change in median time per call, and whether it is real -
+a two-sided Mann-Whitney U test over the two runs' samples, so one noisy
+sample can't make or hide a regression.
+
+A benchmark regresses when it got slower by more than --threshold percent
+and the test says p < --alpha. Exits 1 if any did, 0 otherwise.
+
+Usage: bench-compare.py [--threshold PCT] [--alpha P] BASELINE CURRENT
+"""
+import argparse
+import json
+import math
+import sys
+
+
+def load(path):
+    meta = {}
+    benches = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            rec = json.loads(line)
+            if rec.get('type') == 'meta':
+                meta = rec
+            elif rec.get('type') == 'bench':
+                benches[rec['name']] = rec
+    return meta, benches
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value, normal approximation with tie correction."""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, g) in zip(ranks, pooled) if g == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(var)
+    return max(0.0, min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2))))
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Compare pathsteer-bench runs')
+    ap.add_argument('baseline')
+    ap.add_argument('current')
+    ap.add_argument('--threshold', type=float, default=5.0, help='regression threshold, percent')
+    ap.add_argument('--alpha', type=float, default=0.01, help='significance level')
+    args = ap.parse_args()
+
+    base_meta, base = load(args.baseline)
+    cur_meta, cur = load(args.current)
+
+    for key in ('host', 'cpu_model', 'compiler'):
+        if base_meta.get(key) != cur_meta.get(key):
+            print(f"WARNING: {key} differs: {base_meta.get(key)} vs {cur_meta.get(key)}", file=sys.stderr)
+
+    print(f"{'benchmark':<20} {'base ns':>11} {'now ns':>11} {'change':>8} {'p':>8}  verdict")
+    regressions = 0
+    for name in sorted(set(base) | set(cur)):
+        if name not in base or name not in cur:
+            print(f"{name:<20} {'only in ' + ('current' if name in cur else 'baseline'):>40}")
+            continue
+        b, c = base[name], cur[name]
+        change = (c['median_ns'] - b['median_ns']) / b['median_ns'] * 100.0 if b['median_ns'] > 0 else 0.0
+        p = mann_whitney_p(b.get('samples', []), c.get('samples', []))
+        verdict = 'same'
+        if p < args.alpha and abs(change) > args.threshold:
+            verdict = 'SLOWER' if change > 0 else 'faster'
+            if change > 0:
+                regressions += 1
+        print(f"{name:<20} {b['median_ns']:>11.1f} {c['median_ns']:>11.1f} {change:>+7.1f}% {p:>8.4f}  {verdict}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) regressed by more than {args.threshold:g}%", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,253 @@
+#!/bin/bash
+###############################################################################
+# bench-dup.sh - PathSteer Guardian Duplication Path Throughput Bench
+#
+# What duplicating the active uplink costs at high packet rates: the same
+# client traffic is forwarded from br-lan out of veth_cell_a with
+#
+#   off      no filter
+#   mirred   pathsteerd's filter (dup_enable()): u32 match all + mirred
+#            egress mirror to veth_sl_a, on veth_cell_a's prio qdisc 1:
+#   bpf      a cls_bpf direct-action program calling bpf_clone_redirect()
+#            to veth_sl_a, at the same place (pathsteer-dupbench attach)
+#
+# and for each mode and offered rate reports delivered and mirrored pps,
+# CPU per forwarded packet (all cores, from /proc/stat) and one-way
+# forwarding latency of the active and the duplicate copy (p50/p99/p99.9
+# of 1-in-64 timestamped probes). Run it on the target box to size
+# hardware for MIRROR mode; subtract the "off" row for the duplication
+# cost itself.
+#
+# Topology (own namespaces, safe on a live edge):
+#
+#   psd_lan/lan0 ──── psd_dut: br-lan ─ route ─ veth_cell_a ←→ psd_up_a (sink)
+#   (pathsteer-dupbench gen)                    veth_sl_a   ←→ psd_up_b (sink)
+#                                                  ↑ duplicate
+#
+#   The generator uses PACKET_QDISC_BYPASS + sendmmsg from one core; with
+#   RATES "max" it sends as fast as that core can, so the DUT's forwarding
+#   and duplication share the core with it - the single-flow worst case.
+#   Both uplink namespaces blackhole the traffic.
+#
+# Usage:
+#   bench-dup.sh up | down
+#   bench-dup.sh run [--out DIR] [--seconds S] [--size BYTES] [--modes "off mirred bpf"]
+#                    [RATE ...]          (pps, "max" = unpaced; default 100000 max)
+#
+# Needs root, iproute2 (tc), jq and a kernel with cls_bpf for the bpf mode.
+###############################################################################
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(dirname "$SCRIPT_DIR")"
+DUPBENCH="${DUPBENCH:-$REPO_DIR/src/pathsteerd/pathsteer-dupbench}"
+STATE_DIR="/run/pathsteer-bench-dup"
+MARKER="$STATE_DIR/lab.up"
+
+NS_LAN="psd_lan"
+NS_DUT="psd_dut"
+NS_UP_A="psd_up_a"
+NS_UP_B="psd_up_b"
+LAB_MAC="02:50:53:00:00:02"
+CLIENT_IP="10.90.0.2"
+TARGET_IP="198.18.0.1"
+
+# Uplink root qdisc the filters hang off (the edge's is prio)
+DUT_QDISC="${DUT_QDISC:-prio}"
+
+log() { echo "[$(date '+%H:%M:%S')] $*" >&2; }
+die() { log "ERROR: $*"; exit 1; }
+
+###############################################################################
+# Topology
+###############################################################################
+
+ns_add() {
+    ip netns add "$1"
+    ip -n "$1" link set lo up
+    ip netns exec "$1" sysctl -qw net.ipv4.ip_forward=1
+}
+
+lab_up() {
+    [[ $EUID -eq 0 ]] || die "must run as root"
+    [[ -f "$MARKER" ]] && lab_down
+    log "Building duplication bench lab"
+    mkdir -p "$STATE_DIR"
+    touch "$MARKER"
+
+    for ns in $NS_LAN $NS_DUT $NS_UP_A $NS_UP_B; do ns_add "$ns"; done
+
+    # Client on br-lan
+    ip -n "$NS_DUT" link add br-lan type bridge
+    ip -n "$NS_DUT" addr add 10.90.0.1/24 dev br-lan
+    ip -n "$NS_DUT" link set br-lan up
+    ip link add lan0 netns "$NS_LAN" type veth peer name lan0_p netns "$NS_DUT"
+    ip -n "$NS_DUT" link set lan0_p master br-lan up
+    ip -n "$NS_LAN" addr add "$CLIENT_IP/24" dev lan0
+    ip -n "$NS_LAN" link set lan0 up
+
+    # Uplinks: root qdisc like the edge, same MAC behind both so the
+    # duplicate is accepted like the original
+    local n=1
+    for pair in "veth_cell_a:$NS_UP_A" "veth_sl_a:$NS_UP_B"; do
+        local dev=${pair%%:*} ns=${pair#*:}
+        ip link add "$dev" netns "$NS_DUT" type veth peer name "${dev}_i" netns "$ns"
+        ip -n "$NS_DUT" addr add "10.91.$n.1/30" dev "$dev"
+        ip -n "$ns" addr add "10.91.$n.2/30" dev "${dev}_i"
+        ip -n "$ns" link set "${dev}_i" address "$LAB_MAC"
+        ip -n "$NS_DUT" link set "$dev" up
+        ip -n "$ns" link set "${dev}_i" up
+        ip -n "$ns" route add blackhole 198.18.0.0/15
+        ip netns exec "$NS_DUT" tc qdisc add dev "$dev" root handle 1: $DUT_QDISC
+        n=$((n + 1))
+    done
+    ip -n "$NS_DUT" route add 198.18.0.0/15 via 10.91.1.2 dev veth_cell_a
+    # Resolve the next hop now, not during the first run
+    ip -n "$NS_DUT" neigh replace 10.91.1.2 lladdr "$LAB_MAC" dev veth_cell_a nud permanent
+    log "Lab up: $NS_LAN $NS_DUT $NS_UP_A $NS_UP_B"
+}
+
+lab_down() {
+    [[ -f "$MARKER" ]] || { log "No duplication bench lab"; return 0; }
+    for ns in $NS_LAN $NS_DUT $NS_UP_A $NS_UP_B; do
+        ip netns del "$ns" 2>/dev/null || true
+    done
+    rm -f "$MARKER"
+    log "Lab down"
+}
+
+###############################################################################
+# Run
+###############################################################################
+
+set_mode() {
+    local mode=$1
+    ip netns exec "$NS_DUT" tc filter del dev veth_cell_a parent 1: pref 1 2>/dev/null || true
+    case "$mode" in
+        off) ;;
+        mirred)
+            ip netns exec "$NS_DUT" tc filter add dev veth_cell_a parent 1: protocol all pref 1 \
+                u32 match u32 0 0 action mirred egress mirror dev veth_sl_a || return 1
+            ;;
+        bpf)
+            ip netns exec "$NS_DUT" "$DUPBENCH" attach --dev veth_cell_a --to veth_sl_a --pref 1 >/dev/null || return 1
+            ;;
+        *) die "Unknown mode $mode" ;;
+    esac
+}
+
+rx_packets() {
+    ip -n "$1" -s -j link show dev "$2" | jq '.[0].stats64.rx.packets'
+}
+
+# Busy and total jiffies over all cores
+cpu_jiffies() {
+    awk '/^cpu / { busy = $2 + $3 + $4 + $7 + $8 + $9; print busy, busy + $5 + $6 }' /proc/stat
+}
+
+run_one() {
+    local mode=$1 rate=$2 seconds=$3 size=$4 dir=$5
+    local tag="${mode}_${rate}"
+    local pps=$rate
+    [[ "$rate" == "max" ]] && pps=0
+
+    # Called from an if: set -e is off, check explicitly
+    set_mode "$mode" || return 1
+    local mac; mac=$(ip -n "$NS_DUT" -j link show dev br-lan | jq -r '.[0].address')
+    local a0 b0; a0=$(rx_packets "$NS_UP_A" veth_cell_a_i); b0=$(rx_packets "$NS_UP_B" veth_sl_a_i)
+
+    ip netns exec "$NS_UP_A" "$DUPBENCH" sink --dev veth_cell_a_i --seconds "$((seconds + 1))" \
+        >"$dir/$tag.sink_a.json" &
+    local sink_a=$!
+    ip netns exec "$NS_UP_B" "$DUPBENCH" sink --dev veth_sl_a_i --seconds "$((seconds + 1))" \
+        >"$dir/$tag.sink_b.json" &
+    local sink_b=$!
+    sleep 0.3
+
+    local cpu0; cpu0=$(cpu_jiffies)
+    ip netns exec "$NS_LAN" "$DUPBENCH" gen --dev lan0 --dst-mac "$mac" --src "$CLIENT_IP" \
+        --dst "$TARGET_IP" --rate "$pps" --size "$size" --seconds "$seconds" >"$dir/$tag.gen.json"
+    local cpu1; cpu1=$(cpu_jiffies)
+    wait "$sink_a" "$sink_b" || true
+
+    local a1 b1; a1=$(rx_packets "$NS_UP_A" veth_cell_a_i); b1=$(rx_packets "$NS_UP_B" veth_sl_a_i)
+    set_mode off
+
+    jq -c -n --arg mode "$mode" --arg rate "$rate" --argjson size "$size" \
+        --slurpfile gen "$dir/$tag.gen.json" --slurpfile sa "$dir/$tag.sink_a.json" \
+        --slurpfile sb "$dir/$tag.sink_b.json" \
+        --argjson a "$((a1 - a0))" --argjson b "$((b1 - b0))" \
+        --argjson busy "$(( ${cpu1% *} - ${cpu0% *} ))" --argjson total "$(( ${cpu1#* } - ${cpu0#* } ))" \
+        --argjson hz "$(getconf CLK_TCK)" '
+        ($gen[0]) as $g | ($sa[0] // {}) as $sa | ($sb[0] // {}) as $sb |
+        {
+            mode: $mode, rate: $rate, size: $size, seconds: $g.seconds,
+            offered_pps: $g.pps,
+            delivered_pps: ($a / $g.seconds | floor),
+            mirrored_pps: ($b / $g.seconds | floor),
+            loss_pct: (if $g.sent > 0 then ((1 - $a / $g.sent) * 10000 | round) / 100 else 0 end),
+            cpu_pct: (if $total > 0 then ($busy * 1000 / $total | round) / 10 else 0 end),
+            cpu_ns_per_pkt: (if $a > 0 then ($busy * 1e9 / $hz / $a | round) else null end),
+            lat_p50_us: $sa.lat_p50_us, lat_p99_us: $sa.lat_p99_us, lat_p999_us: $sa.lat_p999_us,
+            dup_lat_p50_us: $sb.lat_p50_us, dup_lat_p99_us: $sb.lat_p99_us
+        }'
+}
+
+# Per rate: each mode against "off"
+report() {
+    jq -r -s '
+        (map(select(.mode == "off")) | map({key: .rate, value: .}) | from_entries) as $off |
+        ["mode", "rate", "offered", "delivered", "mirrored", "cpu%", "ns/pkt", "+ns/pkt", "p50us", "p99us", "+p50us"],
+        (.[] | ($off[.rate] // {}) as $o | [
+            .mode, .rate, .offered_pps, .delivered_pps, .mirrored_pps, .cpu_pct, .cpu_ns_per_pkt,
+            (if .mode != "off" and $o.cpu_ns_per_pkt and .cpu_ns_per_pkt then .cpu_ns_per_pkt - $o.cpu_ns_per_pkt else "-" end),
+            .lat_p50_us, .lat_p99_us,
+            (if .mode != "off" and $o.lat_p50_us and .lat_p50_us then ((.lat_p50_us - $o.lat_p50_us) * 100 | round) / 100 else "-" end)
+        ]) | @tsv' "$1" | awk -F'\t' '{ for (i = 1; i <= NF; i++) printf "%-10s", $i; print "" }'
+}
+
+cmd_run() {
+    local out seconds=10 size=64 modes="off mirred bpf"
+    out="/var/lib/pathsteer/bench/dup_$(date +%Y%m%d_%H%M%S)"
+    local rates=()
+    while [[ $# -gt 0 ]]; do
+        case "$1" in
+            --out) out=$2; shift 2 ;;
+            --seconds) seconds=$2; shift 2 ;;
+            --size) size=$2; shift 2 ;;
+            --modes) modes=$2; shift 2 ;;
+            *) rates+=("$1"); shift ;;
+        esac
+    done
+    [[ ${#rates[@]} -eq 0 ]] && rates=(100000 max)
+
+    [[ -x "$DUPBENCH" ]] || die "$DUPBENCH not built (make -C src/pathsteerd)"
+    for tool in ip tc jq; do
+        command -v "$tool" >/dev/null || die "$tool not found"
+    done
+
+    mkdir -p "$out"
+    trap lab_down EXIT
+    lab_up
+
+    for rate in "${rates[@]}"; do
+        for mode in $modes; do
+            log "[$mode] ${rate} pps, ${size} B, ${seconds}s"
+            if ! run_one "$mode" "$rate" "$seconds" "$size" "$out" >>"$out/results.jsonl"; then
+                log "WARNING: $mode at $rate failed, skipped"
+            fi
+        done
+    done
+    report "$out/results.jsonl"
+    log "Results: $out/results.jsonl"
+}
+
+case "${1:-}" in
+    up)   lab_up ;;
+    down) lab_down ;;
+    run)  shift; cmd_run "$@" ;;
+    *)
+        echo "Usage: $0 {up|down|run [--out DIR] [--seconds S] [--size BYTES] [--modes \"off mirred bpf\"] [RATE ...]}"
+        exit 1
+        ;;
+esac
@@ -0,0 +1,367 @@
+#!/bin/bash
+###############################################################################
+# bench-lab.sh - PathSteer Guardian Failover Bench (local namespaces)
+#
+# Builds the edge topology on one Linux box, with no network access and no
+# modems or dishes, runs pathsteerd against it, replays scripted netem
+# impairment profiles and measures what a client behind the VIP sees:
+# end-to-end loss, outage duration, tripwire detection time and
+# tripwire -> duplication latency (bench-report.py).
+#
+# Topology (names as on the edge, so pathsteerd runs unmodified):
+#
+#   ns_vip  (pathsteerd, client on VIP 104.204.136.50)
+#     ├── veth_cell_a ←→ ns_cell_a/veth_cell_a_i ── wan_cell_a ←→ isp_cell_a ─┐
+#     ├── wg-ca-cA    ←→ ns_cell_a/wg-ca-cA_i   (LTE probe path)              │
+#     ├── veth_sl_a   ←→ ns_sl_a/veth_sl_a_i     ── wan_sl_a   ←→ isp_sl_a   ─┤ ns_ctrl
+#     └── veth_fa     ←→ ns_fa/veth_fa_i         ── wan_fa     ←→ isp_fa     ─┘ (dedupe,
+#                                                                               8.8.8.8,
+#                                                                               10.200.1.1)
+#
+#   - netem on both ends of each wan/isp link is that uplink's "ISP":
+#     profile delays are one-way, so RTT is twice the configured delay.
+#   - pathsteerd duplicates with tc mirred between veth_<u> in ns_vip (see
+#     dup_enable()). All veth_<u>_i share one MAC so a mirrored frame is
+#     accepted by the secondary's namespace and forwarded like the original.
+#   - The route follower stands in for the production route switch: it
+#     moves the ns_vip default and the controller return route to whatever
+#     status.json says is active.
+#
+# Usage:
+#   bench-lab.sh up | down | list
+#   bench-lab.sh run [--out DIR] [--config FILE] [profile | trace.jsonl ...]
+#
+#   run brings the lab up, runs each profile (default: all in
+#   bench-profiles/) against a fresh pathsteerd, tears it down and writes
+#   one JSON result line per profile to DIR/results.jsonl. A recorded
+#   drive (daemon log with "trace_log") is played by pathsteer-emu instead:
+#   real RTT, loss and outages per uplink at 10 ms resolution.
+#
+# Needs root, iproute2 with netem, iputils ping, jq and python3. Refuses to
+# touch a box that already has an ns_vip it didn't create (a real edge).
+###############################################################################
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(dirname "$SCRIPT_DIR")"
+PROFILE_DIR="${PROFILE_DIR:-$SCRIPT_DIR/bench-profiles}"
+PATHSTEERD="${PATHSTEERD:-$REPO_DIR/src/pathsteerd/pathsteerd}"
+DEDUPE="${DEDUPE:-$REPO_DIR/src/dedupe/dedupe}"
+EMU="${EMU:-$REPO_DIR/src/pathsteerd/pathsteer-emu}"
+STATE_DIR="/run/pathsteer-bench"
+MARKER="$STATE_DIR/lab.up"
+STATUS_FILE="/run/pathsteer/status.json"
+LOG_DIR="/var/lib/pathsteer/logs"
+
+VIP="104.204.136.50"
+PROBE_TARGET="8.8.8.8"
+LAB_MAC="02:50:53:00:00:02"
+
+# Client flow: one ICMP echo every PING_INTERVAL seconds
+PING_INTERVAL="0.01"
+
+# Settle time after pathsteerd starts (baselines need a few probe rounds)
+WARMUP_SEC=15
+
+# Uplinks in the lab: name -> "subnet_index:baseline netem (one way)"
+# Subnet indices follow netns-full-init.sh (10.201.N.0/30)
+declare -A UPLINKS=(
+    ["cell_a"]="5:delay 22ms 4ms"
+    ["sl_a"]="3:delay 18ms 6ms"
+    ["fa"]="1:delay 4ms 1ms"
+)
+UPLINK_ORDER="cell_a sl_a fa"
+
+log() { echo "[$(date '+%H:%M:%S')] $*" >&2; }
+die() { log "ERROR: $*"; exit 1; }
+
+idx_of()      { echo "${UPLINKS[$1]%%:*}"; }
+baseline_of() { echo "${UPLINKS[$1]#*:}"; }
+
+###############################################################################
+# Topology
+###############################################################################
+
+ns_add() {
+    ip netns add "$1"
+    ip -n "$1" link set lo up
+    ip netns exec "$1" sysctl -qw net.ipv4.ip_forward=1
+    ip netns exec "$1" sysctl -qw net.ipv4.conf.all.rp_filter=0
+    ip netns exec "$1" sysctl -qw net.ipv4.conf.default.rp_filter=0
+}
+
+# veth pair with one end in each namespace, addressed /30
+link_add() {
+    local ns_a=$1 dev_a=$2 ip_a=$3 ns_b=$4 dev_b=$5 ip_b=$6
+    ip link add "$dev_a" netns "$ns_a" type veth peer name "$dev_b" netns "$ns_b"
+    ip -n "$ns_a" addr add "$ip_a/30" dev "$dev_a"
+    ip -n "$ns_b" addr add "$ip_b/30" dev "$dev_b"
+    ip -n "$ns_a" link set "$dev_a" up
+    ip -n "$ns_b" link set "$dev_b" up
+}
+
+# netem on both directions of an uplink's ISP link
+netem_set() {
+    local name=$1; shift
+    local ns="ns_$name"
+    ip netns exec "$ns" tc qdisc replace dev "wan_$name" root netem "$@"
+    ip netns exec ns_ctrl tc qdisc replace dev "isp_$name" root netem "$@"
+}
+
+lab_up() {
+    [[ $EUID -eq 0 ]] || die "must run as root"
+    if ip netns list | grep -qw ns_vip && [[ ! -f "$MARKER" ]]; then
+        die "ns_vip exists and is not a bench lab - refusing to run on a live edge"
+    fi
+    pgrep -x pathsteerd >/dev/null && die "pathsteerd is already running"
+    [[ -f "$MARKER" ]] && lab_down
+
+    log "Building bench lab"
+    mkdir -p "$STATE_DIR"
+    touch "$MARKER"
+
+    ns_add ns_vip
+    ns_add ns_ctrl
+    ip -n ns_vip addr add "$VIP/32" dev lo
+    ip -n ns_ctrl addr add "$PROBE_TARGET/32" dev lo
+    ip -n ns_ctrl addr add 10.200.1.1/32 dev lo
+
+    # Daemon's dup_init() shapes br-lan; give it one to shape
+    ip -n ns_vip link add br-lan type bridge
+    ip -n ns_vip link set br-lan up
+
+    for name in $UPLINK_ORDER; do
+        local n; n=$(idx_of "$name")
+        local ns="ns_$name"
+        ns_add "$ns"
+
+        # ns_vip <-> path namespace (pathsteerd mirrors between these)
+        link_add ns_vip "veth_$name" "10.201.$n.1" "$ns" "veth_${name}_i" "10.201.$n.2"
+        ip -n "$ns" link set "veth_${name}_i" address "$LAB_MAC"
+        ip netns exec ns_vip tc qdisc add dev "veth_$name" root handle 1: prio
+
+        # Path namespace <-> controller: the ISP
+        link_add "$ns" "wan_$name" "10.202.$n.2" ns_ctrl "isp_$name" "10.202.$n.1"
+        ip -n "$ns" route add default via "10.202.$n.1" dev "wan_$name"
+        ip -n "$ns" route add "$VIP/32" via "10.201.$n.1" dev "veth_${name}_i"
+        netem_set "$name" $(baseline_of "$name")
+    done
+
+    # LTE probes go "ping -I wg-ca-cA 10.200.1.1" (uplink_poll)
+    link_add ns_vip wg-ca-cA 10.200.1.6 ns_cell_a wg-ca-cA_i 10.200.1.5
+    ip -n ns_vip route add 10.200.1.1/32 via 10.200.1.5 dev wg-ca-cA
+    ip -n ns_ctrl route add 10.200.1.4/30 via 10.202.5.2 dev isp_cell_a
+
+    # Start on cell_a, like pathsteerd
+    route_to cell_a
+
+    if [[ -x "$DEDUPE" ]]; then
+        ip netns exec ns_ctrl "$DEDUPE" >"$STATE_DIR/dedupe.log" 2>&1 &
+        echo $! >"$STATE_DIR/dedupe.pid"
+    else
+        log "WARNING: $DEDUPE not built, controller runs without dedupe"
+    fi
+    log "Lab up: ns_vip ns_ctrl $(for n in $UPLINK_ORDER; do echo -n "ns_$n "; done)"
+}
+
+lab_down() {
+    [[ -f "$MARKER" ]] || { log "No bench lab"; return 0; }
+    for pidfile in "$STATE_DIR"/*.pid; do
+        [[ -f "$pidfile" ]] || continue
+        kill "$(cat "$pidfile")" 2>/dev/null || true
+        rm -f "$pidfile"
+    done
+    for ns in ns_vip ns_ctrl $(for n in $UPLINK_ORDER; do echo "ns_$n"; done); do
+        ip netns del "$ns" 2>/dev/null || true
+    done
+    rm -f "$MARKER"
+    log "Lab down"
+}
+
+# Point the client and the controller return route at one uplink
+route_to() {
+    local name=$1
+    local n; n=$(idx_of "$name")
+    ip -n ns_vip route replace default via "10.201.$n.2" dev "veth_$name"
+    ip -n ns_ctrl route replace "$VIP/32" via "10.202.$n.2" dev "isp_$name"
+}
+
+###############################################################################
+# Run
+###############################################################################
+
+# Stand-in for the production route switch: follow status.json
+route_follower() {
+    local events=$1
+    local current="cell_a"
+    while true; do
+        local active
+        active=$(jq -r '.active_uplink // empty' "$STATUS_FILE" 2>/dev/null || true)
+        if [[ -n "$active" && "$active" != "$current" && -n "${UPLINKS[$active]:-}" ]]; then
+            route_to "$active"
+            echo "$(date +%s.%N) switch $active" >>"$events"
+            current=$active
+        fi
+        sleep 0.05
+    done
+}
+
+write_config() {
+    local out=$1
+    cat >"$out" <<EOF
+{
+  "id": "bench-lab",
+  "mode": "tripwire",
+  "uplinks": [
+    {"name": "cell_a", "type": "lte", "enabled": true},
+    {"name": "cell_b", "type": "lte", "enabled": false},
+    {"name": "sl_a", "type": "starlink", "enabled": true},
+    {"name": "sl_b", "type": "starlink", "enabled": false},
+    {"name": "fa", "type": "fiber", "enabled": true},
+    {"name": "fb", "type": "fiber", "enabled": false}
+  ],
+  "gps_enabled": false,
+  "pcap_enabled": false,
+  "sample_rate_hz": 10,
+  "trace_log": true,
+  "training_db": "$STATE_DIR/training.db",
+  "routes_file": "$STATE_DIR/routes.bin",
+  "model_file": "$STATE_DIR/risk_model.txt"
+}
+EOF
+}
+
+# Profile lines: "<sec> <uplink> <netem args | base | down>" or "<sec> end"
+profile_duration() {
+    awk '!/^#/ && $2 == "end" { print $1 }' "$1"
+}
+
+play_profile() {
+    local profile=$1 events=$2 t0=$3
+    while read -r at name args; do
+        [[ -z "$at" || "$at" == \#* ]] && continue
+        [[ "$name" == "end" ]] && break
+        local wait
+        wait=$(awk -v t0="$t0" -v at="$at" -v now="$(date +%s.%N)" 'BEGIN { d = t0 + at - now; print (d > 0 ? d : 0) }')
+        sleep "$wait"
+        case "$args" in
+            base) args=$(baseline_of "$name") ;;
+            down) args="$(baseline_of "$name") loss 100%" ;;
+        esac
+        # shellcheck disable=SC2086
+        netem_set "$name" $args
+        echo "$(date +%s.%N) impair $name $args" >>"$events"
+    done <"$profile"
+}
+
+# Recorded drive through pathsteer-emu; its outages become impair events
+play_trace() {
+    local trace=$1 events=$2 t0=$3 dir=$4
+    "$EMU" --verbose "$trace" >"$dir/emu.jsonl" || log "WARNING: pathsteer-emu failed, see $dir/emu.jsonl"
+    jq -r 'select(.event == "netem") | "\(.data.t) \(.data.uplink) \(.data.loss_pct)"' "$dir/emu.jsonl" |
+        awk -v t0="$t0" '$3 >= 100 && !down[$2] { printf "%.6f impair %s trace-outage\n", t0 + $1, $2; down[$2] = 1 }
+                         $3 < 100 { down[$2] = 0 }' >>"$events"
+}
+
+run_profile() {
+    local profile=$1 out=$2 config=$3
+    local pname duration
+    if [[ "$profile" == *.jsonl ]]; then
+        [[ -x "$EMU" ]] || die "$EMU not built (make -C src/pathsteerd)"
+        pname=$(basename "$profile" .jsonl)
+        duration=$("$EMU" --length "$profile") || die "Cannot read trace $profile"
+    else
+        pname=$(basename "$profile" .prof)
+        duration=$(profile_duration "$profile")
+        [[ -n "$duration" ]] || die "$profile has no end line"
+    fi
+    local dir="$out/$pname"
+    mkdir -p "$dir"
+    : >"$dir/events.txt"
+
+    lab_up
+    log "[$pname] pathsteerd warmup ${WARMUP_SEC}s"
+    local before; before=$(ls -t "$LOG_DIR"/pathsteer_*.jsonl 2>/dev/null | head -1 || true)
+    ip netns exec ns_vip "$PATHSTEERD" --config "$config" >"$dir/pathsteerd.out" 2>&1 &
+    local daemon=$!
+    echo "$daemon" >"$STATE_DIR/pathsteerd.pid"
+    sleep "$WARMUP_SEC"
+    kill -0 "$daemon" 2>/dev/null || die "pathsteerd exited, see $dir/pathsteerd.out"
+
+    route_follower "$dir/events.txt" &
+    echo $! >"$STATE_DIR/follower.pid"
+
+    log "[$pname] running ${duration}s"
+    local count; count=$(awk -v d="$duration" -v i="$PING_INTERVAL" 'BEGIN { printf "%d", d / i }')
+    local t0; t0=$(date +%s.%N)
+    echo "$t0 start" >>"$dir/events.txt"
+    ip netns exec ns_vip ping -I "$VIP" -i "$PING_INTERVAL" -c "$count" -D -O -W 1 "$PROBE_TARGET" \
+        >"$dir/ping.txt" 2>&1 &
+    local pinger=$!
+    if [[ "$profile" == *.jsonl ]]; then
+        play_trace "$profile" "$dir/events.txt" "$t0" "$dir"
+    else
+        play_profile "$profile" "$dir/events.txt" "$t0"
+    fi
+    wait "$pinger" || true
+
+    kill "$daemon" 2>/dev/null || true
+    wait "$daemon" 2>/dev/null || true
+    local logfile; logfile=$(ls -t "$LOG_DIR"/pathsteer_*.jsonl 2>/dev/null | head -1 || true)
+    [[ -n "$logfile" && "$logfile" != "$before" ]] && cp "$logfile" "$dir/pathsteerd.jsonl"
+    lab_down
+
+    python3 "$SCRIPT_DIR/bench-report.py" --profile "$pname" --interval "$PING_INTERVAL" \
+        --events "$dir/events.txt" --ping "$dir/ping.txt" --log "$dir/pathsteerd.jsonl" \
+        | tee -a "$out/results.jsonl"
+}
+
+cmd_run() {
+    local out config=""
+    out="/var/lib/pathsteer/bench/$(date +%Y%m%d_%H%M%S)"
+    local profiles=()
+    while [[ $# -gt 0 ]]; do
+        case "$1" in
+            --out) out=$2; shift 2 ;;
+            --config) config=$2; shift 2 ;;
+            *) profiles+=("$1"); shift ;;
+        esac
+    done
+    if [[ ${#profiles[@]} -eq 0 ]]; then
+        profiles=("$PROFILE_DIR"/*.prof)
+    fi
+
+    [[ -x "$PATHSTEERD" ]] || die "$PATHSTEERD not built (make -C src/pathsteerd)"
+    for tool in ip tc ping jq python3; do
+        command -v "$tool" >/dev/null || die "$tool not found"
+    done
+
+    mkdir -p "$out"
+    if [[ -z "$config" ]]; then
+        config="$out/config.json"
+        write_config "$config"
+    fi
+    trap lab_down EXIT
+
+    for p in "${profiles[@]}"; do
+        [[ -f "$p" ]] || p="$PROFILE_DIR/$p.prof"
+        [[ -f "$p" ]] || die "No profile $p"
+        run_profile "$p" "$out" "$config"
+    done
+    log "Results: $out/results.jsonl"
+}
+
+case "${1:-}" in
+    up)   lab_up ;;
+    down) lab_down ;;
+    list)
+        for p in "$PROFILE_DIR"/*.prof; do
+            printf "%-16s %s\n" "$(basename "$p" .prof)" "$(sed -n 's/^# *//p' "$p" | head -1)"
+        done
+        ;;
+    run)  shift; cmd_run "$@" ;;
+    *)
+        echo "Usage: $0 {up|down|list|run [--out DIR] [--config FILE] [profile | trace.jsonl ...]}"
+        exit 1
+        ;;
+esac
@@ -0,0 +1,107 @@
+#!/bin/bash
+###############################################################################
+# bench-micro.sh - PathSteer Guardian Decision Core Microbenchmarks
+#
+# Runs pathsteer-bench (tripwire_check, select_best, prediction_tick,
+# protection_tick, status.json rendering, config parsing over synthetic
+# uplink state) with the CPU frequency held still:
+#
+#   - the benchmark CPU's governor is set to performance
+#   - turbo / boost is switched off (intel_pstate no_turbo or cpufreq boost)
+#
+# and both are put back on exit. Results are JSONL (one meta line, one line
+# per benchmark with the median, MAD, percentiles and every sample); with
+# --baseline the run is compared against an earlier one by
+# bench-compare.py, which exits non-zero on a significant regression.
+#
+# Usage:
+#   bench-micro.sh [--out FILE] [--cpu N] [--reps N] [--sample-ms MS]
+#                  [--filter NAME] [--baseline FILE] [--threshold PCT]
+#
+# Without root the frequency is left alone and pathsteer-bench warns about
+# it; numbers from such a run are only good for a rough look.
+###############################################################################
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_DIR="$(dirname "$SCRIPT_DIR")"
+MICROBENCH="${MICROBENCH:-$REPO_DIR/src/pathsteerd/pathsteer-bench}"
+
+log() { echo "[$(date '+%H:%M:%S')] $*" >&2; }
+die() { log "ERROR: $*"; exit 1; }
+
+SAVED_GOVERNOR=""
+SAVED_NO_TURBO=""
+SAVED_BOOST=""
+GOVERNOR_FILE=""
+
+###############################################################################
+# CPU frequency
+###############################################################################
+
+freq_pin() {
+    local cpu=$1
+    [[ $EUID -eq 0 ]] || { log "WARNING: not root, CPU frequency not pinned"; return 0; }
+
+    GOVERNOR_FILE="/sys/devices/system/cpu/cpu$cpu/cpufreq/scaling_governor"
+    if [[ -w "$GOVERNOR_FILE" ]]; then
+        SAVED_GOVERNOR=$(cat "$GOVERNOR_FILE")
+        echo performance >"$GOVERNOR_FILE" || log "WARNING: cannot set performance governor"
+    else
+        log "WARNING: no cpufreq governor for cpu$cpu"
+    fi
+
+    if [[ -w /sys/devices/system/cpu/intel_pstate/no_turbo ]]; then
+        SAVED_NO_TURBO=$(cat /sys/devices/system/cpu/intel_pstate/no_turbo)
+        echo 1 >/sys/devices/system/cpu/intel_pstate/no_turbo || true
+    elif [[ -w /sys/devices/system/cpu/cpufreq/boost ]]; then
+        SAVED_BOOST=$(cat /sys/devices/system/cpu/cpufreq/boost)
+        echo 0 >/sys/devices/system/cpu/cpufreq/boost || true
+    fi
+}
+
+freq_restore() {
+    [[ -n "$SAVED_GOVERNOR" ]] && echo "$SAVED_GOVERNOR" >"$GOVERNOR_FILE" 2>/dev/null || true
+    [[ -n "$SAVED_NO_TURBO" ]] && echo "$SAVED_NO_TURBO" >/sys/devices/system/cpu/intel_pstate/no_turbo 2>/dev/null || true
+    [[ -n "$SAVED_BOOST" ]] && echo "$SAVED_BOOST" >/sys/devices/system/cpu/cpufreq/boost 2>/dev/null || true
+}
+
+###############################################################################
+# Main
+###############################################################################
+
+out="/var/lib/pathsteer/bench/micro_$(date +%Y%m%d_%H%M%S).jsonl"
+cpu=$(( $(nproc) - 1 ))
+baseline=""
+threshold=5
+args=()
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --out) out=$2; shift 2 ;;
+        --cpu) cpu=$2; shift 2 ;;
+        --reps|--sample-ms|--filter) args+=("$1" "$2"); shift 2 ;;
+        --baseline) baseline=$2; shift 2 ;;
+        --threshold) threshold=$2; shift 2 ;;
+        *)
+            echo "Usage: $0 [--out FILE] [--cpu N] [--reps N] [--sample-ms MS] [--filter NAME] [--baseline FILE] [--threshold PCT]"
+            exit 1
+            ;;
+    esac
+done
+
+[[ -x "$MICROBENCH" ]] || die "$MICROBENCH not built (make -C src/pathsteerd)"
+[[ -z "$baseline" || -f "$baseline" ]] || die "baseline $baseline not found"
+
+label=$(git -C "$REPO_DIR" describe --always --dirty 2>/dev/null || echo unknown)
+mkdir -p "$(dirname "$out")"
+
+trap freq_restore EXIT
+freq_pin "$cpu"
+
+log "Microbenchmarks on cpu$cpu ($label)"
+"$MICROBENCH" --cpu "$cpu" --label "$label" --out "$out" ${args[@]+"${args[@]}"}
+log "Results: $out"
+
+if [[ -n "$baseline" ]]; then
+    "$SCRIPT_DIR/bench-compare.py" --threshold "$threshold" "$baseline" "$out"
+fi
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+PathSteer Failover Bench Report
+Turns one bench-lab.sh profile run into a JSON result line:
+- ping.txt:  client flow through the VIP (ping -D -O), one echo per interval
+- events.txt: lab timeline ("<epoch> start|impair <uplink> ...|switch <uplink>")
+- pathsteerd.jsonl: the daemon's event log for the run
+
+Reports end-to-end loss and duplicates, the longest outage the client saw,
+and from the first impairment: time to tripwire_fire, tripwire -> duplication
+latency (as measured by pathsteerd around tc) and time to the route switch.
+
+Usage: bench-report.py --profile NAME --interval SEC --ping F --events F [--log F]
+"""
+import argparse
+import json
+import os
+import re
+import sys
+import time
+
+PING_REPLY = re.compile(r'^\[(\d+\.\d+)\].*icmp_seq=(\d+).*time=([\d.]+) ms(.*)$')
+PING_NOANSWER = re.compile(r'^\[(\d+\.\d+)\] no answer yet for icmp_seq=(\d+)')
+
+
+def parse_ping(path):
+    replies = {}        # seq -> rtt ms (first copy)
+    dups = 0
+    max_seq = 0
+    with open(path) as f:
+        for line in f:
+            m = PING_REPLY.match(line)
+            if m:
+                seq = int(m.group(2))
+                max_seq = max(max_seq, seq)
+                if 'DUP!' in m.group(4) or seq in replies:
+                    dups += 1
+                else:
+                    replies[seq] = float(m.group(3))
+                continue
+            m = PING_NOANSWER.match(line)
+            if m:
+                max_seq = max(max_seq, int(m.group(2)))
+    return replies, dups, max_seq
+
+
+def parse_events(path):
+    events = []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) >= 2:
+                events.append((float(parts[0]), parts[1], parts[2:]))
+    return events
+
+
+def log_time(ts):
+    # pathsteerd logs local time with milliseconds: 2025-01-01T12:00:00.123
+    base, _, ms = ts.partition('.')
+    return time.mktime(time.strptime(base, '%Y-%m-%dT%H:%M:%S')) + int(ms or 0) / 1000.0
+
+
+def parse_log(path):
+    out = []
+    if not path or not os.path.exists(path):
+        return out
+    with open(path) as f:
+        for line in f:
+            try:
+                rec = json.loads(line)
+                out.append((log_time(rec['ts']), rec['event'], rec.get('data')))
+            except (ValueError, KeyError):
+                continue
+    return out
+
+
+def longest_gap(replies, max_seq):
+    longest = run = 0
+    for seq in range(1, max_seq + 1):
+        if seq in replies:
+            run = 0
+        else:
+            run += 1
+            longest = max(longest, run)
+    return longest
+
+
+def ms_after(t0, t):
+    return round((t - t0) * 1000.0, 1) if t is not None and t0 is not None else None
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('--profile', required=True)
+    ap.add_argument('--interval', type=float, default=0.01)
+    ap.add_argument('--ping', required=True)
+    ap.add_argument('--events', required=True)
+    ap.add_argument('--log')
+    args = ap.parse_args()
+
+    replies, dups, max_seq = parse_ping(args.ping)
+    events = parse_events(args.events)
+    log = parse_log(args.log)
+
+    # Everything is timed from the first impairment of the profile
+    impair = next((t for t, kind, rest in events if kind == 'impair'), None)
+    switch = next((t for t, kind, rest in events if kind == 'switch' and impair and t >= impair), None)
+
+    fire = next(((t, d) for t, ev, d in log if ev == 'tripwire_fire' and impair and t >= impair - 0.001),
+                (None, None))
+    dup = next(((t, d) for t, ev, d in log if ev == 'dup_enable' and fire[0] and t >= fire[0] - 0.001),
+               (None, None))
+
+    lost = max_seq - len(replies)
+    rtts = sorted(replies.values())
+    result = {
+        'profile': args.profile,
+        'sent': max_seq,
+        'received': len(replies),
+        'lost': lost,
+        'loss_pct': round(100.0 * lost / max_seq, 3) if max_seq else None,
+        'duplicates': dups,
+        'outage_ms': round(longest_gap(replies, max_seq) * args.interval * 1000.0, 1),
+        'lost_ms': round(lost * args.interval * 1000.0, 1),
+        'rtt_p50_ms': rtts[len(rtts) // 2] if rtts else None,
+        'rtt_p99_ms': rtts[min(len(rtts) - 1, int(len(rtts) * 0.99))] if rtts else None,
+        'detect_ms': ms_after(impair, fire[0]),
+        'trigger': fire[1].get('trigger') if fire[1] else None,
+        'tripwire_dup_us': fire[1].get('latency_us') if fire[1] else None,
+        'tc_mirred_us': dup[1].get('latency_us') if dup[1] else None,
+        'switch_ms': ms_after(impair, switch),
+        'fires': sum(1 for _, ev, _ in log if ev == 'tripwire_fire'),
+        'switches': sum(1 for _, kind, _ in events if kind == 'switch'),
+    }
+    if not log:
+        print(f'{args.profile}: no pathsteerd log, detection metrics missing', file=sys.stderr)
+    print(json.dumps(result))
+
+
+if __name__ == '__main__':
+    main()
@@ -4,7 +4,12 @@
 #
 # Usage:
 #   cellular-monitor.sh poll <dev_num> <name>
+#   cellular-monitor.sh cell <dev_num>
 #   cellular-monitor.sh status
+#
+# cell: serving/neighbour LTE cells, normalized for pathsteerd (handover.h):
+#   neighbor pci=<pci> earfcn=<earfcn> rsrp=<dBm>     (one per cell)
+#   serving cell_id=<id> tac=<tac> earfcn=<earfcn> band=<n> pci=<pci>
 ###############################################################################
 
 CMD="${1:-status}"
@@ -23,10 +28,44 @@ poll_signal() {
     qmicli -d "$cdc" --nas-get-signal-strength 2>/dev/null
 }
 
+poll_cells() {
+    local cdc="/dev/cdc-wdm${DEV_NUM}"
+    
+    if [[ ! -c "$cdc" ]]; then
+        echo "Device not found: $cdc"
+        return 1
+    fi
+    
+    # Cell location info lists the serving cell and measured neighbours
+    qmicli -d "$cdc" --nas-get-cell-location-info 2>/dev/null | awk -F"'" '
+        /^Intrafrequency LTE Info/ { sec = "intra"; next }
+        /^Interfrequency LTE Info/ { sec = "inter"; next }
+        /^[^ \t]/                  { sec = ""; next }
+        sec == ""                  { next }
+        /Tracking Area Code:/      { tac = $2 }
+        /Global Cell ID:/          { gcid = $2 }
+        /Serving Cell ID:/         { spci = $2 }
+        /EUTRA Absolute RF Channel Number:/ {
+            earfcn = $2
+            band = ""
+            if (match($3, /band [0-9]+/)) band = substr($3, RSTART + 5, RLENGTH - 5)
+            if (sec == "intra") { s_earfcn = earfcn; s_band = band }
+        }
+        /Physical Cell ID:/        { pci = $2 }
+        /RSRP:/                    { printf "neighbor pci=%s earfcn=%s rsrp=%s\n", pci, earfcn, $2 }
+        END {
+            if (gcid != "")
+                printf "serving cell_id=%s tac=%s earfcn=%s band=%s pci=%s\n", gcid, tac, s_earfcn, s_band, spci
+        }'
+}
+
 case "$CMD" in
     poll)
         poll_signal
         ;;
+    cell)
+        poll_cells
+        ;;
     status)
         echo "Cellular Monitor"
         for i in 0 1; do
@@ -36,7 +75,7 @@ case "$CMD" in
         done
         ;;
     *)
-        echo "Usage: $0 {poll <dev_num> <name>|status}"
+        echo "Usage: $0 {poll <dev_num> <name>|cell <dev_num>|status}"
         exit 1
         ;;
 esac
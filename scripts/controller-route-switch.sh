@@ -6,6 +6,9 @@
 # at the controller. This ensures return traffic flows through the same
 # uplink as outbound traffic.
 #
+# pathsteerd normally does this in-band (retpath, served by dedupe) and
+# only runs this script when the controller didn't ack within 5 s.
+#
 # Usage: controller-route-switch.sh <uplink_name>
 ###############################################################################
 
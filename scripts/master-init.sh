@@ -439,6 +439,12 @@ iptables -t mangle -A FORWARD -i br-client -p tcp --tcp-flags SYN,RST SYN -j TCP
 ip netns exec ns_vip iptables -t mangle -D FORWARD -p tcp --tcp-flags SYN,RST SYN -j TCPMSS --clamp-mss-to-pmtu 2>/dev/null || true
 ip netns exec ns_vip iptables -t mangle -A FORWARD -p tcp --tcp-flags SYN,RST SYN -j TCPMSS --clamp-mss-to-pmtu
 
+# Connection tracking with byte/packet counters in ns_vip for pathsteerd's
+# flow monitor (flows.json); the kernel only tracks when a rule uses it
+ip netns exec ns_vip sysctl -qw net.netfilter.nf_conntrack_acct=1 2>/dev/null || true
+ip netns exec ns_vip iptables -t mangle -D FORWARD -m conntrack --ctstate NEW 2>/dev/null || true
+ip netns exec ns_vip iptables -t mangle -A FORWARD -m conntrack --ctstate NEW
+
 # vip_wifi MTU
 ip link set vip_wifi mtu 1380 2>/dev/null || true
 ip netns exec ns_vip ip link set vip_wifi_i mtu 1380 2>/dev/null || true
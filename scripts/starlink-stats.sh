@@ -2,11 +2,46 @@
 ###############################################################################
 # starlink-stats.sh - Poll Starlink dish metrics via gRPC
 #
-# Usage: starlink-stats.sh <namespace> <dish_ip>
+# Usage: starlink-stats.sh <namespace> <dish_ip> [status|map]
+#
+# map: obstruction map reduced to 12 azimuth sectors (30 deg each, sector 0
+#      at the top of the map, clockwise) as obstructed fractions 0..1.
+#      sky_frame is "earth" (top = north) or "dish" (top = dish forward).
 ###############################################################################
 
 NS="${1:-ns_sl_a}"
 DISH_IP="${2:-192.168.100.1}"
+MODE="${3:-status}"
+
+if [[ "$MODE" == "map" ]]; then
+    command -v grpcurl &>/dev/null || { echo '{"error": "no_grpcurl"}'; exit 0; }
+    ip netns exec "$NS" timeout 3 grpcurl -plaintext -d '{"dish_get_obstruction_map":{}}' \
+        "${DISH_IP}:9200" SpaceX.API.Device.Device/Handle 2>/dev/null | python3 -c '
+import sys, json, math
+try:
+    m = json.load(sys.stdin)["dishGetObstructionMap"]
+    rows, cols, snr = m["numRows"], m["numCols"], m["snr"]
+    cy, cx = (rows - 1) / 2.0, (cols - 1) / 2.0
+    known = [0] * 12
+    blocked = [0] * 12
+    for r in range(rows):
+        for c in range(cols):
+            v = snr[r * cols + c]
+            if v < 0:
+                continue            # never looked there
+            az = math.degrees(math.atan2(c - cx, cy - r)) % 360.0
+            s = int(az // 30) % 12
+            known[s] += 1
+            if v < 0.9:
+                blocked[s] += 1
+    frame = "earth" if m.get("mapReferenceFrame", "FRAME_EARTH") == "FRAME_EARTH" else "dish"
+    sky = [round(blocked[s] / known[s], 3) if known[s] else 0 for s in range(12)]
+    print(json.dumps({"sky_frame": frame, "sky": sky}))
+except Exception:
+    print("{\"error\": \"parse_failed\"}")
+' 2>/dev/null || echo '{"error": "dish_unreachable"}'
+    exit 0
+fi
 
 # Try to get stats from dish via gRPC (using grpcurl if available)
 if command -v grpcurl &>/dev/null; then
@@ -25,6 +60,7 @@ try:
         "downlink_bps": dish.get("downlinkThroughputBps", 0),
         "uplink_bps": dish.get("uplinkThroughputBps", 0),
         "obstruction": dish.get("obstructionStats", {}).get("fractionObstructed", 0),
+        "currently_obstructed": dish.get("obstructionStats", {}).get("currentlyObstructed", False),
         "snr_ok": dish.get("state", "") == "CONNECTED"
     }))
 except:
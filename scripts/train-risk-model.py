@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+PathSteer Risk Model Trainer
+Fits the pathsteerd risk model offline from labelled samples:
+- Reads model_samples (written by pathsteerd, one row per labelled snapshot)
+- Weighted logistic regression, batch gradient descent with L2
+- Writes the text model file pathsteerd hot-swaps within a few seconds
+
+Usage: train-risk-model.py [--db PATH] [--out PATH] [--days N] [--epochs N]
+"""
+import argparse
+import math
+import os
+import sqlite3
+import sys
+import time
+
+DB_PATH = '/opt/pathsteer/data/training.db'
+MODEL_FILE = '/var/lib/pathsteer/risk_model.txt'
+
+# Must match model_feature_t / MODEL_FEATURE_NAMES in src/pathsteerd/model.h
+FEATURES = ['bias', 'rtt_ratio', 'jitter', 'loss', 'consec_fail',
+            'rsrp', 'rsrp_trend', 'sinr', 'sinr_trend', 'sl_obstr',
+            'speed', 'loc_risk']
+
+
+def load_samples(db_path, days):
+    db = sqlite3.connect(db_path)
+    cols = [r[1] for r in db.execute('PRAGMA table_info(model_samples)')]
+    if not cols:
+        sys.exit(f'no model_samples table in {db_path}')
+
+    # Columns missing from an older table read as 0
+    select = ', '.join(f if f in cols else '0' for f in FEATURES)
+    since = int(time.time()) - days * 86400 if days > 0 else 0
+    rows = db.execute(f'SELECT label, weight, {select} FROM model_samples WHERE ts >= ?',
+                      (since,)).fetchall()
+    db.close()
+
+    X, y, w = [], [], []
+    for r in rows:
+        y.append(float(r[0]))
+        w.append(float(r[1] or 1.0))
+        X.append([float(v or 0.0) for v in r[2:]])
+    return X, y, w
+
+
+def sigmoid(z):
+    if z < -30:
+        return 0.0
+    if z > 30:
+        return 1.0
+    return 1.0 / (1.0 + math.exp(-z))
+
+
+def train(X, y, w, epochs, lr, l2):
+    nf = len(FEATURES)
+    weights = [0.0] * nf
+    total_w = sum(w)
+
+    # Start from the base rate so early epochs aren't spent on the bias
+    pos = sum(wi for yi, wi in zip(y, w) if yi > 0)
+    rate = min(max(pos / total_w, 1e-4), 1 - 1e-4)
+    weights[0] = math.log(rate / (1 - rate))
+
+    for epoch in range(epochs):
+        grad = [0.0] * nf
+        loss = 0.0
+        for xi, yi, wi in zip(X, y, w):
+            z = sum(a * b for a, b in zip(weights, xi))
+            p = sigmoid(z)
+            g = (p - yi) * wi
+            for f in range(nf):
+                grad[f] += g * xi[f]
+            p = min(max(p, 1e-7), 1 - 1e-7)
+            loss -= wi * (yi * math.log(p) + (1 - yi) * math.log(1 - p))
+
+        for f in range(nf):
+            decay = 0.0 if f == 0 else l2 * weights[f]
+            weights[f] -= lr * (grad[f] / total_w + decay)
+
+        if epoch % 100 == 0 or epoch == epochs - 1:
+            print(f'epoch {epoch:5d}  loss {loss / total_w:.5f}')
+
+    return weights
+
+
+def write_model(path, weights, n, online_lr, l2):
+    tmp = path + '.tmp'
+    with open(tmp, 'w') as f:
+        f.write(f'# pathsteer risk model (train-risk-model.py, {n} samples, '
+                f'{time.strftime("%Y-%m-%dT%H:%M:%S")})\n')
+        f.write('features ' + ' '.join(FEATURES) + '\n')
+        f.write('weights ' + ' '.join(f'{v:.6g}' for v in weights) + '\n')
+        f.write(f'lr {online_lr:.6g}\n')
+        f.write(f'l2 {l2:.6g}\n')
+    os.rename(tmp, path)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Train the pathsteerd risk model')
+    ap.add_argument('--db', default=DB_PATH)
+    ap.add_argument('--out', default=MODEL_FILE)
+    ap.add_argument('--days', type=int, default=30, help='only samples from the last N days (0 = all)')
+    ap.add_argument('--epochs', type=int, default=1000)
+    ap.add_argument('--lr', type=float, default=0.5, help='batch learning rate')
+    ap.add_argument('--l2', type=float, default=1e-4)
+    ap.add_argument('--online-lr', type=float, default=0.005, help='SGD rate pathsteerd uses after loading')
+    args = ap.parse_args()
+
+    X, y, w = load_samples(args.db, args.days)
+    positives = sum(1 for v in y if v > 0)
+    print(f'{len(X)} samples, {positives} positive')
+    if positives == 0 or positives == len(X):
+        sys.exit('need both positive and negative samples')
+
+    weights = train(X, y, w, args.epochs, args.lr, args.l2)
+    for name, v in zip(FEATURES, weights):
+        print(f'  {name:12s} {v:+.4f}')
+
+    write_model(args.out, weights, len(X), args.online_lr, args.l2)
+    print(f'wrote {args.out}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * metrics.c - PathSteer Prometheus / OpenMetrics Exporter
+ *
+ * See metrics.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "metrics.h"
+
+#define METRICS_CONTENT_TYPE    "text/plain; version=0.0.4; charset=utf-8"
+
+void metrics_init(metrics_t* m) {
+    memset(m, 0, sizeof(*m));
+    atomic_store(&m->pub, -1);
+    m->cur = -1;
+    m->fd = -1;
+}
+
+/*=============================================================================
+ * Rendering (daemon's thread)
+ *===========================================================================*/
+
+void metrics_begin(metrics_t* m) {
+    int pub = atomic_load(&m->pub);
+    m->cur = -1;
+    m->truncated = false;
+    for (int i = 0; i < METRICS_BUFS; i++) {
+        if (i != pub && atomic_load(&m->readers[i]) == 0) {
+            m->cur = i;
+            m->len[i] = 0;
+            return;
+        }
+    }
+}
+
+void metrics_printf(metrics_t* m, const char* fmt, ...) {
+    if (m->cur < 0 || m->truncated) return;
+    size_t* len = &m->len[m->cur];
+    size_t room = METRICS_BUF_SIZE - *len;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(m->data[m->cur] + *len, room, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= room) {
+        m->truncated = true;        /* Published up to the last whole line */
+        return;
+    }
+    *len += n;
+}
+
+void metrics_type(metrics_t* m, const char* name, const char* type, const char* help) {
+    metrics_printf(m, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_publish(metrics_t* m) {
+    if (m->cur < 0) return;
+    if (m->truncated) {
+        char* buf = m->data[m->cur];
+        size_t len = m->len[m->cur];
+        while (len > 0 && buf[len - 1] != '\n') len--;
+        m->len[m->cur] = len;
+    }
+    atomic_store(&m->pub, m->cur);
+    m->cur = -1;
+}
+
+/*=============================================================================
+ * Serving (server thread)
+ *===========================================================================*/
+
+static int send_all(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Take a reference on the published buffer, -1 if nothing rendered yet */
+static int acquire(metrics_t* m) {
+    for (;;) {
+        int pub = atomic_load(&m->pub);
+        if (pub < 0) return -1;
+        atomic_fetch_add(&m->readers[pub], 1);
+        if (atomic_load(&m->pub) == pub) return pub;
+        atomic_fetch_sub(&m->readers[pub], 1);
+    }
+}
+
+static void serve(metrics_t* m, int fd) {
+    struct timeval tv = { METRICS_IO_TIMEOUT_MS / 1000, (METRICS_IO_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    /* Request line and headers; only the request line matters */
+    char req[1024];
+    size_t got = 0;
+    while (got < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+        if (n <= 0) break;
+        got += (size_t)n;
+        req[got] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+    req[got] = '\0';
+
+    char hdr[256];
+    int buf = -1;
+    if (strncmp(req, "GET /metrics", 12) != 0 || (req[12] != ' ' && req[12] != '?')) {
+        static const char not_found[] =
+            "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n"
+            "Connection: close\r\n\r\nnot found\n";
+        send_all(fd, not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    buf = acquire(m);
+    size_t len = buf >= 0 ? m->len[buf] : 0;
+    int n = snprintf(hdr, sizeof(hdr),
+                     "HTTP/1.0 200 OK\r\nContent-Type: " METRICS_CONTENT_TYPE "\r\n"
+                     "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+    if (send_all(fd, hdr, (size_t)n) == 0 && len > 0) send_all(fd, m->data[buf], len);
+    if (buf >= 0) atomic_fetch_sub(&m->readers[buf], 1);
+    atomic_fetch_add(&m->scrapes, 1);
+}
+
+static void* server_thread(void* arg) {
+    metrics_t* m = arg;
+    while (atomic_load(&m->running)) {
+        int fd = accept(m->fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;                  /* Listening socket shut down */
+        }
+        serve(m, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+int metrics_start(metrics_t* m, const char* listen_addr) {
+    char host[64];
+    const char* colon = strrchr(listen_addr, ':');
+    if (!colon || colon == listen_addr || (size_t)(colon - listen_addr) >= sizeof(host)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, listen_addr, colon - listen_addr);
+    host[colon - listen_addr] = '\0';
+
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons((uint16_t)atoi(colon + 1)) };
+    if (inet_pton(AF_INET, host, &sa.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 || listen(fd, 8) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    m->fd = fd;
+    atomic_store(&m->running, true);
+    int rc = pthread_create(&m->thread, NULL, server_thread, m);
+    if (rc != 0) {
+        close(fd);
+        m->fd = -1;
+        atomic_store(&m->running, false);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_stop(metrics_t* m) {
+    if (m->fd < 0) return;
+    atomic_store(&m->running, false);
+    shutdown(m->fd, SHUT_RDWR);     /* Wakes accept() */
+    pthread_join(m->thread, NULL);
+    close(m->fd);
+    m->fd = -1;
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * metrics.h - PathSteer Prometheus / OpenMetrics Exporter
+ *
+ * PURPOSE:
+ *   Embedded "GET /metrics" endpoint for pathsteerd and dedupe, in the
+ *   Prometheus text format. The daemon renders its metrics into a static
+ *   buffer from its own loop (metrics_begin / metrics_printf /
+ *   metrics_publish, about once a second); a server thread only ever copies
+ *   the last published buffer to the socket. Scrapes never take a daemon
+ *   lock, never allocate and never wait on the fast path.
+ *
+ * BUFFERS:
+ *   METRICS_BUFS static buffers: one published, one possibly still being
+ *   sent to a scraper, one free to render into. A buffer is reused only
+ *   when it is neither published nor being read.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_METRICS_H
+#define PATHSTEER_METRICS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define METRICS_BUFS            3
+#define METRICS_BUF_SIZE        65536
+
+/* Per-connection socket timeout: a stuck scraper can't hold the server */
+#define METRICS_IO_TIMEOUT_MS   1000
+
+typedef struct {
+    char            data[METRICS_BUFS][METRICS_BUF_SIZE];
+    size_t          len[METRICS_BUFS];
+    _Atomic int     pub;                    /* Published buffer, -1 = none yet */
+    _Atomic int     readers[METRICS_BUFS];
+    int             cur;                    /* Being rendered, -1 = none */
+    bool            truncated;
+
+    int             fd;                     /* Listening socket, -1 = off */
+    pthread_t       thread;
+    _Atomic bool    running;
+    _Atomic uint64_t scrapes;
+} metrics_t;
+
+/* Zero m; nothing is served until metrics_start() */
+void metrics_init(metrics_t* m);
+
+/*
+ * Serve on listen, "ADDR:PORT" (e.g. "127.0.0.1:9108" or a management
+ * address). Returns 0, -1 with errno if the address won't bind.
+ */
+int  metrics_start(metrics_t* m, const char* listen);
+void metrics_stop(metrics_t* m);
+
+/* Render a new exposition: begin, any number of printf / type, publish */
+void metrics_begin(metrics_t* m);
+void metrics_printf(metrics_t* m, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void metrics_type(metrics_t* m, const char* name, const char* type, const char* help);
+void metrics_publish(metrics_t* m);
+
+#endif /* PATHSTEER_METRICS_H */
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * netns.c - PathSteer Network Namespace Entry
+ *
+ * See netns.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* setns */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "netns.h"
+
+int netns_open(const char* netns) {
+    char path[64];
+    snprintf(path, sizeof(path), "/run/netns/%s", netns);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+int netns_enter_fd(int target, int* self) {
+    int back = -1;
+    if (self) {
+        *self = -1;
+        back = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+        if (back < 0) return -1;
+    }
+    if (setns(target, CLONE_NEWNET) < 0) {
+        int err = errno;
+        if (back >= 0) close(back);
+        errno = err;
+        return -1;
+    }
+    if (self) *self = back;
+    return 0;
+}
+
+int netns_enter(const char* netns, int* self) {
+    if (self) *self = -1;
+    if (!netns || !netns[0]) return 0;
+
+    int target = netns_open(netns);
+    if (target < 0) return -1;
+    int rc = netns_enter_fd(target, self);
+    int err = errno;
+    close(target);
+    errno = err;
+    return rc;
+}
+
+void netns_leave(int self) {
+    if (self < 0) return;
+    setns(self, CLONE_NEWNET);
+    close(self);
+}
@@ -0,0 +1,37 @@
+/*******************************************************************************
+ * netns.h - PathSteer Network Namespace Entry
+ *
+ * PURPOSE:
+ *   Sockets, netlink and interface indexes belong to the namespace the
+ *   thread is in when they are created. Uplinks live in named namespaces
+ *   (ip netns, /run/netns/<name>), so a socket for one is opened by
+ *   stepping the calling thread in, creating it and stepping back:
+ *
+ *     int self;
+ *     if (netns_enter(ns, &self) < 0) return -1;
+ *     fd = socket(...);
+ *     netns_leave(self);
+ *
+ *   A thread that should live in the namespace (capture, netlink apply)
+ *   enters it and doesn't come back (self NULL).
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_NETNS_H
+#define PATHSTEER_NETNS_H
+
+/* /run/netns/<netns>, O_CLOEXEC; -1 with errno */
+int  netns_open(const char* netns);
+
+/* This thread into the namespace target (an fd from netns_open()); *self =
+ * fd to come back with, or self NULL to stay. 0, or -1 with errno. */
+int  netns_enter_fd(int target, int* self);
+
+/* netns_enter_fd() by name; NULL/"" = stay where we are (*self = -1) */
+int  netns_enter(const char* netns, int* self);
+
+/* Back to where netns_enter() came from and close self; -1 = wasn't moved */
+void netns_leave(int self);
+
+#endif /* PATHSTEER_NETNS_H */
@@ -0,0 +1,501 @@
+/*******************************************************************************
+ * retpath.c - PathSteer In-Band Return Path Switching
+ *
+ * See retpath.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* pipe2 */
+#endif
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "netns.h"
+#include "retpath.h"
+
+#define RETPATH_MAGIC           0x50535250  /* "PSRP" */
+#define RETPATH_VERSION         1
+#define RETPATH_REJECT_LOG_MS   1000        /* retpath_reject events, at most */
+
+static const char* STATUS_NAMES[] = { "ok", "stale", "failed" };
+
+static int64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static const char* status_name(int status) {
+    return status >= 0 && status <= RETPATH_FAILED ? STATUS_NAMES[status] : "?";
+}
+
+/*=============================================================================
+ * SIPHASH-2-4
+ *===========================================================================*/
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                                        \
+    do {                                                                \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);       \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                          \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                          \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);       \
+    } while (0)
+
+static uint64_t get_le64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+uint64_t retpath_siphash(const uint8_t key[RETPATH_KEY_LEN], const uint8_t* data, size_t len) {
+    uint64_t k0 = get_le64(key), k1 = get_le64(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    size_t full = len & ~(size_t)7;
+    for (size_t i = 0; i < full; i += 8) {
+        uint64_t m = get_le64(data + i);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < (len & 7); i++) b |= (uint64_t)data[full + i] << (8 * i);
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*=============================================================================
+ * MESSAGE
+ *===========================================================================*/
+
+int retpath_load_key(const char* path, uint8_t key[RETPATH_KEY_LEN]) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return -1;
+    char hex[80] = "";
+    char* ok = fgets(hex, sizeof(hex), fp);
+    fclose(fp);
+
+    int n = 0;
+    for (const char* p = hex; ok && *p && n < RETPATH_KEY_LEN * 2; p++) {
+        if (isspace((unsigned char)*p)) continue;
+        if (!isxdigit((unsigned char)*p)) break;
+        int v = isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10;
+        if (n % 2 == 0) key[n / 2] = (uint8_t)(v << 4);
+        else key[n / 2] |= (uint8_t)v;
+        n++;
+    }
+    if (n != RETPATH_KEY_LEN * 2) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+void retpath_encode(const retpath_msg_t* msg, const uint8_t key[RETPATH_KEY_LEN], uint8_t buf[RETPATH_MSG_LEN]) {
+    memset(buf, 0, RETPATH_MSG_LEN);
+    uint32_t magic = htonl(RETPATH_MAGIC);
+    memcpy(buf, &magic, 4);
+    buf[4] = RETPATH_VERSION;
+    buf[5] = msg->type;
+    buf[6] = msg->via;
+    buf[7] = msg->status;
+    for (int i = 0; i < 8; i++) buf[8 + i] = (uint8_t)(msg->id >> (56 - 8 * i));
+    memcpy(buf + 16, msg->uplink, strnlen(msg->uplink, RETPATH_NAME_LEN));
+
+    uint64_t mac = retpath_siphash(key, buf, 24);
+    for (int i = 0; i < 8; i++) buf[24 + i] = (uint8_t)(mac >> (8 * i));
+}
+
+int retpath_decode(const uint8_t* buf, size_t len, const uint8_t key[RETPATH_KEY_LEN], retpath_msg_t* msg) {
+    if (len != RETPATH_MSG_LEN) return -1;
+    uint32_t magic;
+    memcpy(&magic, buf, 4);
+    if (ntohl(magic) != RETPATH_MAGIC || buf[4] != RETPATH_VERSION) return -1;
+
+    /* Constant-time compare: a forger learns nothing from timing */
+    uint64_t mac = retpath_siphash(key, buf, 24);
+    uint8_t diff = 0;
+    for (int i = 0; i < 8; i++) diff |= buf[24 + i] ^ (uint8_t)(mac >> (8 * i));
+    if (diff) return -1;
+
+    msg->type = buf[5];
+    msg->via = buf[6];
+    msg->status = buf[7];
+    msg->id = 0;
+    for (int i = 0; i < 8; i++) msg->id = msg->id << 8 | buf[8 + i];
+    memcpy(msg->uplink, buf + 16, RETPATH_NAME_LEN);
+    msg->uplink[RETPATH_NAME_LEN] = '\0';
+    return 0;
+}
+
+/*=============================================================================
+ * SENDER
+ *===========================================================================*/
+
+void retpath_client_init(retpath_client_t* cl) {
+    memset(cl, 0, sizeof(*cl));
+    cl->wake[0] = cl->wake[1] = -1;
+    for (int i = 0; i < RETPATH_PATHS; i++) cl->paths[i].fd = -1;
+    pthread_mutex_init(&cl->lock, NULL);
+}
+
+int retpath_client_add_path(retpath_client_t* cl, const char* name, const char* netns, const char* addr) {
+    if (cl->npaths >= RETPATH_PATHS) {
+        errno = ENOSPC;
+        return -1;
+    }
+    retpath_path_t* p = &cl->paths[cl->npaths++];
+    snprintf(p->name, sizeof(p->name), "%s", name);
+    snprintf(p->addr, sizeof(p->addr), "%s", addr);
+
+    int self;
+    if (netns_enter(netns, &self) < 0) return -1;
+    p->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int err = errno;
+    netns_leave(self);
+    if (p->fd < 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+static void client_send(retpath_client_t* cl) {
+    uint8_t buf[RETPATH_MSG_LEN];
+    for (int i = 0; i < cl->npaths; i++) {
+        retpath_path_t* p = &cl->paths[i];
+        if (p->fd < 0 || !(cl->cur_mask & (1u << i))) continue;
+
+        struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(cl->port) };
+        if (inet_pton(AF_INET, p->addr, &sa.sin_addr) != 1) continue;
+        cl->cur.via = (uint8_t)i;
+        retpath_encode(&cl->cur, cl->key, buf);
+        sendto(p->fd, buf, sizeof(buf), 0, (struct sockaddr*)&sa, sizeof(sa));
+    }
+    cl->attempts++;
+}
+
+static void client_recv(retpath_client_t* cl, int i, int64_t now) {
+    uint8_t buf[64];
+    retpath_msg_t ack;
+    ssize_t n;
+    while ((n = recv(cl->paths[i].fd, buf, sizeof(buf), 0)) >= 0) {
+        if (retpath_decode(buf, (size_t)n, cl->key, &ack) < 0 || ack.type != RETPATH_ACK) continue;
+        if (!cl->in_flight || ack.id != cl->cur.id) continue;     /* Late ack of an earlier switch */
+
+        cl->in_flight = false;
+        int64_t rtt = now - cl->sent_us;
+        atomic_fetch_add(&cl->acks, 1);
+        atomic_store(&cl->last_rtt_us, rtt);
+        if (cl->on_event) {
+            char json[256];
+            snprintf(json, sizeof(json),
+                     "{\"uplink\":\"%s\",\"via\":\"%s\",\"status\":\"%s\",\"rtt_ms\":%.1f,\"attempts\":%d}",
+                     cl->cur.uplink, ack.via < cl->npaths ? cl->paths[ack.via].name : "?",
+                     status_name(ack.status), rtt / 1000.0, cl->attempts);
+            cl->on_event(cl->ctx, ack.status == RETPATH_FAILED ? "retpath_failed" : "retpath_ack", json);
+        }
+    }
+}
+
+static void* client_thread(void* arg) {
+    retpath_client_t* cl = arg;
+    struct pollfd pfd[RETPATH_PATHS + 1];
+
+    while (atomic_load(&cl->running)) {
+        int64_t now = mono_us();
+        int timeout = 200;
+        if (cl->in_flight) timeout = cl->next_us > now ? (int)((cl->next_us - now + 999) / 1000) : 0;
+
+        pfd[0] = (struct pollfd){ .fd = cl->wake[0], .events = POLLIN };
+        for (int i = 0; i < cl->npaths; i++) pfd[i + 1] = (struct pollfd){ .fd = cl->paths[i].fd, .events = POLLIN };
+        int rc = poll(pfd, cl->npaths + 1, timeout);
+        now = mono_us();
+
+        if (rc > 0) {
+            for (int i = 0; i < cl->npaths; i++) {
+                if (pfd[i + 1].revents & POLLIN) client_recv(cl, i, now);
+            }
+        }
+
+        /* A new switch replaces whatever is in flight */
+        if (rc > 0 && (pfd[0].revents & POLLIN)) {
+            char drain[16];
+            while (read(cl->wake[0], drain, sizeof(drain)) > 0) {
+            }
+            pthread_mutex_lock(&cl->lock);
+            bool fresh = cl->has_pending;
+            if (fresh) {
+                cl->cur = cl->pending;
+                cl->cur_mask = cl->pending_mask;
+                cl->has_pending = false;
+            }
+            pthread_mutex_unlock(&cl->lock);
+            if (fresh) {
+                cl->in_flight = true;
+                cl->attempts = 0;
+                cl->rto_ms = RETPATH_RTO_MS;
+                cl->sent_us = now;
+                client_send(cl);
+                cl->next_us = now + cl->rto_ms * 1000LL;
+                continue;
+            }
+        }
+
+        if (!cl->in_flight || now < cl->next_us) continue;
+        if (now - cl->sent_us >= RETPATH_GIVEUP_MS * 1000LL) {
+            cl->in_flight = false;
+            atomic_fetch_add(&cl->timeouts, 1);
+            if (cl->on_event) {
+                char json[128];
+                snprintf(json, sizeof(json), "{\"uplink\":\"%s\",\"attempts\":%d}", cl->cur.uplink, cl->attempts);
+                cl->on_event(cl->ctx, "retpath_timeout", json);
+            }
+            continue;
+        }
+        client_send(cl);
+        cl->rto_ms = cl->rto_ms * 2 > RETPATH_RTO_MAX_MS ? RETPATH_RTO_MAX_MS : cl->rto_ms * 2;
+        cl->next_us = now + cl->rto_ms * 1000LL;
+    }
+    return NULL;
+}
+
+int retpath_client_start(retpath_client_t* cl, const uint8_t key[RETPATH_KEY_LEN], int port,
+                         retpath_event_cb on_event, void* ctx) {
+    memcpy(cl->key, key, RETPATH_KEY_LEN);
+    cl->port = port;
+    cl->on_event = on_event;
+    cl->ctx = ctx;
+    if (pipe2(cl->wake, O_NONBLOCK | O_CLOEXEC) < 0) return -1;
+
+    atomic_store(&cl->running, true);
+    int rc = pthread_create(&cl->thread, NULL, client_thread, cl);
+    if (rc != 0) {
+        atomic_store(&cl->running, false);
+        close(cl->wake[0]);
+        close(cl->wake[1]);
+        cl->wake[0] = cl->wake[1] = -1;
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int retpath_switch(retpath_client_t* cl, const char* uplink, uint32_t mask) {
+    if (!atomic_load(&cl->running)) {
+        errno = ENOTCONN;
+        return -1;
+    }
+    if (strlen(uplink) > RETPATH_NAME_LEN) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    pthread_mutex_lock(&cl->lock);
+    memset(&cl->pending, 0, sizeof(cl->pending));
+    cl->pending.type = RETPATH_SWITCH;
+    cl->pending.id = (uint64_t)realtime_us();
+    snprintf(cl->pending.uplink, sizeof(cl->pending.uplink), "%s", uplink);
+    cl->pending_mask = mask;
+    cl->has_pending = true;
+    pthread_mutex_unlock(&cl->lock);
+
+    atomic_fetch_add(&cl->switches, 1);
+    char c = 1;
+    if (write(cl->wake[1], &c, 1) < 0) {
+        /* Pipe full: a wakeup is already pending */
+    }
+    return 0;
+}
+
+void retpath_client_stop(retpath_client_t* cl) {
+    if (atomic_load(&cl->running)) {
+        atomic_store(&cl->running, false);
+        pthread_join(cl->thread, NULL);
+        close(cl->wake[0]);
+        close(cl->wake[1]);
+        cl->wake[0] = cl->wake[1] = -1;
+    }
+    for (int i = 0; i < cl->npaths; i++) {
+        if (cl->paths[i].fd >= 0) close(cl->paths[i].fd);
+        cl->paths[i].fd = -1;
+    }
+}
+
+/*=============================================================================
+ * RECEIVER
+ *===========================================================================*/
+
+static void server_reject(retpath_server_t* srv, const struct sockaddr_in* from, const char* why,
+                          int64_t* last_log) {
+    atomic_fetch_add(&srv->rejected, 1);
+    int64_t now = mono_us();
+    if (!srv->on_event || now - *last_log < RETPATH_REJECT_LOG_MS * 1000LL) return;
+    *last_log = now;
+
+    char addr[INET_ADDRSTRLEN], json[160];
+    inet_ntop(AF_INET, &from->sin_addr, addr, sizeof(addr));
+    snprintf(json, sizeof(json), "{\"from\":\"%s\",\"reason\":\"%s\"}", addr, why);
+    srv->on_event(srv->ctx, "retpath_reject", json);
+}
+
+static void server_handle(retpath_server_t* srv, const uint8_t* buf, size_t len,
+                          const struct sockaddr_in* from, int64_t* last_log) {
+    retpath_msg_t msg;
+    if (retpath_decode(buf, len, srv->key, &msg) < 0) {
+        server_reject(srv, from, "mac", last_log);
+        return;
+    }
+    if (msg.type != RETPATH_SWITCH) return;
+
+    retpath_msg_t ack = msg;
+    ack.type = RETPATH_ACK;
+
+    if (msg.id == srv->last_id) {
+        /* Retransmit, or the same switch over another tunnel */
+        atomic_fetch_add(&srv->duplicates, 1);
+        ack.status = (uint8_t)srv->last_status;
+    } else if (msg.id < srv->last_id) {
+        atomic_fetch_add(&srv->stale, 1);
+        ack.status = RETPATH_STALE;
+    } else {
+        int64_t skew = realtime_us() - (int64_t)msg.id;
+        if (skew > RETPATH_MAX_SKEW_S * 1000000LL || skew < -RETPATH_MAX_SKEW_S * 1000000LL) {
+            server_reject(srv, from, "skew", last_log);
+            return;
+        }
+
+        int64_t start = mono_us();
+        int rc = srv->apply(srv->ctx, msg.uplink);
+        int64_t took = mono_us() - start;
+        srv->last_id = msg.id;
+        srv->last_status = rc == 0 ? RETPATH_OK : RETPATH_FAILED;
+        ack.status = (uint8_t)srv->last_status;
+        atomic_fetch_add(rc == 0 ? &srv->applied : &srv->failed, 1);
+
+        if (srv->on_event) {
+            char addr[INET_ADDRSTRLEN], json[256];
+            inet_ntop(AF_INET, &from->sin_addr, addr, sizeof(addr));
+            snprintf(json, sizeof(json),
+                     "{\"uplink\":\"%s\",\"from\":\"%s\",\"age_ms\":%.1f,\"apply_us\":%lld,\"status\":\"%s\",\"error\":\"%s\"}",
+                     msg.uplink, addr, skew / 1000.0, (long long)took, status_name(ack.status),
+                     rc == 0 ? "" : strerror(-rc));
+            srv->on_event(srv->ctx, "retpath_apply", json);
+        }
+    }
+
+    uint8_t out[RETPATH_MSG_LEN];
+    retpath_encode(&ack, srv->key, out);
+    sendto(srv->fd, out, sizeof(out), 0, (const struct sockaddr*)from, sizeof(*from));
+}
+
+static void* server_thread(void* arg) {
+    retpath_server_t* srv = arg;
+    int64_t last_log = 0;
+
+    /* apply() opens its netlink sockets here: stay in the service namespace */
+    netns_enter(srv->netns, NULL);
+
+    while (atomic_load(&srv->running)) {
+        struct pollfd pfd = { .fd = srv->fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) <= 0) continue;
+
+        uint8_t buf[64];
+        struct sockaddr_in from;
+        socklen_t flen = sizeof(from);
+        ssize_t n;
+        while ((n = recvfrom(srv->fd, buf, sizeof(buf), 0, (struct sockaddr*)&from, &flen)) >= 0) {
+            server_handle(srv, buf, (size_t)n, &from, &last_log);
+            flen = sizeof(from);
+        }
+    }
+    return NULL;
+}
+
+void retpath_server_init(retpath_server_t* srv) {
+    memset(srv, 0, sizeof(*srv));
+    srv->fd = -1;
+}
+
+int retpath_server_start(retpath_server_t* srv, const uint8_t key[RETPATH_KEY_LEN], const char* netns, int port,
+                         retpath_apply_cb apply, retpath_event_cb on_event, void* ctx) {
+    memcpy(srv->key, key, RETPATH_KEY_LEN);
+    snprintf(srv->netns, sizeof(srv->netns), "%s", netns ? netns : "");
+    srv->port = port;
+    srv->apply = apply;
+    srv->on_event = on_event;
+    srv->ctx = ctx;
+    srv->last_id = (uint64_t)realtime_us();     /* Nothing from before we started */
+    srv->last_status = RETPATH_STALE;
+
+    int self;
+    if (netns_enter(srv->netns, &self) < 0) return -1;
+    srv->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int err = errno;
+    if (srv->fd >= 0) {
+        struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+        if (bind(srv->fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+            err = errno;
+            close(srv->fd);
+            srv->fd = -1;
+        }
+    }
+    netns_leave(self);
+    if (srv->fd < 0) {
+        errno = err;
+        return -1;
+    }
+
+    atomic_store(&srv->running, true);
+    int rc = pthread_create(&srv->thread, NULL, server_thread, srv);
+    if (rc != 0) {
+        atomic_store(&srv->running, false);
+        close(srv->fd);
+        srv->fd = -1;
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void retpath_server_stop(retpath_server_t* srv) {
+    if (!atomic_load(&srv->running)) return;
+    atomic_store(&srv->running, false);
+    pthread_join(srv->thread, NULL);
+    close(srv->fd);
+    srv->fd = -1;
+}
@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * retpath.h - PathSteer In-Band Return Path Switching
+ *
+ * PURPOSE:
+ *   After an uplink switch the controller must send the service prefix's
+ *   return traffic down the new uplink's tunnel. Doing that over a fresh
+ *   SSH connection takes seconds, all of them on the old, degraded path.
+ *   Instead pathsteerd sends one small authenticated UDP datagram over
+ *   every healthy tunnel at once; dedupe on the controller replaces the
+ *   route over rtnetlink and acknowledges. First copy in wins, so the
+ *   return path follows in about one RTT of the best surviving tunnel.
+ *
+ * MESSAGE (RETPATH_MSG_LEN bytes, network order):
+ *   0  magic "PSRP"        4  version         5  type (SWITCH / ACK)
+ *   6  via (sender's path) 7  status (ACK: RETPATH_OK / _STALE / _FAILED)
+ *   8  id, u64: edge wall clock in us when the switch was decided
+ *   16 uplink name, NUL padded
+ *   24 SipHash-2-4 over bytes 0..23 with the shared 128-bit key
+ *
+ * ORDERING / REPLAY:
+ *   The controller applies an id only if it is newer than the last one it
+ *   applied and within RETPATH_MAX_SKEW_S of its own clock. The same id
+ *   again (a retransmit, or its copy over another tunnel) is acked without
+ *   touching the route; an older one is acked RETPATH_STALE so the sender
+ *   stops. Acks are authenticated too. The receiver starts with its own
+ *   start time as the last id, so a restart doesn't reopen the skew window
+ *   to switches captured before it.
+ *
+ *   Uplink names longer than RETPATH_NAME_LEN don't fit the message: the
+ *   sender refuses them rather than send a truncated name.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_RETPATH_H
+#define PATHSTEER_RETPATH_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RETPATH_PORT            9110
+#define RETPATH_MSG_LEN         32
+#define RETPATH_KEY_LEN         16
+#define RETPATH_NAME_LEN        8           /* Uplink name on the wire, NUL padded */
+#define RETPATH_MAX_SKEW_S      60
+#define RETPATH_RTO_MS          50          /* First retransmit, doubling */
+#define RETPATH_RTO_MAX_MS      400
+#define RETPATH_GIVEUP_MS       5000
+#define RETPATH_PATHS           10          /* At least pathsteerd's MAX_UPLINKS */
+
+typedef enum {
+    RETPATH_SWITCH = 1,
+    RETPATH_ACK = 2,
+} retpath_type_t;
+
+typedef enum {
+    RETPATH_OK = 0,
+    RETPATH_STALE,                  /* A newer switch was already applied */
+    RETPATH_FAILED,                 /* Unknown uplink or the route change failed */
+} retpath_status_t;
+
+typedef struct {
+    uint8_t     type;
+    uint8_t     via;
+    uint8_t     status;
+    uint64_t    id;
+    char        uplink[RETPATH_NAME_LEN + 1];
+} retpath_msg_t;
+
+/* 0 and the key from a file of 32 hex digits, -1 with errno */
+int  retpath_load_key(const char* path, uint8_t key[RETPATH_KEY_LEN]);
+
+/* Serialize and MAC msg into buf */
+void retpath_encode(const retpath_msg_t* msg, const uint8_t key[RETPATH_KEY_LEN], uint8_t buf[RETPATH_MSG_LEN]);
+
+/* 0 and msg if buf is a well-formed message with a valid MAC, else -1 */
+int  retpath_decode(const uint8_t* buf, size_t len, const uint8_t key[RETPATH_KEY_LEN], retpath_msg_t* msg);
+
+uint64_t retpath_siphash(const uint8_t key[RETPATH_KEY_LEN], const uint8_t* data, size_t len);
+
+/* Events, from either side's thread: type and its complete JSON object */
+typedef void (*retpath_event_cb)(void* ctx, const char* type, const char* json);
+
+/*=============================================================================
+ * SENDER (edge)
+ *
+ * One UDP socket per tunnel, created in that tunnel's namespace. A switch
+ * goes out over every path in the healthy mask, and is retransmitted over
+ * all of them every RETPATH_RTO_MS (doubling) until the first ack or
+ * RETPATH_GIVEUP_MS. A newer switch replaces one still in flight.
+ * Events: "retpath_ack" and "retpath_timeout".
+ *===========================================================================*/
+
+typedef struct {
+    int         fd;
+    char        name[32];
+    char        addr[64];           /* Controller's address through this tunnel */
+} retpath_path_t;
+
+typedef struct {
+    uint8_t             key[RETPATH_KEY_LEN];
+    int                 port;
+    retpath_path_t      paths[RETPATH_PATHS];
+    int                 npaths;
+    retpath_event_cb    on_event;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+    int                 wake[2];    /* Pipe: a new switch is pending */
+
+    pthread_mutex_t     lock;
+    retpath_msg_t       pending;
+    uint32_t            pending_mask;
+    bool                has_pending;
+
+    /* Sender thread only */
+    retpath_msg_t       cur;
+    uint32_t            cur_mask;
+    bool                in_flight;
+    int64_t             sent_us, next_us;
+    int                 rto_ms, attempts;
+
+    _Atomic uint64_t    switches, acks, timeouts;
+    _Atomic int64_t     last_rtt_us;
+} retpath_client_t;
+
+/* Zero cl; retpath_client_stop() is then a no-op */
+void retpath_client_init(retpath_client_t* cl);
+
+/* Path i (wire "via" = i): reach the controller at addr from netns (NULL/"" = ours) */
+int  retpath_client_add_path(retpath_client_t* cl, const char* name, const char* netns, const char* addr);
+
+int  retpath_client_start(retpath_client_t* cl, const uint8_t key[RETPATH_KEY_LEN], int port,
+                          retpath_event_cb on_event, void* ctx);
+
+/* Return traffic for the prefix to uplink, over the paths in mask (bit i = path i).
+ * -1 with errno: ENAMETOOLONG (name over RETPATH_NAME_LEN), ENOTCONN (not started). */
+int  retpath_switch(retpath_client_t* cl, const char* uplink, uint32_t mask);
+
+void retpath_client_stop(retpath_client_t* cl);
+
+/*=============================================================================
+ * RECEIVER (controller)
+ *
+ * A thread in netns (the service namespace) serving port. apply() runs on
+ * that thread, so netlink sockets it opens belong to the namespace; it
+ * returns 0 or -errno. Events: "retpath_apply" (applied, with us taken)
+ * and "retpath_reject" (bad MAC, skew, unknown uplink, failure).
+ *===========================================================================*/
+
+typedef int (*retpath_apply_cb)(void* ctx, const char* uplink);
+
+typedef struct {
+    uint8_t             key[RETPATH_KEY_LEN];
+    int                 fd;
+    char                netns[32];
+    int                 port;
+    retpath_apply_cb    apply;
+    retpath_event_cb    on_event;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+
+    /* Receiver thread only */
+    uint64_t            last_id;
+    int                 last_status;
+
+    _Atomic uint64_t    applied, duplicates, stale, rejected, failed;
+} retpath_server_t;
+
+void retpath_server_init(retpath_server_t* srv);
+
+/* Bind port in netns (NULL/"" = ours). -1 with errno on failure. */
+int  retpath_server_start(retpath_server_t* srv, const uint8_t key[RETPATH_KEY_LEN], const char* netns, int port,
+                          retpath_apply_cb apply, retpath_event_cb on_event, void* ctx);
+
+void retpath_server_stop(retpath_server_t* srv);
+
+#endif /* PATHSTEER_RETPATH_H */
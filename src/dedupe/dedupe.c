@@ -9,11 +9,26 @@
  *   First-arrival wins. We track flows by 5-tuple and sequence/timestamp.
  *   If we see the same packet twice (same hash), we drop the second one.
  *
+ * RETURN PATH:
+ *   Also serves the in-band return path protocol (../common/retpath.h):
+ *   an authenticated switch from pathsteerd, over any tunnel, moves the
+ *   service prefix's route in the service namespace over rtnetlink.
+ *
+ * RETURN PATH LEARNING:
+ *   Without waiting for that message, the same route follows the data
+ *   plane: every packet arriving from the edge on a service tunnel goes
+ *   through the flow table, and per tunnel we keep how far behind the
+ *   first copy its copies arrive. Return traffic goes to the tunnel whose
+ *   copies lead, with hysteresis, so the downlink follows the uplink (or
+ *   the faster of two duplicated ones) with no control round trip.
+ *
  * Copyright (c) 2025 PathSteer Networks
  ******************************************************************************/
 
 #define _GNU_SOURCE
 
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,11 +40,46 @@
 #include <pthread.h>
 #include <sys/time.h>
 
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include "metrics.h"
+#include "netns.h"
+#include "retpath.h"
+
 #define VERSION "1.0.0"
 #define FLOW_TABLE_SIZE 65536
 #define FLOW_TTL_MS 5000
 #define STATS_INTERVAL_SEC 10
 
+/* Prometheus endpoint (../common/metrics.h), "off" to disable */
+#define DEFAULT_METRICS_LISTEN "127.0.0.1:9109"
+
+/* Return path (../common/retpath.h): key shared with pathsteerd, the
+ * namespace holding the service prefix's route */
+#define DEFAULT_RETPATH_KEY "/etc/pathsteer/retpath.key"
+#define DEFAULT_RETPATH_NETNS "ns_svc"
+#define SERVICE_PREFIX "104.204.138.48"
+#define SERVICE_PREFIX_LEN 28
+
+/* Return path learning: judged per window, a tunnel needs a smoothed rate
+ * of LEARN_MIN_PPS (a voice call is 50); a lead of LEARN_HYST_US held
+ * LEARN_HOLD_MS moves the route, never sooner than LEARN_DWELL_MS after the
+ * last move (or retpath switch) */
+#define LEARN_WINDOW_MS 100
+#define LEARN_MIN_PPS 20
+#define LEARN_HYST_US 2000
+#define LEARN_HOLD_MS 300
+#define LEARN_DWELL_MS 1000
+#define LEARN_MAX_LAG_MS 500        /* Later "copies" are a retransmit or a collision */
+#define LEARN_ALPHA 0.3             /* Lag and rate EWMA, per window */
+#define LEARN_SNAPLEN 64
+
 /*=============================================================================
  * Flow Entry - Tracks seen packets
  *===========================================================================*/
@@ -47,6 +97,7 @@ typedef struct {
     uint64_t    packets_forwarded;
     uint64_t    packets_dropped;    /* Duplicates */
     uint64_t    flows_active;
+    uint64_t    evictions;          /* Live entry overwritten by another hash */
 } stats_t;
 
 /*=============================================================================
@@ -56,6 +107,11 @@ static volatile sig_atomic_t g_running = 1;
 static flow_entry_t g_flows[FLOW_TABLE_SIZE];
 static stats_t g_stats;
 static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static metrics_t g_metrics;
+static retpath_server_t g_retpath;
+static pthread_mutex_t g_route_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_route_cur = -1;            /* g_svc_routes index the prefix routes to */
+static int64_t g_route_at_us;           /* ... since */
 
 /*=============================================================================
  * Time
@@ -80,21 +136,25 @@ static uint32_t hash_packet(const uint8_t* data, size_t len) {
     return hash;
 }
 
-/* Check if packet is duplicate, add if not */
-static bool flow_check_and_add(uint32_t hash) {
-    int64_t now = now_us();
+/* Check if packet is duplicate, add if not; a duplicate's first arrival in *first_us */
+static bool flow_check_and_add(uint32_t hash, int64_t now, int64_t* first_us) {
     int idx = hash % FLOW_TABLE_SIZE;
     
     pthread_mutex_lock(&g_mutex);
+    g_stats.packets_total++;
     
     /* Check if exists and not expired */
-    if (g_flows[idx].valid && g_flows[idx].hash == hash) {
+    if (g_flows[idx].valid) {
         int64_t age_ms = (now - g_flows[idx].timestamp_us) / 1000;
         if (age_ms < FLOW_TTL_MS) {
-            /* Duplicate! */
-            g_stats.packets_dropped++;
-            pthread_mutex_unlock(&g_mutex);
-            return true;
+            if (g_flows[idx].hash == hash) {
+                /* Duplicate! */
+                g_stats.packets_dropped++;
+                *first_us = g_flows[idx].timestamp_us;
+                pthread_mutex_unlock(&g_mutex);
+                return true;
+            }
+            g_stats.evictions++;
         }
     }
     
@@ -128,6 +188,352 @@ static void flow_cleanup(void) {
     pthread_mutex_unlock(&g_mutex);
 }
 
+/*=============================================================================
+ * Return Path
+ * 
+ * Per uplink, the service namespace device and the edge's address on it
+ * (as controller-route-switch.sh): the built-in six, then any
+ * --svc-route UPLINK,DEV,GW, up to one per edge return path. apply runs
+ * on the retpath thread, which lives in the service namespace, so its
+ * netlink socket does too.
+ *===========================================================================*/
+typedef struct {
+    const char* uplink;
+    const char* dev;
+    const char* gw;
+} svc_route_t;
+
+static svc_route_t g_svc_routes[RETPATH_PATHS] = {
+    { "cell_a", "svc_ca",   "10.203.5.2" },
+    { "cell_b", "svc_cb",   "10.203.6.2" },
+    { "sl_a",   "svc_sl_a", "10.203.3.2" },
+    { "sl_b",   "svc_sl_b", "10.203.4.2" },
+    { "fa",     "svc_fa",   "10.203.1.2" },
+    { "fb",     "svc_fb",   "10.203.2.2" },
+};
+static int g_svc_route_count = 6;   /* Set before any thread starts */
+
+/* --svc-route UPLINK,DEV,GW (spec is split in place): replaces the entry
+ * of the same uplink or adds one; 0, or -1 if malformed or full */
+static int svc_route_add(char* spec) {
+    char* dev = strchr(spec, ',');
+    char* gw = dev ? strchr(dev + 1, ',') : NULL;
+    struct in_addr a;
+    if (!gw || dev == spec || gw == dev + 1 || inet_pton(AF_INET, gw + 1, &a) != 1) return -1;
+    *dev++ = '\0';
+    *gw++ = '\0';
+    if (strlen(spec) > RETPATH_NAME_LEN) return -1;
+
+    int i = 0;
+    while (i < g_svc_route_count && strcmp(g_svc_routes[i].uplink, spec) != 0) i++;
+    if (i == RETPATH_PATHS) return -1;
+    if (i == g_svc_route_count) g_svc_route_count++;
+    g_svc_routes[i] = (svc_route_t){ spec, dev, gw };
+    return 0;
+}
+
+static void nl_attr(struct nlmsghdr* nh, int type, const void* data, int len) {
+    struct rtattr* rta = (struct rtattr*)((char*)nh + NLMSG_ALIGN(nh->nlmsg_len));
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    memcpy(RTA_DATA(rta), data, len);
+    nh->nlmsg_len = NLMSG_ALIGN(nh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+/* ip route replace SERVICE_PREFIX via gw dev dev; 0 or -errno */
+static int route_replace(const char* dev, const char* gw) {
+    struct {
+        struct nlmsghdr nh;
+        struct rtmsg    rt;
+        char            attrs[64];
+    } req;
+    memset(&req, 0, sizeof(req));
+    
+    struct in_addr dst, via;
+    int oif = (int)if_nametoindex(dev);
+    if (oif == 0) return -errno;
+    inet_pton(AF_INET, SERVICE_PREFIX, &dst);
+    inet_pton(AF_INET, gw, &via);
+    
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    req.nh.nlmsg_type = RTM_NEWROUTE;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_REPLACE;
+    req.rt.rtm_family = AF_INET;
+    req.rt.rtm_dst_len = SERVICE_PREFIX_LEN;
+    req.rt.rtm_table = RT_TABLE_MAIN;
+    req.rt.rtm_protocol = RTPROT_STATIC;
+    req.rt.rtm_scope = RT_SCOPE_UNIVERSE;
+    req.rt.rtm_type = RTN_UNICAST;
+    nl_attr(&req.nh, RTA_DST, &dst, sizeof(dst));
+    nl_attr(&req.nh, RTA_GATEWAY, &via, sizeof(via));
+    nl_attr(&req.nh, RTA_OIF, &oif, sizeof(oif));
+    
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return -errno;
+    struct sockaddr_nl sa = { .nl_family = AF_NETLINK };
+    int rc = -EIO;
+    if (sendto(fd, &req, req.nh.nlmsg_len, 0, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+        rc = -errno;
+    } else {
+        char buf[512];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        struct nlmsghdr* nh = (struct nlmsghdr*)buf;
+        if (n < 0) {
+            rc = -errno;
+        } else if (NLMSG_OK(nh, (size_t)n) && nh->nlmsg_type == NLMSG_ERROR) {
+            rc = ((struct nlmsgerr*)NLMSG_DATA(nh))->error;
+        }
+    }
+    close(fd);
+    return rc;
+}
+
+/* Route the prefix to g_svc_routes[idx]; 0 or -errno */
+static int route_set(int idx) {
+    pthread_mutex_lock(&g_route_lock);
+    int rc = route_replace(g_svc_routes[idx].dev, g_svc_routes[idx].gw);
+    if (rc == 0) {
+        g_route_cur = idx;
+        g_route_at_us = now_us();
+    }
+    pthread_mutex_unlock(&g_route_lock);
+    return rc;
+}
+
+static int retpath_apply(void* ctx, const char* uplink) {
+    (void)ctx;
+    for (int i = 0; i < g_svc_route_count; i++) {
+        if (strcmp(g_svc_routes[i].uplink, uplink) == 0) return route_set(i);
+    }
+    return -ENOENT;
+}
+
+static void retpath_on_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    printf("[dedupe] %s %s\n", type, json);
+    fflush(stdout);
+}
+
+/*=============================================================================
+ * Return Path Learning
+ * 
+ * One AF_PACKET socket in the service namespace sees what arrives on the
+ * svc_* tunnels. A packet's hash skips the fields a path rewrites (TTL /
+ * hop limit, IPv4 checksum), so both copies of a duplicated packet match.
+ * Per window and tunnel: the mean lag of its copies behind the first one
+ * (0 for the copies it delivered first), smoothed. The tunnel with the
+ * least lag takes the route once its lead over the current one is past
+ * LEARN_HYST_US for LEARN_HOLD_MS; a current tunnel that went quiet while
+ * another carries traffic loses it the same way. The rate a tunnel needs
+ * is smoothed across windows, so a call too thin to fill one window still
+ * counts. The learn thread publishes lag and first arrivals under
+ * g_route_lock, once per window, for metrics_render().
+ *===========================================================================*/
+typedef struct {
+    int         ifindex;
+    uint64_t    packets, firsts;    /* This window */
+    double      lag_sum_us;
+    double      pps;                /* EWMA over windows */
+    bool        live;               /* Rate at least LEARN_MIN_PPS */
+
+    /* Written under g_route_lock */
+    double      lag_us;             /* EWMA over windows */
+    uint64_t    firsts_total;
+} tunnel_t;
+
+typedef struct {
+    int         fd;
+    int         nsfd;               /* Namespace the thread enters, -1 = ours */
+    tunnel_t    tunnels[RETPATH_PATHS];
+    pthread_t   thread;
+    _Atomic bool running;
+    int         candidate;          /* Leading, not yet routed, -1 = none */
+    int64_t     candidate_since_us;
+    _Atomic uint64_t switches;
+} learn_t;
+
+static learn_t g_learn = { .fd = -1, .nsfd = -1, .candidate = -1 };
+
+static uint32_t hash_invariant(const uint8_t* pkt, size_t len) {
+    uint8_t buf[LEARN_SNAPLEN];
+    if (len > sizeof(buf)) len = sizeof(buf);
+    memcpy(buf, pkt, len);
+    if (len >= 20 && (buf[0] >> 4) == 4) {
+        buf[8] = 0;                 /* TTL */
+        buf[10] = buf[11] = 0;      /* Header checksum */
+    } else if (len >= 40 && (buf[0] >> 4) == 6) {
+        buf[7] = 0;                 /* Hop limit */
+    }
+    return hash_packet(buf, len);
+}
+
+static void learn_packet(learn_t* l, int t, const uint8_t* pkt, size_t len, int64_t ts) {
+    int64_t first = 0;
+    tunnel_t* tun = &l->tunnels[t];
+    if (flow_check_and_add(hash_invariant(pkt, len), ts, &first)) {
+        int64_t lag = ts > first ? ts - first : 0;
+        if (lag > LEARN_MAX_LAG_MS * 1000LL) return;
+        tun->lag_sum_us += (double)lag;
+    } else {
+        tun->firsts++;
+    }
+    tun->packets++;
+}
+
+/* elapsed: the window's length, polls don't end exactly on time */
+static void learn_window(learn_t* l, int64_t now, int64_t elapsed) {
+    int best = -1;
+    pthread_mutex_lock(&g_route_lock);
+    for (int i = 0; i < g_svc_route_count; i++) {
+        tunnel_t* tun = &l->tunnels[i];
+        double pps = tun->packets * 1e6 / (double)elapsed;
+        tun->pps += LEARN_ALPHA * (pps - tun->pps);
+        tun->live = tun->pps >= LEARN_MIN_PPS;
+        if (tun->packets > 0) {
+            double lag = tun->lag_sum_us / tun->packets;
+            tun->lag_us = tun->lag_us > 0 ? tun->lag_us + LEARN_ALPHA * (lag - tun->lag_us) : lag;
+        }
+        if (tun->live && (best < 0 || tun->lag_us < l->tunnels[best].lag_us)) best = i;
+        tun->firsts_total += tun->firsts;
+        tun->packets = tun->firsts = 0;
+        tun->lag_sum_us = 0;
+    }
+    int cur = g_route_cur;
+    int64_t since = g_route_at_us;
+    pthread_mutex_unlock(&g_route_lock);
+    
+    /* Does best lead the current tunnel by enough? */
+    bool lead = best >= 0 && best != cur &&
+                (cur < 0 || !l->tunnels[cur].live ||
+                 l->tunnels[cur].lag_us - l->tunnels[best].lag_us > LEARN_HYST_US);
+    if (!lead) {
+        l->candidate = -1;
+        return;
+    }
+    if (best != l->candidate) {
+        l->candidate = best;
+        l->candidate_since_us = now;
+    }
+    if (now - l->candidate_since_us < LEARN_HOLD_MS * 1000LL) return;
+    if (now - since < LEARN_DWELL_MS * 1000LL) return;
+    
+    int rc = route_set(best);
+    atomic_fetch_add(&l->switches, 1);
+    printf("[dedupe] learn_switch {\"from\":\"%s\",\"to\":\"%s\",\"lag_ms\":%.2f,\"from_lag_ms\":%.2f,\"from_live\":%s,\"error\":\"%s\"}\n",
+           cur >= 0 ? g_svc_routes[cur].uplink : "", g_svc_routes[best].uplink,
+           l->tunnels[best].lag_us / 1000.0, cur >= 0 ? l->tunnels[cur].lag_us / 1000.0 : 0.0,
+           cur >= 0 && l->tunnels[cur].live ? "true" : "false", rc == 0 ? "" : strerror(-rc));
+    fflush(stdout);
+    l->candidate = -1;
+}
+
+static void* learn_thread(void* arg) {
+    learn_t* l = arg;
+    
+    /* route_set() opens its netlink socket here */
+    if (l->nsfd >= 0) {
+        netns_enter_fd(l->nsfd, NULL);
+        close(l->nsfd);
+        l->nsfd = -1;
+    }
+    
+    int64_t window_start = now_us();
+    while (atomic_load(&l->running)) {
+        struct pollfd pfd = { .fd = l->fd, .events = POLLIN };
+        poll(&pfd, 1, LEARN_WINDOW_MS / 2);
+        
+        for (;;) {
+            uint8_t pkt[LEARN_SNAPLEN];
+            char cbuf[CMSG_SPACE(sizeof(struct timespec))];
+            struct sockaddr_ll sll;
+            struct iovec iov = { .iov_base = pkt, .iov_len = sizeof(pkt) };
+            struct msghdr msg = {
+                .msg_name = &sll, .msg_namelen = sizeof(sll),
+                .msg_iov = &iov, .msg_iovlen = 1,
+                .msg_control = cbuf, .msg_controllen = sizeof(cbuf),
+            };
+            ssize_t n = recvmsg(l->fd, &msg, MSG_DONTWAIT);
+            if (n < 0) break;
+            if (sll.sll_pkttype == PACKET_OUTGOING) continue;
+            
+            int t = -1;
+            for (int i = 0; i < g_svc_route_count; i++) {
+                if (l->tunnels[i].ifindex == sll.sll_ifindex) t = i;
+            }
+            if (t < 0) continue;
+            
+            int64_t ts = 0;
+            for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_TIMESTAMPNS) {
+                    struct timespec tsp;
+                    memcpy(&tsp, CMSG_DATA(c), sizeof(tsp));
+                    ts = (int64_t)tsp.tv_sec * 1000000 + tsp.tv_nsec / 1000;
+                }
+            }
+            learn_packet(l, t, pkt, (size_t)n < sizeof(pkt) ? (size_t)n : sizeof(pkt), ts ? ts : now_us());
+        }
+        
+        int64_t now = now_us();
+        if (now - window_start >= LEARN_WINDOW_MS * 1000LL) {
+            learn_window(l, now, now - window_start);
+            window_start = now;
+        }
+    }
+    return NULL;
+}
+
+/* Capture in netns (NULL/"" = ours); -1 with errno */
+static int learn_start(learn_t* l, const char* netns) {
+    int self = -1;
+    if (netns && netns[0]) {
+        l->nsfd = netns_open(netns);
+        if (l->nsfd < 0 || netns_enter_fd(l->nsfd, &self) < 0) {
+            int err = errno;
+            if (l->nsfd >= 0) close(l->nsfd);
+            l->nsfd = -1;
+            errno = err;
+            return -1;
+        }
+    }
+    
+    l->fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    int err = errno;
+    if (l->fd >= 0) {
+        int one = 1;
+        setsockopt(l->fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    }
+    for (int i = 0; i < g_svc_route_count; i++) {
+        l->tunnels[i].ifindex = (int)if_nametoindex(g_svc_routes[i].dev);
+    }
+    
+    netns_leave(self);
+    if (l->fd < 0) {
+        if (l->nsfd >= 0) close(l->nsfd);
+        l->nsfd = -1;
+        errno = err;
+        return -1;
+    }
+    
+    atomic_store(&l->running, true);
+    int rc = pthread_create(&l->thread, NULL, learn_thread, l);
+    if (rc != 0) {
+        atomic_store(&l->running, false);
+        close(l->fd);
+        l->fd = -1;
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+static void learn_stop(learn_t* l) {
+    if (!atomic_load(&l->running)) return;
+    atomic_store(&l->running, false);
+    pthread_join(l->thread, NULL);
+    close(l->fd);
+    l->fd = -1;
+}
+
 /*=============================================================================
  * Statistics Output
  *===========================================================================*/
@@ -139,6 +545,77 @@ static void stats_print(void) {
            g_stats.flows_active);
 }
 
+/*=============================================================================
+ * Prometheus Metrics
+ * 
+ * Rendered from the main loop once a second; the exporter thread only
+ * copies the last rendering to scrapers and never takes g_mutex.
+ *===========================================================================*/
+static void metrics_render(void) {
+    pthread_mutex_lock(&g_mutex);
+    stats_t st = g_stats;
+    pthread_mutex_unlock(&g_mutex);
+    
+    metrics_t* m = &g_metrics;
+    metrics_begin(m);
+    metrics_type(m, "dedupe_info", "gauge", "Daemon version");
+    metrics_printf(m, "dedupe_info{version=\"%s\"} 1\n", VERSION);
+    metrics_type(m, "dedupe_packets_total", "counter", "Packets checked");
+    metrics_printf(m, "dedupe_packets_total %lu\n", st.packets_total);
+    metrics_type(m, "dedupe_hits_total", "counter", "Duplicates dropped (later arrival)");
+    metrics_printf(m, "dedupe_hits_total %lu\n", st.packets_dropped);
+    metrics_type(m, "dedupe_misses_total", "counter", "First arrivals forwarded");
+    metrics_printf(m, "dedupe_misses_total %lu\n", st.packets_forwarded);
+    metrics_type(m, "dedupe_evictions_total", "counter", "Live flow entries overwritten by a colliding packet");
+    metrics_printf(m, "dedupe_evictions_total %lu\n", st.evictions);
+    metrics_type(m, "dedupe_flows_active", "gauge", "Flow table entries within TTL");
+    metrics_printf(m, "dedupe_flows_active %lu\n", st.flows_active);
+    metrics_type(m, "dedupe_flow_table_size", "gauge", "Flow table slots");
+    metrics_printf(m, "dedupe_flow_table_size %d\n", FLOW_TABLE_SIZE);
+    metrics_type(m, "dedupe_flow_table_occupancy", "gauge", "Active entries / slots");
+    metrics_printf(m, "dedupe_flow_table_occupancy %.4f\n", (double)st.flows_active / FLOW_TABLE_SIZE);
+    if (atomic_load(&g_retpath.running)) {
+        metrics_type(m, "dedupe_retpath_switches_total", "counter", "Return path switch requests by outcome");
+        metrics_printf(m, "dedupe_retpath_switches_total{result=\"applied\"} %lu\n", (unsigned long)atomic_load(&g_retpath.applied));
+        metrics_printf(m, "dedupe_retpath_switches_total{result=\"duplicate\"} %lu\n", (unsigned long)atomic_load(&g_retpath.duplicates));
+        metrics_printf(m, "dedupe_retpath_switches_total{result=\"stale\"} %lu\n", (unsigned long)atomic_load(&g_retpath.stale));
+        metrics_printf(m, "dedupe_retpath_switches_total{result=\"failed\"} %lu\n", (unsigned long)atomic_load(&g_retpath.failed));
+        metrics_printf(m, "dedupe_retpath_switches_total{result=\"rejected\"} %lu\n", (unsigned long)atomic_load(&g_retpath.rejected));
+    }
+    /* The learn and retpath threads move these under g_route_lock */
+    int route_cur;
+    double lag_us[RETPATH_PATHS];
+    uint64_t firsts[RETPATH_PATHS];
+    pthread_mutex_lock(&g_route_lock);
+    route_cur = g_route_cur;
+    for (int i = 0; i < g_svc_route_count; i++) {
+        lag_us[i] = g_learn.tunnels[i].lag_us;
+        firsts[i] = g_learn.tunnels[i].firsts_total;
+    }
+    pthread_mutex_unlock(&g_route_lock);
+    if (atomic_load(&g_learn.running)) {
+        metrics_type(m, "dedupe_learn_switches_total", "counter", "Return path moves learned from the data plane");
+        metrics_printf(m, "dedupe_learn_switches_total %lu\n", (unsigned long)atomic_load(&g_learn.switches));
+        metrics_type(m, "dedupe_first_arrivals_total", "counter", "Packets a tunnel delivered first");
+        for (int i = 0; i < g_svc_route_count; i++) {
+            metrics_printf(m, "dedupe_first_arrivals_total{uplink=\"%s\"} %lu\n", g_svc_routes[i].uplink,
+                           (unsigned long)firsts[i]);
+        }
+        metrics_type(m, "dedupe_tunnel_lag_ms", "gauge", "Smoothed lag of a tunnel's copies behind the first");
+        for (int i = 0; i < g_svc_route_count; i++) {
+            metrics_printf(m, "dedupe_tunnel_lag_ms{uplink=\"%s\"} %.3f\n", g_svc_routes[i].uplink,
+                           lag_us[i] / 1000.0);
+        }
+    }
+    metrics_type(m, "dedupe_return_uplink", "gauge", "Uplink the service prefix returns over, 1 = current");
+    for (int i = 0; i < g_svc_route_count; i++) {
+        metrics_printf(m, "dedupe_return_uplink{uplink=\"%s\"} %d\n", g_svc_routes[i].uplink, route_cur == i);
+    }
+    metrics_type(m, "dedupe_metrics_scrapes_total", "counter", "Scrapes served");
+    metrics_printf(m, "dedupe_metrics_scrapes_total %lu\n", (unsigned long)atomic_load(&m->scrapes));
+    metrics_publish(m);
+}
+
 /*=============================================================================
  * Signal Handling
  *===========================================================================*/
@@ -160,10 +637,33 @@ static void signal_handler(int sig) {
  * This daemon just tracks statistics.
  *===========================================================================*/
 int main(int argc, char** argv) {
-    (void)argc; (void)argv;
+    const char* metrics_listen = DEFAULT_METRICS_LISTEN;
+    const char* retpath_port = "9110";    /* RETPATH_PORT */
+    const char* retpath_key = DEFAULT_RETPATH_KEY;
+    const char* retpath_netns = DEFAULT_RETPATH_NETNS;
+    bool learn = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_listen = argv[++i];
+        } else if (strcmp(argv[i], "--retpath") == 0 && i + 1 < argc) {
+            retpath_port = argv[++i];
+        } else if (strcmp(argv[i], "--retpath-key") == 0 && i + 1 < argc) {
+            retpath_key = argv[++i];
+        } else if (strcmp(argv[i], "--retpath-netns") == 0 && i + 1 < argc) {
+            retpath_netns = argv[++i];
+        } else if (strcmp(argv[i], "--learn") == 0 && i + 1 < argc) {
+            learn = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "--svc-route") == 0 && i + 1 < argc && svc_route_add(argv[++i]) == 0) {
+            /* Added */
+        } else {
+            fprintf(stderr, "Usage: %s [--metrics ADDR:PORT|off] [--retpath PORT|off] [--retpath-key FILE] [--retpath-netns NS] [--learn on|off] [--svc-route UPLINK,DEV,GW]...\n", argv[0]);
+            return 2;
+        }
+    }
     
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
     
     printf("[dedupe] PathSteer Guardian Dedupe Daemon v%s\n", VERSION);
     printf("[dedupe] Flow table size: %d, TTL: %dms\n", FLOW_TABLE_SIZE, FLOW_TTL_MS);
@@ -171,6 +671,37 @@ int main(int argc, char** argv) {
     memset(g_flows, 0, sizeof(g_flows));
     memset(&g_stats, 0, sizeof(g_stats));
     
+    metrics_init(&g_metrics);
+    if (strcmp(metrics_listen, "off") != 0) {
+        if (metrics_start(&g_metrics, metrics_listen) == 0) {
+            printf("[dedupe] Metrics on http://%s/metrics\n", metrics_listen);
+        } else {
+            fprintf(stderr, "[dedupe] Metrics on %s: %s\n", metrics_listen, strerror(errno));
+        }
+    }
+    
+    retpath_server_init(&g_retpath);
+    if (strcmp(retpath_port, "off") != 0) {
+        uint8_t key[RETPATH_KEY_LEN];
+        if (retpath_load_key(retpath_key, key) < 0) {
+            fprintf(stderr, "[dedupe] Return path key %s: %s\n", retpath_key, strerror(errno));
+        } else if (retpath_server_start(&g_retpath, key, retpath_netns, atoi(retpath_port),
+                                        retpath_apply, retpath_on_event, NULL) < 0) {
+            fprintf(stderr, "[dedupe] Return path on %s:%s: %s\n", retpath_netns, retpath_port, strerror(errno));
+        } else {
+            printf("[dedupe] Return path on udp/%s in %s\n", retpath_port, retpath_netns[0] ? retpath_netns : "default netns");
+        }
+        memset(key, 0, sizeof(key));
+    }
+    
+    if (learn) {
+        if (learn_start(&g_learn, retpath_netns) < 0) {
+            fprintf(stderr, "[dedupe] Return path learning in %s: %s\n", retpath_netns, strerror(errno));
+        } else {
+            printf("[dedupe] Learning return path from svc_* tunnels in %s\n", retpath_netns[0] ? retpath_netns : "default netns");
+        }
+    }
+    
     /* 
      * In production, we'd set up NFQUEUE here.
      * For V1, we just monitor and report statistics.
@@ -189,9 +720,10 @@ int main(int argc, char** argv) {
             last_stats = now;
         }
         
-        /* Clean expired flows */
+        /* Clean expired flows, refresh metrics */
         if (now - last_cleanup >= 1) {
             flow_cleanup();
+            if (g_metrics.fd >= 0) metrics_render();
             last_cleanup = now;
         }
         
@@ -199,6 +731,9 @@ int main(int argc, char** argv) {
     }
     
     printf("[dedupe] Shutdown\n");
+    learn_stop(&g_learn);
+    retpath_server_stop(&g_retpath);
+    metrics_stop(&g_metrics);
     stats_print();
     
     return 0;
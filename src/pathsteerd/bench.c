@@ -0,0 +1,463 @@
+/*******************************************************************************
+ * bench.c - PathSteer Guardian Decision Core Microbenchmarks (pathsteer-bench)
+ *
+ * PURPOSE:
+ *   Numbers for the code the main loop runs every iteration, so an
+ *   optimization or a new feature in the decision core can be judged by a
+ *   before/after comparison (scripts/bench-compare.py) instead of by eye.
+ *
+ *     pathsteer-bench [--cpu N] [--reps N] [--sample-ms MS] [--filter NAME]
+ *                     [--label TEXT] [--out FILE]
+ *
+ * BENCHMARKS (ns per call, synthetic state, no I/O unless named):
+ *   tripwire_check      engine_tripwire_check() on a healthy active uplink:
+ *                       every check runs, none fires
+ *   select_best         engine_select_best() over six available uplinks
+ *   prediction_tick     engine_prediction_tick(): features and model for all
+ *                       uplinks (online learning off, as in pathsteer-replay)
+ *   protection_tick     engine_protection_tick() inside the hold time
+ *   status_render       status.json serialization into memory, the body of
+ *                       status_write() without open/close and without the
+ *                       daemon-only sections (PoP, latency, watchdog, shadows)
+ *   engine_config_load  decision keys from a full config in memory
+ *   config_load         the daemon's config file read and config_parse():
+ *                       validation and every key
+ *
+ *   Linked against the daemon's own engine.c, config.c and status.c, so
+ *   what is measured is what pathsteerd runs.
+ *
+ * METHOD:
+ *   Pinned to one CPU (--cpu, default the last). Each benchmark is warmed
+ *   up for BENCH_WARMUP_MS, calibrated to the number of calls that takes
+ *   --sample-ms, then timed for --reps samples of that many calls. Reported
+ *   per benchmark: median and MAD (robust to the odd interrupted sample),
+ *   min, p5/p95, mean, stddev and every sample, so two runs can be compared
+ *   with a rank test. Frequency scaling is the caller's job
+ *   (scripts/bench-micro.sh sets the performance governor and turns boost
+ *   off); the governor and frequency found are recorded and a warning is
+ *   printed when they can move.
+ *
+ * OUTPUT (JSONL, --out or stdout):
+ *   {"type":"meta",...}    host, CPU, governor, compiler, label, parameters
+ *   {"type":"bench","name":...,"median_ns":...,"samples":[...]}
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "config.h"
+#include "engine.h"
+#include "model.h"
+#include "status.h"
+
+#define BENCH_REPS              31
+#define BENCH_SAMPLE_MS         20
+#define BENCH_WARMUP_MS         200
+
+/* Synthetic clock: fixed, so every call takes the same path */
+#define BENCH_T0_US             1700000000000000LL
+
+typedef struct {
+    const char* name;
+    void        (*setup)(void);
+    void        (*run)(void);
+} bench_t;
+
+static volatile int64_t g_bench_sink;       /* Keeps results observable */
+static char             g_bench_config[256];
+static config_t         g_bench_cfg;        /* BENCH_CONFIG, parsed once */
+
+/* The state the daemon's main loop drives, synthetic */
+static uplink_t         g_uplinks[MAX_UPLINKS];
+static status_t         g_status;
+static gps_t            g_gps;
+static model_t*         g_model;
+static engine_t         g_engine;
+
+static int64_t bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*=============================================================================
+ * Synthetic State
+ *===========================================================================*/
+
+static int64_t bench_now_us(void* ctx) {
+    (void)ctx;
+    return BENCH_T0_US;
+}
+
+static void bench_log_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    g_bench_sink += (int64_t)strlen(type) + (int64_t)strlen(json);
+}
+
+static void bench_dup_enable(void* ctx, uplink_id_t src, uplink_id_t dst) {
+    (void)ctx;
+    (void)src;
+    (void)dst;
+    g_status.dup_enabled = true;
+}
+
+static void bench_dup_disable(void* ctx) {
+    (void)ctx;
+    g_status.dup_enabled = false;
+}
+
+/* No failure history yet: the prior, as the daemon answers at a new place */
+static double bench_corr(void* ctx, int a, int b, double prior) {
+    (void)ctx;
+    g_bench_sink += a + b;
+    return prior;
+}
+
+/* The daemon's engine ops minus the clock, tc, the log and learning */
+static const engine_ops_t g_bench_ops = {
+    .now_us = bench_now_us,
+    .log_event = bench_log_event,
+    .dup_enable = bench_dup_enable,
+    .dup_disable = bench_dup_disable,
+    .corr = bench_corr,
+};
+
+/* A production-sized config, for the parse benchmarks */
+static const char* BENCH_CONFIG =
+    "{\"id\":\"bench-edge\",\"role\":\"edge\",\"mode\":\"tripwire\","
+    "\"uplinks\":[{\"name\":\"cell_a\",\"type\":\"lte\",\"enabled\":true},"
+    "{\"name\":\"cell_b\",\"type\":\"lte\",\"enabled\":true},"
+    "{\"name\":\"sl_a\",\"type\":\"starlink\",\"enabled\":true},"
+    "{\"name\":\"sl_b\",\"type\":\"starlink\",\"enabled\":true},"
+    "{\"name\":\"fa\",\"type\":\"fiber\",\"enabled\":true},"
+    "{\"name\":\"fb\",\"type\":\"fiber\",\"enabled\":true}],"
+    "\"rtt_step_ms\":80,\"rtt_window_ms\":200,\"probe_miss_count\":2,\"probe_miss_window_ms\":300,"
+    "\"rsrp_drop_db\":8,\"sinr_drop_db\":6,\"preroll_ms\":500,\"min_hold_sec\":8,\"clean_exit_sec\":5,"
+    "\"predict_horizon_sec\":30,\"predict_lead_sec\":5,\"risk_prepare\":0.4,\"risk_protect\":0.7,"
+    "\"gps_enabled\":true,\"pcap_enabled\":false,\"sample_rate_hz\":10,\"trace_log\":true,"
+    "\"training_db\":\"/opt/pathsteer/data/training.db\",\"routes_file\":\"/opt/pathsteer/data/routes.bin\","
+    "\"model_file\":\"/opt/pathsteer/data/risk_model.txt\",\"metrics_listen\":\"127.0.0.1:9108\","
+    "\"flightrec_pre_sec\":5,\"flightrec_post_sec\":10,\"flowmon_netns\":\"ns_vip\",\"rtpmon_netns\":\"ns_vip\"}";
+
+/* Six enabled uplinks with a full, slightly noisy probe history */
+static void bench_state(void) {
+    uint32_t seed = 12345;
+    memset(g_uplinks, 0, sizeof(g_uplinks));
+    memset(&g_status, 0, sizeof(g_status));
+    memset(&g_gps, 0, sizeof(g_gps));
+    if (g_bench_cfg.uplink_count == 0) {
+        char err[256];
+        if (config_parse(BENCH_CONFIG, &g_bench_cfg, err, sizeof(err)) != 0) {
+            fprintf(stderr, "BENCH_CONFIG: %s\n", err);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < g_bench_cfg.uplink_count; i++) {
+        config_uplink_init(&g_uplinks[i], i, &g_bench_cfg.uplinks[i]);
+    }
+    snprintf(g_status.run_id, sizeof(g_status.run_id), "bench");
+    snprintf(g_status.recommendation, sizeof(g_status.recommendation), "NORMAL");
+
+    for (int i = 0; i < g_bench_cfg.uplink_count; i++) {
+        uplink_t* u = &g_uplinks[i];
+        u->enabled = true;
+        u->available = true;
+        double base = u->type == UPLINK_TYPE_FIBER ? 8 : u->type == UPLINK_TYPE_STARLINK ? 35 : 55;
+        for (int k = 0; k < HISTORY_SIZE; k++) {
+            seed = seed * 1103515245u + 12345u;
+            engine_probe(u, base + (seed >> 16) % 10, BENCH_T0_US - (HISTORY_SIZE - k) * 100000LL);
+        }
+        if (u->type == UPLINK_TYPE_LTE) {
+            u->cellular.rsrp = -95 + i;
+            u->cellular.sinr = 12;
+            snprintf(u->cellular.carrier, sizeof(u->cellular.carrier), "bench");
+        }
+        if (u->type == UPLINK_TYPE_STARLINK) {
+            u->starlink.online = true;
+            u->starlink.obstruction_pct = 0.5;
+            snprintf(u->starlink.state, sizeof(u->starlink.state), "CONNECTED");
+        }
+        u->risk_ahead = 0.1f;
+        u->confidence = 0.5f;
+        u->eta_prepare = -1;
+        u->eta_protect = -1;
+    }
+    g_status.active_uplink = UPLINK_CELL_A;
+    g_uplinks[UPLINK_CELL_A].is_active = true;
+    g_gps.valid = true;
+    g_gps.speed_mps = 20;
+
+    if (!g_model) {
+        g_model = malloc(sizeof(model_t));
+        if (!g_model) exit(1);
+    }
+    model_defaults(g_model);
+
+    g_engine.ops = &g_bench_ops;
+    g_engine.ctx = NULL;
+    g_engine.cfg = &g_bench_cfg;
+    g_engine.uplinks = g_uplinks;
+    g_engine.n_uplinks = g_bench_cfg.uplink_count;
+    g_engine.status = &g_status;
+    g_engine.gps = &g_gps;
+    g_engine.model = g_model;
+}
+
+/*=============================================================================
+ * Benchmarks
+ *===========================================================================*/
+
+static void run_tripwire_check(void) {
+    g_bench_sink += engine_tripwire_check(&g_engine, &g_uplinks[g_status.active_uplink]);
+}
+
+static void run_select_best(void) {
+    g_bench_sink += engine_select_best(&g_engine);
+}
+
+static void run_prediction_tick(void) {
+    engine_prediction_tick(&g_engine);
+    g_bench_sink += (int64_t)(g_status.global_risk * 1000);
+}
+
+static void setup_protection_tick(void) {
+    g_status.state = STATE_PROTECT;
+    g_status.protect_start_us = BENCH_T0_US - 1000000;
+}
+
+static void run_protection_tick(void) {
+    engine_protection_tick(&g_engine);
+    g_bench_sink += g_status.hold_remaining_sec;
+}
+
+static FILE*  g_status_fp;
+static char   g_status_buf[16384];
+
+static void setup_status_render(void) {
+    if (!g_status_fp) g_status_fp = fmemopen(g_status_buf, sizeof(g_status_buf), "w");
+    if (!g_status_fp) exit(1);
+}
+
+static void run_status_render(void) {
+    status_view_t v = { .engine = &g_engine, .route = -1 };
+    rewind(g_status_fp);
+    status_render(g_status_fp, &v);
+    fflush(g_status_fp);
+    g_bench_sink += ftell(g_status_fp);
+}
+
+static void run_engine_config_load(void) {
+    static config_t cfg;
+    engine_config_load(&cfg, BENCH_CONFIG);
+    g_bench_sink += cfg.rtt_step_ms;
+}
+
+static void setup_config_load(void) {
+    snprintf(g_bench_config, sizeof(g_bench_config), "/tmp/pathsteer-bench-XXXXXX");
+    int fd = mkstemp(g_bench_config);
+    if (fd < 0 || write(fd, BENCH_CONFIG, strlen(BENCH_CONFIG)) != (ssize_t)strlen(BENCH_CONFIG)) {
+        fprintf(stderr, "Cannot write %s\n", g_bench_config);
+        exit(1);
+    }
+    close(fd);
+}
+
+static void run_config_load(void) {
+    static config_t cfg;
+    char err[256];
+    char* json = config_file_read(g_bench_config);
+    if (!json || config_parse(json, &cfg, err, sizeof(err)) != 0) exit(1);
+    free(json);
+    g_bench_sink += cfg.uplink_count;
+}
+
+static const bench_t BENCHES[] = {
+    { "tripwire_check",     NULL,                   run_tripwire_check },
+    { "select_best",        NULL,                   run_select_best },
+    { "prediction_tick",    NULL,                   run_prediction_tick },
+    { "protection_tick",    setup_protection_tick,  run_protection_tick },
+    { "status_render",      setup_status_render,    run_status_render },
+    { "engine_config_load", NULL,                   run_engine_config_load },
+    { "config_load",        setup_config_load,      run_config_load },
+};
+
+/*=============================================================================
+ * Harness
+ *===========================================================================*/
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Quantile of sorted v by linear interpolation */
+static double quantile(const double* v, int n, double q) {
+    double pos = q * (n - 1);
+    int lo = (int)pos;
+    if (lo >= n - 1) return v[n - 1];
+    return v[lo] + (pos - lo) * (v[lo + 1] - v[lo]);
+}
+
+static void bench_run(const bench_t* b, int reps, int sample_ms, FILE* out) {
+    bench_state();
+    if (b->setup) b->setup();
+
+    /* Warm caches and branch predictors, then size a sample */
+    int64_t start = bench_ns();
+    uint64_t calls = 0;
+    while (bench_ns() - start < BENCH_WARMUP_MS * 1000000LL) {
+        b->run();
+        calls++;
+    }
+    double per_call = (double)(bench_ns() - start) / (double)calls;
+    uint64_t iters = (uint64_t)(sample_ms * 1e6 / per_call);
+    if (iters < 1) iters = 1;
+
+    double* ns = malloc((size_t)reps * sizeof(double));
+    double* sorted = malloc((size_t)reps * sizeof(double));
+    double* dev = malloc((size_t)reps * sizeof(double));
+    if (!ns || !sorted || !dev) exit(1);
+    double sum = 0;
+    for (int r = 0; r < reps; r++) {
+        int64_t t0 = bench_ns();
+        for (uint64_t k = 0; k < iters; k++) b->run();
+        ns[r] = (double)(bench_ns() - t0) / (double)iters;
+        sum += ns[r];
+    }
+
+    memcpy(sorted, ns, (size_t)reps * sizeof(double));
+    qsort(sorted, (size_t)reps, sizeof(double), cmp_double);
+    double median = quantile(sorted, reps, 0.5);
+    double mean = sum / reps, var = 0;
+    for (int r = 0; r < reps; r++) {
+        var += (ns[r] - mean) * (ns[r] - mean);
+        dev[r] = fabs(ns[r] - median);
+    }
+    qsort(dev, (size_t)reps, sizeof(double), cmp_double);
+
+    fprintf(out, "{\"type\":\"bench\",\"name\":\"%s\",\"reps\":%d,\"iters\":%llu,\"median_ns\":%.2f,"
+            "\"mad_ns\":%.2f,\"min_ns\":%.2f,\"p5_ns\":%.2f,\"p95_ns\":%.2f,\"max_ns\":%.2f,"
+            "\"mean_ns\":%.2f,\"stddev_ns\":%.2f,\"samples\":[",
+            b->name, reps, (unsigned long long)iters, median, quantile(dev, reps, 0.5), sorted[0],
+            quantile(sorted, reps, 0.05), quantile(sorted, reps, 0.95), sorted[reps - 1], mean,
+            reps > 1 ? sqrt(var / (reps - 1)) : 0.0);
+    for (int r = 0; r < reps; r++) fprintf(out, "%s%.2f", r ? "," : "", ns[r]);
+    fprintf(out, "]}\n");
+    fflush(out);
+    fprintf(stderr, "%-20s %10.1f ns  (MAD %.1f, p5 %.1f, p95 %.1f)\n", b->name, median,
+            quantile(dev, reps, 0.5), quantile(sorted, reps, 0.05), quantile(sorted, reps, 0.95));
+    free(ns);
+    free(sorted);
+    free(dev);
+}
+
+static void sysfs_read(const char* path, char* out, size_t len) {
+    out[0] = '\0';
+    FILE* f = fopen(path, "r");
+    if (!f) return;
+    if (fgets(out, (int)len, f)) out[strcspn(out, "\n")] = '\0';
+    fclose(f);
+}
+
+static void cpu_model(char* out, size_t len) {
+    char line[256];
+    snprintf(out, len, "unknown");
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        char* colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && colon) {
+            colon += 2;
+            colon[strcspn(colon, "\n")] = '\0';
+            snprintf(out, len, "%s", colon);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static void write_meta(FILE* out, int cpu, int reps, int sample_ms, const char* label) {
+    char path[128], governor[32], freq[32], boost[8], no_turbo[8], model[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu);
+    sysfs_read(path, governor, sizeof(governor));
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+    sysfs_read(path, freq, sizeof(freq));
+    sysfs_read("/sys/devices/system/cpu/cpufreq/boost", boost, sizeof(boost));
+    sysfs_read("/sys/devices/system/cpu/intel_pstate/no_turbo", no_turbo, sizeof(no_turbo));
+    cpu_model(model, sizeof(model));
+    struct utsname un;
+    uname(&un);
+
+    bool turbo = strcmp(boost, "1") == 0 || strcmp(no_turbo, "0") == 0;
+    if ((governor[0] && strcmp(governor, "performance") != 0) || turbo) {
+        fprintf(stderr, "WARNING: cpu%d governor \"%s\"%s - frequency can move, results are noisy "
+                "(scripts/bench-micro.sh pins it)\n", cpu, governor, turbo ? ", turbo on" : "");
+    }
+
+    fprintf(out, "{\"type\":\"meta\",\"time\":%ld,\"label\":\"%s\",\"host\":\"%s\",\"kernel\":\"%s\","
+            "\"cpu_model\":\"%s\",\"cpu\":%d,\"governor\":\"%s\",\"freq_khz\":%s,\"turbo\":%s,"
+            "\"compiler\":\"%s\",\"reps\":%d,\"sample_ms\":%d}\n",
+            (long)time(NULL), label, un.nodename, un.release, model, cpu, governor,
+            freq[0] ? freq : "null", turbo ? "true" : "false", __VERSION__, reps, sample_ms);
+}
+
+int main(int argc, char** argv) {
+    int cpu = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    int reps = BENCH_REPS, sample_ms = BENCH_SAMPLE_MS;
+    const char *filter = NULL, *label = "", *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc) {
+            sample_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [--cpu N] [--reps N] [--sample-ms MS] [--filter NAME]\n"
+                    "          [--label TEXT] [--out FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 3) reps = 3;
+    if (sample_ms < 1) sample_ms = 1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        fprintf(stderr, "Cannot pin to cpu%d: %s\n", cpu, strerror(errno));
+        return 1;
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", out_path);
+        return 1;
+    }
+    write_meta(out, cpu, reps, sample_ms, label);
+    for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++) {
+        if (filter && !strstr(BENCHES[i].name, filter)) continue;
+        bench_run(&BENCHES[i], reps, sample_ms, out);
+    }
+
+    if (g_bench_config[0]) unlink(g_bench_config);
+    if (out != stdout) fclose(out);
+    return 0;
+}
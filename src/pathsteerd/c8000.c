@@ -0,0 +1,397 @@
+/*******************************************************************************
+ * c8000.c - PathSteer Guardian Persistent C8000 NETCONF Session
+ *
+ * See c8000.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include "c8000.h"
+
+#define NETCONF_EOM     "]]>]]>"
+#define NETCONF_HELLO   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" \
+                        "<hello xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><capabilities>" \
+                        "<capability>urn:ietf:params:netconf:base:1.0</capability>" \
+                        "</capabilities></hello>" NETCONF_EOM
+
+static int64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void emit(c8000_session_t* s, const char* type, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void emit(c8000_session_t* s, const char* type, const char* fmt, ...) {
+    if (!s->on_event) return;
+    char json[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(json, sizeof(json), fmt, ap);
+    va_end(ap);
+    s->on_event(s->ctx, type, json);
+}
+
+/*=============================================================================
+ * TRANSPORT
+ *===========================================================================*/
+
+static int write_all(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Next message into s->buf (EOM stripped, NUL terminated); its length, or
+ * -1 on EOF, timeout or stop. Bytes past the EOM stay for the next call. */
+static ssize_t session_read(c8000_session_t* s, int timeout_ms) {
+    int64_t deadline = mono_us() + timeout_ms * 1000LL;
+    for (;;) {
+        s->buf[s->buf_len] = '\0';
+        char* eom = strstr(s->buf, NETCONF_EOM);
+        if (eom) return eom - s->buf;
+        if (s->buf_len >= sizeof(s->buf) - 1) s->buf_len = 0;    /* Oversized: drop, keep reading */
+
+        int64_t left = deadline - mono_us();
+        if (left <= 0 || !atomic_load(&s->running)) return -1;
+        struct pollfd pfd = { .fd = s->from_fd, .events = POLLIN };
+        if (poll(&pfd, 1, left > 200000 ? 200 : (int)(left / 1000) + 1) <= 0) continue;
+        ssize_t n = read(s->from_fd, s->buf + s->buf_len, sizeof(s->buf) - 1 - s->buf_len);
+        if (n <= 0) return -1;
+        s->buf_len += (size_t)n;
+    }
+}
+
+/* Drop the message session_read() returned */
+static void session_consume(c8000_session_t* s, size_t msg_len) {
+    size_t used = msg_len + strlen(NETCONF_EOM);
+    memmove(s->buf, s->buf + used, s->buf_len - used);
+    s->buf_len -= used;
+}
+
+static void session_close(c8000_session_t* s, const char* why) {
+    if (s->pid > 0) {
+        close(s->to_fd);
+        close(s->from_fd);
+        kill(s->pid, SIGTERM);
+        waitpid(s->pid, NULL, 0);
+    }
+    s->pid = 0;
+    s->to_fd = s->from_fd = -1;
+    s->buf_len = 0;
+    if (atomic_exchange(&s->up, false)) {
+        emit(s, "c8000_session_down", "{\"host\":\"%s\",\"reason\":\"%s\"}", s->host, why);
+        s->backoff_ms = C8000_BACKOFF_MS;
+    }
+    s->next_connect_us = mono_us() + s->backoff_ms * 1000LL;
+    s->backoff_ms = s->backoff_ms * 2 > C8000_BACKOFF_MAX_MS ? C8000_BACKOFF_MAX_MS : s->backoff_ms * 2;
+}
+
+static void session_open(c8000_session_t* s) {
+    int to[2], from[2];
+    if (pipe2(to, O_CLOEXEC) < 0) return;
+    if (pipe2(from, O_CLOEXEC) < 0) {
+        close(to[0]);
+        close(to[1]);
+        return;
+    }
+
+    /* sshpass -e reads SSHPASS. The environment is built before fork(): in
+     * a threaded daemon the child must not malloc, as setenv() may */
+    char sshpass[sizeof(s->pass) + 8];
+    char** envp = environ;
+    if (s->pass[0]) {
+        size_t ne = 0;
+        while (environ[ne]) ne++;
+        envp = calloc(ne + 2, sizeof(*envp));
+        if (!envp) {
+            close(to[0]);
+            close(to[1]);
+            close(from[0]);
+            close(from[1]);
+            return;
+        }
+        snprintf(sshpass, sizeof(sshpass), "SSHPASS=%s", s->pass);
+        envp[0] = sshpass;
+        for (size_t i = 0, k = 1; i < ne; i++) {
+            if (strncmp(environ[i], "SSHPASS=", 8) != 0) envp[k++] = environ[i];
+        }
+    }
+
+    char port[16];
+    snprintf(port, sizeof(port), "%d", s->port);
+    const char* argv[24];
+    int n = 0;
+    if (s->pass[0]) {
+        argv[n++] = "sshpass";
+        argv[n++] = "-e";
+    }
+    argv[n++] = "ssh";
+    argv[n++] = "-s";
+    argv[n++] = "-p";
+    argv[n++] = port;
+    argv[n++] = "-o";
+    argv[n++] = "ConnectTimeout=10";
+    argv[n++] = "-o";
+    argv[n++] = "ServerAliveInterval=5";
+    argv[n++] = "-o";
+    argv[n++] = "ServerAliveCountMax=3";
+    argv[n++] = "-o";
+    argv[n++] = "StrictHostKeyChecking=accept-new";
+    if (!s->pass[0]) {
+        argv[n++] = "-o";
+        argv[n++] = "BatchMode=yes";
+    }
+    if (s->user[0]) {
+        argv[n++] = "-l";
+        argv[n++] = s->user;
+    }
+    argv[n++] = s->host;
+    argv[n++] = "netconf";
+    argv[n] = NULL;
+
+    int64_t t0 = mono_us();
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to[0], STDIN_FILENO);
+        dup2(from[1], STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        execvpe(argv[0], (char* const*)argv, envp);
+        _exit(127);
+    }
+    close(to[0]);
+    close(from[1]);
+    if (envp != environ) {
+        free(envp);
+        memset(sshpass, 0, sizeof(sshpass));
+    }
+    if (pid < 0) {
+        close(to[1]);
+        close(from[0]);
+        session_close(s, "fork");
+        return;
+    }
+    s->pid = pid;
+    s->to_fd = to[1];
+    s->from_fd = from[0];
+    s->buf_len = 0;
+    atomic_fetch_add(&s->connects, 1);
+
+    ssize_t len = session_read(s, C8000_HELLO_TIMEOUT_MS);
+    if (len < 0 || !strstr(s->buf, "<hello") ||
+        write_all(s->to_fd, NETCONF_HELLO, strlen(NETCONF_HELLO)) < 0) {
+        emit(s, "c8000_session_down", "{\"host\":\"%s\",\"reason\":\"%s\"}", s->host,
+             len < 0 ? "no hello" : "bad hello");
+        session_close(s, "hello");
+        return;
+    }
+    session_consume(s, (size_t)len);
+    atomic_store(&s->up, true);
+    s->backoff_ms = C8000_BACKOFF_MS;
+    emit(s, "c8000_session_up", "{\"host\":\"%s\",\"port\":%d,\"ms\":%.0f}", s->host, s->port,
+         (mono_us() - t0) / 1000.0);
+}
+
+/*=============================================================================
+ * RPC
+ *===========================================================================*/
+
+/* Send rpc for target; false if the session failed and it should go again */
+static bool session_rpc(c8000_session_t* s, int target, const char* rpc) {
+    char head[96];
+    unsigned id = ++s->msg_id;
+    snprintf(head, sizeof(head), "<rpc message-id=\"%u\" xmlns=\"urn:ietf:params:xml:ns:netconf:base:1.0\">", id);
+    int64_t t0 = mono_us();
+    if (write_all(s->to_fd, head, strlen(head)) < 0 || write_all(s->to_fd, rpc, strlen(rpc)) < 0 ||
+        write_all(s->to_fd, "</rpc>" NETCONF_EOM, strlen("</rpc>" NETCONF_EOM)) < 0) {
+        session_close(s, "write");
+        return false;
+    }
+
+    char want[32];
+    snprintf(want, sizeof(want), "message-id=\"%u\"", id);
+    for (;;) {
+        ssize_t len = session_read(s, C8000_RPC_TIMEOUT_MS);
+        if (len < 0) {
+            session_close(s, "rpc timeout");
+            return false;
+        }
+        bool mine = strstr(s->buf, want) != NULL;
+        bool ok = strstr(s->buf, "<ok/>") != NULL;
+        char err[128] = "";
+        const char* m = strstr(s->buf, "<error-message");
+        if (m && (m = strchr(m, '>')) != NULL) {
+            size_t k = 0;
+            for (m++; *m && *m != '<' && k < sizeof(err) - 1; m++) {
+                char c = *m;     /* Fit for a JSON string */
+                err[k++] = c == '"' || c == '\\' ? '\'' : (unsigned char)c < ' ' ? ' ' : c;
+            }
+            err[k] = '\0';
+        }
+        session_consume(s, (size_t)len);
+        if (!mine) continue;    /* Notification or a stale reply */
+
+        int64_t took = mono_us() - t0;
+        atomic_store(&s->last_rpc_us, took);
+        if (ok) {
+            atomic_fetch_add(&s->rpcs_ok, 1);
+            atomic_store(&s->applied, target);
+            emit(s, "c8000_rpc_ok", "{\"target\":%d,\"ms\":%.1f}", target, took / 1000.0);
+        } else {
+            atomic_fetch_add(&s->rpcs_failed, 1);
+            emit(s, "c8000_rpc_error", "{\"target\":%d,\"ms\":%.1f,\"error\":\"%s\"}", target, took / 1000.0, err);
+        }
+        return true;
+    }
+}
+
+static void* session_thread(void* arg) {
+    c8000_session_t* s = arg;
+
+    while (atomic_load(&s->running)) {
+        if (s->pid == 0 && mono_us() >= s->next_connect_us) session_open(s);
+
+        if (atomic_load(&s->up)) {
+            pthread_mutex_lock(&s->lock);
+            char* rpc = s->pending;
+            int target = s->pending_target;
+            s->pending = NULL;
+            pthread_mutex_unlock(&s->lock);
+
+            if (rpc) {
+                if (session_rpc(s, target, rpc)) {
+                    atomic_compare_exchange_strong(&s->outstanding, &target, -1);
+                    free(rpc);
+                } else {
+                    /* Again on the next session, unless replaced meanwhile */
+                    pthread_mutex_lock(&s->lock);
+                    if (!s->pending) {
+                        s->pending = rpc;
+                        s->pending_target = target;
+                        rpc = NULL;
+                    }
+                    pthread_mutex_unlock(&s->lock);
+                    free(rpc);
+                }
+                continue;
+            }
+        }
+
+        struct pollfd pfd[2] = {
+            { .fd = s->wake[0], .events = POLLIN },
+            { .fd = s->from_fd, .events = POLLIN },
+        };
+        int nfds = atomic_load(&s->up) ? 2 : 1;
+        int timeout = 1000;
+        if (s->pid == 0) {
+            int64_t left = (s->next_connect_us - mono_us()) / 1000;
+            timeout = left < 0 ? 0 : left < timeout ? (int)left : timeout;
+        }
+        if (poll(pfd, nfds, timeout) <= 0) continue;
+        if (pfd[0].revents & POLLIN) {
+            char drain[16];
+            while (read(s->wake[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (nfds == 2 && (pfd[1].revents & (POLLIN | POLLHUP))) {
+            /* Unsolicited output between RPCs; EOF means ssh is gone */
+            ssize_t n = read(s->from_fd, s->buf, sizeof(s->buf) - 1);
+            if (n <= 0) session_close(s, "eof");
+            else s->buf_len = 0;
+        }
+    }
+    session_close(s, "stop");
+    return NULL;
+}
+
+/*=============================================================================
+ * API
+ *===========================================================================*/
+
+void c8000_init(c8000_session_t* s) {
+    memset(s, 0, sizeof(*s));
+    pthread_mutex_init(&s->lock, NULL);
+    s->wake[0] = s->wake[1] = -1;
+    s->to_fd = s->from_fd = -1;
+    atomic_store(&s->outstanding, -1);
+    atomic_store(&s->applied, -1);
+}
+
+int c8000_start(c8000_session_t* s, const char* host, int port, const char* user, const char* pass,
+                c8000_event_cb on_event, void* ctx) {
+    snprintf(s->host, sizeof(s->host), "%s", host);
+    snprintf(s->user, sizeof(s->user), "%s", user ? user : "");
+    snprintf(s->pass, sizeof(s->pass), "%s", pass ? pass : "");
+    s->port = port;
+    s->on_event = on_event;
+    s->ctx = ctx;
+    s->backoff_ms = C8000_BACKOFF_MS;
+    if (pipe2(s->wake, O_NONBLOCK | O_CLOEXEC) < 0) return -1;
+
+    atomic_store(&s->running, true);
+    int rc = pthread_create(&s->thread, NULL, session_thread, s);
+    if (rc != 0) {
+        atomic_store(&s->running, false);
+        close(s->wake[0]);
+        close(s->wake[1]);
+        s->wake[0] = s->wake[1] = -1;
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void c8000_request(c8000_session_t* s, int target, const char* rpc) {
+    if (!atomic_load(&s->running)) return;
+
+    char* copy = strdup(rpc);
+    if (!copy) return;
+    pthread_mutex_lock(&s->lock);
+    free(s->pending);
+    s->pending = copy;
+    s->pending_target = target;
+    atomic_store(&s->outstanding, target);
+    pthread_mutex_unlock(&s->lock);
+
+    char c = 1;
+    if (write(s->wake[1], &c, 1) < 0) {
+        /* Pipe full: a wakeup is already pending */
+    }
+}
+
+int c8000_pending(c8000_session_t* s) {
+    return atomic_load(&s->outstanding);
+}
+
+void c8000_stop(c8000_session_t* s) {
+    if (!atomic_load(&s->running)) return;
+    atomic_store(&s->running, false);
+    pthread_join(s->thread, NULL);
+    close(s->wake[0]);
+    close(s->wake[1]);
+    s->wake[0] = s->wake[1] = -1;
+    free(s->pending);
+    s->pending = NULL;
+}
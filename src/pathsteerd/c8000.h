@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * c8000.h - PathSteer Guardian Persistent C8000 NETCONF Session
+ *
+ * PURPOSE:
+ *   Moving the C8000 to another PoP used to run c8000-switch.sh: a fresh
+ *   SSH login per switch, seconds of handshake while the vehicle sits on
+ *   the PoP it is leaving. This keeps one NETCONF session (RFC 6242, over
+ *   the system ssh in subsystem mode) open the whole time, so a switch is
+ *   one <edit-config> RPC on an established channel.
+ *
+ * SESSION:
+ *   A thread runs `ssh -s ... netconf` (through sshpass with a password)
+ *   with its stdio on pipes, exchanges base:1.0 hellos and keeps the
+ *   session up; ssh's ServerAlive probes catch a dead transport. When the
+ *   session drops it reconnects, backing off from C8000_BACKOFF_MS to
+ *   C8000_BACKOFF_MAX_MS.
+ *
+ * REQUESTS:
+ *   c8000_request() queues the RPC body for a target (an <edit-config>
+ *   element); a newer request replaces one not sent yet. It goes out as
+ *   soon as the session is up. <ok/> makes the target the applied one; an
+ *   <rpc-error> is final; no reply within C8000_RPC_TIMEOUT_MS drops the
+ *   session and sends the request again on the next one.
+ *   Events: "c8000_session_up", "c8000_session_down", "c8000_rpc_ok",
+ *   "c8000_rpc_error".
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_C8000_H
+#define PATHSTEER_C8000_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define C8000_PORT              830
+#define C8000_HELLO_TIMEOUT_MS  15000       /* Login and server hello */
+#define C8000_RPC_TIMEOUT_MS    5000
+#define C8000_BACKOFF_MS        1000        /* Reconnect, doubling */
+#define C8000_BACKOFF_MAX_MS    30000
+#define C8000_BUF_SIZE          65536       /* Largest reply kept */
+
+/* Events from the session thread: type and its complete JSON object */
+typedef void (*c8000_event_cb)(void* ctx, const char* type, const char* json);
+
+typedef struct {
+    char                host[128];
+    char                user[32];
+    char                pass[64];
+    int                 port;
+    c8000_event_cb      on_event;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+    int                 wake[2];    /* Pipe: a request is pending */
+
+    pthread_mutex_t     lock;
+    char*               pending;    /* RPC body, malloc'd */
+    int                 pending_target;
+
+    /* Session thread only */
+    pid_t               pid;
+    int                 to_fd, from_fd;
+    char                buf[C8000_BUF_SIZE];
+    size_t              buf_len;
+    unsigned            msg_id;
+    int                 backoff_ms;
+    int64_t             next_connect_us;
+
+    _Atomic bool        up;
+    _Atomic int         outstanding;    /* Target requested, not answered, -1 = none */
+    _Atomic int         applied;    /* Target of the last <ok/>, -1 = none */
+    _Atomic uint64_t    connects, rpcs_ok, rpcs_failed;
+    _Atomic int64_t     last_rpc_us;
+} c8000_session_t;
+
+/* Zero s; c8000_stop() is then a no-op */
+void c8000_init(c8000_session_t* s);
+
+/* Keep a session to user@host:port. -1 with errno. */
+int  c8000_start(c8000_session_t* s, const char* host, int port, const char* user, const char* pass,
+                 c8000_event_cb on_event, void* ctx);
+
+/* Send rpc (the element inside <rpc>) to move to target */
+void c8000_request(c8000_session_t* s, int target, const char* rpc);
+
+/* Target of a request not answered yet, -1 = none */
+int  c8000_pending(c8000_session_t* s);
+
+void c8000_stop(c8000_session_t* s);
+
+#endif /* PATHSTEER_C8000_H */
@@ -0,0 +1,519 @@
+/*******************************************************************************
+ * config.c - PathSteer Guardian Daemon Configuration
+ *
+ * See config.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "c8000.h"
+#include "config.h"
+#include "engine.h"
+#include "handover.h"
+#include "json.h"
+#include "retpath.h"
+
+/* The built-in uplinks: no uplinks[], or the defaults of an entry of the same name */
+static const uplink_conf_t DEFAULT_UPLINKS[UPLINK_COUNT] = {
+    {.name = "cell_a", .type = UPLINK_TYPE_LTE, .interface = "wwan0", .veth = "veth_cell_a",
+     .wg = "wg-ca-cA", .probe_target = "10.200.1.1", .carrier = "T-Mobile",
+     .retpath_target = "10.203.5.1", .modem = 0, .enabled = true},
+    {.name = "cell_b", .type = UPLINK_TYPE_LTE, .interface = "wwan1", .veth = "veth_cell_b",
+     .wg = "wg-cb-cA", .probe_target = "10.200.2.1", .carrier = "AT&T",
+     .retpath_target = "10.203.6.1", .modem = 1, .enabled = true},
+    {.name = "sl_a", .type = UPLINK_TYPE_STARLINK, .interface = "enp3s0", .netns = "ns_sl_a",
+     .veth = "veth_sl_a", .probe_target = DEFAULT_PROBE_TARGET, .dish = DEFAULT_DISH,
+     .retpath_target = "10.203.3.1", .enabled = true},
+    {.name = "sl_b", .type = UPLINK_TYPE_STARLINK, .interface = "enp4s0", .netns = "ns_sl_b",
+     .veth = "veth_sl_b", .probe_target = DEFAULT_PROBE_TARGET, .dish = DEFAULT_DISH,
+     .retpath_target = "10.203.4.1", .enabled = true},
+    {.name = "fa", .type = UPLINK_TYPE_FIBER, .interface = "enp1s0", .netns = "ns_fa",
+     .veth = "veth_fa", .probe_target = DEFAULT_PROBE_TARGET, .retpath_target = "10.203.1.1",
+     .enabled = true},
+    {.name = "fb", .type = UPLINK_TYPE_FIBER, .interface = "enp2s0", .netns = "ns_fb",
+     .veth = "veth_fb", .probe_target = DEFAULT_PROBE_TARGET, .retpath_target = "10.203.2.1",
+     .enabled = true},
+};
+
+/*=============================================================================
+ * Schemas
+ *===========================================================================*/
+
+/* Types and ranges of the keys read below; other keys are not ours */
+static const json_field_t CONFIG_SCHEMA[] = {
+    { "node_id",                    JSON_STRING,    1, 63 },
+    { "id",                         JSON_STRING,    1, 63 },
+    { "role",                       JSON_STRING,    1, 15 },
+    { "node",                       JSON_OBJECT,    0, 0 },
+    { "starlink_sky_azimuth",       JSON_NUMBER,    -360, 360 },
+    { "starlink_sky_spread_deg",    JSON_NUMBER,    0, 180 },
+    { "starlink_slot_offset_sec",   JSON_NUMBER,    0, 15 },
+    { "starlink_block_turn",        JSON_NUMBER,    0, 1 },
+    { "starlink_block_slot",        JSON_NUMBER,    0, 1 },
+    { "model_online_learning",      JSON_BOOL,      0, 0 },
+    { "gps_enabled",                JSON_BOOL,      0, 0 },
+    { "pcap_enabled",               JSON_BOOL,      0, 0 },
+    { "sample_rate_hz",             JSON_INT,       1, 100 },
+    { "trace_log",                  JSON_BOOL,      0, 0 },
+    { "flightrec_pre_sec",          JSON_INT,       0, 300 },
+    { "flightrec_post_sec",         JSON_INT,       0, 300 },
+    { "flightrec_ring_mb",          JSON_INT,       1, 1024 },
+    { "flightrec_snaplen",          JSON_INT,       64, 65535 },
+    { "flightrec_dir",              JSON_STRING,    1, 127 },
+    { "flightrec_keep_mb",          JSON_INT,       1, 1 << 20 },
+    { "flowmon_enabled",            JSON_BOOL,      0, 0 },
+    { "flowmon_netns",              JSON_STRING,    0, 31 },
+    { "rtpmon_enabled",             JSON_BOOL,      0, 0 },
+    { "rtpmon_netns",               JSON_STRING,    0, 31 },
+    { "watchdog_enabled",           JSON_BOOL,      0, 0 },
+    { "watchdog_blind_ms",          JSON_INT,       0, 60000 },
+    { "retpath_enabled",            JSON_BOOL,      0, 0 },
+    { "retpath_port",               JSON_INT,       1, 65535 },
+    { "retpath_key_file",           JSON_STRING,    1, 127 },
+    { "retpath_targets",            JSON_ARRAY,     0, 0 },
+    { "uplinks",                    JSON_ARRAY | JSON_OBJECT, 0, 0 },   /* Object: the keyed form */
+    { "metrics_listen",             JSON_STRING,    0, 63 },
+    { "shadow_policies",            JSON_ARRAY,     0, 0 },
+    { "c8000_host",                 JSON_STRING,    0, 127 },
+    { "c8000_user",                 JSON_STRING,    0, 31 },
+    { "c8000_password",             JSON_STRING,    0, 63 },
+    { "c8000_port",                 JSON_INT,       1, 65535 },
+    { "c8000_rpc_dir",              JSON_STRING,    1, 127 },
+    { "host",                       JSON_STRING,    0, 127 },
+    { "user",                       JSON_STRING,    0, 31 },
+    { "password",                   JSON_STRING,    0, 63 },
+    { "controllers",                JSON_ARRAY | JSON_OBJECT, 0, 0 },   /* Object: wg-setup.sh's layout */
+    { "pop_auto",                   JSON_BOOL,      0, 0 },
+    { "pop_hold_ms",                JSON_INT,       0, 3600000 },
+    { "pop_holddown_ms",            JSON_INT,       0, 3600000 },
+    { "pop_hyst_ms",                JSON_NUMBER,    0, 1000 },
+    { "pop_hyst_pct",               JSON_NUMBER,    0, 1 },
+    { "training_db",                JSON_STRING,    1, 255 },
+    { "routes_file",                JSON_STRING,    1, 255 },
+    { "model_file",                 JSON_STRING,    1, 255 },
+};
+
+static const json_field_t NODE_SCHEMA[] = {
+    { "id",                         JSON_STRING,    1, 63 },
+    { "role",                       JSON_STRING,    1, 15 },
+};
+
+/* First member: only the array form names an entry by "name"; in the keyed
+ * form the key does and "name" is the web UI's label */
+static const json_field_t UPLINK_SCHEMA[] = {
+    { "name",                       JSON_STRING,    1, 31 },
+    { "type",                       JSON_STRING,    0, 0 },
+    { "interface",                  JSON_STRING,    0, 31 },
+    { "netns",                      JSON_STRING,    0, 31 },
+    { "veth",                       JSON_STRING,    0, 31 },
+    { "wg",                         JSON_STRING,    0, 31 },
+    { "probe_target",               JSON_STRING,    0, 63 },
+    { "dish",                       JSON_STRING,    0, 63 },
+    { "carrier",                    JSON_STRING,    0, 31 },
+    { "retpath_target",             JSON_STRING,    0, 63 },
+    { "modem",                      JSON_INT,       0, 15 },
+    { "enabled",                    JSON_BOOL,      0, 0 },
+};
+
+static const json_field_t CONTROLLER_SCHEMA[] = {
+    { "name",                       JSON_STRING,    1, 31 },
+    { "host",                       JSON_STRING,    0, 63 },
+};
+
+#define SCHEMA_LEN(s)   ((int)(sizeof(s) / sizeof((s)[0])))
+
+/* Keys read only at startup, by the config_t fields they fill */
+#define RESTART_KEY(key, field) { key, offsetof(config_t, field), sizeof(((config_t*)0)->field) }
+static const struct {
+    const char* key;
+    size_t      off, size;
+} RESTART_KEYS[] = {
+    RESTART_KEY("training_db", training_db),
+    RESTART_KEY("routes_file", routes_file),
+    RESTART_KEY("model_file", model_file),
+    RESTART_KEY("model_online_learning", model_online),
+    RESTART_KEY("gps_enabled", gps_enabled),
+    RESTART_KEY("pcap_enabled", pcap_enabled),
+    RESTART_KEY("flightrec_pre_sec", flightrec_pre_sec),
+    RESTART_KEY("flightrec_post_sec", flightrec_post_sec),
+    RESTART_KEY("flightrec_ring_mb", flightrec_ring_mb),
+    RESTART_KEY("flightrec_snaplen", flightrec_snaplen),
+    RESTART_KEY("flightrec_dir", flightrec_dir),
+    RESTART_KEY("flightrec_keep_mb", flightrec_keep_mb),
+    RESTART_KEY("flowmon_enabled", flowmon_enabled),
+    RESTART_KEY("flowmon_netns", flowmon_netns),
+    RESTART_KEY("rtpmon_enabled", rtpmon_enabled),
+    RESTART_KEY("rtpmon_netns", rtpmon_netns),
+    RESTART_KEY("watchdog_enabled", watchdog_enabled),
+    RESTART_KEY("watchdog_blind_ms", watchdog_blind_ms),
+    RESTART_KEY("retpath_enabled", retpath_enabled),
+    RESTART_KEY("retpath_port", retpath_port),
+    RESTART_KEY("retpath_key_file", retpath_key_file),
+    RESTART_KEY("metrics_listen", metrics_listen),
+    RESTART_KEY("c8000_host", c8000_host),
+    RESTART_KEY("c8000_user", c8000_user),
+    RESTART_KEY("c8000_password", c8000_pass),
+    RESTART_KEY("c8000_port", c8000_port),
+    RESTART_KEY("c8000_rpc_dir", c8000_rpc_dir),
+    RESTART_KEY("controllers", controller_count),
+    RESTART_KEY("controllers", controller_names),
+    RESTART_KEY("controllers", controller_hosts),
+    RESTART_KEY("pop_auto", pop_auto),
+    RESTART_KEY("pop_hold_ms", pop_hold_ms),
+    RESTART_KEY("pop_holddown_ms", pop_holddown_ms),
+    RESTART_KEY("pop_hyst_ms", pop_hyst_ms),
+    RESTART_KEY("pop_hyst_pct", pop_hyst_pct),
+};
+
+/*=============================================================================
+ * Parsing
+ *===========================================================================*/
+
+/* json_check() with where the object is in front of the reason */
+static int config_check_at(const char* obj, const char* where, const json_field_t* schema, int n,
+                           char* err, size_t len) {
+    char why[160];
+    if (json_check(obj, schema, n, why, sizeof(why)) == 0) return 0;
+    snprintf(err, len, "%s: %s", where, why);
+    return -1;
+}
+
+char* config_file_read(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return NULL;
+    
+    struct stat st;
+    char* json = NULL;
+    if (fstat(fileno(f), &st) != 0) goto out;
+    if (st.st_size > CONFIG_MAX_BYTES) {
+        errno = EFBIG;
+        goto out;
+    }
+    json = malloc(st.st_size + 1);
+    if (!json) goto out;
+    size_t n = fread(json, 1, st.st_size, f);
+    json[n] = '\0';
+out:
+    fclose(f);
+    return json;
+}
+
+/*
+ * One uplinks entry named name over its defaults: the DEFAULT_UPLINKS entry
+ * of the same name, else derived from the name and type. lte: LTE entries
+ * before this one, the modem number unless given.
+ */
+static int uplink_config_entry(const char* obj, const char* name, int lte, uplink_conf_t* c) {
+    char type[16];
+    const uplink_conf_t* def = NULL;
+    for (int i = 0; i < UPLINK_COUNT; i++) {
+        if (strcmp(DEFAULT_UPLINKS[i].name, name) == 0) def = &DEFAULT_UPLINKS[i];
+    }
+    if (def) {
+        *c = *def;
+    } else {
+        memset(c, 0, sizeof(*c));
+        snprintf(c->name, sizeof(c->name), "%s", name);
+        snprintf(c->netns, sizeof(c->netns), "ns_%.28s", name);
+        snprintf(c->veth, sizeof(c->veth), "veth_%.26s", name);
+        c->type = UPLINK_TYPE_FIBER;
+        c->enabled = true;
+    }
+    
+    if (json_get_string(obj, "type", type, sizeof(type)) == 0) {
+        if (strcmp(type, "lte") == 0) c->type = UPLINK_TYPE_LTE;
+        else if (strcmp(type, "starlink") == 0) c->type = UPLINK_TYPE_STARLINK;
+        else if (strcmp(type, "fiber") == 0) c->type = UPLINK_TYPE_FIBER;
+        else return -1;
+    }
+    if (!def) {
+        snprintf(c->probe_target, sizeof(c->probe_target), "%s", DEFAULT_PROBE_TARGET);
+        if (c->type == UPLINK_TYPE_STARLINK) snprintf(c->dish, sizeof(c->dish), "%s", DEFAULT_DISH);
+        c->modem = lte;
+    }
+    json_get_string(obj, "interface", c->interface, sizeof(c->interface));
+    json_get_string(obj, "netns", c->netns, sizeof(c->netns));
+    json_get_string(obj, "veth", c->veth, sizeof(c->veth));
+    json_get_string(obj, "wg", c->wg, sizeof(c->wg));
+    json_get_string(obj, "probe_target", c->probe_target, sizeof(c->probe_target));
+    json_get_string(obj, "dish", c->dish, sizeof(c->dish));
+    json_get_string(obj, "carrier", c->carrier, sizeof(c->carrier));
+    json_get_string(obj, "retpath_target", c->retpath_target, sizeof(c->retpath_target));
+    c->modem = json_get_int(obj, "modem", c->modem);
+    c->enabled = json_get_bool(obj, "enabled", c->enabled);
+    return 0;
+}
+
+/*
+ * uplinks[], or DEFAULT_UPLINKS without one. The keyed form of older configs
+ * and the web UI, {"cell_a": {"enabled": false}, ...}, is read the same way
+ * in member order, each key the entry's name.
+ */
+static int uplinks_config_parse(const char* json, config_t* cfg, char* err, size_t len) {
+    char obj[1024], name[32], where[48];
+    const char* v = json_find(json, "uplinks");
+    bool keyed = v && *v == '{';
+    int n = 0, lte = 0;
+    
+    for (;; n++) {
+        if (keyed) {
+            if (json_get_member_at(json, "uplinks", n, name, sizeof(name), obj, sizeof(obj)) != 0) break;
+            snprintf(where, sizeof(where), "uplinks.%s", name);
+        } else {
+            if (json_get_object_at(json, "uplinks", n, obj, sizeof(obj)) != 0) break;
+            snprintf(where, sizeof(where), "uplinks[%d]", n);
+        }
+        if (n == MAX_UPLINKS) {
+            snprintf(err, len, "uplinks: more than %d", MAX_UPLINKS);
+            return -1;
+        }
+        int skip = keyed ? 1 : 0;      /* "name", see UPLINK_SCHEMA */
+        if (config_check_at(obj, where, UPLINK_SCHEMA + skip, SCHEMA_LEN(UPLINK_SCHEMA) - skip,
+                            err, len) != 0) {
+            return -1;
+        }
+        if (!keyed && json_get_string(obj, "name", name, sizeof(name)) != 0) name[0] = '\0';
+        
+        uplink_conf_t* c = &cfg->uplinks[n];
+        if (!name[0] || uplink_config_entry(obj, name, lte, c) != 0) {
+            snprintf(err, len, "%s: no name, or type not lte, starlink or fiber", where);
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (strcmp(cfg->uplinks[i].name, c->name) == 0) {
+                snprintf(err, len, "%s: name used by an earlier uplink", where);
+                return -1;
+            }
+        }
+        if (c->type == UPLINK_TYPE_LTE) lte++;
+    }
+    if (v && n != (keyed ? json_object_len(json, "uplinks") : json_array_len(json, "uplinks"))) {
+        snprintf(err, len, "uplinks: entry %d not an object, its key over %zu or it over %zu bytes",
+                 n, sizeof(name) - 1, sizeof(obj) - 1);
+        return -1;
+    }
+    if (n == 0) {
+        memcpy(cfg->uplinks, DEFAULT_UPLINKS, sizeof(DEFAULT_UPLINKS));
+        n = UPLINK_COUNT;
+    }
+    cfg->uplink_count = n;
+    
+    /* Older configs: controller addresses in uplink order */
+    for (int i = 0; i < n; i++) {
+        json_get_string_at(json, "retpath_targets", i, cfg->uplinks[i].retpath_target,
+                           sizeof(cfg->uplinks[0].retpath_target));
+    }
+    return 0;
+}
+
+/* Controller PoPs: "controllers": [{"name":"cA","host":"..."}, ...]; without
+ * them (or in wg-setup.sh's object form) the two legacy controllers,
+ * switched by hand only */
+static int controllers_config_parse(const char* json, config_t* cfg, char* err, size_t len) {
+    char ctrl[512], where[32];
+    
+    cfg->controller_count = 0;
+    for (int n = 0; json_get_object_at(json, "controllers", n, ctrl, sizeof(ctrl)) == 0; n++) {
+        snprintf(where, sizeof(where), "controllers[%d]", n);
+        if (n == MAX_CONTROLLERS) {
+            snprintf(err, len, "controllers: more than %d", MAX_CONTROLLERS);
+            return -1;
+        }
+        if (config_check_at(ctrl, where, CONTROLLER_SCHEMA, SCHEMA_LEN(CONTROLLER_SCHEMA), err, len) != 0) {
+            return -1;
+        }
+        if (json_get_string(ctrl, "name", cfg->controller_names[n], sizeof(cfg->controller_names[0])) != 0) {
+            snprintf(cfg->controller_names[n], sizeof(cfg->controller_names[0]), "ctrl_%c", 'a' + n);
+        }
+        json_get_string(ctrl, "host", cfg->controller_hosts[n], sizeof(cfg->controller_hosts[0]));
+        cfg->controller_count++;
+    }
+    if (cfg->controller_count == 0) {
+        cfg->controller_count = 2;
+        strcpy(cfg->controller_names[0], "ctrl_a");
+        strcpy(cfg->controller_names[1], "ctrl_b");
+    }
+    return 0;
+}
+
+int config_shadow_files(const char* json, char files[][256], int max) {
+    int n = 0;
+    while (n < max && json_get_string_at(json, "shadow_policies", n, files[n], sizeof(files[0])) == 0) {
+        n++;
+    }
+    return n;
+}
+
+int config_parse(const char* json, config_t* cfg, char* err, size_t len) {
+    memset(cfg, 0, sizeof(*cfg));
+    
+    if (json_validate(json, err, len) != 0) return -1;
+    if (json_check(json, CONFIG_SCHEMA, SCHEMA_LEN(CONFIG_SCHEMA), err, len) != 0) return -1;
+    if (engine_config_check(json, err, len) != 0) return -1;
+    
+    /* Node identity: "node_id", or "id" in "node": {...}, or a bare "id" */
+    const char* node = json_find(json, "node");
+    if (node && config_check_at(node, "node", NODE_SCHEMA, SCHEMA_LEN(NODE_SCHEMA), err, len) != 0) return -1;
+    if (json_get_string(json, "node_id", cfg->node_id, sizeof(cfg->node_id)) != 0 &&
+        json_get_string(node, "id", cfg->node_id, sizeof(cfg->node_id)) != 0) {
+        json_get_string(json, "id", cfg->node_id, sizeof(cfg->node_id));
+    }
+    if (json_get_string(json, "role", cfg->node_role, sizeof(cfg->node_role)) != 0) {
+        json_get_string(node, "role", cfg->node_role, sizeof(cfg->node_role));
+    }
+    
+    /* Tripwire, switching and prediction thresholds (shared with replay) */
+    engine_config_load(cfg, json);
+    if (cfg->risk_prepare > cfg->risk_protect) {
+        snprintf(err, len, "risk_prepare_threshold: above risk_protect_threshold");
+        return -1;
+    }
+    
+    /* Starlink forecast and learning */
+    cfg->sl_sky_az = json_get_double(json, "starlink_sky_azimuth", DEFAULT_SL_SKY_AZ);
+    cfg->sl_sky_spread = json_get_double(json, "starlink_sky_spread_deg", DEFAULT_SL_SKY_SPREAD);
+    cfg->sl_slot_offset = json_get_double(json, "starlink_slot_offset_sec", DEFAULT_SL_SLOT_OFFSET);
+    cfg->sl_block_turn = json_get_double(json, "starlink_block_turn", DEFAULT_SL_BLOCK_TURN);
+    cfg->sl_block_slot = json_get_double(json, "starlink_block_slot", DEFAULT_SL_BLOCK_SLOT);
+    cfg->model_online = json_get_bool(json, "model_online_learning", true);
+    
+    /* Features */
+    cfg->gps_enabled = json_get_bool(json, "gps_enabled", true);
+    cfg->pcap_enabled = json_get_bool(json, "pcap_enabled", true);
+    cfg->sample_rate_hz = json_get_int(json, "sample_rate_hz", 10);
+    cfg->trace_log = json_get_bool(json, "trace_log", false);
+    cfg->flightrec_pre_sec = json_get_int(json, "flightrec_pre_sec", DEFAULT_FLIGHTREC_PRE_SEC);
+    cfg->flightrec_post_sec = json_get_int(json, "flightrec_post_sec", DEFAULT_FLIGHTREC_POST_SEC);
+    cfg->flightrec_ring_mb = json_get_int(json, "flightrec_ring_mb", DEFAULT_FLIGHTREC_RING_MB);
+    cfg->flightrec_snaplen = json_get_int(json, "flightrec_snaplen", DEFAULT_FLIGHTREC_SNAPLEN);
+    cfg->flightrec_keep_mb = json_get_int(json, "flightrec_keep_mb", DEFAULT_FLIGHTREC_KEEP_MB);
+    if (json_get_string(json, "flightrec_dir", cfg->flightrec_dir, sizeof(cfg->flightrec_dir)) != 0) {
+        strncpy(cfg->flightrec_dir, DEFAULT_FLIGHTREC_DIR, sizeof(cfg->flightrec_dir));
+    }
+    cfg->flowmon_enabled = json_get_bool(json, "flowmon_enabled", true);
+    if (json_get_string(json, "flowmon_netns", cfg->flowmon_netns, sizeof(cfg->flowmon_netns)) != 0) {
+        strncpy(cfg->flowmon_netns, DEFAULT_FLOWMON_NETNS, sizeof(cfg->flowmon_netns));
+    }
+    cfg->rtpmon_enabled = json_get_bool(json, "rtpmon_enabled", true);
+    if (json_get_string(json, "rtpmon_netns", cfg->rtpmon_netns, sizeof(cfg->rtpmon_netns)) != 0) {
+        strncpy(cfg->rtpmon_netns, DEFAULT_RTPMON_NETNS, sizeof(cfg->rtpmon_netns));
+    }
+    cfg->watchdog_enabled = json_get_bool(json, "watchdog_enabled", true);
+    cfg->watchdog_blind_ms = json_get_int(json, "watchdog_blind_ms", DEFAULT_WATCHDOG_BLIND_MS);
+    cfg->retpath_port = json_get_int(json, "retpath_port", RETPATH_PORT);
+    if (json_get_string(json, "retpath_key_file", cfg->retpath_key_file, sizeof(cfg->retpath_key_file)) != 0) {
+        strncpy(cfg->retpath_key_file, DEFAULT_RETPATH_KEY, sizeof(cfg->retpath_key_file));
+    }
+    /* On once a key is provisioned on both ends; a bare install has none */
+    cfg->retpath_enabled = json_get_bool(json, "retpath_enabled", access(cfg->retpath_key_file, R_OK) == 0);
+    if (uplinks_config_parse(json, cfg, err, len) != 0) return -1;
+    if (json_get_string(json, "metrics_listen", cfg->metrics_listen, sizeof(cfg->metrics_listen)) != 0) {
+        strncpy(cfg->metrics_listen, DEFAULT_METRICS_LISTEN, sizeof(cfg->metrics_listen));
+    }
+    
+    /* C8000; the bare keys are older configs, which had no "controllers" to clash with */
+    bool has_controllers = json_find(json, "controllers") != NULL;
+    if (json_get_string(json, "c8000_host", cfg->c8000_host, sizeof(cfg->c8000_host)) != 0 && !has_controllers) {
+        json_get_string(json, "host", cfg->c8000_host, sizeof(cfg->c8000_host));
+    }
+    if (json_get_string(json, "c8000_user", cfg->c8000_user, sizeof(cfg->c8000_user)) != 0 && !has_controllers) {
+        json_get_string(json, "user", cfg->c8000_user, sizeof(cfg->c8000_user));
+    }
+    if (json_get_string(json, "c8000_password", cfg->c8000_pass, sizeof(cfg->c8000_pass)) != 0 && !has_controllers) {
+        json_get_string(json, "password", cfg->c8000_pass, sizeof(cfg->c8000_pass));
+    }
+    cfg->c8000_port = json_get_int(json, "c8000_port", C8000_PORT);
+    if (json_get_string(json, "c8000_rpc_dir", cfg->c8000_rpc_dir, sizeof(cfg->c8000_rpc_dir)) != 0) {
+        strncpy(cfg->c8000_rpc_dir, DEFAULT_C8000_RPC_DIR, sizeof(cfg->c8000_rpc_dir));
+    }
+    
+    if (controllers_config_parse(json, cfg, err, len) != 0) return -1;
+    cfg->pop_auto = json_get_bool(json, "pop_auto", true);
+    cfg->pop_hold_ms = json_get_int(json, "pop_hold_ms", DEFAULT_POP_HOLD_MS);
+    cfg->pop_holddown_ms = json_get_int(json, "pop_holddown_ms", DEFAULT_POP_HOLDDOWN_MS);
+    cfg->pop_hyst_ms = json_get_double(json, "pop_hyst_ms", DEFAULT_POP_HYST_MS);
+    cfg->pop_hyst_pct = json_get_double(json, "pop_hyst_pct", DEFAULT_POP_HYST_PCT);
+    
+    /* Paths */
+    strncpy(cfg->data_dir, "/var/lib/pathsteer", sizeof(cfg->data_dir));
+    snprintf(cfg->log_path, sizeof(cfg->log_path), "%s/logs", cfg->data_dir);
+    if (json_get_string(json, "training_db", cfg->training_db, sizeof(cfg->training_db)) != 0) {
+        strncpy(cfg->training_db, DEFAULT_TRAINING_DB, sizeof(cfg->training_db));
+    }
+    if (json_get_string(json, "routes_file", cfg->routes_file, sizeof(cfg->routes_file)) != 0) {
+        strncpy(cfg->routes_file, DEFAULT_ROUTES_FILE, sizeof(cfg->routes_file));
+    }
+    if (json_get_string(json, "model_file", cfg->model_file, sizeof(cfg->model_file)) != 0) {
+        strncpy(cfg->model_file, DEFAULT_MODEL_FILE, sizeof(cfg->model_file));
+    }
+    return 0;
+}
+
+/*=============================================================================
+ * Reload
+ *===========================================================================*/
+
+bool config_uplinks_same(const config_t* a, const config_t* b) {
+    if (a->uplink_count != b->uplink_count) return false;
+    for (int i = 0; i < a->uplink_count; i++) {
+        const uplink_conf_t* x = &a->uplinks[i];
+        const uplink_conf_t* y = &b->uplinks[i];
+        if (strcmp(x->name, y->name) != 0 || x->type != y->type || x->modem != y->modem ||
+            strcmp(x->interface, y->interface) != 0 || strcmp(x->netns, y->netns) != 0 ||
+            strcmp(x->veth, y->veth) != 0 || strcmp(x->wg, y->wg) != 0 ||
+            strcmp(x->probe_target, y->probe_target) != 0 || strcmp(x->dish, y->dish) != 0 ||
+            strcmp(x->carrier, y->carrier) != 0 || strcmp(x->retpath_target, y->retpath_target) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t config_keep_restart(config_t* next, const config_t* cur, char* out, size_t len) {
+    size_t n = 0;
+    const char* last = NULL;
+
+    out[0] = '\0';
+    for (size_t i = 0; i < sizeof(RESTART_KEYS) / sizeof(RESTART_KEYS[0]); i++) {
+        char* to = (char*)next + RESTART_KEYS[i].off;
+        const char* from = (const char*)cur + RESTART_KEYS[i].off;
+        if (memcmp(to, from, RESTART_KEYS[i].size) == 0) continue;
+        memcpy(to, from, RESTART_KEYS[i].size);
+        if (last && strcmp(last, RESTART_KEYS[i].key) == 0) continue;
+        last = RESTART_KEYS[i].key;
+        n += snprintf(out + n, len - n, "%s\"%s\"", n ? "," : "", last);
+        if (n >= len) n = len - 1;
+    }
+    return n;
+}
+
+/*=============================================================================
+ * Uplinks
+ *===========================================================================*/
+
+void config_uplink_init(uplink_t* u, int id, const uplink_conf_t* c) {
+    memset(u, 0, sizeof(*u));
+    u->id = id;
+    u->type = c->type;
+    snprintf(u->name, sizeof(u->name), "%s", c->name);
+    snprintf(u->interface, sizeof(u->interface), "%s", c->interface);
+    snprintf(u->netns, sizeof(u->netns), "%s", c->netns);
+    snprintf(u->veth, sizeof(u->veth), "%s", c->veth);
+    snprintf(u->wg, sizeof(u->wg), "%s", c->wg);
+    snprintf(u->probe_target, sizeof(u->probe_target), "%s", c->probe_target);
+    snprintf(u->dish, sizeof(u->dish), "%s", c->dish);
+    snprintf(u->cellular.carrier, sizeof(u->cellular.carrier), "%s", c->carrier);
+    u->modem = c->modem;
+    u->enabled = c->enabled;
+    ho_reset(&u->cellular.ho);
+    u->cellular.ho_eta = -1;
+    u->starlink.obstruction_eta = -1;
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * config.h - PathSteer Guardian Daemon Configuration
+ *
+ * PURPOSE:
+ *   config.json into a config_t (pathsteer.h). pathsteerd reads it at
+ *   startup and on every reload, pathsteer-bench times it.
+ *
+ * VALIDATION:
+ *   The text is checked whole before anything is taken from it: JSON
+ *   syntax, then the type and range of every key we read (json.h schemas;
+ *   decision keys in engine_config_check(), shared with pathsteer-replay).
+ *   A config that fails is refused with the reason, never half applied.
+ *   Missing keys take the defaults below.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_CONFIG_H
+#define PATHSTEER_CONFIG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pathsteer.h"
+
+/* Largest config.json read */
+#define CONFIG_MAX_BYTES            (1 << 20)
+
+/* Uplink table (config.json uplinks[]). An entry named like one of the
+ * built-in six starts from it; other names get ns_<name>, veth_<name> and
+ * these probe and dish defaults. No uplinks[] at all: the built-in six. */
+#define DEFAULT_PROBE_TARGET        "8.8.8.8"
+#define DEFAULT_DISH                "192.168.100.1"
+
+/* Starlink obstruction forecast (skymap.h)
+ * SKY_AZ/SPREAD: Earth-frame sky region satellites are served from
+ * SLOT_OFFSET: Reassignment grid phase (seconds past each 15 s boundary)
+ * BLOCK_TURN: Blockage that cuts the current satellite off when we turn into it
+ * BLOCK_SLOT: Blockage at which a satellite reassignment is treated as risky
+ */
+#define DEFAULT_SL_SKY_AZ           0.0
+#define DEFAULT_SL_SKY_SPREAD       60.0
+#define DEFAULT_SL_SLOT_OFFSET      12.0
+#define DEFAULT_SL_BLOCK_TURN       0.5
+#define DEFAULT_SL_BLOCK_SLOT       0.25
+
+/* Files: training database (shared with Web UI and training scripts),
+ * known-route profiles (pathsteer-routes), learned risk model (model.h) */
+#define DEFAULT_TRAINING_DB         "/opt/pathsteer/data/training.db"
+#define DEFAULT_ROUTES_FILE         "/var/lib/pathsteer/routes.bin"
+#define DEFAULT_MODEL_FILE          "/var/lib/pathsteer/risk_model.txt"
+
+/* Prometheus endpoint (../common/metrics.h) */
+#define DEFAULT_METRICS_LISTEN      "127.0.0.1:9108"
+
+/* Flight recorder (flightrec.h): slice around each incident, ring per device */
+#define DEFAULT_FLIGHTREC_DIR       "/opt/pathsteer/data/pcaps"
+#define DEFAULT_FLIGHTREC_PRE_SEC   5
+#define DEFAULT_FLIGHTREC_POST_SEC  10
+#define DEFAULT_FLIGHTREC_RING_MB   16
+#define DEFAULT_FLIGHTREC_SNAPLEN   128
+#define DEFAULT_FLIGHTREC_KEEP_MB   512         /* Oldest dumps deleted beyond this */
+
+/* Flow and RTP monitors (flowmon.h, rtpmon.h): the client namespace */
+#define DEFAULT_FLOWMON_NETNS       "ns_vip"
+#define DEFAULT_RTPMON_NETNS        "ns_vip"
+
+/* Control loop watchdog (watchdog.h): no decision on fresh probes this long,
+ * past any ping's own timeout, duplicate onto the standby until the loop is back */
+#define DEFAULT_WATCHDOG_BLIND_MS   500
+
+/* Return path (../common/retpath.h): key shared with dedupe on the controller.
+ * retpath_enabled defaults to whether this file is readable. */
+#define DEFAULT_RETPATH_KEY         "/etc/pathsteer/retpath.key"
+
+/* C8000 PoP switching (c8000.h, popsel.h): the RPC per controller from
+ * <rpc_dir>/<name>.xml; hold, holddown and hysteresis of automatic choice */
+#define DEFAULT_C8000_RPC_DIR       "/etc/pathsteer/c8000"
+#define DEFAULT_POP_HOLD_MS         30000
+#define DEFAULT_POP_HOLDDOWN_MS     120000
+#define DEFAULT_POP_HYST_MS         10.0
+#define DEFAULT_POP_HYST_PCT        0.2
+
+/* path into a malloc'd, NUL-terminated string; NULL with errno */
+char* config_file_read(const char* path);
+
+/* A whole config from its JSON text: 0, or -1 and why in err (cfg is then undefined) */
+int   config_parse(const char* json, config_t* cfg, char* err, size_t len);
+
+/* shadow_policies[] into files (at most max), the count */
+int   config_shadow_files(const char* json, char files[][256], int max);
+
+/* Same uplink table, "enabled" aside */
+bool  config_uplinks_same(const config_t* a, const config_t* b);
+
+/*
+ * Keys read only at startup keep their running values: copied from cur
+ * into next where they differ, their names as a JSON string list
+ * ("a","b") into out. Returns the length written, 0 if none differed.
+ */
+size_t config_keep_restart(config_t* next, const config_t* cur, char* out, size_t len);
+
+/* u for its table entry c at index id: identity, flags, no metrics yet */
+void  config_uplink_init(uplink_t* u, int id, const uplink_conf_t* c);
+
+#endif /* PATHSTEER_CONFIG_H */
@@ -0,0 +1,258 @@
+/*******************************************************************************
+ * corrmap.c - PathSteer Guardian Per-Location Failure Correlation
+ *
+ * See corrmap.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+#include "corrmap.h"
+#include "riskmap.h"
+
+/* Same load limit as riskmap.c */
+#define MAX_LOAD_NUM    7
+#define MAX_LOAD_DEN    8
+
+/* Index of pair (i, j), i < j, in the triangular both[] array */
+static int pair_index(int i, int j) {
+    if (i > j) {
+        int t = i;
+        i = j;
+        j = t;
+    }
+    return i * (2 * CORRMAP_MAX_UPLINKS - i - 1) / 2 + (j - i - 1);
+}
+
+static uint32_t key_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (uint32_t)key;
+}
+
+/*=============================================================================
+ * Table lifecycle
+ *===========================================================================*/
+
+int corrmap_init(corrmap_t* cm, uint32_t capacity) {
+    memset(cm, 0, sizeof(*cm));
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+
+    cm->slots = calloc(capacity, sizeof(corrmap_entry_t));
+    if (!cm->slots) return -1;
+    cm->mask = capacity - 1;
+    return 0;
+}
+
+void corrmap_free(corrmap_t* cm) {
+    free(cm->slots);
+    memset(cm, 0, sizeof(*cm));
+}
+
+uint64_t corrmap_key(double lat, double lon) {
+    return riskmap_key(lat, lon, 0, 0);
+}
+
+static const corrmap_entry_t* find(const corrmap_t* cm, uint64_t key) {
+    if (!cm->slots || key == 0) return NULL;
+
+    uint32_t i = key_hash(key) & cm->mask;
+    for (;;) {
+        const corrmap_entry_t* e = &cm->slots[i];
+        if (e->key == key) return e;
+        if (e->key == 0) return NULL;
+        i = (i + 1) & cm->mask;
+    }
+}
+
+static corrmap_entry_t* insert(corrmap_t* cm, uint64_t key) {
+    if (key == 0) return &cm->global;
+    if (!cm->slots) return NULL;
+
+    uint32_t i = key_hash(key) & cm->mask;
+    for (;;) {
+        corrmap_entry_t* e = &cm->slots[i];
+        if (e->key == key) return e;
+        if (e->key == 0) {
+            if ((uint64_t)(cm->count + 1) * MAX_LOAD_DEN > (uint64_t)(cm->mask + 1) * MAX_LOAD_NUM) {
+                cm->full_drops++;
+                return NULL;
+            }
+            e->key = key;
+            cm->count++;
+            return e;
+        }
+        i = (i + 1) & cm->mask;
+    }
+}
+
+/*=============================================================================
+ * Update / Query
+ *===========================================================================*/
+
+static void observe_entry(corrmap_entry_t* e, uint32_t fail_mask, uint32_t now_s) {
+    const float keep = (float)(1.0 - 1.0 / CORRMAP_WINDOW);
+
+    for (int i = 0; i < CORRMAP_MAX_UPLINKS; i++) {
+        e->n[i] = e->n[i] * keep + ((fail_mask >> i) & 1);
+    }
+    for (int i = 0; i < CORRMAP_MAX_UPLINKS; i++) {
+        for (int j = i + 1; j < CORRMAP_MAX_UPLINKS; j++) {
+            int p = pair_index(i, j);
+            e->both[p] = e->both[p] * keep + (((fail_mask >> i) & (fail_mask >> j)) & 1);
+        }
+    }
+    e->updated_s = now_s;
+    e->dirty = 1;
+}
+
+void corrmap_observe(corrmap_t* cm, uint64_t key, uint32_t fail_mask, uint32_t now_s) {
+    fail_mask &= (1u << CORRMAP_MAX_UPLINKS) - 1;
+    if (fail_mask == 0) return;
+
+    observe_entry(&cm->global, fail_mask, now_s);
+    if (key != 0) {
+        corrmap_entry_t* e = insert(cm, key);
+        if (e) observe_entry(e, fail_mask, now_s);
+    }
+}
+
+/* Blend e's conditional into base by e's confidence */
+static double blend(const corrmap_entry_t* e, int a, int b, double base) {
+    if (!e || e->n[a] <= 0) return base;
+    double p = e->both[pair_index(a, b)] / e->n[a];
+    if (p > 1) p = 1;
+    double conf = e->n[a] / (e->n[a] + CORRMAP_CONF_K);
+    return conf * p + (1.0 - conf) * base;
+}
+
+double corrmap_cond(const corrmap_t* cm, uint64_t key, int a, int b, double prior) {
+    if (a < 0 || b < 0 || a >= CORRMAP_MAX_UPLINKS || b >= CORRMAP_MAX_UPLINKS || a == b) {
+        return prior;
+    }
+    double g = blend(&cm->global, a, b, prior);
+    return blend(find(cm, key), a, b, g);
+}
+
+/*=============================================================================
+ * Persistence
+ *===========================================================================*/
+
+int corrmap_db_init(sqlite3* db) {
+    const char* sql =
+        "CREATE TABLE IF NOT EXISTS failure_corr ("
+        " tile_key INTEGER, uplink_a TEXT, uplink_b TEXT,"
+        " latitude REAL, longitude REAL,"
+        " fail_a REAL, fail_b REAL, fail_both REAL,"
+        " updated_at INTEGER,"
+        " PRIMARY KEY (tile_key, uplink_a, uplink_b))";
+    char* err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        syslog(LOG_WARNING, "corrmap: create failure_corr: %s", err ? err : "?");
+        sqlite3_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+static int uplink_index(const char* name, const char* const* names, int n_names) {
+    if (!name) return -1;
+    for (int i = 0; i < n_names && i < CORRMAP_MAX_UPLINKS; i++) {
+        if (names[i] && strcmp(names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int corrmap_load(corrmap_t* cm, sqlite3* db, const char* const* names, int n_names) {
+    sqlite3_stmt* st = NULL;
+    const char* sql =
+        "SELECT tile_key, uplink_a, uplink_b, latitude, longitude, fail_a, fail_b, fail_both "
+        "FROM failure_corr";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        syslog(LOG_WARNING, "corrmap: load: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int loaded = 0;
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        int a = uplink_index((const char*)sqlite3_column_text(st, 1), names, n_names);
+        int b = uplink_index((const char*)sqlite3_column_text(st, 2), names, n_names);
+        if (a < 0 || b < 0 || a == b) continue;
+
+        /* Rebuild the key from the position, as riskmap_load does */
+        uint64_t key = 0;
+        if (sqlite3_column_int64(st, 0) != 0) {
+            key = corrmap_key(sqlite3_column_double(st, 3), sqlite3_column_double(st, 4));
+        }
+        corrmap_entry_t* e = insert(cm, key);
+        if (!e) break;
+        e->n[a] = (float)sqlite3_column_double(st, 5);
+        e->n[b] = (float)sqlite3_column_double(st, 6);
+        e->both[pair_index(a, b)] = (float)sqlite3_column_double(st, 7);
+        loaded++;
+    }
+    sqlite3_finalize(st);
+    return loaded;
+}
+
+static int flush_entry(sqlite3_stmt* st, corrmap_entry_t* e, const char* const* names, int n_names) {
+    double lat = 0, lon = 0;
+    if (e->key != 0) {
+        riskmap_key_decode(e->key, &lat, &lon, NULL, NULL, NULL);
+    }
+
+    int written = 0;
+    int n = n_names < CORRMAP_MAX_UPLINKS ? n_names : CORRMAP_MAX_UPLINKS;
+    for (int a = 0; a < n; a++) {
+        for (int b = a + 1; b < n; b++) {
+            float both = e->both[pair_index(a, b)];
+            if (!names[a] || !names[b] || (e->n[a] <= 0 && e->n[b] <= 0)) continue;
+
+            /* Keys carry bit 63; store as signed, SQLite INTEGER is int64 */
+            sqlite3_bind_int64(st, 1, (sqlite3_int64)(e->key & ~(1ULL << 63)));
+            sqlite3_bind_text(st, 2, names[a], -1, SQLITE_STATIC);
+            sqlite3_bind_text(st, 3, names[b], -1, SQLITE_STATIC);
+            sqlite3_bind_double(st, 4, lat);
+            sqlite3_bind_double(st, 5, lon);
+            sqlite3_bind_double(st, 6, e->n[a]);
+            sqlite3_bind_double(st, 7, e->n[b]);
+            sqlite3_bind_double(st, 8, both);
+            sqlite3_bind_int64(st, 9, e->updated_s);
+            if (sqlite3_step(st) == SQLITE_DONE) written++;
+            sqlite3_reset(st);
+        }
+    }
+    e->dirty = 0;
+    return written > 0;
+}
+
+int corrmap_flush(corrmap_t* cm, sqlite3* db, const char* const* names, int n_names) {
+    sqlite3_stmt* st = NULL;
+    const char* sql =
+        "INSERT OR REPLACE INTO failure_corr (tile_key, uplink_a, uplink_b, latitude, longitude,"
+        " fail_a, fail_b, fail_both, updated_at)"
+        " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        syslog(LOG_WARNING, "corrmap: flush: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+    int written = 0;
+    if (cm->global.dirty) written += flush_entry(st, &cm->global, names, n_names);
+    for (uint32_t i = 0; cm->slots && i <= cm->mask; i++) {
+        corrmap_entry_t* e = &cm->slots[i];
+        if (e->key == 0 || !e->dirty) continue;
+        written += flush_entry(st, e, names, n_names);
+    }
+    sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+    sqlite3_finalize(st);
+    return written;
+}
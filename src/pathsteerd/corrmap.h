@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * corrmap.h - PathSteer Guardian Per-Location Failure Correlation
+ *
+ * PURPOSE:
+ *   Duplication only helps if the second copy doesn't die with the first.
+ *   cell_a and cell_b lose coverage in the same valleys; both Starlinks
+ *   share one sky. For every location tile we keep how often each pair of
+ *   uplinks failed in the same observation window, so the secondary can be
+ *   the path least likely to fail together with the active one here.
+ *
+ * STATISTIC:
+ *   Per tile: n[i] = windows where uplink i failed, both[i,j] = windows
+ *   where i and j both failed. Both decay by 1/CORRMAP_WINDOW per window
+ *   with any failure, so the matrix is a rolling one. The answer is
+ *   P(j fails | i fails) = both[i,j] / n[i], blended with a tile-independent
+ *   global matrix (and then the caller's prior) while a tile has little data.
+ *
+ * LAYOUT:
+ *   Open-addressed hash like riskmap.h, keyed by riskmap tile (heading and
+ *   uplink bits zero). Pairs i<j packed into a triangular array.
+ *
+ * PERSISTENCE:
+ *   failure_corr table in the training DB, one row per tile and pair.
+ *   tile_key 0 is the global matrix.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_CORRMAP_H
+#define PATHSTEER_CORRMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+#define CORRMAP_MAX_UPLINKS     8
+#define CORRMAP_PAIRS           (CORRMAP_MAX_UPLINKS * (CORRMAP_MAX_UPLINKS - 1) / 2)
+
+/* Tiles (must be a power of two) */
+#define CORRMAP_CAPACITY        (1u << 14)
+
+/* Rolling window, in failure windows */
+#define CORRMAP_WINDOW          200.0
+
+/* Tile confidence = n[i] / (n[i] + K); same for global vs. prior */
+#define CORRMAP_CONF_K          5.0
+
+typedef struct {
+    uint64_t    key;                    /* Tile key, 0 = empty */
+    float       n[CORRMAP_MAX_UPLINKS];
+    float       both[CORRMAP_PAIRS];
+    uint32_t    updated_s;
+    uint8_t     dirty;
+} corrmap_entry_t;
+
+typedef struct {
+    corrmap_entry_t*    slots;
+    uint32_t            mask;
+    uint32_t            count;
+    uint32_t            full_drops;
+    corrmap_entry_t     global;         /* All locations */
+} corrmap_t;
+
+int  corrmap_init(corrmap_t* cm, uint32_t capacity);
+void corrmap_free(corrmap_t* cm);
+
+/* Tile key for a position */
+uint64_t corrmap_key(double lat, double lon);
+
+/*
+ * One observation window. fail_mask bit i = uplink i failed in it.
+ * key 0 updates only the global matrix (no GPS).
+ */
+void corrmap_observe(corrmap_t* cm, uint64_t key, uint32_t fail_mask, uint32_t now_s);
+
+/* P(b fails | a fails) at key (0 = global only), falling back to prior */
+double corrmap_cond(const corrmap_t* cm, uint64_t key, int a, int b, double prior);
+
+/* Persistence (failure_corr table). names[i] is the uplink name for index i. */
+int corrmap_db_init(sqlite3* db);
+int corrmap_load(corrmap_t* cm, sqlite3* db, const char* const* names, int n_names);
+int corrmap_flush(corrmap_t* cm, sqlite3* db, const char* const* names, int n_names);
+
+#endif /* PATHSTEER_CORRMAP_H */
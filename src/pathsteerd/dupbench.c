@@ -0,0 +1,494 @@
+/*******************************************************************************
+ * dupbench.c - PathSteer Guardian Duplication Path Bench (pathsteer-dupbench)
+ *
+ * PURPOSE:
+ *   The data-plane half of scripts/bench-dup.sh: what duplicating the
+ *   active uplink costs the edge CPU at high packet rates, and what it adds
+ *   to forwarding latency, so hardware can be sized for MIRROR mode.
+ *
+ *     pathsteer-dupbench gen --dev lan0 --dst-mac 02:.. --src 10.90.0.2
+ *                            --dst 198.18.0.1 [--rate PPS] [--size BYTES]
+ *                            [--seconds S] [--sample N]
+ *     pathsteer-dupbench sink --dev veth_cell_a_i [--seconds S]
+ *     pathsteer-dupbench attach --dev veth_cell_a --to veth_sl_a [--pref N]
+ *
+ * GEN:
+ *   UDP/IPv4 frames from an AF_PACKET socket with PACKET_QDISC_BYPASS,
+ *   sendmmsg() in batches of DUPBENCH_BATCH, paced to --rate (0 = as fast
+ *   as the core goes). Every frame carries a sequence number and its
+ *   CLOCK_REALTIME send time; one in --sample is marked as a probe.
+ *
+ * SINK:
+ *   A classic BPF filter passes only probes to userspace, so the sink costs
+ *   next to nothing at line rate (packet counts come from the device
+ *   counters). Latency is the kernel receive timestamp minus the send time,
+ *   namespaces share the clock. Records nanoseconds in an hdr_t.
+ *
+ * ATTACH:
+ *   The alternative to pathsteerd's "u32 match all + mirred" filter: a
+ *   five-instruction SCHED_CLS program calling bpf_clone_redirect() to
+ *   --to's egress, loaded over bpf(2) and attached direct-action at the
+ *   same place (parent 1:, pref 1) over rtnetlink. The filter holds the
+ *   program, so nothing is pinned; "tc filter del ... pref 1" removes it
+ *   like pathsteerd's dup_disable().
+ *
+ * OUTPUT (stdout): one JSON line per command.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/pkt_cls.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "hdr.h"
+
+#define DUPBENCH_BATCH          64
+#define DUPBENCH_MAGIC          0x50534442u     /* "PSDB" */
+#define DUPBENCH_PROBE          0x50534450u     /* "PSDP": timestamped for the sink */
+#define DUPBENCH_PAYLOAD_OFF    42              /* Ethernet + IPv4 (no options) + UDP */
+#define DUPBENCH_MIN_SIZE       60              /* Frame bytes, without FCS */
+#define DUPBENCH_MAX_SIZE       1514
+#define DUPBENCH_UDP_PORT       9
+
+/* UDP payload, small enough for a minimum-size frame */
+typedef struct __attribute__((packed)) {
+    uint32_t    magic;          /* DUPBENCH_MAGIC / DUPBENCH_PROBE, network order */
+    uint32_t    seq;
+    uint64_t    ts_ns;          /* CLOCK_REALTIME at send */
+} dupbench_payload_t;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s gen --dev DEV --dst-mac MAC --src IP --dst IP [--rate PPS]\n"
+            "          [--size BYTES] [--seconds S] [--sample N]\n"
+            "       %s sink --dev DEV [--seconds S]\n"
+            "       %s attach --dev DEV --to DEV [--pref N]\n", prog, prog, prog);
+}
+
+static int64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int packet_socket(const char* dev, int proto, int* ifindex) {
+    *ifindex = (int)if_nametoindex(dev);
+    if (*ifindex == 0) return -1;
+    int fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(proto));
+    if (fd < 0) return -1;
+    struct sockaddr_ll sll = { .sll_family = AF_PACKET, .sll_protocol = htons(proto), .sll_ifindex = *ifindex };
+    if (bind(fd, (struct sockaddr*)&sll, sizeof(sll)) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/*=============================================================================
+ * Generator
+ *===========================================================================*/
+
+static uint16_t ip_checksum(const uint8_t* p, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) sum += (uint32_t)(p[i] << 8 | p[i + 1]);
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static void build_frame(uint8_t* f, size_t size, const uint8_t* dst_mac, const uint8_t* src_mac,
+                        struct in_addr src, struct in_addr dst) {
+    memset(f, 0, size);
+    memcpy(f, dst_mac, 6);
+    memcpy(f + 6, src_mac, 6);
+    f[12] = ETH_P_IP >> 8;
+    f[13] = ETH_P_IP & 0xff;
+
+    uint8_t* ip = f + 14;
+    uint16_t ip_len = (uint16_t)(size - 14);
+    ip[0] = 0x45;
+    ip[2] = ip_len >> 8;
+    ip[3] = ip_len & 0xff;
+    ip[6] = 0x40;                               /* DF */
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    memcpy(ip + 12, &src, 4);
+    memcpy(ip + 16, &dst, 4);
+    uint16_t csum = ip_checksum(ip, 20);
+    ip[10] = csum >> 8;
+    ip[11] = csum & 0xff;
+
+    uint8_t* udp = ip + 20;
+    uint16_t udp_len = (uint16_t)(ip_len - 20);
+    udp[0] = DUPBENCH_UDP_PORT >> 8;
+    udp[1] = DUPBENCH_UDP_PORT & 0xff;
+    udp[2] = DUPBENCH_UDP_PORT >> 8;
+    udp[3] = DUPBENCH_UDP_PORT & 0xff;
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xff;                    /* Checksum 0: none */
+}
+
+static int cmd_gen(const char* dev, const char* dst_mac_arg, const char* src_arg, const char* dst_arg,
+                   double rate, int size, double seconds, int sample) {
+    uint8_t dst_mac[6], src_mac[6];
+    struct in_addr src, dst;
+    if (sscanf(dst_mac_arg, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &dst_mac[0], &dst_mac[1], &dst_mac[2],
+               &dst_mac[3], &dst_mac[4], &dst_mac[5]) != 6 ||
+        inet_pton(AF_INET, src_arg, &src) != 1 || inet_pton(AF_INET, dst_arg, &dst) != 1) {
+        fprintf(stderr, "Bad --dst-mac, --src or --dst\n");
+        return 1;
+    }
+    if (size < DUPBENCH_MIN_SIZE) size = DUPBENCH_MIN_SIZE;
+    if (size > DUPBENCH_MAX_SIZE) size = DUPBENCH_MAX_SIZE;
+    if (sample < 1) sample = 1;
+
+    int ifindex;
+    int fd = packet_socket(dev, ETH_P_IP, &ifindex);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+        return 1;
+    }
+    /* Straight to the driver: the generator's own qdisc is not under test */
+    int one = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+    struct ifreq ifr = { 0 };
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", dev);
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+        fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    memcpy(src_mac, ifr.ifr_hwaddr.sa_data, 6);
+
+    static uint8_t frames[DUPBENCH_BATCH][DUPBENCH_MAX_SIZE];
+    struct iovec iov[DUPBENCH_BATCH];
+    struct mmsghdr msgs[DUPBENCH_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < DUPBENCH_BATCH; i++) {
+        build_frame(frames[i], (size_t)size, dst_mac, src_mac, src, dst);
+        iov[i].iov_base = frames[i];
+        iov[i].iov_len = (size_t)size;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t seq = 0, sent = 0, errors = 0;
+    int64_t start = mono_ns();
+    int64_t end = start + (int64_t)(seconds * 1e9);
+    int64_t now = start;
+    while (!g_stop && now < end) {
+        int n = DUPBENCH_BATCH;
+        if (rate > 0) {
+            /* Pace to the rate: send what is due, else wait a little */
+            double due = rate * (now - start) / 1e9 - (double)sent;
+            if (due < 1) {
+                struct timespec pause = { 0, 20000 };
+                nanosleep(&pause, NULL);
+                now = mono_ns();
+                continue;
+            }
+            if (due < n) n = (int)due;
+        }
+
+        uint64_t ts = (uint64_t)realtime_ns();
+        for (int i = 0; i < n; i++) {
+            dupbench_payload_t p = {
+                .magic = htonl((seq + (uint64_t)i) % (uint64_t)sample == 0 ? DUPBENCH_PROBE : DUPBENCH_MAGIC),
+                .seq = (uint32_t)(seq + (uint64_t)i),
+                .ts_ns = ts,
+            };
+            memcpy(frames[i] + DUPBENCH_PAYLOAD_OFF, &p, sizeof(p));
+        }
+        int r = sendmmsg(fd, msgs, (unsigned)n, 0);
+        if (r < 0) {
+            if (errno != ENOBUFS && errno != EAGAIN && errno != EINTR) {
+                fprintf(stderr, "sendmmsg: %s\n", strerror(errno));
+                break;
+            }
+            errors++;
+        } else {
+            seq += (uint64_t)r;
+            sent += (uint64_t)r;
+        }
+        now = mono_ns();
+    }
+    close(fd);
+
+    double elapsed = (now - start) / 1e9;
+    printf("{\"cmd\":\"gen\",\"dev\":\"%s\",\"size\":%d,\"rate\":%.0f,\"seconds\":%.3f,\"sent\":%llu,"
+           "\"pps\":%.0f,\"errors\":%llu}\n",
+           dev, size, rate, elapsed, (unsigned long long)sent, elapsed > 0 ? sent / elapsed : 0.0,
+           (unsigned long long)errors);
+    return 0;
+}
+
+/*=============================================================================
+ * Sink
+ *===========================================================================*/
+
+/* Probes only */
+static int attach_probe_filter(int fd) {
+    struct sock_filter code[] = {
+        /* 0 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, DUPBENCH_PAYLOAD_OFF),
+        /* 1 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, DUPBENCH_PROBE, 0, 1),
+        /* 2 */ BPF_STMT(BPF_RET | BPF_K, DUPBENCH_PAYLOAD_OFF + sizeof(dupbench_payload_t)),
+        /* 3 */ BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+static int cmd_sink(const char* dev, double seconds) {
+    int ifindex;
+    int fd = packet_socket(dev, ETH_P_IP, &ifindex);
+    int one = 1;
+    if (fd < 0 || attach_probe_filter(fd) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) < 0) {
+        fprintf(stderr, "%s: %s\n", dev, strerror(errno));
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    struct timeval tv = { 0, 100000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    static hdr_t lat;
+    hdr_reset(&lat);
+    uint64_t probes = 0, reordered = 0;
+    uint32_t last_seq = 0;
+    int64_t end = mono_ns() + (int64_t)(seconds * 1e9);
+    while (!g_stop && mono_ns() < end) {
+        uint8_t buf[DUPBENCH_PAYLOAD_OFF + sizeof(dupbench_payload_t)];
+        char ctrl[CMSG_SPACE(sizeof(struct timespec))];
+        struct iovec iov = { buf, sizeof(buf) };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctrl, .msg_controllen = sizeof(ctrl) };
+        ssize_t n = recvmsg(fd, &msg, 0);
+        if (n < (ssize_t)sizeof(buf)) continue;
+
+        int64_t rx_ns = 0;
+        for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                rx_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+            }
+        }
+        if (!rx_ns) continue;
+        dupbench_payload_t p;
+        memcpy(&p, buf + DUPBENCH_PAYLOAD_OFF, sizeof(p));
+        hdr_record(&lat, rx_ns - (int64_t)p.ts_ns);
+        if (probes && (int32_t)(p.seq - last_seq) < 0) reordered++;
+        last_seq = p.seq;
+        probes++;
+    }
+    close(fd);
+
+    uint64_t count = atomic_load(&lat.total);
+    printf("{\"cmd\":\"sink\",\"dev\":\"%s\",\"probes\":%llu,\"reordered\":%llu,\"lat_mean_us\":%.2f,"
+           "\"lat_p50_us\":%.2f,\"lat_p99_us\":%.2f,\"lat_p999_us\":%.2f,\"lat_max_us\":%.2f}\n",
+           dev, (unsigned long long)probes, (unsigned long long)reordered,
+           count ? atomic_load(&lat.sum_us) / 1000.0 / count : 0.0,
+           hdr_quantile(&lat, 0.50) / 1000.0, hdr_quantile(&lat, 0.99) / 1000.0,
+           hdr_quantile(&lat, 0.999) / 1000.0, atomic_load(&lat.max_us) / 1000.0);
+    return 0;
+}
+
+/*=============================================================================
+ * Clone-Redirect Filter
+ *===========================================================================*/
+
+#define NLMSG_TAIL(n) ((struct rtattr*)((char*)(n) + NLMSG_ALIGN((n)->nlmsg_len)))
+
+typedef struct {
+    struct nlmsghdr n;
+    struct tcmsg    t;
+    char            buf[256];
+} dupbench_req_t;
+
+static int dupbench_addattr(struct nlmsghdr* n, size_t max, int type, const void* data, size_t len) {
+    size_t rta_len = RTA_LENGTH(len);
+    if (NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(rta_len) > max) return -1;
+    struct rtattr* rta = NLMSG_TAIL(n);
+    rta->rta_type = type;
+    rta->rta_len = rta_len;
+    if (len) memcpy(RTA_DATA(rta), data, len);
+    n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(rta_len);
+    return 0;
+}
+
+/* r2 = to, r3 = 0 (egress); bpf_clone_redirect(skb, to, 0); return TC_ACT_OK */
+static int load_clone_redirect(int to_ifindex) {
+    struct bpf_insn insns[] = {
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_2, .imm = to_ifindex },
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_3, .imm = 0 },
+        { .code = BPF_JMP | BPF_CALL, .imm = BPF_FUNC_clone_redirect },
+        { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_0, .imm = TC_ACT_OK },
+        { .code = BPF_JMP | BPF_EXIT },
+    };
+    static char verifier_log[4096];
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_SCHED_CLS;
+    attr.insns = (uint64_t)(uintptr_t)insns;
+    attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+    attr.license = (uint64_t)(uintptr_t)"GPL";
+    attr.log_buf = (uint64_t)(uintptr_t)verifier_log;
+    attr.log_size = sizeof(verifier_log);
+    attr.log_level = 1;
+    snprintf(attr.prog_name, sizeof(attr.prog_name), "pathsteer_dup");
+    int fd = (int)syscall(SYS_bpf, BPF_PROG_LOAD, &attr, sizeof(attr));
+    if (fd < 0 && verifier_log[0]) fprintf(stderr, "%s", verifier_log);
+    return fd;
+}
+
+static int cmd_attach(const char* dev, const char* to, int pref) {
+    int ifindex = (int)if_nametoindex(dev);
+    int to_ifindex = (int)if_nametoindex(to);
+    if (!ifindex || !to_ifindex) {
+        fprintf(stderr, "No device %s\n", ifindex ? to : dev);
+        return 1;
+    }
+    int prog = load_clone_redirect(to_ifindex);
+    if (prog < 0) {
+        fprintf(stderr, "BPF_PROG_LOAD: %s\n", strerror(errno));
+        return 1;
+    }
+
+    /* tc filter add dev DEV parent 1: protocol all pref PREF bpf da fd PROG */
+    dupbench_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_type = RTM_NEWTFILTER;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL | NLM_F_ACK;
+    req.n.nlmsg_seq = 1;
+    req.t.tcm_family = AF_UNSPEC;
+    req.t.tcm_ifindex = ifindex;
+    req.t.tcm_parent = TC_H_MAKE(1U << 16, 0);
+    req.t.tcm_info = TC_H_MAKE((uint32_t)pref << 16, htons(ETH_P_ALL));
+
+    uint32_t prog_fd = (uint32_t)prog, flags = TCA_BPF_FLAG_ACT_DIRECT;
+    dupbench_addattr(&req.n, sizeof(req), TCA_KIND, "bpf", sizeof("bpf"));
+    struct rtattr* options = NLMSG_TAIL(&req.n);
+    if (dupbench_addattr(&req.n, sizeof(req), TCA_OPTIONS, NULL, 0) != 0 ||
+        dupbench_addattr(&req.n, sizeof(req), TCA_BPF_FD, &prog_fd, sizeof(prog_fd)) != 0 ||
+        dupbench_addattr(&req.n, sizeof(req), TCA_BPF_NAME, "pathsteer_dup", sizeof("pathsteer_dup")) != 0 ||
+        dupbench_addattr(&req.n, sizeof(req), TCA_BPF_FLAGS, &flags, sizeof(flags)) != 0) {
+        close(prog);
+        return 1;
+    }
+    options->rta_len = (char*)NLMSG_TAIL(&req.n) - (char*)options;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    int err = 0;
+    if (fd < 0 || sendto(fd, &req, req.n.nlmsg_len, 0, (struct sockaddr*)&kernel, sizeof(kernel)) < 0) {
+        err = errno;
+    } else {
+        char buf[1024];
+        int n = (int)recv(fd, buf, sizeof(buf), 0);
+        err = n < 0 ? errno : EPROTO;
+        for (struct nlmsghdr* h = (struct nlmsghdr*)buf; n > 0 && NLMSG_OK(h, n); h = NLMSG_NEXT(h, n)) {
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                err = -((const struct nlmsgerr*)NLMSG_DATA(h))->error;
+                break;
+            }
+        }
+    }
+    if (fd >= 0) close(fd);
+    close(prog);
+    if (err) {
+        fprintf(stderr, "RTM_NEWTFILTER %s: %s\n", dev, strerror(err));
+        return 1;
+    }
+    printf("{\"cmd\":\"attach\",\"dev\":\"%s\",\"to\":\"%s\",\"pref\":%d}\n", dev, to, pref);
+    return 0;
+}
+
+/*=============================================================================
+ * Main
+ *===========================================================================*/
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* cmd = argv[1];
+    const char *dev = NULL, *to = NULL, *dst_mac = NULL, *src = NULL, *dst = NULL;
+    double rate = 0, seconds = 10;
+    int size = DUPBENCH_MIN_SIZE, sample = 64, pref = 1;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--dev") == 0 && i + 1 < argc) {
+            dev = argv[++i];
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to = argv[++i];
+        } else if (strcmp(argv[i], "--dst-mac") == 0 && i + 1 < argc) {
+            dst_mac = argv[++i];
+        } else if (strcmp(argv[i], "--src") == 0 && i + 1 < argc) {
+            src = argv[++i];
+        } else if (strcmp(argv[i], "--dst") == 0 && i + 1 < argc) {
+            dst = argv[++i];
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+            sample = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pref") == 0 && i + 1 < argc) {
+            pref = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (strcmp(cmd, "gen") == 0 && dev && dst_mac && src && dst) {
+        return cmd_gen(dev, dst_mac, src, dst, rate, size, seconds, sample);
+    } else if (strcmp(cmd, "sink") == 0 && dev) {
+        return cmd_sink(dev, seconds);
+    } else if (strcmp(cmd, "attach") == 0 && dev && to) {
+        return cmd_attach(dev, to, pref);
+    }
+    usage(argv[0]);
+    return 1;
+}
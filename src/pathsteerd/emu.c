@@ -0,0 +1,389 @@
+/*******************************************************************************
+ * emu.c - PathSteer Guardian Trace-Driven Network Emulator (pathsteer-emu)
+ *
+ * PURPOSE:
+ *   Play recorded drives back onto the bench lab's links (bench-lab.sh):
+ *   each uplink's probe RTT, loss and outages from a trace become netem
+ *   delay, jitter and loss on that uplink's ISP link, updated every 10 ms.
+ *   pathsteerd then sees real road conditions on a real datapath, so
+ *   failover and its duplication cost can be regression-tested against
+ *   drives instead of chaos.json's constant offsets.
+ *
+ *     pathsteer-emu /var/lib/pathsteer/logs/pathsteer_20250301_*.jsonl
+ *     pathsteer-emu --db /opt/pathsteer/data/training.db --start 3600 --duration 600
+ *
+ * TRACE -> NETEM (per uplink, from the probes around each instant):
+ *   delay     probe RTT / 2 on both ends of wan_<u> <-> isp_<u>, linearly
+ *             interpolated between successive probes; held through losses
+ *   jitter    mean RTT change between successive probes / 2
+ *   loss      isolated lost probes, as a rate over the last EMU_LOSS_WINDOW
+ *   outage    two or more lost probes in a row: 100% loss until the next
+ *             successful probe
+ *   Recording gaps longer than SIM_MAX_GAP_SEC are skipped. A qdisc is only
+ *   touched when its quantized parameters change.
+ *
+ * OUTPUT (stdout, JSONL):
+ *   With --verbose or --dry-run, one line per parameter change; then one
+ *   "summary" line: ticks, netlink updates and errors, late ticks.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "netem.h"
+#include "sim.h"
+
+#define EMU_TICK_MS             10
+
+/* Probes the isolated-loss rate and jitter are taken over */
+#define EMU_LOSS_WINDOW         10
+
+/* Quantization: changes smaller than this don't touch the qdisc */
+#define EMU_DELAY_STEP_US       500
+#define EMU_LOSS_STEP_PCT       0.5
+
+/* Replayed gap in place of a recording gap > SIM_MAX_GAP_SEC */
+#define EMU_GAP_US              100000LL
+
+#define EMU_CTRL_NS             "ns_ctrl"
+
+static const char* const EMU_NAMES[UPLINK_COUNT] = {
+    "cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"
+};
+
+/* One uplink's conditions from one probe, on the emulation timeline */
+typedef struct {
+    int64_t     t_us;
+    int64_t     delay_us;       /* One way */
+    int64_t     jitter_us;
+    double      loss_pct;
+    bool        ok;             /* Probe succeeded (delay is measured, not held) */
+} emu_point_t;
+
+typedef struct {
+    int             id;
+    emu_point_t*    pts;
+    size_t          n;
+    size_t          cur;            /* First point with t_us >= now */
+    netem_params_t  applied;
+    bool            have_applied;
+    netem_link_t    wan;            /* ns_<u>/wan_<u>: upstream */
+    netem_link_t    isp;            /* ns_ctrl/isp_<u>: downstream */
+} emu_uplink_t;
+
+static volatile sig_atomic_t g_running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--db PATH] [--uplinks a,b,...] [--start SEC] [--duration SEC]\n"
+            "          [--base-rtt MS] [--ctrl-ns NAME] [--no-jitter] [--verbose]\n"
+            "          [--dry-run] [--length] [trace.jsonl ...]\n"
+            "Without trace files, the samples table of --db is played.\n", prog);
+}
+
+static int64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*=============================================================================
+ * Trace -> per-uplink conditions
+ *===========================================================================*/
+
+/* Emulation time of each record: trace time with long recording gaps cut out */
+static int64_t* emu_timeline(const sim_trace_t* tr) {
+    int64_t* t = malloc(tr->n * sizeof(*t));
+    if (!t) return NULL;
+    for (size_t k = 0; k < tr->n; k++) {
+        int64_t dt = k ? tr->rec[k].t_us - tr->rec[k - 1].t_us : 0;
+        if (dt < 0 || dt > SIM_MAX_GAP_SEC * 1000000LL) dt = EMU_GAP_US;
+        t[k] = k ? t[k - 1] + dt : 0;
+    }
+    return t;
+}
+
+static bool emu_lost(const sim_trace_t* tr, size_t k, int id) {
+    return k < tr->n && tr->rec[k].u[id].present && tr->rec[k].u[id].rtt <= 0;
+}
+
+static int emu_build(emu_uplink_t* eu, const sim_trace_t* tr, const int64_t* t,
+                     double base_rtt, bool jitter) {
+    int id = eu->id;
+    eu->pts = malloc(tr->n * sizeof(emu_point_t));
+    if (!eu->pts) return -1;
+
+    double held = base_rtt;
+    for (size_t k = 0; k < tr->n; k++) {
+        const sim_uplink_t* su = &tr->rec[k].u[id];
+        if (!su->present) continue;
+
+        bool lost = su->rtt <= 0;
+        bool outage = lost && ((k > 0 && emu_lost(tr, k - 1, id)) || emu_lost(tr, k + 1, id));
+
+        /* Window of recent probes: isolated losses and RTT variation */
+        int probes = 0, losses = 0, pairs = 0;
+        double var = 0, prev = 0;
+        size_t from = k + 1 > EMU_LOSS_WINDOW ? k + 1 - EMU_LOSS_WINDOW : 0;
+        for (size_t w = from; w <= k; w++) {
+            const sim_uplink_t* wu = &tr->rec[w].u[id];
+            if (!wu->present) continue;
+            bool wl = wu->rtt <= 0;
+            bool wo = wl && ((w > 0 && emu_lost(tr, w - 1, id)) || emu_lost(tr, w + 1, id));
+            if (wo) {
+                prev = 0;
+                continue;
+            }
+            probes++;
+            if (wl) {
+                losses++;
+                prev = 0;
+                continue;
+            }
+            if (prev > 0) {
+                var += wu->rtt > prev ? wu->rtt - prev : prev - wu->rtt;
+                pairs++;
+            }
+            prev = wu->rtt;
+        }
+
+        if (!lost) held = su->rtt;
+        double one_way = (held - base_rtt) / 2.0;
+        emu_point_t* p = &eu->pts[eu->n++];
+        p->t_us = t[k];
+        p->ok = !lost;
+        p->delay_us = one_way > 0 ? (int64_t)(one_way * 1000) : 0;
+        p->jitter_us = jitter && pairs ? (int64_t)(var / pairs / 2.0 * 1000) : 0;
+        p->loss_pct = outage ? 100.0 : probes ? 100.0 * losses / probes : 0.0;
+    }
+    return 0;
+}
+
+/* Conditions at emulation time now; false past the uplink's last probe */
+static bool emu_at(emu_uplink_t* eu, int64_t now, netem_params_t* out) {
+    while (eu->cur < eu->n && eu->pts[eu->cur].t_us < now) eu->cur++;
+    if (eu->cur >= eu->n) return false;
+
+    /* A probe describes the interval since the one before it */
+    const emu_point_t* p = &eu->pts[eu->cur];
+    out->delay_us = p->delay_us;
+    out->jitter_us = p->jitter_us;
+    out->loss_pct = p->loss_pct;
+
+    if (eu->cur > 0 && p->ok && eu->pts[eu->cur - 1].ok && p->t_us > eu->pts[eu->cur - 1].t_us) {
+        const emu_point_t* a = &eu->pts[eu->cur - 1];
+        double f = (double)(now - a->t_us) / (double)(p->t_us - a->t_us);
+        out->delay_us = a->delay_us + (int64_t)((p->delay_us - a->delay_us) * f);
+    }
+
+    out->delay_us = (out->delay_us + EMU_DELAY_STEP_US / 2) / EMU_DELAY_STEP_US * EMU_DELAY_STEP_US;
+    out->jitter_us = (out->jitter_us + EMU_DELAY_STEP_US / 2) / EMU_DELAY_STEP_US * EMU_DELAY_STEP_US;
+    out->loss_pct = (int)(out->loss_pct / EMU_LOSS_STEP_PCT + 0.5) * EMU_LOSS_STEP_PCT;
+    return true;
+}
+
+/*=============================================================================
+ * Main
+ *===========================================================================*/
+
+int main(int argc, char** argv) {
+    const char* db_path = NULL;
+    const char* uplinks_arg = NULL;
+    const char* ctrl_ns = EMU_CTRL_NS;
+    double start_sec = 0, duration_sec = 0, base_rtt = 0;
+    bool jitter = true, verbose = false, dry_run = false, length_only = false;
+    int first_trace = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--uplinks") == 0 && i + 1 < argc) {
+            uplinks_arg = argv[++i];
+        } else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc) {
+            start_sec = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_sec = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--base-rtt") == 0 && i + 1 < argc) {
+            base_rtt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ctrl-ns") == 0 && i + 1 < argc) {
+            ctrl_ns = argv[++i];
+        } else if (strcmp(argv[i], "--no-jitter") == 0) {
+            jitter = false;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--dry-run") == 0) {
+            dry_run = verbose = true;
+        } else if (strcmp(argv[i], "--length") == 0) {
+            length_only = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            first_trace = i;
+            break;
+        }
+    }
+    if (first_trace == argc && !db_path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    sim_trace_t tr = {0};
+    for (int i = first_trace; i < argc; i++) {
+        if (sim_load_jsonl(&tr, argv[i]) < 0) {
+            fprintf(stderr, "Cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (first_trace == argc) {
+        sqlite3* db = NULL;
+        if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+            fprintf(stderr, "Cannot open %s: %s\n", db_path, sqlite3_errmsg(db));
+            return 1;
+        }
+        int rc = sim_load_db(&tr, db);
+        sqlite3_close(db);
+        if (rc < 0) return 1;
+    }
+    if (tr.n == 0) {
+        fprintf(stderr, "No trace records (enable \"trace_log\" in the daemon config)\n");
+        return 1;
+    }
+
+    int64_t* timeline = emu_timeline(&tr);
+    if (!timeline) return 1;
+    int64_t length_us = timeline[tr.n - 1];
+    if (length_only) {
+        printf("%.1f\n", length_us / 1e6);
+        return 0;
+    }
+
+    /* Uplinks: as asked, else every one in the trace the lab has */
+    emu_uplink_t eus[UPLINK_COUNT];
+    int n_eu = 0;
+    for (int id = 0; id < UPLINK_COUNT; id++) {
+        bool in_trace = false;
+        for (size_t k = 0; k < tr.n && !in_trace; k++) in_trace = tr.rec[k].u[id].present;
+
+        char ns[32], path[64];
+        snprintf(ns, sizeof(ns), "ns_%s", EMU_NAMES[id]);
+        snprintf(path, sizeof(path), "/run/netns/%s", ns);
+        bool wanted;
+        if (uplinks_arg) {
+            char list[128];
+            snprintf(list, sizeof(list), ",%s,", uplinks_arg);
+            char key[16];
+            snprintf(key, sizeof(key), ",%s,", EMU_NAMES[id]);
+            wanted = strstr(list, key) != NULL;
+        } else {
+            wanted = in_trace && (dry_run || access(path, F_OK) == 0);
+        }
+        if (!wanted) continue;
+        if (!in_trace) {
+            fprintf(stderr, "%s: not in the trace\n", EMU_NAMES[id]);
+            return 1;
+        }
+
+        emu_uplink_t* eu = &eus[n_eu++];
+        memset(eu, 0, sizeof(*eu));
+        eu->id = id;
+        eu->wan.fd = eu->isp.fd = -1;
+        if (emu_build(eu, &tr, timeline, base_rtt, jitter) != 0) return 1;
+        if (dry_run) continue;
+
+        char wan[16], isp[16];
+        snprintf(wan, sizeof(wan), "wan_%s", EMU_NAMES[id]);
+        snprintf(isp, sizeof(isp), "isp_%s", EMU_NAMES[id]);
+        if (netem_open(&eu->wan, ns, wan) != 0 || netem_open(&eu->isp, ctrl_ns, isp) != 0) {
+            fprintf(stderr, "%s: cannot open %s/%s, %s/%s: %s (bench-lab.sh up?)\n", EMU_NAMES[id],
+                    ns, wan, ctrl_ns, isp, strerror(errno));
+            return 1;
+        }
+    }
+    if (n_eu == 0) {
+        fprintf(stderr, "No uplinks to emulate (bench-lab.sh up?)\n");
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    /* Play: one tick per EMU_TICK_MS of trace, on the monotonic clock */
+    int64_t from = (int64_t)(start_sec * 1e6);
+    int64_t to = duration_sec > 0 ? from + (int64_t)(duration_sec * 1e6) : length_us;
+    if (to > length_us) to = length_us;
+    int64_t tick_us = EMU_TICK_MS * 1000;
+    int64_t t0 = mono_us();
+    long ticks = 0, updates = 0, errors = 0, late = 0;
+    int64_t max_lag = 0;
+
+    for (int64_t now = from; g_running && now <= to; now += tick_us, ticks++) {
+        if (!dry_run) {
+            int64_t due = t0 + (now - from);
+            struct timespec ts = { due / 1000000, (due % 1000000) * 1000 };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+
+        for (int i = 0; i < n_eu; i++) {
+            emu_uplink_t* eu = &eus[i];
+            netem_params_t p;
+            if (!emu_at(eu, now, &p)) continue;
+            if (eu->have_applied && p.delay_us == eu->applied.delay_us &&
+                p.jitter_us == eu->applied.jitter_us && p.loss_pct == eu->applied.loss_pct) {
+                continue;
+            }
+            eu->applied = p;
+            eu->have_applied = true;
+            updates++;
+
+            if (!dry_run && (netem_set(&eu->wan, &p) != 0 || netem_set(&eu->isp, &p) != 0)) {
+                if (errors++ == 0) {
+                    fprintf(stderr, "%s: netem: %s\n", EMU_NAMES[eu->id], strerror(errno));
+                }
+            }
+            if (verbose) {
+                printf("{\"event\":\"netem\",\"data\":{\"t\":%.2f,\"uplink\":\"%s\",\"delay_ms\":%.1f,"
+                       "\"jitter_ms\":%.1f,\"loss_pct\":%.1f}}\n",
+                       now / 1e6, EMU_NAMES[eu->id], p.delay_us / 1000.0, p.jitter_us / 1000.0,
+                       p.loss_pct);
+            }
+        }
+
+        if (!dry_run) {
+            int64_t lag = mono_us() - (t0 + (now - from));
+            if (lag > max_lag) max_lag = lag;
+            if (lag > tick_us) late++;
+        }
+    }
+
+    printf("{\"event\":\"summary\",\"data\":{\"records\":%zu,\"sec\":%.1f,\"uplinks\":%d,"
+           "\"ticks\":%ld,\"updates\":%ld,\"errors\":%ld,\"late_ticks\":%ld,\"max_lag_us\":%ld,"
+           "\"dry_run\":%s}}\n",
+           tr.n, (to - from) / 1e6, n_eu, ticks, updates, errors, late, (long)max_lag,
+           dry_run ? "true" : "false");
+
+    for (int i = 0; i < n_eu; i++) {
+        netem_close(&eus[i].wan);
+        netem_close(&eus[i].isp);
+        free(eus[i].pts);
+    }
+    free(timeline);
+    sim_trace_free(&tr);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,706 @@
+/*******************************************************************************
+ * engine.c - PathSteer Guardian Decision Engine
+ *
+ * See engine.h for the split between engine and owner.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <math.h>
+
+#include "engine.h"
+#include "json.h"
+
+const char* const MODE_NAMES[] = {"TRAINING", "TRIPWIRE", "MIRROR"};
+
+const char* const STATE_NAMES[] = {"NORMAL", "PREPARE", "PROTECT", "SWITCHING", "HOLDING"};
+
+const char* const UPLINK_TYPE_NAMES[] = {"lte", "starlink", "fiber"};
+
+const char* const UPLINK_NAMES[] = {
+    "cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"
+};
+
+const char* const TRIGGER_NAMES[] = {
+    "none", "rtt_step", "probe_miss", "link_down", "rsrp_drop",
+    "sinr_drop", "starlink_obstruction", "predicted", "manual"
+};
+
+static int64_t now_us(engine_t* e) {
+    return e->ops->now_us(e->ctx);
+}
+
+static void log_event(engine_t* e, const char* type, const char* fmt, ...) {
+    char msg[1024];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    e->ops->log_event(e->ctx, type, msg);
+}
+
+/*=============================================================================
+ * CONFIGURATION
+ *===========================================================================*/
+
+void engine_config_load(config_t* cfg, const char* json) {
+    /* Tripwire thresholds */
+    cfg->rtt_step_ms = DEFAULT_RTT_STEP_MS;
+    cfg->rtt_window_ms = DEFAULT_RTT_WINDOW_MS;
+    cfg->probe_miss_count = DEFAULT_PROBE_MISS_COUNT;
+    cfg->probe_miss_window_ms = DEFAULT_PROBE_MISS_WINDOW;
+    cfg->rsrp_drop_db = DEFAULT_RSRP_DROP_DB;
+    cfg->sinr_drop_db = DEFAULT_SINR_DROP_DB;
+
+    /* Switching */
+    cfg->preroll_ms = DEFAULT_PREROLL_MS;
+    cfg->min_hold_sec = DEFAULT_MIN_HOLD_SEC;
+    cfg->clean_exit_sec = DEFAULT_CLEAN_EXIT_SEC;
+
+    /* Prediction */
+    cfg->predict_horizon_sec = DEFAULT_PREDICT_HORIZON_SEC;
+    cfg->predict_lead_sec = DEFAULT_PREDICT_LEAD_SEC;
+    cfg->risk_prepare = DEFAULT_RISK_PREPARE;
+    cfg->risk_protect = DEFAULT_RISK_PROTECT;
+    cfg->predict_min_conf = DEFAULT_PREDICT_MIN_CONF;
+    cfg->ho_hyst_db = DEFAULT_HO_HYST_DB;
+    cfg->ho_lead_ms = DEFAULT_HO_LEAD_MS;
+    cfg->ho_prob = DEFAULT_HO_PROB;
+
+    engine_config_overlay(cfg, json);
+}
+
+/* Read by engine_config_overlay(); integers where it reads an int */
+static const json_field_t ENGINE_CONFIG_SCHEMA[] = {
+    { "rtt_step_threshold_ms",      JSON_INT,       1, 10000 },
+    { "rtt_step_window_ms",         JSON_INT,       1, 60000 },
+    { "probe_miss_count",           JSON_INT,       1, HISTORY_SIZE },
+    { "probe_miss_window_ms",       JSON_INT,       1, 60000 },
+    { "rsrp_drop_threshold_db",     JSON_INT,       1, 100 },
+    { "sinr_drop_threshold_db",     JSON_INT,       1, 100 },
+    { "preroll_ms",                 JSON_INT,       0, 60000 },
+    { "min_hold_sec",               JSON_INT,       0, 3600 },
+    { "clean_exit_sec",             JSON_INT,       0, 3600 },
+    { "predict_horizon_sec",        JSON_INT,       1, 600 },
+    { "predict_lead_sec",           JSON_INT,       0, 600 },
+    { "risk_prepare_threshold",     JSON_NUMBER,    0, 1 },
+    { "risk_protect_threshold",     JSON_NUMBER,    0, 1 },
+    { "predict_min_confidence",     JSON_NUMBER,    0, 1 },
+    { "handover_hyst_db",           JSON_NUMBER,    0, 30 },
+    { "handover_lead_ms",           JSON_INT,       0, 60000 },
+    { "handover_prob_threshold",    JSON_NUMBER,    0, 1 },
+};
+
+int engine_config_check(const char* json, char* err, size_t len) {
+    return json_check(json, ENGINE_CONFIG_SCHEMA,
+                      (int)(sizeof(ENGINE_CONFIG_SCHEMA) / sizeof(ENGINE_CONFIG_SCHEMA[0])), err, len);
+}
+
+/* Keys present in json replace the values already in cfg */
+void engine_config_overlay(config_t* cfg, const char* json) {
+    /* Tripwire thresholds */
+    cfg->rtt_step_ms = json_get_int(json, "rtt_step_threshold_ms", cfg->rtt_step_ms);
+    cfg->rtt_window_ms = json_get_int(json, "rtt_step_window_ms", cfg->rtt_window_ms);
+    cfg->probe_miss_count = json_get_int(json, "probe_miss_count", cfg->probe_miss_count);
+    cfg->probe_miss_window_ms = json_get_int(json, "probe_miss_window_ms", cfg->probe_miss_window_ms);
+    cfg->rsrp_drop_db = json_get_int(json, "rsrp_drop_threshold_db", cfg->rsrp_drop_db);
+    cfg->sinr_drop_db = json_get_int(json, "sinr_drop_threshold_db", cfg->sinr_drop_db);
+
+    /* Switching */
+    cfg->preroll_ms = json_get_int(json, "preroll_ms", cfg->preroll_ms);
+    cfg->min_hold_sec = json_get_int(json, "min_hold_sec", cfg->min_hold_sec);
+    cfg->clean_exit_sec = json_get_int(json, "clean_exit_sec", cfg->clean_exit_sec);
+
+    /* Prediction */
+    cfg->predict_horizon_sec = json_get_int(json, "predict_horizon_sec", cfg->predict_horizon_sec);
+    cfg->predict_lead_sec = json_get_int(json, "predict_lead_sec", cfg->predict_lead_sec);
+    cfg->risk_prepare = json_get_double(json, "risk_prepare_threshold", cfg->risk_prepare);
+    cfg->risk_protect = json_get_double(json, "risk_protect_threshold", cfg->risk_protect);
+    cfg->predict_min_conf = json_get_double(json, "predict_min_confidence", cfg->predict_min_conf);
+    cfg->ho_hyst_db = json_get_double(json, "handover_hyst_db", cfg->ho_hyst_db);
+    cfg->ho_lead_ms = json_get_int(json, "handover_lead_ms", cfg->ho_lead_ms);
+    cfg->ho_prob = json_get_double(json, "handover_prob_threshold", cfg->ho_prob);
+}
+
+/*=============================================================================
+ * METRICS
+ *===========================================================================*/
+
+void engine_probe(uplink_t* u, double rtt, int64_t t_us) {
+    /* Record in history */
+    int idx = u->history_idx % HISTORY_SIZE;
+    u->history[idx].rtt_ms = rtt;
+    u->history[idx].success = (rtt > 0);
+    u->history[idx].timestamp_us = t_us;
+    u->history_idx++;
+
+    /* Update metrics */
+    if (rtt > 0) {
+        u->rtt_ms = rtt;
+        /* Apply chaos injection */
+        u->rtt_ms += u->chaos_rtt;
+        if (u->chaos_jitter > 0) {
+            /* rand() only when injecting: it is a locked global, and sweeps run this in parallel */
+            u->rtt_ms += u->chaos_jitter * ((double)rand()/RAND_MAX - 0.5) * 2;
+        }
+        if (!u->force_failed) u->available = true;
+        u->consec_fail = 0;
+
+        /* Update baseline (slow EMA) */
+        if (u->rtt_baseline == 0) {
+            u->rtt_baseline = rtt;
+        } else {
+            u->rtt_baseline = u->rtt_baseline * 0.95 + rtt * 0.05;
+        }
+    } else {
+        u->consec_fail++;
+        if (u->consec_fail > 5) {
+            u->available = false;
+        }
+    }
+
+    /* Calculate loss from history */
+    int success = 0, total = 0;
+    for (int i = 0; i < 20 && i < u->history_idx; i++) {
+        int hi = (u->history_idx - 1 - i) % HISTORY_SIZE;
+        total++;
+        if (u->history[hi].success) success++;
+    }
+    /* Jitter: mean absolute delta between consecutive successful probes */
+    double jsum = 0, prev = -1;
+    int jn = 0;
+    for (int i = 0; i < 10 && i < u->history_idx; i++) {
+        int hi = (u->history_idx - 1 - i) % HISTORY_SIZE;
+        if (!u->history[hi].success) continue;
+        if (prev >= 0) {
+            jsum += fabs(u->history[hi].rtt_ms - prev);
+            jn++;
+        }
+        prev = u->history[hi].rtt_ms;
+    }
+    u->jitter_ms = jn > 0 ? jsum / jn : 0;
+
+    if (total > 0) {
+        u->loss_pct = 100.0 * (total - success) / total;
+        u->loss_pct += u->chaos_loss; if (u->loss_pct > 100.0) u->loss_pct = 100.0;  /* Add chaos injection */
+    }
+}
+
+/*=============================================================================
+ * FAILURE CORRELATION
+ *===========================================================================*/
+
+double engine_corr(engine_t* e, int a, int b) {
+    double prior = e->uplinks[a].type == e->uplinks[b].type ? CORR_PRIOR_SAME_TYPE : CORR_PRIOR_OTHER_TYPE;
+    return e->ops->corr(e->ctx, a, b, prior);
+}
+
+/*
+ * Healthy uplink least likely to fail together with active. Ties go to the
+ * next one after active, as before.
+ */
+uplink_id_t engine_pick_secondary(engine_t* e, uplink_id_t active) {
+    uplink_id_t best = active;
+    double best_score = 1e9;
+
+    for (int k = 1; k < e->n_uplinks; k++) {
+        uplink_id_t i = (active + k) % e->n_uplinks;
+        uplink_t* u = &e->uplinks[i];
+        if (!u->enabled || !u->available) continue;
+
+        double score = engine_corr(e, active, i) + 0.25 * u->risk_now;
+        if (u->consec_fail > 0) score += 1.0;   /* Already failing: last resort */
+
+        if (score < best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/*=============================================================================
+ * HANDOVER PREDICTION
+ *===========================================================================*/
+
+/* Called from engine_tripwire_check() on the active modem - keep it cheap */
+static bool handover_imminent(engine_t* e, uplink_t* u) {
+    cellular_t* c = &u->cellular;
+
+    c->ho_eta = ho_eta(&c->ho, e->cfg->ho_hyst_db, now_us(e));
+    bool close = c->ho.best_pci >= 0 && c->ho.margin >= -e->cfg->ho_hyst_db;
+    bool want = (c->ho_eta >= 0 && c->ho_eta * 1000.0 <= e->cfg->ho_lead_ms) ||
+                (close && c->ho_prob >= e->cfg->ho_prob);
+
+    /* Handovers here have been seamless - don't pay for duplication */
+    if (want && c->ho_gap_ms >= 0 && c->ho_gap_ms < HO_MIN_GAP_MS) want = false;
+
+    if (!want) {
+        c->ho_fired = false;
+        return false;
+    }
+    if (c->ho_fired) return false;
+    c->ho_fired = true;
+
+    log_event(e, "handover_predicted", "{\"uplink\":\"%s\",\"cell\":\"%s\",\"neighbor_pci\":%d,\"margin_db\":%.1f,\"trend_dbs\":%.2f,\"eta_sec\":%.2f,\"prob\":%.2f,\"gap_ms\":%.0f}",
+              u->name, c->cell_id, c->ho.best_pci, c->ho.margin, c->ho.margin_trend,
+              c->ho_eta, c->ho_prob, c->ho_gap_ms);
+    return true;
+}
+
+/*=============================================================================
+ * TRIPWIRE (FAST PATH)
+ *
+ * The tripwire is the fast-path detection mechanism. When ANY of these
+ * conditions is met, we IMMEDIATELY enable duplication - no waiting,
+ * no arbitration. Speed is critical here (milliseconds matter).
+ *
+ * After duplication is enabled, the slow path arbitrates which path
+ * to switch to. But duplication happens first.
+ *===========================================================================*/
+
+trigger_t engine_tripwire_check(engine_t* e, uplink_t* active) {
+    if (!active || !active->enabled || !active->available) {
+        return TRIGGER_LINK_DOWN;
+    }
+
+    /*
+     * Check 1: RTT Step
+     * If RTT jumped significantly over baseline, something changed.
+     */
+    if (active->history_idx >= 5) {
+        double recent_sum = 0;
+        int count = 0;
+        for (int i = 0; i < 3; i++) {
+            int idx = (active->history_idx - 1 - i) % HISTORY_SIZE;
+            if (active->history[idx].success) {
+                recent_sum += active->history[idx].rtt_ms;
+                count++;
+            }
+        }
+        if (count > 0) {
+            double recent_avg = recent_sum / count;
+            double step = recent_avg - active->rtt_baseline;
+            if (step >= e->cfg->rtt_step_ms) {
+                return TRIGGER_RTT_STEP;
+            }
+        }
+    }
+
+    /*
+     * Check 2: Probe Miss
+     * Consecutive probe failures indicate path problems.
+     */
+    if (active->consec_fail >= e->cfg->probe_miss_count) {
+        return TRIGGER_PROBE_MISS;
+    }
+
+    /*
+     * Check 3: LTE Signal Drop (if LTE uplink)
+     */
+    if (active->type == UPLINK_TYPE_LTE && active->cellular.rsrp < -120) {
+        return TRIGGER_RSRP_DROP;
+    }
+
+    /*
+     * Check 3b: Imminent handover (if LTE uplink)
+     */
+    if (active->type == UPLINK_TYPE_LTE && handover_imminent(e, active)) {
+        return TRIGGER_PREDICTED;
+    }
+
+    /*
+     * Check 4: Starlink Obstruction (if Starlink uplink)
+     */
+    if (active->type == UPLINK_TYPE_STARLINK) {
+        if (active->starlink.obstructed) {
+            return TRIGGER_STARLINK_OBSTR;
+        }
+        /* Also trigger if obstruction predicted within 5 seconds */
+        if (active->starlink.obstruction_eta > 0 && active->starlink.obstruction_eta < 5) {
+            return TRIGGER_STARLINK_OBSTR;
+        }
+    }
+
+    return TRIGGER_NONE;
+}
+
+void engine_tripwire_fire(engine_t* e, trigger_t reason, const char* detail) {
+    /*
+     * FAST PATH: Enable duplication IMMEDIATELY.
+     * This is the critical path - must complete in milliseconds.
+     */
+    status_t* s = e->status;
+    int64_t start = now_us(e);
+
+    /* Find secondary uplink to duplicate to - the one least likely to fail with us */
+    uplink_id_t secondary = engine_pick_secondary(e, s->active_uplink);
+
+    /* Enable duplication */
+    if (secondary != s->active_uplink) {
+        e->ops->dup_enable(e->ctx, s->active_uplink, secondary);
+    }
+
+    /* Update state */
+    s->state = STATE_PROTECT;
+    s->last_trigger = reason;
+    snprintf(s->trigger_detail, sizeof(s->trigger_detail), "%s", detail ? detail : "");
+    s->protect_start_us = now_us(e);
+    s->switches_this_window = 0;
+    s->last_clean_us = 0;
+    s->flap_suppressed = false;
+
+    int64_t elapsed = now_us(e) - start;
+
+    log_event(e, "tripwire_fire", "{\"trigger\":\"%s\",\"detail\":\"%s\",\"secondary\":\"%s\",\"corr\":%.2f,\"latency_us\":%ld}",
+              TRIGGER_NAMES[reason], detail ? detail : "",
+              secondary != s->active_uplink ? e->uplinks[secondary].name : "none",
+              secondary != s->active_uplink ? engine_corr(e, s->active_uplink, secondary) : 0.0,
+              elapsed);
+}
+
+/*=============================================================================
+ * SWITCHING (SLOW PATH)
+ *
+ * After duplication is active, we arbitrate which path to switch to.
+ * This is the "slow" path - we have time because duplication protects us.
+ *
+ * Rules:
+ * 1. Wait preroll period before switching (let things stabilize)
+ * 2. Switch at most ONCE per protection window (no flapping)
+ * 3. Stay in protection for min_hold time
+ * 4. Exit only after clean_exit time with no issues
+ *===========================================================================*/
+
+void engine_slowpath_arbitrate(engine_t* e) {
+    status_t* s = e->status;
+    int64_t elapsed_ms = (now_us(e) - s->protect_start_us) / 1000;
+
+    /* Still in preroll? */
+    if (elapsed_ms < e->cfg->preroll_ms) {
+        s->state = STATE_SWITCHING;
+        return;
+    }
+
+    /* Already switched this window? */
+    if (s->switches_this_window >= 1) {
+        s->flap_suppressed = true;
+        return;
+    }
+
+    /* Select best uplink */
+    uplink_id_t best = engine_select_best(e);
+
+    /* Execute switch if different from current */
+    if (best != s->active_uplink) {
+        engine_switch(e, best);
+    }
+
+    s->state = STATE_HOLDING;
+}
+
+uplink_id_t engine_select_best(engine_t* e) {
+    /*
+     * Score each available uplink and select the best.
+     * Lower RTT, lower risk, lower loss = better score.
+     */
+    uplink_id_t active = e->status->active_uplink;
+    uplink_id_t best = active;
+    double best_score = -9999;
+
+    for (int i = 0; i < e->n_uplinks; i++) {
+        uplink_t* u = &e->uplinks[i];
+        if (!u->enabled || !u->available) continue;
+
+        /* Base score: 100 - RTT */
+        double score = 100.0 - u->rtt_ms;
+
+        /* Penalty for risk */
+        score -= u->risk_now * 50.0;
+
+        /* Penalty for loss */
+        score -= u->loss_pct * 10.0;
+
+        /* Bonus for good Starlink state */
+        if (u->type == UPLINK_TYPE_STARLINK && u->starlink.online && !u->starlink.obstructed) {
+            score += 20.0;
+        }
+
+        /* Penalty for failing together with the path we're leaving */
+        if (i != (int)active) {
+            score -= engine_corr(e, active, i) * 40.0;
+        }
+
+        /* Penalty for Starlink heading into a forecast obstruction */
+        if (u->type == UPLINK_TYPE_STARLINK && u->starlink.obstruction_eta > 0 &&
+            u->starlink.obstruction_eta < 5) {
+            score -= 40.0;
+        }
+
+        /* Bonus for strong LTE signal */
+        if (u->type == UPLINK_TYPE_LTE && u->cellular.rsrp > -90) {
+            score += 15.0;
+        }
+
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+void engine_switch(engine_t* e, uplink_id_t target) {
+    status_t* s = e->status;
+    uplink_id_t old = s->active_uplink;
+
+    log_event(e, "switch", "{\"from\":\"%s\",\"to\":\"%s\"}",
+              e->uplinks[old].name, e->uplinks[target].name);
+
+    /* Update routing to use new uplink's veth */
+    /* In V1, this is handled by changing which veth is "primary" */
+
+    e->uplinks[old].is_active = false;
+    e->uplinks[target].is_active = true;
+    s->active_uplink = target;
+    s->switches_this_window++;
+    s->switch_start_us = now_us(e);
+
+    /* Return traffic follows (controller route, in-band) */
+    if (e->ops->route_switch) e->ops->route_switch(e->ctx, target);
+}
+
+/*=============================================================================
+ * PROTECTION MODE TICK
+ *
+ * Called every loop iteration when in protection mode.
+ * Manages hold timer and clean exit logic.
+ *===========================================================================*/
+
+void engine_protection_tick(engine_t* e) {
+    status_t* s = e->status;
+    const config_t* cfg = e->cfg;
+    int64_t now = now_us(e);
+    int64_t protect_elapsed_sec = (now - s->protect_start_us) / 1000000;
+
+    /* Update countdown displays */
+    s->hold_remaining_sec = cfg->min_hold_sec - protect_elapsed_sec;
+    if (s->hold_remaining_sec < 0) s->hold_remaining_sec = 0;
+
+    /* Is current path clean? */
+    uplink_t* active = &e->uplinks[s->active_uplink];
+    bool is_clean = (active->consec_fail == 0 &&
+                     active->rtt_ms < active->rtt_baseline + 30 &&
+                     active->loss_pct < 2.0);
+
+    if (is_clean) {
+        if (s->last_clean_us == 0) {
+            s->last_clean_us = now;
+        }
+        int64_t clean_sec = (now - s->last_clean_us) / 1000000;
+        s->clean_remaining_sec = cfg->clean_exit_sec - clean_sec;
+        if (s->clean_remaining_sec < 0) s->clean_remaining_sec = 0;
+
+        /* Exit if hold passed AND clean enough */
+        if (protect_elapsed_sec >= cfg->min_hold_sec &&
+            clean_sec >= cfg->clean_exit_sec) {
+
+            /* Exit protection */
+            if (s->mode != MODE_MIRROR) {
+                e->ops->dup_disable(e->ctx);
+            }
+
+            s->state = STATE_NORMAL;
+            s->last_trigger = TRIGGER_NONE;
+
+            log_event(e, "protection_exit", "{\"duration_sec\":%ld,\"clean_sec\":%ld}",
+                      protect_elapsed_sec, clean_sec);
+        }
+    } else {
+        s->last_clean_us = 0;
+        s->clean_remaining_sec = cfg->clean_exit_sec;
+    }
+}
+
+/*=============================================================================
+ * PREDICTION ENGINE
+ *===========================================================================*/
+
+static float clampf(double v, double lo, double hi) {
+    return (float)(v < lo ? lo : (v > hi ? hi : v));
+}
+
+/* Feature vector for one uplink - see model_feature_t for scaling */
+static void model_features(const engine_t* e, const uplink_t* u, float* x) {
+    memset(x, 0, MODEL_FEATURES * sizeof(float));
+
+    x[F_BIAS] = 1.0f;
+    if (u->rtt_baseline > 0) x[F_RTT_RATIO] = clampf(u->rtt_ms / u->rtt_baseline - 1.0, 0, 5);
+    x[F_JITTER] = clampf(u->jitter_ms / 50.0, 0, 4);
+    x[F_LOSS] = clampf(u->loss_pct / 100.0, 0, 1);
+    x[F_CONSEC_FAIL] = clampf(u->consec_fail / 5.0, 0, 1);
+
+    if (u->type == UPLINK_TYPE_LTE && u->cellular.rsrp != 0) {
+        x[F_RSRP] = clampf((-90.0 - u->cellular.rsrp) / 30.0, 0, 1.5);
+        x[F_RSRP_TREND] = clampf(-u->cellular.rsrp_trend / 2.0, -1, 1);
+        x[F_SINR] = clampf((10.0 - u->cellular.sinr) / 20.0, 0, 1.5);
+        x[F_SINR_TREND] = clampf(-u->cellular.sinr_trend / 2.0, -1, 1);
+    }
+    if (u->type == UPLINK_TYPE_STARLINK) {
+        x[F_SL_OBSTR] = u->starlink.obstructed ? 1.0f : clampf(u->starlink.obstruction_pct / 10.0, 0, 1);
+    }
+
+    x[F_SPEED] = clampf(e->gps->speed_mps / 30.0, 0, 2);
+    x[F_LOC_RISK] = clampf(u->risk_ahead * u->confidence, 0, 1);
+}
+
+void engine_prediction_tick(engine_t* e) {
+    status_t* s = e->status;
+    double max_risk = 0;
+    int64_t now = now_us(e);
+
+    /*
+     * risk_now from the learned model, MODEL_LANES uplinks per vector.
+     * Features are gathered feature-major so model_predict() is one
+     * multiply-add per feature across all lanes.
+     */
+    model_batch_t batch;
+    float xs[MODEL_LANES][MODEL_FEATURES];
+    float p[MODEL_LANES];
+    int lane_uplink[MODEL_LANES];
+    int n = 0;
+    struct timespec t0, t1;
+    int64_t infer_ns = 0;
+
+    memset(&batch, 0, sizeof(batch));
+    for (int i = 0; i <= e->n_uplinks; i++) {
+        if (i < e->n_uplinks && e->uplinks[i].enabled) {
+            model_features(e, &e->uplinks[i], xs[n]);
+            for (int f = 0; f < MODEL_FEATURES; f++) batch.x[f][n] = xs[n][f];
+            lane_uplink[n++] = i;
+        }
+        if (n == MODEL_LANES || (i == e->n_uplinks && n > 0)) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            model_predict(e->model, &batch, n, p);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            infer_ns += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+
+            for (int l = 0; l < n; l++) {
+                uplink_t* u = &e->uplinks[lane_uplink[l]];
+                u->risk_now = p[l];
+                if (e->ops->learn) e->ops->learn(e->ctx, u, lane_uplink[l], xs[l], now);
+                if (u->is_active && u->risk_now > max_risk) {
+                    max_risk = u->risk_now;
+                }
+            }
+            memset(&batch, 0, sizeof(batch));
+            n = 0;
+        }
+    }
+    s->model_infer_ns = infer_ns;
+
+    s->global_risk = max_risk;
+
+    if (max_risk >= e->cfg->risk_protect) {
+        strcpy(s->recommendation, "PROTECT");
+    } else if (max_risk >= e->cfg->risk_prepare) {
+        strcpy(s->recommendation, "PREPARE");
+    } else {
+        strcpy(s->recommendation, "NORMAL");
+    }
+}
+
+/*
+ * Act on the look-ahead for the active uplink. Called from the NORMAL/PREPARE
+ * branch of the state machine when the tripwire is quiet. With actuate=false
+ * (TRAINING) we only log what we would have done.
+ */
+void engine_predictor_step(engine_t* e, bool actuate) {
+    status_t* s = e->status;
+    uplink_t* active = &e->uplinks[s->active_uplink];
+    sys_state_t want = STATE_NORMAL;
+
+    if (active->eta_protect >= 0 && active->eta_protect <= e->cfg->predict_lead_sec) {
+        want = STATE_PROTECT;
+    } else if (active->eta_prepare >= 0) {
+        want = STATE_PREPARE;
+    }
+
+    sys_state_t was = s->predicted_state;
+    s->predicted_state = want;
+
+    if (!actuate) {
+        if (want != was) {
+            log_event(e, "would_do", "{\"state\":\"%s\",\"uplink\":\"%s\",\"risk_ahead\":%.2f,\"eta_sec\":%.1f}",
+                      STATE_NAMES[want], active->name, active->risk_ahead,
+                      want == STATE_PROTECT ? active->eta_protect : active->eta_prepare);
+        }
+        return;
+    }
+
+    /*
+     * Once per approach, like handover_imminent(): eta_protect stays 0 while
+     * parked or crawling through the tile, and must not fire again each time
+     * protection exits. Re-armed when the horizon clears.
+     */
+    if (active->eta_protect < 0) active->predict_fired = false;
+
+    if (want == STATE_PROTECT && active->predict_fired) {
+        want = STATE_PREPARE;       /* Stay prepared until the horizon clears */
+    } else if (want == STATE_PROTECT) {
+        active->predict_fired = true;
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "%s risk %.2f in %.1fs",
+                 active->name, active->risk_ahead, active->eta_protect);
+        engine_tripwire_fire(e, TRIGGER_PREDICTED, detail);
+        return;
+    }
+
+    if (want != s->state) {
+        log_event(e, "prepare", "{\"state\":\"%s\",\"uplink\":\"%s\",\"risk_ahead\":%.2f,\"eta_sec\":%.1f}",
+                  STATE_NAMES[want], active->name, active->risk_ahead, active->eta_prepare);
+        s->state = want;
+    }
+}
+
+/*=============================================================================
+ * STATE MACHINE
+ *===========================================================================*/
+
+void engine_step(engine_t* e) {
+    status_t* s = e->status;
+
+    if (s->mode == MODE_TRAINING) {
+        engine_predictor_step(e, false);  /* TRAINING: log would-do only */
+        return;
+    }
+
+    switch (s->state) {
+        case STATE_NORMAL:
+        case STATE_PREPARE: {
+            uplink_t* active = &e->uplinks[s->active_uplink];
+            trigger_t t = engine_tripwire_check(e, active);
+            if (t != TRIGGER_NONE) {
+                engine_tripwire_fire(e, t, TRIGGER_NAMES[t]);
+            } else {
+                engine_predictor_step(e, true);
+            }
+            break;
+        }
+        case STATE_PROTECT:
+            engine_slowpath_arbitrate(e);
+            /* fall through */
+        case STATE_SWITCHING:
+        case STATE_HOLDING:
+            engine_protection_tick(e);
+            break;
+    }
+}
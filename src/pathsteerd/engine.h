@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * engine.h - PathSteer Guardian Decision Engine
+ *
+ * PURPOSE:
+ *   The tripwire / protection state machine, secondary and best-path
+ *   selection and the risk model tick, with everything they touch in the
+ *   outside world behind engine_ops_t. The daemon wires the ops to the real
+ *   clock, tc and the JSONL log; pathsteer-replay wires them to a simulated
+ *   clock and counters and drives the same code from recorded traces.
+ *
+ * METRIC SOURCE:
+ *   The engine reads the uplink table it is given. Whoever owns the table
+ *   fills it: the daemon from probes, qmicli and the dish API, replay from
+ *   trace records. Probe results go through engine_probe() in both, so
+ *   baseline, loss and jitter are derived the same way.
+ *
+ * THREADING:
+ *   None. Call from one thread, like the daemon main loop.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_ENGINE_H
+#define PATHSTEER_ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "model.h"
+#include "pathsteer.h"
+
+/* Default tripwire thresholds
+ * RTT_STEP: If RTT jumps by this much over baseline, trigger protection
+ * PROBE_MISS: If we miss this many consecutive probes, trigger protection
+ * RSRP_DROP: If LTE signal drops by this many dB, trigger protection
+ * SINR_DROP: If LTE SNR drops by this many dB, trigger protection
+ */
+#define DEFAULT_RTT_STEP_MS         80
+#define DEFAULT_RTT_WINDOW_MS       200
+#define DEFAULT_PROBE_MISS_COUNT    2
+#define DEFAULT_PROBE_MISS_WINDOW   300
+#define DEFAULT_RSRP_DROP_DB        8
+#define DEFAULT_SINR_DROP_DB        6
+
+/* Switching parameters
+ * PREROLL: Wait this long after triggering before switching (let duplication stabilize)
+ * MIN_HOLD: Stay in protection mode for at least this long
+ * CLEAN_EXIT: Need this many seconds of "clean" before exiting protection
+ */
+#define DEFAULT_PREROLL_MS          500
+#define DEFAULT_MIN_HOLD_SEC        8
+#define DEFAULT_CLEAN_EXIT_SEC      5
+
+/* Risk output interval (how often prediction engine runs) */
+#define RISK_INTERVAL_MS            250
+
+/* Trajectory look-ahead
+ * HORIZON: How far ahead we walk the risk index
+ * LEAD: Pre-arm duplication when a high-risk tile is this close
+ * PREPARE/PROTECT: Risk thresholds for recommendation and predictor
+ * MIN_CONF: Ignore tiles we have seen too few times
+ */
+#define DEFAULT_PREDICT_HORIZON_SEC 30
+#define DEFAULT_PREDICT_LEAD_SEC    5
+#define DEFAULT_RISK_PREPARE        0.4
+#define DEFAULT_RISK_PROTECT        0.7
+#define DEFAULT_PREDICT_MIN_CONF    0.3
+
+/* Cellular handover prediction (handover.h)
+ * HYST: Neighbour must beat the serving cell by this much (network A3 offset)
+ * LEAD_MS: Duplicate this long before the predicted handover
+ * PROB: Learned handover likelihood that arms on a close neighbour alone
+ * MIN_GAP_MS: Learned gaps shorter than this aren't worth duplicating for
+ */
+#define DEFAULT_HO_HYST_DB          3.0
+#define DEFAULT_HO_LEAD_MS          500
+#define DEFAULT_HO_PROB             0.5
+#define HO_MIN_GAP_MS               50
+
+/* Failure correlation (corrmap.h) - P(b fails | a fails) before any data:
+ * uplinks of one type share coverage holes / sky, others mostly don't
+ */
+#define CORR_PRIOR_SAME_TYPE        0.3
+#define CORR_PRIOR_OTHER_TYPE       0.1
+
+/*
+ * Side effects. Every engine decision that leaves the engine goes through
+ * one of these; ctx is engine_t.ctx.
+ */
+typedef struct {
+    int64_t (*now_us)(void* ctx);
+
+    /* type is the event name, json its complete data object */
+    void    (*log_event)(void* ctx, const char* type, const char* json);
+
+    /* Start/stop copying src's traffic to dst. Must keep status->dup_* current. */
+    void    (*dup_enable)(void* ctx, uplink_id_t src, uplink_id_t dst);
+    void    (*dup_disable)(void* ctx);
+
+    /* P(b fails | a fails) at the current location, prior if unknown */
+    double  (*corr)(void* ctx, int a, int b, double prior);
+
+    /* Optional: every feature vector the model scored (online learning) */
+    void    (*learn)(void* ctx, const uplink_t* u, int i, const float* x, int64_t now);
+
+    /* Optional: the active uplink is now target; bring the return path along */
+    void    (*route_switch)(void* ctx, uplink_id_t target);
+} engine_ops_t;
+
+typedef struct {
+    const engine_ops_t* ops;
+    void*           ctx;
+    const config_t* cfg;            /* Swapped by the owner on reload */
+    uplink_t*       uplinks;
+    int             n_uplinks;      /* Table size, at most MAX_UPLINKS */
+    status_t*       status;
+    const gps_t*    gps;
+    const model_t*  model;          /* Swapped by the owner on reload */
+} engine_t;
+
+/* Decision thresholds from config JSON, defaults for missing keys */
+void engine_config_load(config_t* cfg, const char* json);
+
+/* Only the keys present in json, the rest of cfg is kept (shadow policies) */
+void engine_config_overlay(config_t* cfg, const char* json);
+
+/* Types and ranges of the decision keys in json: 0, or -1 and why in err */
+int  engine_config_check(const char* json, char* err, size_t len);
+
+/* Record one probe result (rtt <= 0 = lost) and update u's derived metrics */
+void engine_probe(uplink_t* u, double rtt, int64_t t_us);
+
+/* One main-loop iteration of the state machine (mode, state -> action) */
+void engine_step(engine_t* e);
+
+/* risk_now per uplink from the model, global_risk and recommendation */
+void engine_prediction_tick(engine_t* e);
+
+/* Fast path */
+trigger_t   engine_tripwire_check(engine_t* e, uplink_t* active);
+void        engine_tripwire_fire(engine_t* e, trigger_t reason, const char* detail);
+
+/* Slow path */
+void        engine_slowpath_arbitrate(engine_t* e);
+uplink_id_t engine_select_best(engine_t* e);
+void        engine_switch(engine_t* e, uplink_id_t target);
+void        engine_protection_tick(engine_t* e);
+
+/* Act on the active uplink's look-ahead ETAs; actuate=false logs would-do only */
+void        engine_predictor_step(engine_t* e, bool actuate);
+
+/* P(b fails | a fails) here, with the by-type prior */
+double      engine_corr(engine_t* e, int a, int b);
+
+/* Healthy uplink least likely to fail together with active */
+uplink_id_t engine_pick_secondary(engine_t* e, uplink_id_t active);
+
+#endif /* PATHSTEER_ENGINE_H */
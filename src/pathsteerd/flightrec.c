@@ -0,0 +1,471 @@
+/*******************************************************************************
+ * flightrec.c - PathSteer Guardian Data-Plane Flight Recorder
+ *
+ * See flightrec.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "flightrec.h"
+
+/* How often the thread collects retired blocks. Not poll(): a V3 ring
+ * reads as ready for as long as we hold its last retired block.
+ */
+#define FLIGHTREC_SCAN_MS       100
+
+#define PCAP_MAGIC_NS           0xa1b23c4d
+#define LINKTYPE_ETHERNET       1
+
+static int64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*=============================================================================
+ * Rings
+ *===========================================================================*/
+
+static struct tpacket_block_desc* ring_block(const flightrec_ring_t* r, unsigned i) {
+    return (struct tpacket_block_desc*)(r->map + (size_t)(i % r->nblocks) * FLIGHTREC_BLOCK_SIZE);
+}
+
+static int64_t block_last_us(const struct tpacket_block_desc* bd) {
+    return (int64_t)bd->hdr.bh1.ts_last_pkt.ts_sec * 1000000 + bd->hdr.bh1.ts_last_pkt.ts_nsec / 1000;
+}
+
+static int ring_bind(flightrec_ring_t* r, const char* dev) {
+    unsigned idx = if_nametoindex(dev);
+    if (idx == 0) return -1;
+    struct sockaddr_ll sll = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons(ETH_P_ALL),
+        .sll_ifindex = (int)idx,
+    };
+    if (bind(r->fd, (struct sockaddr*)&sll, sizeof(sll)) < 0) return -1;
+    snprintf(r->dev, sizeof(r->dev), "%s", dev);
+    return 0;
+}
+
+static void ring_close(flightrec_ring_t* r) {
+    if (r->map) munmap(r->map, (size_t)r->nblocks * FLIGHTREC_BLOCK_SIZE);
+    if (r->fd >= 0) close(r->fd);
+    r->map = NULL;
+    r->fd = -1;
+}
+
+static int ring_open(flightrec_ring_t* r, const char* name, const char* dev, unsigned nblocks, int snaplen) {
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->nblocks = nblocks;
+
+    r->fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    if (r->fd < 0) return -1;
+
+    /* Headers only: the kernel cuts every packet to snaplen */
+    struct sock_filter code[] = { BPF_STMT(BPF_RET | BPF_K, (unsigned)snaplen) };
+    struct sock_fprog prog = { .len = 1, .filter = code };
+    int version = TPACKET_V3;
+    struct tpacket_req3 req = {
+        .tp_block_size = FLIGHTREC_BLOCK_SIZE,
+        .tp_block_nr = r->nblocks,
+        .tp_frame_size = FLIGHTREC_FRAME_SIZE,
+        .tp_frame_nr = r->nblocks * (FLIGHTREC_BLOCK_SIZE / FLIGHTREC_FRAME_SIZE),
+        .tp_retire_blk_tov = FLIGHTREC_BLOCK_TOV_MS,
+    };
+    if (setsockopt(r->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0 ||
+        setsockopt(r->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+        setsockopt(r->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        goto fail;
+    }
+
+    void* map = mmap(NULL, (size_t)r->nblocks * FLIGHTREC_BLOCK_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, r->fd, 0);
+    if (map == MAP_FAILED) goto fail;
+    r->map = map;
+
+    if (ring_bind(r, dev) < 0) goto fail;
+    return 0;
+
+fail:;
+    int err = errno;
+    ring_close(r);
+    errno = err;
+    return -1;
+}
+
+/* Pick up blocks the kernel has retired since the last scan */
+static void ring_collect(flightrec_ring_t* r) {
+    while (r->held < r->nblocks) {
+        struct tpacket_block_desc* bd = ring_block(r, r->head + r->held);
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) break;
+        r->held++;
+    }
+}
+
+static void ring_release(flightrec_ring_t* r) {
+    struct tpacket_block_desc* bd = ring_block(r, r->head);
+    __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    r->head = (r->head + 1) % r->nblocks;
+    r->held--;
+}
+
+/* Give back blocks older than keep_us. Returns the newest packet time of
+ * any block given back early (ring full) that was still wanted from
+ * want_us on, else INT64_MIN.
+ */
+static int64_t ring_trim(flightrec_ring_t* r, int64_t keep_us, int64_t want_us) {
+    int64_t lost_us = INT64_MIN;
+    while (r->held > 0) {
+        struct tpacket_block_desc* bd = ring_block(r, r->head);
+        int64_t last = block_last_us(bd);
+        if (bd->hdr.bh1.num_pkts > 0 && r->held <= r->nblocks - FLIGHTREC_SPARE_BLOCKS && last >= keep_us) break;
+        if (bd->hdr.bh1.num_pkts > 0 && last >= want_us) {
+            r->released_early++;
+            lost_us = last;
+        }
+        ring_release(r);
+    }
+    return lost_us;
+}
+
+/*=============================================================================
+ * Dumps
+ *===========================================================================*/
+
+typedef struct {
+    uint32_t    magic;
+    uint16_t    version_major;
+    uint16_t    version_minor;
+    int32_t     thiszone;
+    uint32_t    sigfigs;
+    uint32_t    snaplen;
+    uint32_t    network;
+} pcap_file_hdr_t;
+
+typedef struct {
+    uint32_t    ts_sec;
+    uint32_t    ts_nsec;
+    uint32_t    caplen;
+    uint32_t    len;
+} pcap_rec_hdr_t;
+
+/* Held packets in [from_us, to_us] to path; -1 if it can't be written */
+static long ring_dump(const flightrec_ring_t* r, int snaplen, int64_t from_us, int64_t to_us,
+                      const char* path, int64_t* first_us) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+
+    pcap_file_hdr_t fh = { PCAP_MAGIC_NS, 2, 4, 0, 0, (uint32_t)snaplen, LINKTYPE_ETHERNET };
+    fwrite(&fh, sizeof(fh), 1, f);
+
+    long n = 0;
+    *first_us = 0;
+    for (unsigned b = 0; b < r->held; b++) {
+        struct tpacket_block_desc* bd = ring_block(r, r->head + b);
+        if (block_last_us(bd) < from_us) continue;
+
+        uint8_t* p = (uint8_t*)bd + bd->hdr.bh1.offset_to_first_pkt;
+        for (uint32_t i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+            struct tpacket3_hdr* ph = (struct tpacket3_hdr*)p;
+            int64_t t = (int64_t)ph->tp_sec * 1000000 + ph->tp_nsec / 1000;
+            if (t >= from_us && t <= to_us) {
+                pcap_rec_hdr_t rh = { ph->tp_sec, ph->tp_nsec, ph->tp_snaplen, ph->tp_len };
+                fwrite(&rh, sizeof(rh), 1, f);
+                fwrite((uint8_t*)ph + ph->tp_mac, 1, ph->tp_snaplen, f);
+                if (n++ == 0) *first_us = t;
+            }
+            p += ph->tp_next_offset;
+        }
+    }
+
+    if (fclose(f) != 0) return -1;
+    return n;
+}
+
+static void mkdir_p(const char* dir) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char* p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        mkdir(path, 0755);
+        *p = '/';
+    }
+    mkdir(path, 0755);
+}
+
+typedef struct {
+    char        name[96];
+    time_t      mtime;
+    int64_t     bytes;
+} dump_file_t;
+
+static int dump_file_cmp(const void* a, const void* b) {
+    const dump_file_t* x = a;
+    const dump_file_t* y = b;
+    if (x->mtime != y->mtime) return x->mtime < y->mtime ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* Delete the oldest dumps until the rest fit in keep_bytes; never the last
+ * keep_newest files (the dump just written). Returns the files deleted. */
+static int prune(flightrec_t* fr, int keep_newest) {
+    DIR* d = opendir(fr->dir);
+    if (!d) return 0;
+
+    dump_file_t* files = NULL;
+    size_t n = 0, cap = 0;
+    int64_t total = 0;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (strncmp(de->d_name, FLIGHTREC_PREFIX, strlen(FLIGHTREC_PREFIX)) != 0 ||
+            len < 5 || strcmp(de->d_name + len - 5, ".pcap") != 0 || len >= sizeof(files[0].name)) {
+            continue;
+        }
+        char path[256];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", fr->dir, de->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        if (n == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            dump_file_t* nf = realloc(files, ncap * sizeof(*files));
+            if (!nf) break;
+            files = nf;
+            cap = ncap;
+        }
+        snprintf(files[n].name, sizeof(files[n].name), "%s", de->d_name);
+        files[n].mtime = st.st_mtime;
+        files[n].bytes = st.st_size;
+        total += st.st_size;
+        n++;
+    }
+    closedir(d);
+
+    int deleted = 0;
+    if (total > fr->keep_bytes) {
+        qsort(files, n, sizeof(*files), dump_file_cmp);
+        for (size_t i = 0; i + keep_newest < n && total > fr->keep_bytes; i++) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s/%s", fr->dir, files[i].name);
+            if (unlink(path) == 0) {
+                total -= files[i].bytes;
+                deleted++;
+            }
+        }
+    }
+    free(files);
+    return deleted;
+}
+
+static void dump(flightrec_t* fr, const flightrec_slice_t* s) {
+    mkdir_p(fr->dir);
+
+    /* Named after the first trigger */
+    time_t t = (time_t)((s->from_us + (int64_t)fr->pre_ms * 1000) / 1000000);
+    struct tm tm;
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime_r(&t, &tm));
+
+    char json[1024];
+    size_t len = (size_t)snprintf(json, sizeof(json),
+        "{\"reason\":\"%s\",\"merged\":%d,\"pre_ms\":%d,\"span_ms\":%ld,\"truncated\":%s,\"files\":[",
+        s->reason, s->merged, fr->pre_ms, (long)((s->to_us - s->from_us) / 1000),
+        s->truncated ? "true" : "false");
+
+    for (int i = 0; i < fr->nrings; i++) {
+        flightrec_ring_t* r = &fr->rings[i];
+        char name[96], path[256];
+        snprintf(name, sizeof(name), FLIGHTREC_PREFIX "%s_%s_%s.pcap", stamp, s->reason, r->name);
+        snprintf(path, sizeof(path), "%s/%s", fr->dir, name);
+
+        int64_t first_us;
+        long n = ring_dump(r, fr->snaplen, s->from_us, s->to_us, path, &first_us);
+
+        /* Kernel drops since the previous dump (reading resets them) */
+        struct tpacket_stats_v3 st = { 0 };
+        socklen_t sl = sizeof(st);
+        getsockopt(r->fd, SOL_PACKET, PACKET_STATISTICS, &st, &sl);
+
+        if (len < sizeof(json)) {
+            len += (size_t)snprintf(json + len, sizeof(json) - len,
+                "%s{\"dev\":\"%s\",\"file\":\"%s\",\"packets\":%ld,\"first_ms\":%ld,\"kernel_drops\":%u}",
+                i ? "," : "", r->dev, n >= 0 ? name : "", n,
+                n > 0 ? (long)((first_us - s->from_us) / 1000) : -1L, st.tp_drops);
+        }
+    }
+    int pruned = prune(fr, fr->nrings);
+    if (len < sizeof(json)) snprintf(json + len, sizeof(json) - len, "],\"pruned\":%d}", pruned);
+
+    if (fr->on_dump) fr->on_dump(fr->ctx, json);
+}
+
+/*=============================================================================
+ * Recorder Thread
+ *===========================================================================*/
+
+static void* recorder_thread(void* arg) {
+    flightrec_t* fr = arg;
+    const int64_t retire_us = 2LL * FLIGHTREC_BLOCK_TOV_MS * 1000;  /* Last packet to its block retired */
+
+    for (;;) {
+        bool running = atomic_load(&fr->running);
+        int64_t now = realtime_us();
+
+        pthread_mutex_lock(&fr->lock);
+        if (fr->follow_dev[0] && fr->nrings > 1) {
+            ring_bind(&fr->rings[1], fr->follow_dev);
+            fr->follow_dev[0] = '\0';
+        }
+        int64_t want = fr->npending ? fr->pending[0].from_us : INT64_MAX;
+        pthread_mutex_unlock(&fr->lock);
+
+        /* Keep the pre window, plus whatever a pending slice still needs */
+        int64_t keep = now - (int64_t)fr->pre_ms * 1000 - retire_us;
+        if (want < keep) keep = want;
+
+        int64_t lost = INT64_MIN;
+        for (int i = 0; i < fr->nrings; i++) {
+            ring_collect(&fr->rings[i]);
+            int64_t l = ring_trim(&fr->rings[i], keep, want);
+            if (l > lost) lost = l;
+        }
+
+        /* Write every slice whose post window is in (or that we're stopping) */
+        for (;;) {
+            flightrec_slice_t s;
+            pthread_mutex_lock(&fr->lock);
+            for (int i = 0; i < fr->npending && lost != INT64_MIN; i++) {
+                if (fr->pending[i].from_us <= lost) fr->pending[i].truncated = true;
+            }
+            bool due = fr->npending > 0 && (!running || fr->pending[0].to_us + retire_us <= now);
+            if (due) {
+                s = fr->pending[0];
+                fr->npending--;
+                memmove(&fr->pending[0], &fr->pending[1], fr->npending * sizeof(fr->pending[0]));
+            }
+            pthread_mutex_unlock(&fr->lock);
+            lost = INT64_MIN;
+            if (!due) break;
+            dump(fr, &s);
+        }
+
+        if (!running) break;
+        struct timespec ts = { 0, FLIGHTREC_SCAN_MS * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+/*=============================================================================
+ * API
+ *===========================================================================*/
+
+void flightrec_init(flightrec_t* fr) {
+    memset(fr, 0, sizeof(*fr));
+    for (int i = 0; i < FLIGHTREC_RINGS; i++) fr->rings[i].fd = -1;
+    pthread_mutex_init(&fr->lock, NULL);
+}
+
+int flightrec_start(flightrec_t* fr, const char* lan_dev, const char* active_dev,
+                    int ring_mb, int snaplen, int pre_ms, int post_ms,
+                    const char* dir, int keep_mb,
+                    flightrec_dump_cb on_dump, void* ctx) {
+    fr->pre_ms = pre_ms;
+    fr->post_ms = post_ms;
+    fr->snaplen = snaplen;
+    snprintf(fr->dir, sizeof(fr->dir), "%s", dir);
+    fr->keep_bytes = (int64_t)keep_mb * 1024 * 1024;
+    fr->on_dump = on_dump;
+    fr->ctx = ctx;
+
+    /* A quiet link still retires a block per timeout: keep enough of them
+     * for two back-to-back slices whatever the rate, ring_mb or not.
+     */
+    unsigned nblocks = (unsigned)((size_t)ring_mb * 1024 * 1024 / FLIGHTREC_BLOCK_SIZE);
+    unsigned min_blocks = (unsigned)(2 * (pre_ms + post_ms) / FLIGHTREC_BLOCK_TOV_MS) + 4 * FLIGHTREC_SPARE_BLOCKS;
+    if (nblocks < min_blocks) nblocks = min_blocks;
+
+    const char* devs[FLIGHTREC_RINGS] = { lan_dev, active_dev };
+    const char* names[FLIGHTREC_RINGS] = { "lan", "active" };
+    fr->nrings = 0;
+    for (int i = 0; i < FLIGHTREC_RINGS; i++) {
+        if (ring_open(&fr->rings[i], names[i], devs[i], nblocks, snaplen) < 0) goto fail;
+        fr->nrings++;
+    }
+
+    atomic_store(&fr->running, true);
+    int rc = pthread_create(&fr->thread, NULL, recorder_thread, fr);
+    if (rc != 0) {
+        atomic_store(&fr->running, false);
+        errno = rc;
+        goto fail;
+    }
+    return 0;
+
+fail:;
+    int err = errno;
+    for (int i = 0; i < fr->nrings; i++) ring_close(&fr->rings[i]);
+    fr->nrings = 0;
+    errno = err;
+    return -1;
+}
+
+void flightrec_trigger(flightrec_t* fr, const char* reason) {
+    if (!atomic_load(&fr->running)) return;
+    int64_t now = realtime_us();
+    int64_t from = now - (int64_t)fr->pre_ms * 1000;
+    int64_t to = now + (int64_t)fr->post_ms * 1000;
+
+    pthread_mutex_lock(&fr->lock);
+    flightrec_slice_t* last = fr->npending ? &fr->pending[fr->npending - 1] : NULL;
+    if (last && from <= last->to_us && to - last->from_us <= FLIGHTREC_MAX_SPAN_MS * 1000LL) {
+        /* Overlaps the previous incident: one longer slice */
+        last->to_us = to;
+        last->merged++;
+    } else if (fr->npending < FLIGHTREC_PENDING) {
+        flightrec_slice_t* s = &fr->pending[fr->npending++];
+        memset(s, 0, sizeof(*s));
+        s->from_us = from;
+        s->to_us = to;
+        snprintf(s->reason, sizeof(s->reason), "%s", reason);
+    } else {
+        fr->dropped++;
+    }
+    pthread_mutex_unlock(&fr->lock);
+}
+
+void flightrec_follow(flightrec_t* fr, const char* dev) {
+    if (!atomic_load(&fr->running)) return;
+    pthread_mutex_lock(&fr->lock);
+    snprintf(fr->follow_dev, sizeof(fr->follow_dev), "%s", dev);
+    pthread_mutex_unlock(&fr->lock);
+}
+
+void flightrec_stop(flightrec_t* fr) {
+    if (!atomic_load(&fr->running)) return;
+    atomic_store(&fr->running, false);
+    pthread_join(fr->thread, NULL);
+    for (int i = 0; i < fr->nrings; i++) ring_close(&fr->rings[i]);
+    fr->nrings = 0;
+}
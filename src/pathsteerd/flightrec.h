@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * flightrec.h - PathSteer Guardian Data-Plane Flight Recorder
+ *
+ * PURPOSE:
+ *   Keep the last few seconds of packet headers from br-lan and the active
+ *   uplink's veth in memory, and write a pcap slice around every incident
+ *   (from pre_ms before to post_ms after the trigger) without an always-on
+ *   tcpdump.
+ *
+ * HOW:
+ *   One AF_PACKET TPACKET_V3 ring per interface, with a one-instruction BPF
+ *   filter cutting packets to snaplen in the kernel. Packets are never
+ *   copied while recording: the recorder thread holds on to retired ring
+ *   blocks until they are older than the window it must keep, then hands
+ *   them back to the kernel. A dump walks the held blocks once the post
+ *   window has been retired.
+ *
+ *   If traffic outruns the ring, the oldest blocks are handed back early
+ *   so capture never stalls; the slice then starts later than asked and
+ *   the dump says so.
+ *
+ * THREADING:
+ *   flightrec_trigger() and flightrec_follow() may be called from any
+ *   thread; the ring is only touched by the recorder thread, which also
+ *   writes the dumps and reports them through the on_dump callback.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_FLIGHTREC_H
+#define PATHSTEER_FLIGHTREC_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLIGHTREC_RINGS         2           /* br-lan, active veth */
+#define FLIGHTREC_BLOCK_SIZE    (1 << 17)   /* 128 KB ring blocks */
+#define FLIGHTREC_FRAME_SIZE    2048        /* V3 ignores frames, the kernel still checks them */
+#define FLIGHTREC_BLOCK_TOV_MS  250         /* Partly filled blocks retire after this */
+#define FLIGHTREC_SPARE_BLOCKS  2           /* Never hold these last blocks back */
+#define FLIGHTREC_PENDING       4           /* Triggers waiting for their post window */
+#define FLIGHTREC_MAX_SPAN_MS   60000       /* Merged triggers extend a slice up to this */
+#define FLIGHTREC_PREFIX        "fr_"       /* Dump files; only these are pruned */
+
+/* Called from the recorder thread after each dump */
+typedef void (*flightrec_dump_cb)(void* ctx, const char* json);
+
+typedef struct {
+    char        name[16];           /* File suffix: "lan", "active" */
+    char        dev[32];            /* Bound interface */
+    int         fd;
+    uint8_t*    map;
+    unsigned    nblocks;
+    unsigned    head;               /* Oldest held block */
+    unsigned    held;               /* Retired blocks held from head */
+    uint64_t    released_early;     /* Held blocks given back while a slice wanted them */
+} flightrec_ring_t;
+
+typedef struct {
+    int64_t     from_us;            /* Wall clock, as packet timestamps */
+    int64_t     to_us;
+    int         merged;             /* Further triggers folded into this slice */
+    bool        truncated;          /* Ring overran: starts later than from_us */
+    char        reason[32];
+} flightrec_slice_t;
+
+typedef struct {
+    flightrec_ring_t    rings[FLIGHTREC_RINGS];
+    int                 nrings;
+    int                 pre_ms;
+    int                 post_ms;
+    int                 snaplen;
+    char                dir[128];
+    int64_t             keep_bytes;     /* Dumps in dir beyond this are pruned, oldest first */
+    flightrec_dump_cb   on_dump;
+    void*               ctx;
+
+    pthread_t           thread;
+    _Atomic bool        running;
+    pthread_mutex_t     lock;       /* Guards the fields below */
+    flightrec_slice_t   pending[FLIGHTREC_PENDING];
+    int                 npending;
+    uint64_t            dropped;    /* Triggers with no pending slot */
+    char                follow_dev[32];     /* Rebind rings[1] to this */
+} flightrec_t;
+
+/* Zero fr; flightrec_stop() is then a no-op */
+void flightrec_init(flightrec_t* fr);
+
+/* Open a ring_mb ring on lan_dev and on active_dev and start recording.
+ * Rings are raised to one block per FLIGHTREC_BLOCK_TOV_MS of two
+ * slices. After each dump, older dumps in dir are deleted until they fit
+ * in keep_mb (the newest is always kept). -1 with errno on failure (e.g.
+ * EPERM without CAP_NET_RAW).
+ */
+int  flightrec_start(flightrec_t* fr, const char* lan_dev, const char* active_dev,
+                     int ring_mb, int snaplen, int pre_ms, int post_ms,
+                     const char* dir, int keep_mb,
+                     flightrec_dump_cb on_dump, void* ctx);
+
+/* Dump [now - pre_ms, now + post_ms] once it has been recorded */
+void flightrec_trigger(flightrec_t* fr, const char* reason);
+
+/* Move the active-path ring to dev (after a switch) */
+void flightrec_follow(flightrec_t* fr, const char* dev);
+
+/* Stop the thread and unmap the rings; pending slices are written first */
+void flightrec_stop(flightrec_t* fr);
+
+#endif /* PATHSTEER_FLIGHTREC_H */
@@ -0,0 +1,485 @@
+/*******************************************************************************
+ * flowmon.c - PathSteer Guardian Conntrack Flow Monitor
+ *
+ * See flowmon.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <endian.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/netlink.h>
+
+#include "flowmon.h"
+#include "netns.h"
+
+#define FLOWMON_RCVBUF          (4 << 20)   /* Event bursts (many flows at once) */
+
+/* Link addresses between ns_vip and the path namespaces: probes, not clients */
+#define FLOWMON_SKIP_NET        0x0ac90a00  /* 10.201.10.0/24 */
+#define FLOWMON_SKIP_MASK       0xffffff00
+
+static int64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*=============================================================================
+ * Services (as scripts/flow-monitor.py)
+ *===========================================================================*/
+
+static void flow_service(flowmon_flow_t* f) {
+    const flowmon_key_t* k = &f->key;
+    bool udp = k->proto == IPPROTO_UDP;
+    unsigned port = k->dport;
+    const char* name = NULL;
+
+    if (port == 443 && !udp) name = "HTTPS/WSS";
+    else if (port == 5060) name = udp ? "SIP" : "SIP-TCP";
+    else if (port == 5061 && !udp) name = "SIP-TLS";
+    else if (port == 8443 && !udp) name = "WebRTC-Sig";
+    else if (udp && port >= 16384 && port <= 32767) name = port % 2 ? "RTCP" : "RTP/SRTP";
+    else if (udp && port > 10000) name = "UDP-Media";
+    if (name) {
+        snprintf(f->service, sizeof(f->service), "%s", name);
+        return;
+    }
+
+    if (k->family == AF_INET) {
+        switch (k->dst[0]) {
+        case 3: case 52: case 54:
+            snprintf(f->service, sizeof(f->service), "AWS:%u", port);
+            return;
+        case 170: case 173:
+            snprintf(f->service, sizeof(f->service), "Webex:%u", port);
+            return;
+        }
+    }
+    snprintf(f->service, sizeof(f->service), "%s:%u", udp ? "UDP" : k->proto == IPPROTO_TCP ? "TCP" : "IP", port);
+}
+
+/*=============================================================================
+ * Flow Table
+ *
+ * Chained hash over a fixed array; entries come from a free list, so an
+ * event is one hash and a short chain walk.
+ *===========================================================================*/
+
+static uint32_t key_hash(const flowmon_key_t* k) {
+    /* FNV-1a */
+    const uint8_t* p = (const uint8_t*)k;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(*k); i++) h = (h ^ p[i]) * 16777619u;
+    return h % FLOWMON_BUCKETS;
+}
+
+static flowmon_flow_t* flow_find(flowmon_t* fm, const flowmon_key_t* k, bool create) {
+    uint32_t b = key_hash(k);
+    for (int32_t i = fm->buckets[b]; i >= 0; i = fm->flows[i].next) {
+        if (memcmp(&fm->flows[i].key, k, sizeof(*k)) == 0) return &fm->flows[i];
+    }
+    if (!create) return NULL;
+    if (fm->free_head < 0) {
+        fm->table_full++;
+        return NULL;
+    }
+
+    int32_t i = fm->free_head;
+    flowmon_flow_t* f = &fm->flows[i];
+    fm->free_head = f->next;
+    memset(f, 0, sizeof(*f));
+    f->key = *k;
+    f->next = fm->buckets[b];
+    fm->buckets[b] = i;
+    f->start_us = f->last_seen_us = realtime_us();
+    f->seen_gen = fm->gen;
+    flow_service(f);
+    fm->count++;
+    return f;
+}
+
+static void flow_free(flowmon_t* fm, flowmon_flow_t* f) {
+    int32_t idx = (int32_t)(f - fm->flows);
+    int32_t* link = &fm->buckets[key_hash(&f->key)];
+    while (*link != idx) link = &fm->flows[*link].next;
+    *link = f->next;
+    f->next = fm->free_head;
+    f->key.family = 0;
+    fm->free_head = idx;
+    fm->count--;
+}
+
+/*=============================================================================
+ * ctnetlink Messages
+ *===========================================================================*/
+
+static void nla_parse(const struct nlattr** tb, int max, const void* data, int len) {
+    memset(tb, 0, (max + 1) * sizeof(*tb));
+    const struct nlattr* a = data;
+    while (len >= (int)sizeof(*a) && a->nla_len >= sizeof(*a) && a->nla_len <= len) {
+        int type = a->nla_type & NLA_TYPE_MASK;
+        if (type <= max) tb[type] = a;
+        int step = NLA_ALIGN(a->nla_len);
+        len -= step;
+        a = (const struct nlattr*)((const char*)a + step);
+    }
+}
+
+#define NLA_DATA(a)     ((const void*)((const char*)(a) + NLA_HDRLEN))
+#define NLA_LEN(a)      ((int)(a)->nla_len - NLA_HDRLEN)
+
+static uint64_t nla_be64(const struct nlattr* a) {
+    uint64_t v;
+    memcpy(&v, NLA_DATA(a), sizeof(v));
+    return be64toh(v);
+}
+
+static uint16_t nla_be16(const struct nlattr* a) {
+    uint16_t v;
+    memcpy(&v, NLA_DATA(a), sizeof(v));
+    return ntohs(v);
+}
+
+/* CTA_TUPLE_ORIG into k; false for flows we don't track */
+static bool parse_tuple(const struct nlattr* tuple, uint8_t family, flowmon_key_t* k) {
+    const struct nlattr* tt[CTA_TUPLE_MAX + 1];
+    const struct nlattr* ip[CTA_IP_MAX + 1];
+    const struct nlattr* pr[CTA_PROTO_MAX + 1];
+
+    nla_parse(tt, CTA_TUPLE_MAX, NLA_DATA(tuple), NLA_LEN(tuple));
+    if (!tt[CTA_TUPLE_IP] || !tt[CTA_TUPLE_PROTO]) return false;
+    nla_parse(ip, CTA_IP_MAX, NLA_DATA(tt[CTA_TUPLE_IP]), NLA_LEN(tt[CTA_TUPLE_IP]));
+    nla_parse(pr, CTA_PROTO_MAX, NLA_DATA(tt[CTA_TUPLE_PROTO]), NLA_LEN(tt[CTA_TUPLE_PROTO]));
+    if (!pr[CTA_PROTO_NUM]) return false;
+
+    memset(k, 0, sizeof(*k));
+    k->family = family;
+    k->proto = *(const uint8_t*)NLA_DATA(pr[CTA_PROTO_NUM]);
+    if (k->proto != IPPROTO_TCP && k->proto != IPPROTO_UDP) return false;
+    if (pr[CTA_PROTO_SRC_PORT]) k->sport = nla_be16(pr[CTA_PROTO_SRC_PORT]);
+    if (pr[CTA_PROTO_DST_PORT]) k->dport = nla_be16(pr[CTA_PROTO_DST_PORT]);
+
+    if (family == AF_INET && ip[CTA_IP_V4_SRC] && ip[CTA_IP_V4_DST]) {
+        memcpy(k->src, NLA_DATA(ip[CTA_IP_V4_SRC]), 4);
+        memcpy(k->dst, NLA_DATA(ip[CTA_IP_V4_DST]), 4);
+        uint32_t s, d;
+        memcpy(&s, k->src, 4);
+        memcpy(&d, k->dst, 4);
+        if ((ntohl(s) & FLOWMON_SKIP_MASK) == FLOWMON_SKIP_NET ||
+            (ntohl(d) & FLOWMON_SKIP_MASK) == FLOWMON_SKIP_NET) {
+            return false;
+        }
+        return true;
+    }
+    if (family == AF_INET6 && ip[CTA_IP_V6_SRC] && ip[CTA_IP_V6_DST]) {
+        memcpy(k->src, NLA_DATA(ip[CTA_IP_V6_SRC]), 16);
+        memcpy(k->dst, NLA_DATA(ip[CTA_IP_V6_DST]), 16);
+        return true;
+    }
+    return false;
+}
+
+static void parse_counters(const struct nlattr* a, uint64_t* packets, uint64_t* bytes) {
+    const struct nlattr* tb[CTA_COUNTERS_MAX + 1];
+    if (!a) return;
+    nla_parse(tb, CTA_COUNTERS_MAX, NLA_DATA(a), NLA_LEN(a));
+    if (tb[CTA_COUNTERS_PACKETS]) *packets += nla_be64(tb[CTA_COUNTERS_PACKETS]);
+    if (tb[CTA_COUNTERS_BYTES]) *bytes += nla_be64(tb[CTA_COUNTERS_BYTES]);
+}
+
+/* One conntrack message: an event, or an entry of a dump dt_us after the last */
+static void ct_message(flowmon_t* fm, const struct nlmsghdr* nh, int64_t now, bool dump, int64_t dt_us) {
+    int msg = NFNL_MSG_TYPE(nh->nlmsg_type);
+    if (NFNL_SUBSYS_ID(nh->nlmsg_type) != NFNL_SUBSYS_CTNETLINK) return;
+    if (msg != IPCTNL_MSG_CT_NEW && msg != IPCTNL_MSG_CT_DELETE) return;
+    if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct nfgenmsg))) return;
+
+    const struct nfgenmsg* g = NLMSG_DATA(nh);
+    const struct nlattr* tb[CTA_MAX + 1];
+    int len = (int)nh->nlmsg_len - NLMSG_LENGTH(sizeof(*g));
+    nla_parse(tb, CTA_MAX, (const char*)g + NLMSG_ALIGN(sizeof(*g)), len);
+
+    flowmon_key_t k;
+    if (!tb[CTA_TUPLE_ORIG] || !parse_tuple(tb[CTA_TUPLE_ORIG], g->nfgen_family, &k)) return;
+
+    bool destroy = msg == IPCTNL_MSG_CT_DELETE;
+    flowmon_flow_t* f = flow_find(fm, &k, !destroy);
+    if (!f) return;
+    if (!dump) fm->events++;
+
+    uint64_t packets = 0, bytes = 0;
+    parse_counters(tb[CTA_COUNTERS_ORIG], &packets, &bytes);
+    parse_counters(tb[CTA_COUNTERS_REPLY], &packets, &bytes);
+
+    /* Counters only grow; a reused tuple restarts them */
+    if (packets < f->packets) f->packets = f->bytes = 0;
+    if (packets > f->packets) {
+        if (dump && dt_us > 0) {
+            f->pps = (packets - f->packets) * 1e6 / dt_us;
+            f->bps = (bytes - f->bytes) * 8e6 / dt_us;
+        }
+        f->packets = packets;
+        f->bytes = bytes;
+        f->last_seen_us = now;
+    } else if (dump) {
+        f->pps = f->bps = 0;
+    }
+
+    if (destroy) {
+        f->ended = true;
+        f->pps = f->bps = 0;
+    } else if (dump) {
+        f->seen_gen = fm->gen;
+        f->ended = false;
+    }
+}
+
+/* Returns false once the socket has nothing more (or a dump is done) */
+static bool ct_recv(flowmon_t* fm, int fd, bool dump, int64_t now, int64_t dt_us) {
+    static char buf[65536];
+    ssize_t n = recv(fd, buf, sizeof(buf), dump ? 0 : MSG_DONTWAIT);
+    if (n < 0) {
+        if (errno == ENOBUFS) {
+            fm->overruns++;             /* The next dump catches up */
+            return true;
+        }
+        return false;
+    }
+    for (struct nlmsghdr* nh = (struct nlmsghdr*)buf; NLMSG_OK(nh, n); nh = NLMSG_NEXT(nh, n)) {
+        if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) return false;
+        ct_message(fm, nh, now, dump, dt_us);
+    }
+    return true;
+}
+
+static void ct_dump(flowmon_t* fm, int64_t now, int64_t dt_us) {
+    struct {
+        struct nlmsghdr n;
+        struct nfgenmsg g;
+    } req = {
+        .n = {
+            .nlmsg_len = sizeof(req),
+            .nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_GET,
+            .nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+        },
+        .g = { .nfgen_family = AF_UNSPEC, .version = NFNETLINK_V0 },
+    };
+    if (send(fm->dump_fd, &req, sizeof(req), 0) < 0) return;
+
+    fm->gen++;
+    while (ct_recv(fm, fm->dump_fd, true, now, dt_us)) {
+    }
+
+    /* Gone from the table without a destroy event we saw */
+    for (int i = 0; i < FLOWMON_MAX; i++) {
+        flowmon_flow_t* f = &fm->flows[i];
+        if (f->key.family && !f->ended && f->seen_gen != fm->gen) {
+            f->ended = true;
+            f->pps = f->bps = 0;
+        }
+    }
+}
+
+/*=============================================================================
+ * Failovers, Expiry and flows.json
+ *===========================================================================*/
+
+static void apply_failovers(flowmon_t* fm, int64_t now) {
+    uint32_t n = atomic_load(&fm->failovers);
+    if (n == fm->applied) return;
+    uint32_t add = n - fm->applied;
+    fm->applied = n;
+    for (int i = 0; i < FLOWMON_MAX; i++) {
+        flowmon_flow_t* f = &fm->flows[i];
+        if (f->key.family && !f->ended && now - f->last_seen_us < FLOWMON_SURVIVE_SEC * 1000000LL) {
+            f->failovers += add;
+        }
+    }
+}
+
+static void expire(flowmon_t* fm, int64_t now) {
+    for (int i = 0; i < FLOWMON_MAX; i++) {
+        flowmon_flow_t* f = &fm->flows[i];
+        if (f->key.family && now - f->last_seen_us > FLOWMON_KEEP_SEC * 1000000LL) flow_free(fm, f);
+    }
+}
+
+static bool flow_active(const flowmon_flow_t* f, int64_t now) {
+    return !f->ended && now - f->last_seen_us <= FLOWMON_ACTIVE_SEC * 1000000LL;
+}
+
+static void endpoint(const flowmon_key_t* k, const uint8_t* addr, unsigned port, char* out, size_t len) {
+    char ip[INET6_ADDRSTRLEN];
+    inet_ntop(k->family, addr, ip, sizeof(ip));
+    snprintf(out, len, k->family == AF_INET6 ? "[%s]:%u" : "%s:%u", ip, port);
+}
+
+static void write_json(flowmon_t* fm, int64_t now) {
+    /* FLOWMON_LIST most recently seen active flows, as flow-monitor.py */
+    int list[FLOWMON_LIST];
+    int nlist = 0, active = 0;
+    double pps = 0, bps = 0;
+    for (int i = 0; i < FLOWMON_MAX; i++) {
+        const flowmon_flow_t* f = &fm->flows[i];
+        if (!f->key.family || !flow_active(f, now)) continue;
+        active++;
+        pps += f->pps;
+        bps += f->bps;
+
+        int pos = nlist < FLOWMON_LIST ? nlist++ : FLOWMON_LIST;
+        while (pos > 0 && fm->flows[list[pos - 1]].last_seen_us < f->last_seen_us) {
+            if (pos < FLOWMON_LIST) list[pos] = list[pos - 1];
+            pos--;
+        }
+        if (pos < FLOWMON_LIST) list[pos] = i;
+    }
+
+    char tmp[160];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", fm->path);
+    FILE* fp = fopen(tmp, "w");
+    if (!fp) return;
+
+    fprintf(fp, "{\"source\":\"conntrack\",\"active_flows\":%d,\"total_flows\":%d,\"failover_count\":%u,"
+                "\"pps\":%.1f,\"bps\":%.0f,\"events\":%llu,\"overruns\":%llu,\"untracked\":%llu,\"flows\":[",
+            active, fm->count, fm->applied, pps, bps, (unsigned long long)fm->events,
+            (unsigned long long)fm->overruns, (unsigned long long)fm->table_full);
+    for (int j = 0; j < nlist; j++) {
+        const flowmon_flow_t* f = &fm->flows[list[j]];
+        char src[64], dst[64];
+        endpoint(&f->key, f->key.src, f->key.sport, src, sizeof(src));
+        endpoint(&f->key, f->key.dst, f->key.dport, dst, sizeof(dst));
+        fprintf(fp, "%s{\"proto\":\"%s\",\"src\":\"%s\",\"dst\":\"%s\",\"service\":\"%s\","
+                    "\"packets\":%llu,\"bytes\":%llu,\"pps\":%.1f,\"bps\":%.0f,\"start\":%.3f,"
+                    "\"last_seen\":%.3f,\"failovers_survived\":%u,\"active\":true}",
+                j ? "," : "", f->key.proto == IPPROTO_TCP ? "tcp" : "udp", src, dst, f->service,
+                (unsigned long long)f->packets, (unsigned long long)f->bytes, f->pps, f->bps,
+                f->start_us / 1e6, f->last_seen_us / 1e6, f->failovers);
+    }
+    fprintf(fp, "],\"updated\":%.3f}\n", now / 1e6);
+    fclose(fp);
+    rename(tmp, fm->path);
+}
+
+/*=============================================================================
+ * Thread and API
+ *===========================================================================*/
+
+static void* flowmon_thread(void* arg) {
+    flowmon_t* fm = arg;
+    int64_t last_dump = realtime_us(), last_write = 0;
+
+    ct_dump(fm, last_dump, 0);         /* Flows already open at start */
+    while (atomic_load(&fm->running)) {
+        struct pollfd pfd = { .fd = fm->ev_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) > 0) {
+            int64_t now = realtime_us();
+            while (ct_recv(fm, fm->ev_fd, false, now, 0)) {
+            }
+        }
+
+        int64_t now = realtime_us();
+        apply_failovers(fm, now);
+        if (now - last_dump >= FLOWMON_DUMP_MS * 1000LL) {
+            ct_dump(fm, now, now - last_dump);
+            last_dump = now;
+        }
+        if (now - last_write >= FLOWMON_WRITE_MS * 1000LL) {
+            expire(fm, now);
+            write_json(fm, now);
+            last_write = now;
+        }
+    }
+    return NULL;
+}
+
+void flowmon_init(flowmon_t* fm) {
+    memset(fm, 0, sizeof(*fm));
+    fm->ev_fd = fm->dump_fd = -1;
+    for (int i = 0; i < FLOWMON_BUCKETS; i++) fm->buckets[i] = -1;
+    for (int i = 0; i < FLOWMON_MAX; i++) fm->flows[i].next = i + 1 < FLOWMON_MAX ? i + 1 : -1;
+    fm->free_head = 0;
+}
+
+static int ct_socket(unsigned group) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (fd < 0) return -1;
+    struct sockaddr_nl sa = { .nl_family = AF_NETLINK };
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) goto fail;
+    if (group) {
+        int rcvbuf = FLOWMON_RCVBUF;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf));
+        unsigned groups[] = { NFNLGRP_CONNTRACK_NEW, NFNLGRP_CONNTRACK_DESTROY };
+        for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+            if (setsockopt(fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &groups[i], sizeof(groups[i])) < 0) goto fail;
+        }
+    }
+    return fd;
+
+fail:;
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+}
+
+int flowmon_start(flowmon_t* fm, const char* netns, const char* path) {
+    snprintf(fm->path, sizeof(fm->path), "%s", path);
+
+    /* Sockets (and the sysctl) belong to the namespace we are in when opened */
+    int self;
+    if (netns_enter(netns, &self) < 0) return -1;
+
+    FILE* acct = fopen("/proc/sys/net/netfilter/nf_conntrack_acct", "w");
+    if (acct) {
+        fputs("1\n", acct);
+        fclose(acct);
+    }
+    fm->ev_fd = ct_socket(1);
+    int err = errno;
+    if (fm->ev_fd >= 0) {
+        fm->dump_fd = ct_socket(0);
+        err = errno;
+    }
+
+    netns_leave(self);
+    if (fm->dump_fd < 0) goto fail;
+
+    atomic_store(&fm->running, true);
+    int rc = pthread_create(&fm->thread, NULL, flowmon_thread, fm);
+    if (rc == 0) return 0;
+    atomic_store(&fm->running, false);
+    err = rc;
+
+fail:
+    if (fm->ev_fd >= 0) close(fm->ev_fd);
+    if (fm->dump_fd >= 0) close(fm->dump_fd);
+    fm->ev_fd = fm->dump_fd = -1;
+    errno = err;
+    return -1;
+}
+
+void flowmon_failover(flowmon_t* fm) {
+    atomic_fetch_add(&fm->failovers, 1);
+}
+
+void flowmon_stop(flowmon_t* fm) {
+    if (!atomic_load(&fm->running)) return;
+    atomic_store(&fm->running, false);
+    pthread_join(fm->thread, NULL);
+    close(fm->ev_fd);
+    close(fm->dump_fd);
+    fm->ev_fd = fm->dump_fd = -1;
+}
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * flowmon.h - PathSteer Guardian Conntrack Flow Monitor
+ *
+ * PURPOSE:
+ *   Track the client sessions crossing ns_vip (service, packet and byte
+ *   rates, switches survived) for flows.json, from the kernel's connection
+ *   tracking instead of per-packet capture.
+ *
+ * HOW:
+ *   Two ctnetlink sockets opened inside the namespace: one subscribed to
+ *   new/destroy events, each a hash table insert or lookup, and one that
+ *   dumps the table with its accounting counters once a second for rates.
+ *   Userspace never sees a packet; work is per flow event and per flow per
+ *   dump. The dump also picks up flows whose events were lost (ENOBUFS).
+ *
+ *   Counters need net.netfilter.nf_conntrack_acct=1 in the namespace
+ *   (set by flowmon_start) and a ruleset that uses conntrack there, or the
+ *   kernel tracks nothing.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_FLOWMON_H
+#define PATHSTEER_FLOWMON_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FLOWMON_MAX             8192        /* Tracked flows, live and recently ended */
+#define FLOWMON_BUCKETS         16384
+#define FLOWMON_DUMP_MS         1000        /* Counter dump / rate period */
+#define FLOWMON_WRITE_MS        2000        /* flows.json period */
+#define FLOWMON_ACTIVE_SEC      30          /* Idle this long: inactive */
+#define FLOWMON_SURVIVE_SEC     10          /* Carried traffic this recently: survived a switch */
+#define FLOWMON_KEEP_SEC        300         /* Inactive flows kept for the UI */
+#define FLOWMON_LIST            20          /* Flows listed in flows.json */
+
+typedef struct {
+    uint8_t     family;             /* AF_INET / AF_INET6 */
+    uint8_t     proto;              /* IPPROTO_* */
+    uint16_t    sport;              /* Host order, original direction */
+    uint16_t    dport;
+    uint8_t     src[16];
+    uint8_t     dst[16];
+} flowmon_key_t;
+
+typedef struct {
+    flowmon_key_t   key;
+    int32_t         next;           /* Bucket chain / free list, -1 = end */
+    bool            ended;          /* Destroy event seen (or missing from a dump) */
+    uint32_t        seen_gen;       /* Last dump that listed it */
+    char            service[24];
+    int64_t         start_us;
+    int64_t         last_seen_us;   /* Last dump its counters moved */
+    uint64_t        packets;        /* Both directions */
+    uint64_t        bytes;
+    double          pps;            /* Over the last dump period */
+    double          bps;
+    uint32_t        failovers;      /* Switches it carried traffic across */
+} flowmon_flow_t;
+
+typedef struct {
+    int                 ev_fd;      /* Event subscription */
+    int                 dump_fd;    /* Counter dumps */
+    char                path[128];  /* flows.json */
+    pthread_t           thread;
+    _Atomic bool        running;
+    _Atomic uint32_t    failovers;  /* flowmon_failover() calls */
+    uint32_t            applied;    /* ... applied to the table */
+
+    /* Recorder thread only */
+    flowmon_flow_t      flows[FLOWMON_MAX];
+    int32_t             buckets[FLOWMON_BUCKETS];
+    int32_t             free_head;
+    int                 count;
+    uint32_t            gen;
+    uint64_t            events;
+    uint64_t            overruns;   /* Event socket overflows (ENOBUFS) */
+    uint64_t            table_full; /* Flows not tracked */
+} flowmon_t;
+
+/* Zero fm; flowmon_stop() is then a no-op */
+void flowmon_init(flowmon_t* fm);
+
+/* Open ctnetlink in netns (NULL/"" = ours) and write path every
+ * FLOWMON_WRITE_MS. -1 with errno on failure.
+ */
+int  flowmon_start(flowmon_t* fm, const char* netns, const char* path);
+
+/* The active uplink changed: count it for every flow still carrying traffic */
+void flowmon_failover(flowmon_t* fm);
+
+void flowmon_stop(flowmon_t* fm);
+
+#endif /* PATHSTEER_FLOWMON_H */
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * handover.c - PathSteer Guardian Cellular Handover Tracker
+ *
+ * See handover.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "handover.h"
+
+/*=============================================================================
+ * Parsing
+ *===========================================================================*/
+
+/* Value of key=... in line, copied up to the next space */
+static bool field(const char* line, const char* key, char* out, size_t len) {
+    const char* p = strstr(line, key);
+    if (!p || len == 0) return false;
+    p += strlen(key);
+
+    size_t n = 0;
+    while (p[n] && p[n] != ' ' && p[n] != '\n' && n + 1 < len) n++;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return n > 0;
+}
+
+void ho_snapshot_reset(ho_snapshot_t* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void ho_parse_line(ho_snapshot_t* s, const char* line) {
+    char v[32];
+
+    if (strncmp(line, "serving ", 8) == 0) {
+        field(line, "cell_id=", s->cell_id, sizeof(s->cell_id));
+        field(line, "tac=", s->tac, sizeof(s->tac));
+        if (field(line, "earfcn=", v, sizeof(v))) s->earfcn = (uint32_t)strtoul(v, NULL, 10);
+        if (field(line, "band=", v, sizeof(v))) s->band = atoi(v);
+        if (field(line, "pci=", v, sizeof(v))) s->pci = (uint16_t)atoi(v);
+        s->valid = s->cell_id[0] != '\0';
+    } else if (strncmp(line, "neighbor ", 9) == 0 && s->n_nbr < HO_MAX_NEIGHBORS) {
+        ho_cell_t* c = &s->nbr[s->n_nbr];
+        if (!field(line, "pci=", v, sizeof(v))) return;
+        c->pci = (uint16_t)atoi(v);
+        if (field(line, "earfcn=", v, sizeof(v))) c->earfcn = (uint32_t)strtoul(v, NULL, 10);
+        if (!field(line, "rsrp=", v, sizeof(v))) return;
+        c->rsrp = strtof(v, NULL);
+        s->n_nbr++;
+    }
+}
+
+/*=============================================================================
+ * Tracking
+ *===========================================================================*/
+
+void ho_reset(ho_tracker_t* t) {
+    memset(t, 0, sizeof(*t));
+    t->best_pci = -1;
+}
+
+bool ho_update(ho_tracker_t* t, const ho_snapshot_t* s, int64_t now_us) {
+    if (!s->valid) return false;
+
+    /* The serving line arrives after the list - find our own RSRP in it */
+    ho_snapshot_t snap = *s;
+    float best = -200.0f;
+    int best_pci = -1;
+    for (int i = 0; i < snap.n_nbr; i++) {
+        const ho_cell_t* c = &snap.nbr[i];
+        if (c->pci == snap.pci && c->earfcn == snap.earfcn) {
+            snap.rsrp = c->rsrp;
+        } else if (c->rsrp > best) {
+            best = c->rsrp;
+            best_pci = c->pci;
+        }
+    }
+
+    bool changed = t->cur.valid &&
+                   (strcmp(t->cur.cell_id, snap.cell_id) != 0 || t->cur.pci != snap.pci);
+
+    if (changed) {
+        memcpy(t->prev_cell_id, t->cur.cell_id, sizeof(t->prev_cell_id));
+        t->prev_pci = t->cur.pci;
+        t->handovers++;
+        t->last_ho_us = now_us;
+    }
+
+    if (best_pci < 0 || snap.rsrp == 0) {
+        /* Nothing to compare against */
+        t->best_pci = -1;
+        t->margin = 0;
+        t->margin_trend = 0;
+    } else {
+        double margin = best - snap.rsrp;
+        /* A new serving cell (or new best neighbour) restarts the trend */
+        if (!changed && t->best_pci == best_pci && t->t_us > 0 && now_us > t->t_us) {
+            double slope = (margin - t->margin) / ((now_us - t->t_us) / 1e6);
+            t->margin_trend += HO_TREND_ALPHA * (slope - t->margin_trend);
+        } else {
+            t->margin_trend = 0;
+        }
+        t->margin = margin;
+        t->best_pci = best_pci;
+    }
+
+    t->cur = snap;
+    t->t_us = now_us;
+    return changed;
+}
+
+double ho_eta(const ho_tracker_t* t, double hyst_db, int64_t now_us) {
+    if (!t->cur.valid || t->best_pci < 0) return -1;
+
+    double dt = (now_us - t->t_us) / 1e6;
+    if (dt > HO_STALE_SEC) return -1;
+
+    double m = t->margin + t->margin_trend * dt;
+    if (m >= hyst_db) return 0;
+    if (t->margin_trend < HO_MIN_TREND_DBS) return -1;
+
+    double eta = (hyst_db - m) / t->margin_trend;
+    return eta <= HO_ETA_MAX_SEC ? eta : -1;
+}
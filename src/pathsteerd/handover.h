@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * handover.h - PathSteer Guardian Cellular Handover Tracker
+ *
+ * PURPOSE:
+ *   Handover gaps are the most frequent cellular stall. The modem hands
+ *   over when a neighbour cell beats the serving cell by the network's A3
+ *   offset for time-to-trigger (typically ~3 dB for a few hundred ms), so
+ *   the serving-vs-best-neighbour RSRP margin and its trend tell us a
+ *   handover is coming before it happens.
+ *
+ * INPUT:
+ *   cellular-monitor.sh cell <dev> prints normalized qmicli cell location
+ *   info, one item per line:
+ *     serving cell_id=26634767 tac=30474 earfcn=66786 band=66 pci=157
+ *     neighbor pci=157 earfcn=66786 rsrp=-97.7
+ *     neighbor pci=300 earfcn=5035 rsrp=-105.0
+ *   The serving cell appears in the neighbour list too (same pci/earfcn);
+ *   that entry is its RSRP.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_HANDOVER_H
+#define PATHSTEER_HANDOVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HO_MAX_NEIGHBORS        16
+
+/* Margin trend smoothing and how far ahead we extrapolate it */
+#define HO_TREND_ALPHA          0.5
+#define HO_ETA_MAX_SEC          10.0
+
+/* A neighbour rising slower than this is not converging */
+#define HO_MIN_TREND_DBS        0.2
+
+/* Don't extrapolate a snapshot older than this */
+#define HO_STALE_SEC            3.0
+
+typedef struct {
+    uint16_t    pci;
+    uint32_t    earfcn;
+    float       rsrp;
+} ho_cell_t;
+
+/* One poll's worth of cell info */
+typedef struct {
+    char        cell_id[24];
+    char        tac[16];
+    int         band;
+    uint32_t    earfcn;
+    uint16_t    pci;
+    float       rsrp;           /* Serving cell, 0 if not listed */
+    ho_cell_t   nbr[HO_MAX_NEIGHBORS];
+    int         n_nbr;
+    bool        valid;          /* Saw a serving line */
+} ho_snapshot_t;
+
+typedef struct {
+    ho_snapshot_t cur;
+    double      margin;         /* Best neighbour - serving, dB */
+    double      margin_trend;   /* dB/s, smoothed */
+    int         best_pci;       /* -1 if no neighbour */
+    int64_t     t_us;           /* When cur was taken */
+    uint32_t    handovers;
+    int64_t     last_ho_us;
+    char        prev_cell_id[24]; /* Serving cell before the last handover */
+    uint16_t    prev_pci;
+} ho_tracker_t;
+
+void ho_snapshot_reset(ho_snapshot_t* s);
+
+/* Feed one line of script output into s */
+void ho_parse_line(ho_snapshot_t* s, const char* line);
+
+void ho_reset(ho_tracker_t* t);
+
+/* Take a new snapshot. Returns true if the serving cell changed. */
+bool ho_update(ho_tracker_t* t, const ho_snapshot_t* s, int64_t now_us);
+
+/*
+ * Seconds until the best neighbour is expected to beat the serving cell by
+ * hyst_db, extrapolating the margin trend to now_us. 0 if it already does,
+ * -1 if it is not converging (or there is no neighbour).
+ */
+double ho_eta(const ho_tracker_t* t, double hyst_db, int64_t now_us);
+
+#endif /* PATHSTEER_HANDOVER_H */
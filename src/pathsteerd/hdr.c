@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * hdr.c - PathSteer Guardian Latency Histograms
+ *
+ * See hdr.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hdr.h"
+
+#define HDR_HALF    (HDR_SUB_COUNT / 2)
+
+static int hdr_index(int64_t v) {
+    if (v < HDR_SUB_COUNT) return (int)v;
+
+    /* v in [2^msb, 2^(msb+1)): keep its top HDR_SUB_BITS - 1 bits */
+    int msb = 63 - __builtin_clzll((uint64_t)v);
+    int shift = msb - (HDR_SUB_BITS - 1);
+    int sub = (int)(v >> shift);            /* HDR_HALF..HDR_SUB_COUNT-1 */
+    return HDR_SUB_COUNT + (shift - 1) * HDR_HALF + (sub - HDR_HALF);
+}
+
+/* Middle of bucket idx */
+static int64_t hdr_value(int idx) {
+    if (idx < HDR_SUB_COUNT) return idx;
+    int shift = (idx - HDR_SUB_COUNT) / HDR_HALF + 1;
+    int64_t sub = (idx - HDR_SUB_COUNT) % HDR_HALF + HDR_HALF;
+    return (sub << shift) + (1LL << (shift - 1));
+}
+
+void hdr_reset(hdr_t* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void hdr_record(hdr_t* h, int64_t us) {
+    if (us < 0) us = 0;
+    if (us > HDR_MAX_US) us = HDR_MAX_US;
+    atomic_fetch_add_explicit(&h->counts[hdr_index(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, (uint64_t)us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+
+    int64_t max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+    while (us > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max_us, &max, us,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+int64_t hdr_quantile(const hdr_t* h, double q) {
+    uint64_t total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    if (total == 0) return 0;
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+
+    /* Rank of the value we want, 1-based */
+    uint64_t rank = (uint64_t)(q * total + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HDR_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= rank) {
+            int64_t v = hdr_value(i);
+            int64_t max = atomic_load_explicit(&h->max_us, memory_order_relaxed);
+            return v < max ? v : max;
+        }
+    }
+    /* Counts still landing after total was read */
+    return atomic_load_explicit(&h->max_us, memory_order_relaxed);
+}
+
+uint64_t hdr_count_le(const hdr_t* h, int64_t us) {
+    if (us < 0) return 0;
+    if (us > HDR_MAX_US) us = HDR_MAX_US;
+    int last = hdr_index(us);
+    uint64_t n = 0;
+    for (int i = 0; i <= last; i++) n += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+    return n;
+}
+
+void hdr_json(const hdr_t* h, char* out, size_t len) {
+    uint64_t total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    uint64_t sum = atomic_load_explicit(&h->sum_us, memory_order_relaxed);
+    snprintf(out, len,
+             "{\"count\":%llu,\"mean\":%.0f,\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p999\":%lld,"
+             "\"max\":%lld}",
+             (unsigned long long)total, total ? (double)sum / total : 0.0,
+             (long long)hdr_quantile(h, 0.50), (long long)hdr_quantile(h, 0.90),
+             (long long)hdr_quantile(h, 0.99), (long long)hdr_quantile(h, 0.999),
+             (long long)atomic_load_explicit(&h->max_us, memory_order_relaxed));
+}
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * hdr.h - PathSteer Guardian Latency Histograms
+ *
+ * PURPOSE:
+ *   Fixed-size HDR (high dynamic range) histograms for hot-path latencies:
+ *   recording is a couple of relaxed atomic adds, never a lock or an
+ *   allocation, so any thread can record while another reads percentiles.
+ *
+ * LAYOUT:
+ *   Values are microseconds. Below HDR_SUB_COUNT each value has its own
+ *   bucket; above, every power of two is split into HDR_SUB_COUNT / 2
+ *   linear sub-buckets, so any value is kept to within 1/64 (~1.6%) from
+ *   1 us up to HDR_MAX_US. Larger values are recorded as HDR_MAX_US.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_HDR_H
+#define PATHSTEER_HDR_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HDR_SUB_BITS            7
+#define HDR_SUB_COUNT           (1 << HDR_SUB_BITS)         /* 128 */
+#define HDR_MAX_EXP             36                          /* 2^36 us, ~19 h */
+#define HDR_BUCKETS             (HDR_SUB_COUNT + (HDR_MAX_EXP - HDR_SUB_BITS) * (HDR_SUB_COUNT / 2))
+#define HDR_MAX_US              ((1LL << HDR_MAX_EXP) - 1)
+
+typedef struct {
+    _Atomic uint64_t    counts[HDR_BUCKETS];
+    _Atomic uint64_t    total;
+    _Atomic uint64_t    sum_us;
+    _Atomic int64_t     max_us;
+} hdr_t;
+
+/* Zero h (not concurrently with hdr_record) */
+void    hdr_reset(hdr_t* h);
+
+/* Record one value; negative values count as 0 */
+void    hdr_record(hdr_t* h, int64_t us);
+
+/* Value at quantile q (0..1), as the middle of its bucket; 0 if empty */
+int64_t hdr_quantile(const hdr_t* h, double q);
+
+/* Values recorded <= us (by bucket, so within the bucket precision) */
+uint64_t hdr_count_le(const hdr_t* h, int64_t us);
+
+/* {"count":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..} */
+void    hdr_json(const hdr_t* h, char* out, size_t len);
+
+#endif /* PATHSTEER_HDR_H */
@@ -0,0 +1,535 @@
+/*******************************************************************************
+ * json.c - PathSteer Guardian Minimal JSON Reader
+ *
+ * See json.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/*=============================================================================
+ * Scanner
+ *===========================================================================*/
+
+typedef struct {
+    const char* at;
+    const char* what;
+} scan_err_t;
+
+static const char* scan_fail(scan_err_t* e, const char* at, const char* what) {
+    if (e) {
+        e->at = at;
+        e->what = what;
+    }
+    return NULL;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static const char* skip_ws(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    return p;
+}
+
+/* p at '"': past the closing quote, NULL if malformed */
+static const char* skip_string(const char* p) {
+    for (p++; *p != '"'; p++) {
+        if ((unsigned char)*p < 0x20) return NULL;     /* Control character or end of text */
+        if (*p != '\\') continue;
+        p++;
+        if (*p == 'u') {
+            for (int i = 1; i <= 4; i++) {
+                if (hex_value(p[i]) < 0) return NULL;
+            }
+            p += 4;
+        } else if (!*p || !strchr("\"\\/bfnrt", *p)) {
+            return NULL;
+        }
+    }
+    return p + 1;
+}
+
+/* Past the number at p, NULL if there is none */
+static const char* skip_number(const char* p) {
+    if (*p == '-') p++;
+    if (*p == '0') {
+        p++;
+    } else if (is_digit(*p)) {
+        while (is_digit(*p)) p++;
+    } else {
+        return NULL;
+    }
+    if (*p == '.') {
+        if (!is_digit(*++p)) return NULL;
+        while (is_digit(*p)) p++;
+    }
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        if (*p == '+' || *p == '-') p++;
+        if (!is_digit(*p)) return NULL;
+        while (is_digit(*p)) p++;
+    }
+    return p;
+}
+
+/* Past the value at p (leading whitespace skipped), NULL and e set if malformed */
+static const char* skip_value(const char* p, int depth, scan_err_t* e) {
+    p = skip_ws(p);
+    switch (*p) {
+    case '"': {
+        const char* end = skip_string(p);
+        return end ? end : scan_fail(e, p, "bad string");
+    }
+    case '{':
+    case '[': {
+        char close = (*p == '{') ? '}' : ']';
+        if (depth >= JSON_MAX_DEPTH) return scan_fail(e, p, "nested too deep");
+        p = skip_ws(p + 1);
+        if (*p == close) return p + 1;
+        for (;;) {
+            if (close == '}') {
+                if (*p != '"') return scan_fail(e, p, "expected a key");
+                const char* end = skip_string(p);
+                if (!end) return scan_fail(e, p, "bad string");
+                p = skip_ws(end);
+                if (*p != ':') return scan_fail(e, p, "expected ':'");
+                p++;
+            }
+            p = skip_value(p, depth + 1, e);
+            if (!p) return NULL;
+            p = skip_ws(p);
+            if (*p == close) return p + 1;
+            if (*p != ',') {
+                return scan_fail(e, p, close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+            }
+            p = skip_ws(p + 1);
+        }
+    }
+    case 't':
+        return strncmp(p, "true", 4) == 0 ? p + 4 : scan_fail(e, p, "unexpected character");
+    case 'f':
+        return strncmp(p, "false", 5) == 0 ? p + 5 : scan_fail(e, p, "unexpected character");
+    case 'n':
+        return strncmp(p, "null", 4) == 0 ? p + 4 : scan_fail(e, p, "unexpected character");
+    case '\0':
+        return scan_fail(e, p, "unexpected end");
+    default: {
+        const char* end = skip_number(p);
+        return end ? end : scan_fail(e, p, *p == '-' || is_digit(*p) ? "bad number" : "unexpected character");
+    }
+    }
+}
+
+/* Past the value at p without checking it, for lookups in text that was
+ * validated; NULL at the end of the text */
+static const char* skip_over(const char* p) {
+    int depth = 0;
+
+    for (;; p++) {
+        switch (*p) {
+        case '\0':
+            return NULL;
+        case '"':
+            for (p++; *p != '"'; p++) {
+                if (!*p || (*p == '\\' && !*++p)) return NULL;
+            }
+            if (depth == 0) return p + 1;
+            break;
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) return p;       /* After a scalar */
+            if (--depth == 0) return p + 1;
+            break;
+        case ',':
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            if (depth == 0) return p;
+            break;
+        }
+    }
+}
+
+/* JSON_* of the value at p, 0 if it is malformed */
+static unsigned value_type(const char* p) {
+    switch (*p) {
+    case '"': return skip_string(p) ? JSON_STRING : 0;
+    case '{': return JSON_OBJECT;
+    case '[': return JSON_ARRAY;
+    case 't':
+    case 'f': return JSON_BOOL;
+    case 'n': return JSON_NULL;
+    default: {
+        const char* end = skip_number(p);
+        if (!end) return 0;
+        for (const char* q = p; q < end; q++) {
+            if (*q == '.' || *q == 'e' || *q == 'E') return JSON_NUMBER;
+        }
+        return JSON_NUMBER | JSON_INT;
+    }
+    }
+}
+
+/* Unescape the string at p (a '"') into out, truncated to len */
+static void copy_string(const char* p, char* out, size_t len) {
+    size_t n = 0;
+    char utf8[4];
+
+    for (p++; *p && *p != '"'; p++) {
+        int k = 1;
+        utf8[0] = *p;
+        if (*p == '\\') {
+            p++;
+            switch (*p) {
+            case 'b': utf8[0] = '\b'; break;
+            case 'f': utf8[0] = '\f'; break;
+            case 'n': utf8[0] = '\n'; break;
+            case 'r': utf8[0] = '\r'; break;
+            case 't': utf8[0] = '\t'; break;
+            case 'u': {
+                uint32_t c = 0;
+                for (int i = 1; i <= 4; i++) c = (c << 4) | (uint32_t)hex_value(p[i]);
+                p += 4;
+                /* Surrogate pair */
+                if (c >= 0xD800 && c < 0xDC00 && p[1] == '\\' && p[2] == 'u') {
+                    uint32_t lo = 0;
+                    for (int i = 3; i <= 6; i++) lo = (lo << 4) | (uint32_t)hex_value(p[i]);
+                    if (lo >= 0xDC00 && lo < 0xE000) {
+                        c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                if (c >= 0xD800 && c < 0xE000) c = '?';     /* Unpaired surrogate */
+                if (c < 0x80) {
+                    utf8[0] = (char)c;
+                } else if (c < 0x800) {
+                    utf8[0] = (char)(0xC0 | (c >> 6));
+                    utf8[1] = (char)(0x80 | (c & 0x3F));
+                    k = 2;
+                } else if (c < 0x10000) {
+                    utf8[0] = (char)(0xE0 | (c >> 12));
+                    utf8[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+                    utf8[2] = (char)(0x80 | (c & 0x3F));
+                    k = 3;
+                } else {
+                    utf8[0] = (char)(0xF0 | (c >> 18));
+                    utf8[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+                    utf8[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+                    utf8[3] = (char)(0x80 | (c & 0x3F));
+                    k = 4;
+                }
+                break;
+            }
+            default: utf8[0] = *p; break;     /* " \ / */
+            }
+        }
+        if (n + k >= len) break;    /* Whole characters only */
+        memcpy(out + n, utf8, k);
+        n += k;
+    }
+    out[n] = '\0';
+}
+
+/*=============================================================================
+ * Lookup
+ *===========================================================================*/
+
+const char* json_find(const char* json, const char* key) {
+    if (!json) return NULL;
+    const char* p = skip_ws(json);
+    if (*p != '{') return NULL;
+
+    size_t klen = strlen(key);
+    p = skip_ws(p + 1);
+    while (*p == '"') {
+        const char* end = skip_string(p);
+        if (!end) return NULL;
+        bool match = (size_t)(end - p - 2) == klen && memcmp(p + 1, key, klen) == 0;
+        p = skip_ws(end);
+        if (*p != ':') return NULL;
+        p = skip_ws(p + 1);
+        if (match) return p;
+        p = skip_over(p);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ',') return NULL;
+        p = skip_ws(p + 1);
+    }
+    return NULL;
+}
+
+int json_get_string(const char* json, const char* key, char* out, size_t len) {
+    const char* v = json_find(json, key);
+    if (!v || *v != '"' || !skip_string(v)) return -1;
+    copy_string(v, out, len);
+    return 0;
+}
+
+static bool get_number(const char* json, const char* key, double* out) {
+    const char* v = json_find(json, key);
+    if (!v || !skip_number(v)) return false;
+    *out = strtod(v, NULL);
+    return true;
+}
+
+int json_get_int(const char* json, const char* key, int def) {
+    double v;
+    if (!get_number(json, key, &v) || v < INT_MIN || v > INT_MAX) return def;
+    return (int)v;
+}
+
+double json_get_double(const char* json, const char* key, double def) {
+    double v;
+    return get_number(json, key, &v) ? v : def;
+}
+
+bool json_get_bool(const char* json, const char* key, bool def) {
+    const char* v = json_find(json, key);
+    if (!v) return def;
+    if (strncmp(v, "true", 4) == 0) return true;
+    if (strncmp(v, "false", 5) == 0) return false;
+    return def;
+}
+
+/* idx-th element of array "key" that starts with first ('"' or '{'), NULL if none */
+static const char* array_nth(const char* json, const char* key, char first, int idx) {
+    const char* p = json_find(json, key);
+    if (!p || *p != '[') return NULL;
+
+    p = skip_ws(p + 1);
+    while (*p && *p != ']') {
+        if (*p == first && idx-- == 0) return p;
+        p = skip_over(p);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ',') return NULL;
+        p = skip_ws(p + 1);
+    }
+    return NULL;
+}
+
+int json_get_string_at(const char* json, const char* key, int idx, char* out, size_t len) {
+    const char* v = array_nth(json, key, '"', idx);
+    if (!v || !skip_string(v)) return -1;
+    copy_string(v, out, len);
+    return 0;
+}
+
+int json_get_object_at(const char* json, const char* key, int idx, char* out, size_t len) {
+    const char* v = array_nth(json, key, '{', idx);
+    const char* end = v ? skip_over(v) : NULL;
+    if (!end) return -1;
+    size_t n = (size_t)(end - v);
+    if (n >= len) return -1;
+    memcpy(out, v, n);
+    out[n] = '\0';
+    return 0;
+}
+
+int json_array_len(const char* json, const char* key) {
+    const char* p = json_find(json, key);
+    if (!p || *p != '[') return -1;
+
+    int n = 0;
+    p = skip_ws(p + 1);
+    while (*p && *p != ']') {
+        n++;
+        p = skip_over(p);
+        if (!p) return -1;
+        p = skip_ws(p);
+        if (*p != ',') break;
+        p = skip_ws(p + 1);
+    }
+    return n;
+}
+
+/* idx-th member name of object "key", its value in *val; NULL if none */
+static const char* member_nth(const char* json, const char* key, int idx, const char** val) {
+    const char* p = json_find(json, key);
+    if (!p || *p != '{') return NULL;
+
+    p = skip_ws(p + 1);
+    while (*p == '"') {
+        const char* name = p;
+        p = skip_string(p);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ':') return NULL;
+        p = skip_ws(p + 1);
+        if (idx-- == 0) {
+            *val = p;
+            return name;
+        }
+        p = skip_over(p);
+        if (!p) return NULL;
+        p = skip_ws(p);
+        if (*p != ',') return NULL;
+        p = skip_ws(p + 1);
+    }
+    return NULL;
+}
+
+int json_get_member_at(const char* json, const char* key, int idx,
+                       char* name, size_t nlen, char* out, size_t len) {
+    const char* v = NULL;
+    const char* k = member_nth(json, key, idx, &v);
+    if (!k || *v != '{' || (size_t)(skip_string(k) - k - 2) >= nlen) return -1;
+    const char* end = skip_over(v);
+    if (!end) return -1;
+    size_t n = (size_t)(end - v);
+    if (n >= len) return -1;
+    copy_string(k, name, nlen);
+    memcpy(out, v, n);
+    out[n] = '\0';
+    return 0;
+}
+
+int json_object_len(const char* json, const char* key) {
+    const char* p = json_find(json, key);
+    if (!p || *p != '{') return -1;
+
+    int n = 0;
+    p = skip_ws(p + 1);
+    while (*p == '"') {
+        n++;
+        p = skip_string(p);
+        if (!p) return -1;
+        p = skip_ws(p);
+        if (*p != ':') return -1;
+        p = skip_over(skip_ws(p + 1));
+        if (!p) return -1;
+        p = skip_ws(p);
+        if (*p != ',') break;
+        p = skip_ws(p + 1);
+    }
+    return n;
+}
+
+size_t json_value_len(const char* json) {
+    const char* end = skip_value(json, 0, NULL);
+    return end ? (size_t)(end - json) : 0;
+}
+
+/*=============================================================================
+ * Validation
+ *===========================================================================*/
+
+int json_validate(const char* json, char* err, size_t len) {
+    scan_err_t e = { NULL, NULL };
+    const char* p = skip_value(json, 0, &e);
+    if (p) {
+        p = skip_ws(p);
+        if (!*p) return 0;
+        scan_fail(&e, p, "text after the value");
+    }
+
+    int line = 1, col = 1;
+    for (const char* q = json; q < e.at; q++) {
+        if (*q == '\n') {
+            line++;
+            col = 1;
+        } else {
+            col++;
+        }
+    }
+    snprintf(err, len, "line %d col %d: %s", line, col, e.what);
+    return -1;
+}
+
+/* "a string or null" from a JSON_* mask */
+static void type_names(unsigned types, char* out, size_t len) {
+    static const struct {
+        unsigned    type;
+        const char* name;
+    } NAMES[] = {
+        { JSON_STRING, "a string" }, { JSON_NUMBER, "a number" }, { JSON_INT, "an integer" },
+        { JSON_BOOL, "true or false" }, { JSON_ARRAY, "an array" }, { JSON_OBJECT, "an object" },
+        { JSON_NULL, "null" },
+    };
+    size_t n = 0;
+
+    out[0] = '\0';
+    if (types & JSON_NUMBER) types &= ~JSON_INT;
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]) && n < len; i++) {
+        if (!(types & NAMES[i].type)) continue;
+        n += snprintf(out + n, len - n, "%s%s", n ? " or " : "", NAMES[i].name);
+    }
+}
+
+/* v against one schema member */
+static int check_value(const json_field_t* f, const char* v, char* err, size_t len) {
+    unsigned type = value_type(v);
+    if (!(type & f->types)) {
+        char names[64];
+        type_names(f->types, names, sizeof(names));
+        snprintf(err, len, "%s: expected %s", f->key, names);
+        return -1;
+    }
+    if (f->min >= f->max) return 0;
+
+    if (type & JSON_NUMBER) {
+        double d = strtod(v, NULL);
+        if (d < f->min || d > f->max) {
+            snprintf(err, len, "%s: %g is outside %g..%g", f->key, d, f->min, f->max);
+            return -1;
+        }
+    } else if (type == JSON_STRING) {
+        size_t slen = (size_t)(skip_string(v) - v) - 2;
+        if (slen < f->min || slen > f->max) {
+            snprintf(err, len, "%s: length %zu is outside %g..%g", f->key, slen, f->min, f->max);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* One pass over the members, each looked up in the schema */
+int json_check(const char* json, const json_field_t* schema, int n, char* err, size_t len) {
+    const char* p = json ? skip_ws(json) : "";
+    if (*p != '{') {
+        snprintf(err, len, "expected an object");
+        return -1;
+    }
+
+    p = skip_ws(p + 1);
+    while (*p == '"') {
+        const char* end = skip_string(p);
+        if (!end) return 0;
+        size_t klen = (size_t)(end - p - 2);
+        const json_field_t* f = NULL;
+        for (int i = 0; i < n && !f; i++) {
+            if (strncmp(schema[i].key, p + 1, klen) == 0 && schema[i].key[klen] == '\0') f = &schema[i];
+        }
+        p = skip_ws(end);
+        if (*p != ':') return 0;
+        const char* v = skip_ws(p + 1);
+        if (f && check_value(f, v, err, len) != 0) return -1;
+        p = skip_over(v);
+        if (!p) return 0;
+        p = skip_ws(p);
+        if (*p != ',') return 0;
+        p = skip_ws(p + 1);
+    }
+    return 0;
+}
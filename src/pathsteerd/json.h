@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * json.h - PathSteer Guardian Minimal JSON Reader
+ *
+ * PURPOSE:
+ *   Field lookup in config.json, policy overlays, status snippets and our
+ *   own JSONL log lines without a dependency. No tree is built: a lookup
+ *   scans the text once, skipping over the values it passes.
+ *
+ * LOOKUP:
+ *   A key is looked up among the members of the object the text starts
+ *   with, never inside nested values, so "id" does not find "node": {"id"}
+ *   and a nested "host" does not answer a top-level one. json_find()
+ *   returns the value itself, so lookups chain into nested objects:
+ *   json_get_string(json_find(cfg, "node"), "id", ...). A NULL text is an
+ *   object without members. A value of the wrong type reads as missing.
+ *
+ * VALIDATION:
+ *   json_validate() checks a whole document against RFC 8259 (depth
+ *   limited to JSON_MAX_DEPTH) and says where it is wrong; json_check()
+ *   holds an object's members to a schema of types and ranges. Lookups
+ *   assume a document that passed json_validate() and fail soft otherwise.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_JSON_H
+#define PATHSTEER_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_MAX_DEPTH          32
+
+/* Value types, as a mask in json_field_t */
+#define JSON_NULL               0x01
+#define JSON_BOOL               0x02
+#define JSON_INT                0x04        /* A number without fraction or exponent */
+#define JSON_NUMBER             0x08        /* Any number, JSON_INT included */
+#define JSON_STRING             0x10
+#define JSON_ARRAY              0x20
+#define JSON_OBJECT             0x40
+
+/* Value of key in the object json starts with, NULL if none */
+const char* json_find(const char* json, const char* key);
+
+/* 0 and the string (unescaped, truncated to len) in out, -1 if key is missing */
+int    json_get_string(const char* json, const char* key, char* out, size_t len);
+
+/* Value of key, def if missing */
+int    json_get_int(const char* json, const char* key, int def);
+double json_get_double(const char* json, const char* key, double def);
+bool   json_get_bool(const char* json, const char* key, bool def);
+
+/* idx-th string of the array "key": ["a", "b", ...]; 0 and the string in out, -1 if none */
+int    json_get_string_at(const char* json, const char* key, int idx, char* out, size_t len);
+
+/* idx-th object of the array "key": [{...}, {...}], copied whole into out to
+ * narrow lookups to it; 0, or -1 if none or it does not fit */
+int    json_get_object_at(const char* json, const char* key, int idx, char* out, size_t len);
+
+/* Elements of the array "key", -1 if it is missing or not an array */
+int    json_array_len(const char* json, const char* key);
+
+/* idx-th member of the object "key": {"a": {...}, "b": {...}}, its name in
+ * name and its value, an object, copied whole into out; 0, or -1 if none,
+ * the value is not an object or either does not fit */
+int    json_get_member_at(const char* json, const char* key, int idx,
+                          char* name, size_t nlen, char* out, size_t len);
+
+/* Members of the object "key", -1 if it is missing or not an object */
+int    json_object_len(const char* json, const char* key);
+
+/* Length of the value json starts with (leading whitespace included), 0 if malformed */
+size_t json_value_len(const char* json);
+
+/* 0 if json is one well-formed value, else -1 and "line L col C: reason" in err */
+int    json_validate(const char* json, char* err, size_t len);
+
+/*
+ * One member of a schema: its accepted types and, when min < max, the
+ * range of a number or the length of a string. Members not in the schema
+ * are not checked, schema members may be missing.
+ */
+typedef struct {
+    const char* key;
+    unsigned    types;          /* JSON_* mask */
+    double      min, max;
+} json_field_t;
+
+/* 0 if the object json starts with matches schema, else -1 and "key: reason" in err */
+int    json_check(const char* json, const json_field_t* schema, int n, char* err, size_t len);
+
+#endif /* PATHSTEER_JSON_H */
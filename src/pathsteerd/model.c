@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * model.c - PathSteer Guardian Learned Risk Model
+ *
+ * See model.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "model.h"
+
+const char* MODEL_FEATURE_NAMES[MODEL_FEATURES] = {
+    "bias", "rtt_ratio", "jitter", "loss", "consec_fail",
+    "rsrp", "rsrp_trend", "sinr", "sinr_trend", "sl_obstr",
+    "speed", "loc_risk"
+};
+
+/* GCC vector extension: one register's worth of lanes */
+typedef float v8f __attribute__((vector_size(MODEL_LANES * sizeof(float))));
+
+/* Keep weights sane whatever the online learner sees */
+#define WEIGHT_CLAMP    20.0f
+
+/*=============================================================================
+ * Defaults
+ *
+ * Hand-set weights that reproduce the old threshold ladder closely enough
+ * (clean link ~0.05, 50% loss ~0.5, sustained probe loss ~0.75) until a
+ * trained model file is installed.
+ *===========================================================================*/
+
+void model_defaults(model_t* m) {
+    memset(m, 0, sizeof(*m));
+    m->w[F_BIAS]        = -3.0f;
+    m->w[F_RTT_RATIO]   =  2.0f;
+    m->w[F_JITTER]      =  1.0f;
+    m->w[F_LOSS]        =  6.0f;
+    m->w[F_CONSEC_FAIL] =  4.0f;
+    m->w[F_RSRP]        =  2.5f;
+    m->w[F_RSRP_TREND]  =  1.0f;
+    m->w[F_SINR]        =  1.5f;
+    m->w[F_SINR_TREND]  =  0.5f;
+    m->w[F_SL_OBSTR]    =  3.0f;
+    m->w[F_SPEED]       =  0.3f;
+    m->w[F_LOC_RISK]    =  3.0f;
+    m->lr = 0.005f;
+    m->l2 = 0.0001f;
+    snprintf(m->source, sizeof(m->source), "defaults");
+}
+
+/*=============================================================================
+ * File I/O
+ *===========================================================================*/
+
+int model_load(model_t* m, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    model_t tmp;
+    model_defaults(&tmp);
+    memset(tmp.w, 0, sizeof(tmp.w));
+
+    int order[64];
+    int n_names = 0, n_weights = 0;
+    char line[1024];
+
+    while (fgets(line, sizeof(line), f)) {
+        char* save = NULL;
+        char* key = strtok_r(line, " \t\r\n", &save);
+        if (!key || key[0] == '#') continue;
+
+        if (strcmp(key, "features") == 0) {
+            char* tok;
+            while ((tok = strtok_r(NULL, " \t\r\n", &save)) && n_names < 64) {
+                order[n_names] = -1;
+                for (int i = 0; i < MODEL_FEATURES; i++) {
+                    if (strcmp(tok, MODEL_FEATURE_NAMES[i]) == 0) order[n_names] = i;
+                }
+                n_names++;
+            }
+        } else if (strcmp(key, "weights") == 0) {
+            char* tok;
+            while ((tok = strtok_r(NULL, " \t\r\n", &save)) && n_weights < n_names) {
+                if (order[n_weights] >= 0) tmp.w[order[n_weights]] = strtof(tok, NULL);
+                n_weights++;
+            }
+        } else if (strcmp(key, "lr") == 0) {
+            char* tok = strtok_r(NULL, " \t\r\n", &save);
+            if (tok) tmp.lr = strtof(tok, NULL);
+        } else if (strcmp(key, "l2") == 0) {
+            char* tok = strtok_r(NULL, " \t\r\n", &save);
+            if (tok) tmp.l2 = strtof(tok, NULL);
+        }
+    }
+    fclose(f);
+
+    /* Weights line must match the features line */
+    if (n_names == 0 || n_weights != n_names) return -1;
+
+    const char* base = strrchr(path, '/');
+    snprintf(tmp.source, sizeof(tmp.source), "%s", base ? base + 1 : path);
+    *m = tmp;
+    return 0;
+}
+
+int model_save(const model_t* m, const char* path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "w");
+    if (!f) return -1;
+
+    fprintf(f, "# pathsteer risk model (from %s, %llu online updates)\n",
+            m->source, (unsigned long long)m->updates);
+    fprintf(f, "features");
+    for (int i = 0; i < MODEL_FEATURES; i++) fprintf(f, " %s", MODEL_FEATURE_NAMES[i]);
+    fprintf(f, "\nweights");
+    for (int i = 0; i < MODEL_FEATURES; i++) fprintf(f, " %.6g", m->w[i]);
+    fprintf(f, "\nlr %.6g\nl2 %.6g\n", m->lr, m->l2);
+
+    if (fclose(f) != 0) return -1;
+    return rename(tmp, path);
+}
+
+/*=============================================================================
+ * Inference
+ *===========================================================================*/
+
+void model_predict(const model_t* m, const model_batch_t* b, int n, float* out) {
+    v8f z = {0};
+    for (int f = 0; f < MODEL_FEATURES; f++) {
+        v8f x;
+        memcpy(&x, b->x[f], sizeof(x));
+        z += x * m->w[f];
+    }
+
+    float zs[MODEL_LANES];
+    memcpy(zs, &z, sizeof(zs));
+    for (int i = 0; i < n && i < MODEL_LANES; i++) {
+        out[i] = 1.0f / (1.0f + expf(-zs[i]));
+    }
+}
+
+/*=============================================================================
+ * Online SGD
+ *===========================================================================*/
+
+void model_sgd(model_t* m, const float* x, float y) {
+    if (m->lr <= 0) return;
+
+    float z = 0;
+    for (int f = 0; f < MODEL_FEATURES; f++) z += m->w[f] * x[f];
+    float p = 1.0f / (1.0f + expf(-z));
+    float g = p - y;
+
+    for (int f = 0; f < MODEL_FEATURES; f++) {
+        float decay = (f == F_BIAS) ? 0 : m->l2 * m->w[f];
+        float w = m->w[f] - m->lr * (g * x[f] + decay);
+        if (w > WEIGHT_CLAMP) w = WEIGHT_CLAMP;
+        if (w < -WEIGHT_CLAMP) w = -WEIGHT_CLAMP;
+        m->w[f] = w;
+    }
+    m->updates++;
+}
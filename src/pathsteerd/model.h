@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * model.h - PathSteer Guardian Learned Risk Model
+ *
+ * PURPOSE:
+ *   risk_now = P(tripwire fires on this uplink within the label horizon)
+ *   from a per-uplink feature vector. Logistic regression: one weight per
+ *   feature, flat float array.
+ *
+ * INFERENCE:
+ *   Features are laid out feature-major (x[f][lane], one lane per uplink)
+ *   so the dot product runs across all uplinks at once in SIMD registers.
+ *
+ * TRAINING:
+ *   Offline: scripts/train-risk-model.py fits weights from the
+ *            model_samples table and writes a model file.
+ *   Online:  model_sgd() nudges the live weights with each labelled sample.
+ *
+ * MODEL FILE (text, one item per line, '#' comments):
+ *   features bias rtt_ratio jitter ...      names, in weight order
+ *   weights  -3.0 2.0 0.8 ...
+ *   lr       0.005
+ *   l2       0.0001
+ *   Unknown feature names are ignored, missing ones get weight 0, so old
+ *   files keep loading when features are added.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_MODEL_H
+#define PATHSTEER_MODEL_H
+
+#include <stdint.h>
+
+/* SIMD width: uplinks evaluated per vector */
+#define MODEL_LANES             8
+
+typedef enum {
+    F_BIAS = 0,
+    F_RTT_RATIO,        /* rtt / baseline - 1, clamped 0..5 */
+    F_JITTER,           /* Mean abs RTT delta / 50 ms */
+    F_LOSS,             /* loss_pct / 100 */
+    F_CONSEC_FAIL,      /* consec_fail / 5, clamped */
+    F_RSRP,             /* LTE: 0 at -90 dBm, 1 at -120 dBm */
+    F_RSRP_TREND,       /* LTE: falling dB/s / 2 */
+    F_SINR,             /* LTE: 0 at 10 dB, 1 at -10 dB */
+    F_SINR_TREND,       /* LTE: falling dB/s / 2 */
+    F_SL_OBSTR,         /* Starlink: obstructed or recent obstruction % */
+    F_SPEED,            /* Vehicle speed / 30 m/s */
+    F_LOC_RISK,         /* risk_ahead * confidence */
+    MODEL_FEATURES
+} model_feature_t;
+
+extern const char* MODEL_FEATURE_NAMES[MODEL_FEATURES];
+
+typedef struct {
+    float       w[MODEL_FEATURES];
+    float       lr;             /* SGD learning rate, 0 = frozen */
+    float       l2;             /* SGD weight decay */
+    uint64_t    updates;        /* Online SGD steps applied */
+    char        source[64];     /* "defaults", file name, ... */
+} model_t;
+
+/* One feature vector per lane, feature-major */
+typedef struct {
+    float       x[MODEL_FEATURES][MODEL_LANES];
+} model_batch_t;
+
+void model_defaults(model_t* m);
+int  model_load(model_t* m, const char* path);
+int  model_save(const model_t* m, const char* path);
+
+/* Probability for the first n lanes (n <= MODEL_LANES) */
+void model_predict(const model_t* m, const model_batch_t* b, int n, float* out);
+
+/* Single-example SGD step on log-loss. x has MODEL_FEATURES entries. */
+void model_sgd(model_t* m, const float* x, float y);
+
+#endif /* PATHSTEER_MODEL_H */
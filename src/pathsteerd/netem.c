@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * netem.c - PathSteer Guardian netem Control over rtnetlink
+ *
+ * See netem.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+
+#include "netem.h"
+#include "netns.h"
+
+/* Kernel scheduler ticks are 64 ns (PSCHED_SHIFT) */
+#define NETEM_PSCHED_SHIFT      6
+
+#define NLMSG_TAIL(n) ((struct rtattr*)((char*)(n) + NLMSG_ALIGN((n)->nlmsg_len)))
+
+typedef struct {
+    struct nlmsghdr n;
+    struct tcmsg    t;
+    char            buf[256];
+} netem_req_t;
+
+static int netem_addattr(struct nlmsghdr* n, size_t max, int type, const void* data, size_t len) {
+    size_t rta_len = RTA_LENGTH(len);
+    if (NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(rta_len) > max) return -1;
+    struct rtattr* rta = NLMSG_TAIL(n);
+    rta->rta_type = type;
+    rta->rta_len = rta_len;
+    if (len) memcpy(RTA_DATA(rta), data, len);
+    n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(rta_len);
+    return 0;
+}
+
+/*=============================================================================
+ * Link setup
+ *===========================================================================*/
+
+int netem_open(netem_link_t* l, const char* ns, const char* dev) {
+    memset(l, 0, sizeof(*l));
+    l->fd = -1;
+    snprintf(l->ns, sizeof(l->ns), "%s", ns ? ns : "");
+    snprintf(l->dev, sizeof(l->dev), "%s", dev);
+
+    int self;
+    if (netns_enter(l->ns, &self) < 0) return -1;
+
+    /* Socket and ifindex belong to the namespace we are in now */
+    l->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    int err = errno;
+    if (l->fd >= 0) {
+        l->ifindex = if_nametoindex(dev);
+        err = errno;
+    }
+
+    netns_leave(self);
+    if (l->fd < 0 || l->ifindex == 0) {
+        netem_close(l);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void netem_close(netem_link_t* l) {
+    if (l->fd >= 0) close(l->fd);
+    l->fd = -1;
+}
+
+/*=============================================================================
+ * Qdisc change
+ *===========================================================================*/
+
+int netem_set(netem_link_t* l, const netem_params_t* p) {
+    netem_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_type = RTM_NEWQDISC;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE | NLM_F_ACK;
+    req.n.nlmsg_seq = ++l->seq;
+    req.t.tcm_family = AF_UNSPEC;
+    req.t.tcm_ifindex = l->ifindex;
+    req.t.tcm_parent = TC_H_ROOT;
+
+    netem_addattr(&req.n, sizeof(req), TCA_KIND, "netem", sizeof("netem"));
+
+    /* TCA_OPTIONS: tc_netem_qopt, then nested 64-bit delays (ns) */
+    double loss = p->loss_pct < 0 ? 0 : p->loss_pct > 100 ? 100 : p->loss_pct;
+    int64_t latency = p->delay_us * 1000;
+    int64_t jitter = p->jitter_us * 1000;
+    struct tc_netem_qopt opt = {
+        .latency = (uint32_t)((latency >> NETEM_PSCHED_SHIFT) & 0xffffffff),
+        .limit = NETEM_LIMIT,
+        .loss = (uint32_t)(loss / 100.0 * UINT32_MAX),
+        .jitter = (uint32_t)((jitter >> NETEM_PSCHED_SHIFT) & 0xffffffff),
+    };
+    struct rtattr* options = NLMSG_TAIL(&req.n);
+    if (netem_addattr(&req.n, sizeof(req), TCA_OPTIONS, &opt, sizeof(opt)) != 0 ||
+        netem_addattr(&req.n, sizeof(req), TCA_NETEM_LATENCY64, &latency, sizeof(latency)) != 0 ||
+        netem_addattr(&req.n, sizeof(req), TCA_NETEM_JITTER64, &jitter, sizeof(jitter)) != 0) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    options->rta_len = (char*)NLMSG_TAIL(&req.n) - (char*)options;
+
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    if (sendto(l->fd, &req, req.n.nlmsg_len, 0, (struct sockaddr*)&kernel, sizeof(kernel)) < 0) {
+        return -1;
+    }
+
+    /* Wait for our ACK (NLMSG_ERROR with error 0) */
+    char buf[1024];
+    for (;;) {
+        int n = (int)recv(l->fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        for (struct nlmsghdr* h = (struct nlmsghdr*)buf; NLMSG_OK(h, n); h = NLMSG_NEXT(h, n)) {
+            if (h->nlmsg_seq != l->seq || h->nlmsg_type != NLMSG_ERROR) continue;
+            const struct nlmsgerr* e = NLMSG_DATA(h);
+            if (e->error == 0) return 0;
+            errno = -e->error;
+            return -1;
+        }
+    }
+}
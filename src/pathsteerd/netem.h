@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * netem.h - PathSteer Guardian netem Control over rtnetlink
+ *
+ * PURPOSE:
+ *   Set delay, jitter and loss on a device's root netem qdisc directly over
+ *   rtnetlink - what "tc qdisc replace dev X root netem ..." does, without
+ *   a fork/exec per change. pathsteer-emu changes up to a dozen qdiscs every
+ *   10 ms; shelling out to tc cannot keep up with that.
+ *
+ * NAMESPACES:
+ *   The netlink socket is opened inside the device's network namespace
+ *   (/run/netns/<ns>) and stays bound to it, so one process can drive links
+ *   in several namespaces without switching back and forth.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_NETEM_H
+#define PATHSTEER_NETEM_H
+
+#include <stdint.h>
+
+/* netem FIFO limit, packets (tc's default) */
+#define NETEM_LIMIT             1000
+
+typedef struct {
+    int64_t     delay_us;
+    int64_t     jitter_us;
+    double      loss_pct;       /* 0..100 */
+} netem_params_t;
+
+typedef struct {
+    int         fd;             /* NETLINK_ROUTE socket in the device's netns */
+    int         ifindex;
+    uint32_t    seq;
+    char        ns[32];         /* "" = current namespace */
+    char        dev[16];
+} netem_link_t;
+
+/* Resolve dev in netns ns ("" or NULL = ours). Returns 0, -1 with errno. */
+int  netem_open(netem_link_t* l, const char* ns, const char* dev);
+void netem_close(netem_link_t* l);
+
+/* Replace the root qdisc with netem p. Returns 0, -1 with errno from the kernel. */
+int  netem_set(netem_link_t* l, const netem_params_t* p);
+
+#endif /* PATHSTEER_NETEM_H */
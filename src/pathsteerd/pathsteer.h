@@ -0,0 +1,423 @@
+/*******************************************************************************
+ * pathsteer.h - PathSteer Guardian Shared Types
+ *
+ * PURPOSE:
+ *   Modes, states, uplink/status/config structures shared by the daemon,
+ *   the decision engine (engine.h) and the offline tools that drive it.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_H
+#define PATHSTEER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "handover.h"
+#include "skymap.h"
+
+/* Maximum number of uplinks we support (config.json uplinks[]) */
+#define MAX_UPLINKS         10
+#define MAX_CONTROLLERS     4       /* PoPs, see popsel.h */
+
+/* History buffer size for RTT/signal measurements */
+#define HISTORY_SIZE        100
+
+/*=============================================================================
+ * TYPE DEFINITIONS
+ *===========================================================================*/
+
+/*-----------------------------------------------------------------------------
+ * Operating Modes
+ * 
+ * TRAINING: Passive observation only. We collect data and build risk maps
+ *           but NEVER actuate (no tc mirred, no switching). The predictor
+ *           runs and produces "would do" decisions for logging.
+ *           UI shows: "TRAINING MODE - NO PREDICTIVE ACTUATION"
+ *
+ * TRIPWIRE: Default operating mode. Duplication is OFF to save bandwidth.
+ *           When tripwire fires (RTT spike, probe loss, etc), we:
+ *           1. Immediately enable duplication (milliseconds)
+ *           2. Start hold timer
+ *           3. Arbitrate and switch once
+ *           4. Exit after clean period
+ *
+ * MIRROR:   Maximum stability mode. Duplication is ALWAYS ON.
+ *           Switching still uses same logic, but we're always duplicating.
+ *           Use for demos or critical sessions.
+ *---------------------------------------------------------------------------*/
+typedef enum {
+    MODE_TRAINING = 0,
+    MODE_TRIPWIRE,
+    MODE_MIRROR
+} op_mode_t;
+
+extern const char* const MODE_NAMES[];
+
+/*-----------------------------------------------------------------------------
+ * System States
+ * 
+ * NORMAL:     No issues detected, operating normally
+ * PREPARE:    Prediction indicates upcoming degradation, pre-arming
+ * PROTECT:    Tripwire fired, duplication active, evaluating switch
+ * SWITCHING:  In preroll period before executing switch
+ * HOLDING:    Switch executed, holding in protection mode
+ *---------------------------------------------------------------------------*/
+typedef enum {
+    STATE_NORMAL = 0,
+    STATE_PREPARE,
+    STATE_PROTECT,
+    STATE_SWITCHING,
+    STATE_HOLDING
+} sys_state_t;
+
+#define STATE_COUNT     (STATE_HOLDING + 1)
+
+extern const char* const STATE_NAMES[];
+
+/*-----------------------------------------------------------------------------
+ * Uplink Types
+ * 
+ * Each uplink has different characteristics:
+ * - LTE: Has RF metrics (RSRP, SINR), carrier info, can predict via training
+ * - STARLINK: Has dish API (obstruction, latency), unpredictable sat hops
+ * - FIBER: Most stable, typically just RTT monitoring
+ *---------------------------------------------------------------------------*/
+typedef enum {
+    UPLINK_TYPE_LTE = 0,
+    UPLINK_TYPE_STARLINK,
+    UPLINK_TYPE_FIBER
+} uplink_type_t;
+
+extern const char* const UPLINK_TYPE_NAMES[];
+
+/*-----------------------------------------------------------------------------
+ * Uplink IDs
+ * An uplink_id_t is an index into the uplink table, which config.json's
+ * uplinks[] defines. The names below are the default table (no uplinks[])
+ * and the six lanes of the offline trace format (sim.h).
+ *---------------------------------------------------------------------------*/
+typedef enum {
+    UPLINK_CELL_A = 0,
+    UPLINK_CELL_B,
+    UPLINK_SL_A,
+    UPLINK_SL_B,
+    UPLINK_FIBER1,
+    UPLINK_FIBER2,
+    UPLINK_COUNT
+} uplink_id_t;
+
+extern const char* const UPLINK_NAMES[];
+
+/*-----------------------------------------------------------------------------
+ * Trigger Reasons
+ * What caused the tripwire to fire
+ *---------------------------------------------------------------------------*/
+typedef enum {
+    TRIGGER_NONE = 0,
+    TRIGGER_RTT_STEP,           /* RTT jumped significantly */
+    TRIGGER_PROBE_MISS,         /* Lost consecutive probes */
+    TRIGGER_LINK_DOWN,          /* Interface went down */
+    TRIGGER_RSRP_DROP,          /* LTE signal degraded */
+    TRIGGER_SINR_DROP,          /* LTE SNR degraded */
+    TRIGGER_STARLINK_OBSTR,     /* Starlink obstruction detected */
+    TRIGGER_PREDICTED,          /* Prediction engine warned us */
+    TRIGGER_MANUAL,             /* Operator forced via UI */
+    TRIGGER_COUNT
+} trigger_t;
+
+extern const char* const TRIGGER_NAMES[];
+
+/*-----------------------------------------------------------------------------
+ * Probe Result - Single RTT/loss measurement
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    double      rtt_ms;         /* Round-trip time in milliseconds */
+    bool        success;        /* Did probe succeed? */
+    int64_t     timestamp_us;   /* Microsecond timestamp */
+} probe_t;
+
+/*-----------------------------------------------------------------------------
+ * Cellular Info - LTE signal metrics from ModemManager
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    double      rsrp;           /* Reference Signal Received Power (dBm), -140 to -44 */
+    double      rsrq;           /* Reference Signal Received Quality (dB), -20 to -3 */
+    double      sinr;           /* Signal to Interference+Noise (dB), -20 to +30 */
+    double      rssi;           /* Received Signal Strength Indicator (dBm) */
+    char        carrier[32];    /* Carrier name: "T-Mobile", "AT&T", etc */
+    char        cell_id[24];    /* Cell tower ID */
+    char        tac[16];        /* Tracking Area Code */
+    char        band[16];       /* LTE band: "B66", "B14", etc */
+    bool        connected;      /* Is modem connected? */
+    double      rsrp_trend;     /* dB/s, smoothed */
+    double      sinr_trend;     /* dB/s, smoothed */
+    int64_t     timestamp_us;   /* When this was measured */
+    
+    /* Handover prediction */
+    ho_tracker_t ho;            /* Serving/neighbour cells and margin trend */
+    double      ho_eta;         /* Seconds to predicted handover, -1 if none */
+    double      ho_prob;        /* Learned handover likelihood here */
+    double      ho_gap_ms;      /* Learned gap here, -1 if unknown */
+    bool        ho_fired;       /* Already duplicated for this approach */
+    uint64_t    ho_tile_key;    /* Tile being crossed, for the likelihood */
+    bool        ho_tile_hit;    /* Handover seen while crossing it */
+    int64_t     info_poll_us;   /* Last cell info poll */
+    int64_t     signal_poll_us; /* Last signal poll */
+} cellular_t;
+
+/*-----------------------------------------------------------------------------
+ * Starlink Info - From dish HTTP API at 192.168.100.1
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    bool        connected;      /* Can we reach the dish? */
+    bool        online;         /* Is dish online and connected to satellites? */
+    char        state[32];      /* "CONNECTED", "SEARCHING", "BOOTING", etc */
+    double      latency_ms;     /* Pop ping latency from dish */
+    double      drop_rate;      /* Packet drop rate 0.0-1.0 */
+    double      downlink_mbps;  /* Current downlink throughput */
+    double      uplink_mbps;    /* Current uplink throughput */
+    bool        obstructed;     /* Currently obstructed? */
+    double      obstruction_pct;/* Percent time obstructed */
+    int         obstruction_eta;/* Seconds until next obstruction, -1 if unknown */
+    double      blockage;       /* Serving sky obstructed at current heading, 0..1 */
+    skymap_t    sky;            /* Vehicle-frame obstruction map */
+    int64_t     map_poll_us;    /* Last obstruction map fetch */
+    bool        thermal_throttle;/* Hardware thermal limiting */
+    bool        motors_stuck;   /* Hardware motor issue */
+    int64_t     timestamp_us;
+} starlink_t;
+
+/*-----------------------------------------------------------------------------
+ * Uplink - Complete state for one uplink path
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    /* Identity */
+    char            name[32];       /* "cell_a", "sl_b", etc */
+    char            interface[32];  /* "wwan0", "enp1s0", etc */
+    char            netns[32];      /* "ns_cell_a", "ns_sl_a", etc */
+    char            veth[32];       /* "veth_cell_a", etc */
+    char            wg[32];         /* Probe through this WG device, "" = from netns */
+    char            probe_target[64];
+    char            dish[64];       /* Starlink dish address */
+    int             modem;          /* LTE: cellular-monitor.sh device number */
+    uplink_id_t     id;
+    uplink_type_t   type;
+    bool            enabled;        /* Is this uplink configured? */
+    
+    /* Current state */
+    bool            available;      /* Is uplink currently usable? */
+    bool            force_failed;   /* Operator forced fail - sticky until cleared */
+    /* Chaos injection (demo mode) */
+    double          chaos_rtt;      /* Injected RTT */
+    double          chaos_jitter;   /* Injected jitter */
+    double          chaos_loss;     /* Injected loss % */
+    bool            is_active;      /* Is this the primary uplink? */
+    
+    /* Live metrics */
+    double          rtt_ms;         /* Current RTT */
+    double          rtt_baseline;   /* Baseline RTT (slow moving average) */
+    double          loss_pct;       /* Recent loss percentage */
+    double          jitter_ms;      /* RTT variance */
+    int             consec_fail;    /* Consecutive probe failures */
+    
+    /* Type-specific data */
+    cellular_t      cellular;       /* LTE metrics (if type == LTE) */
+    starlink_t      starlink;       /* Starlink metrics (if type == STARLINK) */
+    
+    /* History ring buffer */
+    probe_t         history[HISTORY_SIZE];
+    int             history_idx;
+    
+    /* Prediction scores */
+    double          risk_now;       /* Current risk 0.0-1.0 */
+    double          risk_ahead;     /* Predicted risk 0.0-1.0 */
+    double          confidence;     /* Prediction confidence 0.0-1.0 */
+    double          eta_prepare;    /* Seconds to first tile >= risk_prepare, -1 if clear */
+    double          eta_protect;    /* Seconds to first tile >= risk_protect, -1 if clear */
+    bool            predict_fired;  /* Already protected for this approach */
+} uplink_t;
+
+/*-----------------------------------------------------------------------------
+ * GPS Data - From gpsd
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    double      latitude;
+    double      longitude;
+    double      altitude_m;
+    double      speed_mps;      /* Meters per second */
+    double      heading;        /* Degrees from north */
+    bool        valid;
+    int64_t     timestamp_us;
+} gps_t;
+
+/*-----------------------------------------------------------------------------
+ * System Status - Overall state of the Guardian
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    /* Operating mode and state */
+    op_mode_t       mode;
+    sys_state_t     state;
+    
+    /* Trigger info */
+    trigger_t       last_trigger;
+    char            trigger_detail[128];
+    
+    /* Active paths */
+    uplink_id_t     active_uplink;
+    int             active_controller;  /* Index into config controllers */
+    
+    /* Duplication state */
+    bool            dup_enabled;
+    int64_t         dup_enabled_at_us;
+    
+    /* Timers */
+    int64_t         protect_start_us;
+    int64_t         switch_start_us;
+    int64_t         last_clean_us;
+    int             switches_this_window;
+    
+    /* Display values */
+    int             hold_remaining_sec;
+    int             clean_remaining_sec;
+    bool            flap_suppressed;
+    
+    /* Prediction */
+    double          global_risk;
+    char            recommendation[16];  /* "NORMAL", "PREPARE", "PROTECT" */
+    sys_state_t     predicted_state;     /* Predictor's view, logged as would-do in TRAINING */
+    int64_t         model_infer_ns;      /* Last inference time, all uplinks */
+    
+    /* Run tracking */
+    char            run_id[64];
+} status_t;
+
+/*-----------------------------------------------------------------------------
+ * Uplink Config - One entry of config.json uplinks[]
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    char            name[32];
+    uplink_type_t   type;
+    char            interface[32];
+    char            netns[32];      /* "" = ours */
+    char            veth[32];
+    char            wg[32];
+    char            probe_target[64];
+    char            dish[64];
+    char            carrier[32];
+    char            retpath_target[64]; /* Controller via this uplink's tunnel, "" = none */
+    int             modem;
+    bool            enabled;
+} uplink_conf_t;
+
+/*-----------------------------------------------------------------------------
+ * Configuration - Loaded from JSON
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    /* Paths */
+    char        config_path[256];
+    char        data_dir[256];
+    char        log_path[256];
+    char        training_db[256];
+    char        routes_file[256];
+    char        model_file[256];
+    
+    /* Node identity */
+    char        node_id[64];
+    char        node_role[16];
+    
+    /* Tripwire thresholds */
+    int         rtt_step_ms;
+    int         rtt_window_ms;
+    int         probe_miss_count;
+    int         probe_miss_window_ms;
+    double      rsrp_drop_db;
+    double      sinr_drop_db;
+    
+    /* Switching parameters */
+    int         preroll_ms;
+    int         min_hold_sec;
+    int         clean_exit_sec;
+    
+    /* Prediction */
+    int         predict_horizon_sec;
+    int         predict_lead_sec;
+    double      risk_prepare;
+    double      risk_protect;
+    double      predict_min_conf;
+    bool        model_online;       /* SGD on live data */
+    double      sl_sky_az;          /* Starlink forecast, see DEFAULT_SL_* */
+    double      sl_sky_spread;
+    double      sl_slot_offset;
+    double      sl_block_turn;
+    double      sl_block_slot;
+    double      ho_hyst_db;         /* Handover prediction, see DEFAULT_HO_* */
+    int         ho_lead_ms;
+    double      ho_prob;
+    
+    /* Feature flags */
+    bool        gps_enabled;
+    bool        pcap_enabled;
+    bool        opencellid_enabled;
+    bool        osm_enabled;
+    bool        trace_log;          /* Per-probe "trace" events for replay */
+    
+    /* Sample rate */
+    int         sample_rate_hz;
+    
+    /* C8000 control */
+    char        c8000_host[128];
+    char        c8000_user[32];
+    char        c8000_pass[64];
+    int         c8000_port;             /* NETCONF over SSH */
+    char        c8000_rpc_dir[128];     /* <controller>.xml: <edit-config> moving the C8000 there */
+    
+    /* Controller PoPs and automatic selection (popsel.h) */
+    int         controller_count;
+    char        controller_names[MAX_CONTROLLERS][32];
+    char        controller_hosts[MAX_CONTROLLERS][64];  /* "" = not probed */
+    bool        pop_auto;
+    int         pop_hold_ms;            /* Nearer PoP must stay nearer this long */
+    int         pop_holddown_ms;        /* Min time between switches for distance */
+    double      pop_hyst_ms;            /* ... and be nearer by this much */
+    double      pop_hyst_pct;           /* ... and this fraction of the current RTT */
+    
+    /* Remote targets (nullable) */
+    char        voice_server[64];
+    char        llm_server[64];
+    
+    /* Prometheus endpoint, "ADDR:PORT", "" = off */
+    char        metrics_listen[64];
+    
+    /* Flight recorder (with pcap_enabled) */
+    int         flightrec_pre_sec;
+    int         flightrec_post_sec;
+    int         flightrec_ring_mb;
+    int         flightrec_snaplen;
+    int         flightrec_keep_mb;
+    char        flightrec_dir[128];
+    
+    /* Conntrack flow monitor (flows.json) */
+    bool        flowmon_enabled;
+    char        flowmon_netns[32];
+    
+    /* RTP voice quality monitor (rtp.json) */
+    bool        rtpmon_enabled;
+    char        rtpmon_netns[32];
+    
+    /* Control loop watchdog */
+    bool        watchdog_enabled;
+    int         watchdog_blind_ms;      /* Blind this long: duplicate, 0 = never */
+    
+    /* In-band return path switching (../common/retpath.h) */
+    bool        retpath_enabled;
+    int         retpath_port;
+    char        retpath_key_file[128];
+    
+    /* Uplink table, in uplink_id_t order */
+    int         uplink_count;
+    uplink_conf_t uplinks[MAX_UPLINKS];
+} config_t;
+
+#endif /* PATHSTEER_H */
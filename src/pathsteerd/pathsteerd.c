@@ -39,11 +39,11 @@
  *===========================================================================*/
 
 #include <stdio.h>
-#include <syslog.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <signal.h>
@@ -52,7 +52,9 @@
 #include <fcntl.h>
 #include <pthread.h>
 #include <math.h>
+#include <stdatomic.h>
 
+#include <sys/inotify.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -61,6 +63,30 @@
 #include <sqlite3.h>
 #include <curl/curl.h>
 
+#include "c8000.h"
+#include "config.h"
+#include "corrmap.h"
+#include "engine.h"
+#include "flightrec.h"
+#include "flowmon.h"
+#include "handover.h"
+#include "hdr.h"
+#include "json.h"
+#include "metrics.h"
+#include "model.h"
+#include "pathsteer.h"
+#include "popsel.h"
+#include "retpath.h"
+#include "riskmap.h"
+#include "routes.h"
+#include "rtpmon.h"
+#include "shadow.h"
+#include "skymap.h"
+#include "status.h"
+#include "trajectory.h"
+#include "uplinkidx.h"
+#include "watchdog.h"
+
 /*=============================================================================
  * VERSION AND BUILD INFO
  *===========================================================================*/
@@ -75,333 +101,125 @@
  * The thresholds here are tuned for mobile/vehicle scenarios
  *===========================================================================*/
 
-/* Maximum number of uplinks we support */
-#define MAX_UPLINKS         6
-
-/* Maximum number of controllers (PoPs) */
-#define MAX_CONTROLLERS     2
-
-/* History buffer size for RTT/signal measurements */
-#define HISTORY_SIZE        100
-
 /* How often we probe each uplink (milliseconds) */
 #define PROBE_INTERVAL_MS   100
 
-/* Default tripwire thresholds
- * RTT_STEP: If RTT jumps by this much over baseline, trigger protection
- * PROBE_MISS: If we miss this many consecutive probes, trigger protection
- * RSRP_DROP: If LTE signal drops by this many dB, trigger protection
- * SINR_DROP: If LTE SNR drops by this many dB, trigger protection
+/* Trajectory look-ahead corridor sample spacing (half a risk tile).
+ * Horizon, lead and risk thresholds are in engine.h.
  */
-#define DEFAULT_RTT_STEP_MS         80
-#define DEFAULT_RTT_WINDOW_MS       200
-#define DEFAULT_PROBE_MISS_COUNT    2
-#define DEFAULT_PROBE_MISS_WINDOW   300
-#define DEFAULT_RSRP_DROP_DB        8
-#define DEFAULT_SINR_DROP_DB        6
-
-/* Switching parameters
- * PREROLL: Wait this long after triggering before switching (let duplication stabilize)
- * MIN_HOLD: Stay in protection mode for at least this long
- * CLEAN_EXIT: Need this many seconds of "clean" before exiting protection
+#define PREDICT_STEP_M              100.0
+
+/* Known-route profiles (built offline by pathsteer-routes)
+ * CONF_K: confidence = trips / (trips + K)
+ */
+#define ROUTE_CONF_K                2.0
+
+/* Starlink obstruction forecast (skymap.h, sky region defaults in config.h)
+ * MAP_INTERVAL: How often the dish obstruction map is fetched
+ * FORECAST_SEC: How far ahead the heading is projected
  */
-#define DEFAULT_PREROLL_MS          500
-#define DEFAULT_MIN_HOLD_SEC        8
-#define DEFAULT_CLEAN_EXIT_SEC      5
+#define STARLINK_MAP_INTERVAL_SEC   60
+#define SL_FORECAST_SEC             10
 
-/* Risk output interval (how often prediction engine runs) */
-#define RISK_INTERVAL_MS            250
+/* Cellular handover learning (handover.h, thresholds in engine.h)
+ * POLL: Cell info poll interval, moving / parked
+ * GAP_SCALE_MS: Gaps are stored in the risk index as gap / scale
+ */
+#define HO_POLL_MOVING_MS           1000
+#define HO_POLL_IDLE_MS             5000
+#define HO_GAP_SCALE_MS             2000.0
+
+/* Learned risk model (model.h)
+ * LABEL_MS: risk_now predicts "tripwire would fire within this window"
+ * PENDING: feature snapshots awaiting their label, per uplink
+ * RELOAD_SEC: how often the model file is checked for a new version
+ * NEG_KEEP: keep 1 in N negative examples for offline training (weight N)
+ */
+#define MODEL_LABEL_MS              2000
+#define MODEL_PENDING               16
+#define MODEL_RELOAD_SEC            5
+#define MODEL_NEG_KEEP              20
+#define MODEL_SAMPLE_BUF            4096
 
 /* Status file update interval */
 #define STATUS_INTERVAL_MS          100
 
+/* Risk index: how often learned tiles are written back to the training DB */
+#define RISK_FLUSH_INTERVAL_SEC     60
+
+/* Risk index: ignore GPS fixes older than this */
+#define GPS_STALE_MS                3000
+
+/* Shadow policies (shadow.h): how often their scores are logged */
+#define SHADOW_REPORT_SEC           60
+
+/* Main loop period; an iteration whose work takes longer is an overrun */
+#define LOOP_PERIOD_US              10000
+
+/* Prometheus endpoint (../common/metrics.h): re-render period */
+#define METRICS_RENDER_MS           1000
+
+/* Flight recorder (flightrec.h): the LAN side it records */
+#define FLIGHTREC_LAN_DEV           "br-lan"
+
+/* Flow monitor (flowmon.h): conntrack of the client namespace */
+#define FLOWMON_FILE                "/run/pathsteer/flows.json"
+
+/* RTP monitor (rtpmon.h): voice quality in the client namespace */
+#define RTPMON_FILE                 "/run/pathsteer/rtp.json"
+
+/* Return path (../common/retpath.h): dedupe on the controller is reached
+ * at .1 of each uplink's service tunnel (uplink retpath_target). Without
+ * an ack the SSH script still moves the route. */
+#define RETPATH_FALLBACK_SCRIPT     "/opt/pathsteer/scripts/controller-route-switch.sh"
+
+/* C8000 PoP switching (c8000.h, popsel.h): one NETCONF session kept open,
+ * the RPC per controller from <rpc_dir>/<name>.xml. Without a session or
+ * an RPC file the old per-switch SSH script still does it. */
+#define C8000_SCRIPT                "/opt/pathsteer/scripts/c8000-switch.sh"
+#define POP_RETRY_MS                10000       /* Same automatic switch again, at most */
+
 /*=============================================================================
  * TYPE DEFINITIONS
- *===========================================================================*/
-
-/*-----------------------------------------------------------------------------
- * Operating Modes
- * 
- * TRAINING: Passive observation only. We collect data and build risk maps
- *           but NEVER actuate (no tc mirred, no switching). The predictor
- *           runs and produces "would do" decisions for logging.
- *           UI shows: "TRAINING MODE - NO PREDICTIVE ACTUATION"
  *
- * TRIPWIRE: Default operating mode. Duplication is OFF to save bandwidth.
- *           When tripwire fires (RTT spike, probe loss, etc), we:
- *           1. Immediately enable duplication (milliseconds)
- *           2. Start hold timer
- *           3. Arbitrate and switch once
- *           4. Exit after clean period
- *
- * MIRROR:   Maximum stability mode. Duplication is ALWAYS ON.
- *           Switching still uses same logic, but we're always duplicating.
- *           Use for demos or critical sessions.
- *---------------------------------------------------------------------------*/
-typedef enum {
-    MODE_TRAINING = 0,
-    MODE_TRIPWIRE,
-    MODE_MIRROR
-} op_mode_t;
-
-static const char* MODE_NAMES[] = {"TRAINING", "TRIPWIRE", "MIRROR"};
+ * Shared types are in pathsteer.h.
+ *===========================================================================*/
 
-/*-----------------------------------------------------------------------------
- * System States
- * 
- * NORMAL:     No issues detected, operating normally
- * PREPARE:    Prediction indicates upcoming degradation, pre-arming
- * PROTECT:    Tripwire fired, duplication active, evaluating switch
- * SWITCHING:  In preroll period before executing switch
- * HOLDING:    Switch executed, holding in protection mode
- *---------------------------------------------------------------------------*/
+/* Risk index slots past the uplinks (riskmap key uplink field), + uplink
+ * index; stored as "<uplink>_ho" / "<uplink>_hogap" */
 typedef enum {
-    STATE_NORMAL = 0,
-    STATE_PREPARE,
-    STATE_PROTECT,
-    STATE_SWITCHING,
-    STATE_HOLDING
-} sys_state_t;
+    RISK_SLOT_HO = MAX_UPLINKS,         /* P(handover while crossing this tile) */
+    RISK_SLOT_GAP = 2 * MAX_UPLINKS,    /* Handover gap / HO_GAP_SCALE_MS */
+    RISK_SLOT_COUNT = 3 * MAX_UPLINKS
+} risk_slot_t;
 
-static const char* STATE_NAMES[] = {"NORMAL", "PREPARE", "PROTECT", "SWITCHING", "HOLDING"};
+#if 3 * MAX_UPLINKS > RISKMAP_MAX_UPLINKS
+#error "Risk slots for MAX_UPLINKS don't fit a riskmap key"
+#endif
 
-/*-----------------------------------------------------------------------------
- * Uplink Types
- * 
- * Each uplink has different characteristics:
- * - LTE: Has RF metrics (RSRP, SINR), carrier info, can predict via training
- * - STARLINK: Has dish API (obstruction, latency), unpredictable sat hops
- * - FIBER: Most stable, typically just RTT monitoring
- *---------------------------------------------------------------------------*/
-typedef enum {
-    UPLINK_TYPE_LTE = 0,
-    UPLINK_TYPE_STARLINK,
-    UPLINK_TYPE_FIBER
-} uplink_type_t;
-
-/*-----------------------------------------------------------------------------
- * Uplink IDs
- * These correspond to the config file uplink names
- *---------------------------------------------------------------------------*/
-typedef enum {
-    UPLINK_CELL_A = 0,
-    UPLINK_CELL_B,
-    UPLINK_SL_A,
-    UPLINK_SL_B,
-    UPLINK_FIBER1,
-    UPLINK_FIBER2,
-    UPLINK_COUNT
-} uplink_id_t;
-
-static const char* UPLINK_NAMES[] = {
-    "cell_a", "cell_b", "sl_a", "sl_b", "fiber1", "fiber2"
-};
+/* Per-uplink tables of the return path, PoP probes and route profiles */
+#if RETPATH_PATHS < MAX_UPLINKS || POPSEL_MAX_PATHS < MAX_UPLINKS || ROUTES_MAX_UPLINKS < MAX_UPLINKS
+#error "retpath, popsel and routes must hold MAX_UPLINKS uplinks"
+#endif
 
-/*-----------------------------------------------------------------------------
- * Trigger Reasons
- * What caused the tripwire to fire
- *---------------------------------------------------------------------------*/
+/* Hot-path latency stages, "link degraded -> duplicate flowing" (hdr.h) */
 typedef enum {
-    TRIGGER_NONE = 0,
-    TRIGGER_RTT_STEP,           /* RTT jumped significantly */
-    TRIGGER_PROBE_MISS,         /* Lost consecutive probes */
-    TRIGGER_LINK_DOWN,          /* Interface went down */
-    TRIGGER_RSRP_DROP,          /* LTE signal degraded */
-    TRIGGER_SINR_DROP,          /* LTE SNR degraded */
-    TRIGGER_STARLINK_OBSTR,     /* Starlink obstruction detected */
-    TRIGGER_PREDICTED,          /* Prediction engine warned us */
-    TRIGGER_MANUAL              /* Operator forced via UI */
-} trigger_t;
-
-static const char* TRIGGER_NAMES[] = {
-    "none", "rtt_step", "probe_miss", "link_down", "rsrp_drop",
-    "sinr_drop", "starlink_obstruction", "predicted", "manual"
+    LAT_PROBE_WAIT,         /* Probe round start -> this uplink's probe launched */
+    LAT_PROBE,              /* Probe launched -> reply parsed (RTT + fork/exec) */
+    LAT_METRIC_UPDATE,      /* engine_probe(): history, baseline, loss, jitter */
+    LAT_DECIDE,             /* engine_step(): tripwire checks, state machine */
+    LAT_FIRE_WAIT,          /* Triggering probe parsed -> tripwire fire */
+    LAT_ACTUATE,            /* dup_enable(): tc until the kernel has acked */
+    LAT_DEGRADED_TO_DUP,    /* Triggering probe launched -> duplicate flowing */
+    LAT_LOOP,               /* Main loop iteration, without its sleep */
+    LAT_COUNT
+} lat_stage_t;
+
+static const char* LAT_NAMES[] = {
+    "probe_wait", "probe", "metric_update", "decide", "fire_wait", "actuate",
+    "degraded_to_dup", "loop"
 };
 
-/*-----------------------------------------------------------------------------
- * Probe Result - Single RTT/loss measurement
- *---------------------------------------------------------------------------*/
-typedef struct {
-    double      rtt_ms;         /* Round-trip time in milliseconds */
-    bool        success;        /* Did probe succeed? */
-    int64_t     timestamp_us;   /* Microsecond timestamp */
-} probe_t;
-
-/*-----------------------------------------------------------------------------
- * Cellular Info - LTE signal metrics from ModemManager
- *---------------------------------------------------------------------------*/
-typedef struct {
-    double      rsrp;           /* Reference Signal Received Power (dBm), -140 to -44 */
-    double      rsrq;           /* Reference Signal Received Quality (dB), -20 to -3 */
-    double      sinr;           /* Signal to Interference+Noise (dB), -20 to +30 */
-    double      rssi;           /* Received Signal Strength Indicator (dBm) */
-    char        carrier[32];    /* Carrier name: "T-Mobile", "AT&T", etc */
-    char        cell_id[24];    /* Cell tower ID */
-    char        tac[16];        /* Tracking Area Code */
-    char        band[16];       /* LTE band: "B66", "B14", etc */
-    bool        connected;      /* Is modem connected? */
-    int64_t     timestamp_us;   /* When this was measured */
-} cellular_t;
-
-/*-----------------------------------------------------------------------------
- * Starlink Info - From dish HTTP API at 192.168.100.1
- *---------------------------------------------------------------------------*/
-typedef struct {
-    bool        connected;      /* Can we reach the dish? */
-    bool        online;         /* Is dish online and connected to satellites? */
-    char        state[32];      /* "CONNECTED", "SEARCHING", "BOOTING", etc */
-    double      latency_ms;     /* Pop ping latency from dish */
-    double      drop_rate;      /* Packet drop rate 0.0-1.0 */
-    double      downlink_mbps;  /* Current downlink throughput */
-    double      uplink_mbps;    /* Current uplink throughput */
-    bool        obstructed;     /* Currently obstructed? */
-    double      obstruction_pct;/* Percent time obstructed */
-    int         obstruction_eta;/* Seconds until next obstruction, -1 if unknown */
-    bool        thermal_throttle;/* Hardware thermal limiting */
-    bool        motors_stuck;   /* Hardware motor issue */
-    int64_t     timestamp_us;
-} starlink_t;
-
-/*-----------------------------------------------------------------------------
- * Uplink - Complete state for one uplink path
- *---------------------------------------------------------------------------*/
-typedef struct {
-    /* Identity */
-    char            name[32];       /* "cell_a", "sl_b", etc */
-    char            interface[32];  /* "wwan0", "enp1s0", etc */
-    char            netns[32];      /* "ns_cell_a", "ns_sl_a", etc */
-    char            veth[32];       /* "veth_cell_a", etc */
-    uplink_id_t     id;
-    uplink_type_t   type;
-    bool            enabled;        /* Is this uplink configured? */
-    
-    /* Current state */
-    bool            available;      /* Is uplink currently usable? */
-    bool            force_failed;   /* Operator forced fail - sticky until cleared */
-    /* Chaos injection (demo mode) */
-    double          chaos_rtt;      /* Injected RTT */
-    double          chaos_jitter;   /* Injected jitter */
-    double          chaos_loss;     /* Injected loss % */
-    bool            is_active;      /* Is this the primary uplink? */
-    
-    /* Live metrics */
-    double          rtt_ms;         /* Current RTT */
-    double          rtt_baseline;   /* Baseline RTT (slow moving average) */
-    double          loss_pct;       /* Recent loss percentage */
-    double          jitter_ms;      /* RTT variance */
-    int             consec_fail;    /* Consecutive probe failures */
-    
-    /* Type-specific data */
-    cellular_t      cellular;       /* LTE metrics (if type == LTE) */
-    starlink_t      starlink;       /* Starlink metrics (if type == STARLINK) */
-    
-    /* History ring buffer */
-    probe_t         history[HISTORY_SIZE];
-    int             history_idx;
-    
-    /* Prediction scores */
-    double          risk_now;       /* Current risk 0.0-1.0 */
-    double          risk_ahead;     /* Predicted risk 0.0-1.0 */
-    double          confidence;     /* Prediction confidence 0.0-1.0 */
-} uplink_t;
-
-/*-----------------------------------------------------------------------------
- * GPS Data - From gpsd
- *---------------------------------------------------------------------------*/
-typedef struct {
-    double      latitude;
-    double      longitude;
-    double      altitude_m;
-    double      speed_mps;      /* Meters per second */
-    double      heading;        /* Degrees from north */
-    bool        valid;
-    int64_t     timestamp_us;
-} gps_t;
-
-/*-----------------------------------------------------------------------------
- * System Status - Overall state of the Guardian
- *---------------------------------------------------------------------------*/
-typedef struct {
-    /* Operating mode and state */
-    op_mode_t       mode;
-    sys_state_t     state;
-    
-    /* Trigger info */
-    trigger_t       last_trigger;
-    char            trigger_detail[128];
-    
-    /* Active paths */
-    uplink_id_t     active_uplink;
-    int             active_controller;  /* 0 = ctrl_a, 1 = ctrl_b */
-    
-    /* Duplication state */
-    bool            dup_enabled;
-    int64_t         dup_enabled_at_us;
-    
-    /* Timers */
-    int64_t         protect_start_us;
-    int64_t         switch_start_us;
-    int64_t         last_clean_us;
-    int             switches_this_window;
-    
-    /* Display values */
-    int             hold_remaining_sec;
-    int             clean_remaining_sec;
-    bool            flap_suppressed;
-    
-    /* Prediction */
-    double          global_risk;
-    char            recommendation[16];  /* "NORMAL", "PREPARE", "PROTECT" */
-    
-    /* Run tracking */
-    char            run_id[64];
-} status_t;
-
-/*-----------------------------------------------------------------------------
- * Configuration - Loaded from JSON
- *---------------------------------------------------------------------------*/
-typedef struct {
-    /* Paths */
-    char        config_path[256];
-    char        data_dir[256];
-    char        log_path[256];
-    
-    /* Node identity */
-    char        node_id[64];
-    char        node_role[16];
-    
-    /* Tripwire thresholds */
-    int         rtt_step_ms;
-    int         rtt_window_ms;
-    int         probe_miss_count;
-    int         probe_miss_window_ms;
-    double      rsrp_drop_db;
-    double      sinr_drop_db;
-    
-    /* Switching parameters */
-    int         preroll_ms;
-    int         min_hold_sec;
-    int         clean_exit_sec;
-    
-    /* Feature flags */
-    bool        gps_enabled;
-    bool        pcap_enabled;
-    bool        opencellid_enabled;
-    bool        osm_enabled;
-    
-    /* Sample rate */
-    int         sample_rate_hz;
-    
-    /* C8000 control */
-    char        c8000_host[128];
-    char        c8000_user[32];
-    char        c8000_pass[64];
-    
-    /* Remote targets (nullable) */
-    char        voice_server[64];
-    char        llm_server[64];
-} config_t;
-
 /*=============================================================================
  * GLOBAL STATE
  * 
@@ -410,11 +228,68 @@ typedef struct {
  *===========================================================================*/
 
 static volatile sig_atomic_t    g_running = 1;      /* Main loop control */
-static config_t                 g_config;           /* Configuration */
+static volatile sig_atomic_t    g_reload;           /* SIGHUP: read the config again */
+static const config_t*          g_cfg;              /* Configuration snapshot, swapped on reload */
+static const config_t*          g_cfg_retired;      /* The one before, freed on the next swap */
+static int                      g_cfg_watch = -1;   /* inotify on the config directory */
 static uplink_t                 g_uplinks[MAX_UPLINKS]; /* All uplinks */
+static int                      g_uplink_count;     /* Entries in g_uplinks */
+static uplinkidx_t              g_uplink_idx;       /* Name -> uplink */
 static status_t                 g_status;           /* Current status */
 static gps_t                    g_gps;              /* GPS data */
 static sqlite3*                 g_db = NULL;        /* Training database */
+static riskmap_t                g_riskmap;          /* Learned location risk */
+static traj_t                   g_traj;             /* Dead-reckoned trajectory */
+static routes_t                 g_routes;           /* Known-route profiles (mmap) */
+static int                      g_route_col[MAX_UPLINKS]; /* Profile column per uplink */
+static model_t*                 g_model = NULL;     /* Live risk model, swapped on reload */
+static engine_t                 g_engine;           /* Decision engine, wired in engine_setup() */
+static corrmap_t                g_corrmap;          /* Pairwise failure correlation per tile */
+static shadow_t*                g_shadows[SHADOW_MAX];  /* Configured shadow policies */
+static int                      g_shadow_count;
+static char                     g_shadow_files[SHADOW_MAX][256];    /* From config */
+static int                      g_shadow_file_count;
+static shadow_t*                g_training_shadow;  /* Live thresholds as TRIPWIRE, in TRAINING */
+static shadow_score_t           g_live_score;       /* Live policy, scored like the shadows */
+static int                      g_dup_target = -1;  /* Live duplication target, -1 = off */
+static int64_t                  g_corr_last_us;     /* End of the last observed window */
+static hdr_t                    g_lat[LAT_COUNT];   /* Hot-path latency per stage */
+static _Atomic uint64_t         g_loop_overruns;    /* Iterations over LOOP_PERIOD_US */
+static int64_t                  g_probe_round_us;   /* Start of the current probe round */
+static int64_t                  g_probe_start_us[MAX_UPLINKS];  /* Last probe launched */
+static int64_t                  g_probe_done_us[MAX_UPLINKS];   /* ... and its metrics updated */
+static int                      g_fire_src = -1;    /* Last live dup_enable: active uplink */
+static int64_t                  g_fire_dup_start_us;
+static int64_t                  g_fire_dup_done_us;
+static metrics_t                g_metrics;          /* Prometheus exposition buffers */
+static uint64_t                 g_transitions[STATE_COUNT][STATE_COUNT];    /* [from][to] */
+static sys_state_t              g_last_state;       /* As of the last loop iteration */
+static uint64_t                 g_fires[TRIGGER_COUNT];     /* Live tripwire fires by trigger */
+static uint64_t                 g_dup_bytes;        /* Mirrored bytes, sampled per render */
+static uint64_t                 g_dup_tx_last;      /* Source device tx_bytes at last sample */
+static char                     g_dup_tx_dev[32];   /* ... of this device, "" = not sampling */
+static flightrec_t              g_flightrec;        /* Packet rings around incidents */
+static int                      g_flightrec_active = -1;    /* Uplink its active ring is on */
+static flowmon_t                g_flowmon;          /* Client flows from conntrack */
+static int                      g_flowmon_active = -1;      /* Active uplink it last saw */
+static rtpmon_t                 g_rtpmon;           /* RTP streams and MOS */
+static int                      g_rtpmon_active = -1;       /* Active uplink it last saw */
+static bool                     g_rtpmon_dup;       /* Duplication state it last saw */
+static watchdog_t               g_watchdog;         /* Loop phase budgets, blind deadline */
+static _Atomic int              g_wd_pair = -1;     /* Active << 8 | standby, for the watchdog */
+static _Atomic bool             g_wd_dup;           /* Duplicate is the watchdog's */
+static pthread_mutex_t          g_dup_lock = PTHREAD_MUTEX_INITIALIZER;    /* tc, loop vs watchdog */
+static retpath_client_t         g_retpath;          /* Return path switch sender */
+static int                      g_retpath_path[MAX_UPLINKS];    /* Its path per uplink, -1 = none */
+static int                      g_retpath_last = -1;            /* Uplink of the last switch sent */
+static _Atomic uint64_t         g_retpath_fallback; /* Switches << 8 | uplink + 1, 0 = none */
+static popsel_t                 g_popsel;           /* PoP RTT/loss per uplink, nearest healthy */
+static c8000_session_t          g_c8000;            /* NETCONF session to the C8000 */
+static char*                    g_c8000_rpc[MAX_CONTROLLERS];   /* Per controller, NULL = script */
+static _Atomic bool             g_c8000_script;     /* C8000_SCRIPT running (its own thread) */
+static bool                     g_pop_pinned;       /* Operator chose the PoP */
+static int                      g_pop_tried = -1;   /* Last automatic switch ... */
+static int64_t                  g_pop_tried_us;     /* ... and when */
 static FILE*                    g_logfile = NULL;   /* JSONL log */
 static pthread_mutex_t          g_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -432,42 +307,88 @@ static void log_info(const char* msg);
 
 /* Configuration */
 static int config_load(const char* path);
+static void config_watch_setup(void);
+static bool config_changed(void);
+static void config_reload(void);
 
 /* Uplink monitoring */
 static void uplinks_init(void);
 static void uplink_poll(uplink_t* u);
 static void cellular_poll(uplink_t* u);
+static void cell_info_poll(uplink_t* u);
 static void starlink_poll(uplink_t* u);
+static void starlink_forecast(uplink_t* u);
 
 /* GPS */
 static void gps_poll(void);
 static void chaos_read(void);
 
-/* Tripwire (fast path) */
-static trigger_t tripwire_check(uplink_t* active);
-static void tripwire_fire(trigger_t reason, const char* detail);
+/* Decision engine (engine.h) */
+static void engine_setup(void);
+
+/* Shadow policies */
+static void shadows_init(void);
+static void shadows_step(int64_t now);
+static void shadows_report(const char* type);
+static void shadow_training(bool on);
 
 /* Duplication control */
 static int dup_init(void);
 static int dup_enable(const char* src_veth, const char* dst_veth);
 static int dup_disable(void);
 
-/* Switching (slow path) */
-static void slowpath_arbitrate(void);
-static uplink_id_t select_best_uplink(void);
-static void execute_switch(uplink_id_t target);
+/* Flight recorder */
+static void flightrec_setup(void);
+static void flightrec_observe(void);
 
-/* Protection mode */
-static void protection_tick(void);
+/* Flow monitor */
+static void flowmon_setup(void);
+static void flowmon_observe(void);
+
+/* RTP monitor */
+static void rtpmon_setup(void);
+static void rtpmon_observe(void);
+
+/* Return path */
+static void retpath_setup(void);
+static void retpath_fallback(const char* uplink);
+static void retpath_step(void);
+
+/* Watchdog */
+static void watchdog_setup(void);
+static void watchdog_observe(bool probed);
+
+/* Risk index */
+static void risk_index_init(void);
+static void risk_index_observe(void);
+static void risk_index_flush(void);
+static bool gps_fresh(void);
+
+/* Failure correlation */
+static void corr_observe(void);
+
+/* Handover prediction */
+static void handover_observe(uplink_t* u, bool changed, int64_t since_us);
+
+/* Risk model */
+static void model_init(void);
+static void model_reload(void);
+static void model_learn(const uplink_t* u, int i, const float* x, int64_t now);
+static void model_flush(void);
 
 /* Prediction */
-static void prediction_tick(void);
+static void trajectory_fix(void);
+static void routes_load(void);
+static void predictor_tick(void);
 
 /* C8000 control */
-static int c8000_switch(int controller);
+static void c8000_setup(void);
+static void c8000_step(void);
+static int c8000_switch(int controller, const char* reason);
 
 /* Status output */
 static void status_write(void);
+static void trace_write(int64_t t_us);
 
 /* Command processing */
 static void commands_process(void);
@@ -498,13 +419,14 @@ static int64_t now_ms(void) {
 
 static void log_event(const char* type, const char* fmt, ...) {
     va_list args;
-    char msg[1024];
+    char msg[4096];
     char timestamp[32];
     struct timeval tv;
     
     gettimeofday(&tv, NULL);
-    struct tm* tm = localtime(&tv.tv_sec);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", tm);
+    struct tm tm;
+    localtime_r(&tv.tv_sec, &tm);       /* Also called from worker threads */
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
     
     va_start(args, fmt);
     vsnprintf(msg, sizeof(msg), fmt, args);
@@ -523,95 +445,140 @@ static void log_info(const char* msg) {
 /*=============================================================================
  * CONFIGURATION
  * 
- * Configuration is loaded from JSON file. We use a simple parser here
- * to avoid heavy dependencies. In production, consider using cJSON or jansson.
+ * config.json is parsed and checked in config.c; a config that fails is
+ * refused with the reason, never half applied.
+ *
+ * The parsed config is an immutable snapshot behind g_cfg. SIGHUP, or the
+ * file being rewritten or renamed over (inotify on its directory), makes
+ * the main loop parse a new one and swap the pointer between iterations:
+ * code sees either snapshot, never a mix, and uplink state, baselines and
+ * learned risk carry over. Keys that only take effect at startup (threads,
+ * sockets, files, the uplink table) keep their running values; a reload
+ * that changed them says so in "restart_needed". Per-uplink "enabled" is
+ * applied live, as the enable:/disable: commands would.
  *===========================================================================*/
 
-/* Simple JSON string extraction (good enough for our config) */
-static int json_get_string(const char* json, const char* key, char* out, size_t len) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\":\"", key);
-    const char* p = strstr(json, search);
-    if (!p) return -1;
-    p += strlen(search);
-    size_t i = 0;
-    while (*p && *p != '"' && i < len - 1) out[i++] = *p++;
-    out[i] = '\0';
+/* Startup: the first snapshot and the shadow policy list; -1 (reason on stderr) if unusable */
+static int config_load(const char* path) {
+    char err[256];
+    char* json = config_file_read(path);
+    if (!json) {
+        fprintf(stderr, "Cannot read config %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    config_t* cfg = malloc(sizeof(config_t));
+    if (!cfg || config_parse(json, cfg, err, sizeof(err)) != 0) {
+        fprintf(stderr, "Config %s: %s\n", path, cfg ? err : "out of memory");
+        free(cfg);
+        free(json);
+        return -1;
+    }
+    snprintf(cfg->config_path, sizeof(cfg->config_path), "%s", path);
+    
+    /* Shadow policies: config overlays, e.g. from pathsteer-sweep --emit */
+    g_shadow_file_count = config_shadow_files(json, g_shadow_files, SHADOW_MAX);
+    free(json);
+    
+    g_cfg = cfg;
     return 0;
 }
 
-static int json_get_int(const char* json, const char* key, int def) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    const char* p = strstr(json, search);
-    if (!p) return def;
-    p += strlen(search);
-    while (*p == ' ') p++;
-    return atoi(p);
+/* Watch the config file's directory: editors and the Web UI replace or rewrite it */
+static void config_watch_setup(void) {
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", g_cfg->config_path);
+    char* slash = strrchr(dir, '/');
+    if (!slash) strcpy(dir, ".");
+    else if (slash == dir) slash[1] = '\0';
+    else *slash = '\0';
+    
+    g_cfg_watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_cfg_watch < 0 || inotify_add_watch(g_cfg_watch, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        log_event("config_watch_error", "{\"dir\":\"%s\",\"error\":\"%s\"}", dir, strerror(errno));
+        if (g_cfg_watch >= 0) close(g_cfg_watch);
+        g_cfg_watch = -1;
+        return;
+    }
+    log_event("config_watch", "{\"dir\":\"%s\"}", dir);
 }
 
-static bool json_get_bool(const char* json, const char* key, bool def) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    const char* p = strstr(json, search);
-    if (!p) return def;
-    p += strlen(search);
-    while (*p == ' ') p++;
-    return (strncmp(p, "true", 4) == 0);
+/* SIGHUP, or the config file written or renamed over, since the last call */
+static bool config_changed(void) {
+    bool changed = g_reload;
+    g_reload = 0;
+    if (g_cfg_watch < 0) return changed;
+    
+    const char* base = strrchr(g_cfg->config_path, '/');
+    base = base ? base + 1 : g_cfg->config_path;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(g_cfg_watch, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n; ) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            if ((ev->mask & IN_Q_OVERFLOW) || (ev->len && strcmp(ev->name, base) == 0)) changed = true;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    return changed;
 }
 
-static int config_load(const char* path) {
-    /* Read file */
-    FILE* f = fopen(path, "r");
-    if (!f) {
-        fprintf(stderr, "Cannot open config: %s\n", path);
-        return -1;
-    }
-    
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    char* json = malloc(size + 1);
-    fread(json, 1, size, f);
-    json[size] = '\0';
-    fclose(f);
-    
-    /* Parse values */
-    strncpy(g_config.config_path, path, sizeof(g_config.config_path));
+/* Main loop, between iterations: parse the file again and swap the snapshot */
+static void config_reload(void) {
+    const config_t* cur = g_cfg;
+    char err[256];
     
-    json_get_string(json, "id", g_config.node_id, sizeof(g_config.node_id));
-    json_get_string(json, "role", g_config.node_role, sizeof(g_config.node_role));
-    
-    /* Tripwire thresholds */
-    g_config.rtt_step_ms = json_get_int(json, "rtt_step_threshold_ms", DEFAULT_RTT_STEP_MS);
-    g_config.rtt_window_ms = json_get_int(json, "rtt_step_window_ms", DEFAULT_RTT_WINDOW_MS);
-    g_config.probe_miss_count = json_get_int(json, "probe_miss_count", DEFAULT_PROBE_MISS_COUNT);
-    g_config.probe_miss_window_ms = json_get_int(json, "probe_miss_window_ms", DEFAULT_PROBE_MISS_WINDOW);
-    g_config.rsrp_drop_db = json_get_int(json, "rsrp_drop_threshold_db", DEFAULT_RSRP_DROP_DB);
-    g_config.sinr_drop_db = json_get_int(json, "sinr_drop_threshold_db", DEFAULT_SINR_DROP_DB);
-    
-    /* Switching */
-    g_config.preroll_ms = json_get_int(json, "preroll_ms", DEFAULT_PREROLL_MS);
-    g_config.min_hold_sec = json_get_int(json, "min_hold_sec", DEFAULT_MIN_HOLD_SEC);
-    g_config.clean_exit_sec = json_get_int(json, "clean_exit_sec", DEFAULT_CLEAN_EXIT_SEC);
-    
-    /* Features */
-    g_config.gps_enabled = json_get_bool(json, "gps_enabled", true);
-    g_config.pcap_enabled = json_get_bool(json, "pcap_enabled", true);
-    g_config.sample_rate_hz = json_get_int(json, "sample_rate_hz", 10);
+    char* json = config_file_read(cur->config_path);
+    if (!json) {
+        log_event("config_reload", "{\"status\":\"read_failed\",\"error\":\"%s\"}", strerror(errno));
+        return;
+    }
+    config_t* next = malloc(sizeof(config_t));
+    if (!next || config_parse(json, next, err, sizeof(err)) != 0) {
+        log_event("config_reload", "{\"status\":\"rejected\",\"error\":\"%s\"}", next ? err : "out of memory");
+        free(next);
+        free(json);
+        return;
+    }
+    snprintf(next->config_path, sizeof(next->config_path), "%s", cur->config_path);
+    
+    /* Startup-only keys keep their running values */
+    char restart[512];
+    size_t rn = config_keep_restart(next, cur, restart, sizeof(restart));
+    
+    char files[SHADOW_MAX][256];
+    int nfiles = config_shadow_files(json, files, SHADOW_MAX);
+    bool same = (nfiles == g_shadow_file_count);
+    for (int i = 0; same && i < nfiles; i++) same = strcmp(files[i], g_shadow_files[i]) == 0;
+    if (!same) {
+        rn += snprintf(restart + rn, sizeof(restart) - rn, "%s\"shadow_policies\"", rn ? "," : "");
+        if (rn >= sizeof(restart)) rn = sizeof(restart) - 1;
+    }
+    free(json);
     
-    /* C8000 */
-    json_get_string(json, "host", g_config.c8000_host, sizeof(g_config.c8000_host));
-    json_get_string(json, "user", g_config.c8000_user, sizeof(g_config.c8000_user));
-    json_get_string(json, "password", g_config.c8000_pass, sizeof(g_config.c8000_pass));
+    if (!config_uplinks_same(cur, next)) {
+        next->uplink_count = cur->uplink_count;
+        memcpy(next->uplinks, cur->uplinks, sizeof(next->uplinks));
+        snprintf(restart + rn, sizeof(restart) - rn, "%s\"uplinks\"", rn ? "," : "");
+    } else {
+        for (int i = 0; i < g_uplink_count; i++) {
+            if (next->uplinks[i].enabled == cur->uplinks[i].enabled) continue;
+            g_uplinks[i].enabled = next->uplinks[i].enabled;
+            log_event(g_uplinks[i].enabled ? "uplink_enabled" : "uplink_disabled",
+                      "{\"uplink\":\"%s\",\"source\":\"config\"}", g_uplinks[i].name);
+        }
+    }
     
-    /* Paths */
-    strncpy(g_config.data_dir, "/var/lib/pathsteer", sizeof(g_config.data_dir));
-    snprintf(g_config.log_path, sizeof(g_config.log_path), "%s/logs", g_config.data_dir);
+    /* Publish; the previous snapshot is freed a reload later, long after
+     * anything that loaded g_cfg before this is done with it */
+    __atomic_store_n(&g_cfg, next, __ATOMIC_RELEASE);
+    g_engine.cfg = next;
+    for (int i = 0; i < g_shadow_count; i++) shadow_reconfig(g_shadows[i]);
+    if (g_training_shadow) shadow_reconfig(g_training_shadow);
+    free((void*)g_cfg_retired);
+    g_cfg_retired = cur;
     
-    free(json);
-    return 0;
+    log_event("config_reload", "{\"status\":\"ok\",\"restart_needed\":[%s]}", restart);
 }
 
 /*=============================================================================
@@ -647,7 +614,11 @@ static int dup_init(void) {
     return 0;
 }
 
-static int dup_enable(const char* src_veth, const char* dst_veth) {
+/* Device the mirred filter is on, for dup_disable() */
+static char g_dup_src[32] = "br-lan";
+
+/* dup_enable() with g_dup_lock held */
+static void dup_enable_locked(const char* src_veth, const char* dst_veth) {
     /*
      * Enable duplication by adding a mirred filter.
      * This copies ALL packets from src_veth to dst_veth.
@@ -668,468 +639,728 @@ static int dup_enable(const char* src_veth, const char* dst_veth) {
     system(cmd);
     
     int64_t elapsed = now_us() - start;
+    hdr_record(&g_lat[LAT_ACTUATE], elapsed);
     
     pthread_mutex_lock(&g_mutex);
+    snprintf(g_dup_src, sizeof(g_dup_src), "%.31s", src_veth);
     g_status.dup_enabled = true;
     g_status.dup_enabled_at_us = now_us();
     pthread_mutex_unlock(&g_mutex);
     
     log_event("dup_enable", "{\"src\":\"%s\",\"dst\":\"%s\",\"latency_us\":%ld}",
               src_veth, dst_veth, elapsed);
-    
+}
+
+static int dup_enable(const char* src_veth, const char* dst_veth) {
+    pthread_mutex_lock(&g_dup_lock);
+    dup_enable_locked(src_veth, dst_veth);
+    pthread_mutex_unlock(&g_dup_lock);
     return 0;
 }
 
 static int dup_disable(void) {
     /*
-     * Disable all active duplication filters.
+     * Disable the active duplication filter, wherever dup_enable put it.
      */
-    system("tc filter del dev br-lan parent 1: pref 1 2>/dev/null");
+    pthread_mutex_lock(&g_dup_lock);
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "tc filter del dev %s parent 1: pref 1 2>/dev/null", g_dup_src);
+    system(cmd);
     
     pthread_mutex_lock(&g_mutex);
     g_status.dup_enabled = false;
+    g_dup_target = -1;
     pthread_mutex_unlock(&g_mutex);
+    pthread_mutex_unlock(&g_dup_lock);
+    atomic_store(&g_wd_dup, false);
     
     log_event("dup_disable", "{\"status\":\"disabled\"}");
     return 0;
 }
 
 /*=============================================================================
- * TRIPWIRE (FAST PATH)
- * 
- * The tripwire is the fast-path detection mechanism. When ANY of these
- * conditions is met, we IMMEDIATELY enable duplication - no waiting,
- * no arbitration. Speed is critical here (milliseconds matter).
+ * LATENCY INSTRUMENTATION
  * 
- * After duplication is enabled, the slow path arbitrates which path
- * to switch to. But duplication happens first.
+ * Every stage from probe launch to the mirred filter being in the kernel is
+ * recorded into a lock-free HDR histogram (hdr.h) - status.json "latency",
+ * in microseconds. degraded_to_dup is the end-to-end number: launch of the
+ * probe that showed the active path failing until tc has returned.
  *===========================================================================*/
 
-static trigger_t tripwire_check(uplink_t* active) {
-    if (!active || !active->enabled || !active->available) {
-        return TRIGGER_LINK_DOWN;
-    }
-    
-    /*
-     * Check 1: RTT Step
-     * If RTT jumped significantly over baseline, something changed.
-     */
-    if (active->history_idx >= 5) {
-        double recent_sum = 0;
-        int count = 0;
-        for (int i = 0; i < 3; i++) {
-            int idx = (active->history_idx - 1 - i) % HISTORY_SIZE;
-            if (active->history[idx].success) {
-                recent_sum += active->history[idx].rtt_ms;
-                count++;
-            }
-        }
-        if (count > 0) {
-            double recent_avg = recent_sum / count;
-            double step = recent_avg - active->rtt_baseline;
-            if (step >= g_config.rtt_step_ms) {
-                return TRIGGER_RTT_STEP;
-            }
-        }
-    }
-    
-    /*
-     * Check 2: Probe Miss
-     * Consecutive probe failures indicate path problems.
-     */
-    if (active->consec_fail >= g_config.probe_miss_count) {
-        return TRIGGER_PROBE_MISS;
-    }
-    
-    /*
-     * Check 3: LTE Signal Drop (if LTE uplink)
-     */
-    if (active->type == UPLINK_TYPE_LTE && active->cellular.rsrp < -120) {
-        return TRIGGER_RSRP_DROP;
-    }
+/* tripwire_fire being logged: time it from the active uplink's last probe */
+static void lat_fire(void) {
+    int src = g_fire_src;
+    g_fire_src = -1;
     
-    /*
-     * Check 4: Starlink Obstruction (if Starlink uplink)
-     */
-    if (active->type == UPLINK_TYPE_STARLINK) {
-        if (active->starlink.obstructed) {
-            return TRIGGER_STARLINK_OBSTR;
-        }
-        /* Also trigger if obstruction predicted within 5 seconds */
-        if (active->starlink.obstruction_eta > 0 && active->starlink.obstruction_eta < 5) {
-            return TRIGGER_STARLINK_OBSTR;
-        }
-    }
+    /* No duplicate, or nothing measured to time from */
+    if (src < 0 || g_probe_done_us[src] == 0) return;
+    if (g_status.last_trigger == TRIGGER_PREDICTED || g_status.last_trigger == TRIGGER_MANUAL) return;
     
-    return TRIGGER_NONE;
+    hdr_record(&g_lat[LAT_FIRE_WAIT], g_fire_dup_start_us - g_probe_done_us[src]);
+    hdr_record(&g_lat[LAT_DEGRADED_TO_DUP], g_fire_dup_done_us - g_probe_start_us[src]);
 }
 
-static void tripwire_fire(trigger_t reason, const char* detail) {
-    /*
-     * FAST PATH: Enable duplication IMMEDIATELY.
-     * This is the critical path - must complete in milliseconds.
-     */
-    int64_t start = now_us();
-    
-    /* Find secondary uplink to duplicate to */
-    uplink_id_t secondary = (g_status.active_uplink + 1) % UPLINK_COUNT;
-    while (secondary != g_status.active_uplink) {
-        if (g_uplinks[secondary].enabled && g_uplinks[secondary].available) {
-            break;
-        }
-        secondary = (secondary + 1) % UPLINK_COUNT;
+/* One main loop iteration's work, started at start */
+static void lat_loop(int64_t start) {
+    int64_t work = now_us() - start;
+    hdr_record(&g_lat[LAT_LOOP], work);
+    if (work > LOOP_PERIOD_US) atomic_fetch_add_explicit(&g_loop_overruns, 1, memory_order_relaxed);
+}
+
+static void lat_json(char* out, size_t len) {
+    size_t n = snprintf(out, len, "{");
+    for (int i = 0; i < LAT_COUNT && n < len; i++) {
+        char h[256];
+        hdr_json(&g_lat[i], h, sizeof(h));
+        n += snprintf(out + n, len - n, "\"%s\": %s, ", LAT_NAMES[i], h);
     }
-    
-    /* Enable duplication */
-    if (secondary != g_status.active_uplink) {
-        dup_enable(g_uplinks[g_status.active_uplink].veth, g_uplinks[secondary].veth);
+    if (n < len) {
+        snprintf(out + n, len - n, "\"loop_overruns\": %llu}",
+                 (unsigned long long)atomic_load_explicit(&g_loop_overruns, memory_order_relaxed));
     }
-    
-    /* Update state */
-    pthread_mutex_lock(&g_mutex);
-    g_status.state = STATE_PROTECT;
-    g_status.last_trigger = reason;
-    snprintf(g_status.trigger_detail, sizeof(g_status.trigger_detail), "%s", detail ? detail : "");
-    g_status.protect_start_us = now_us();
-    g_status.switches_this_window = 0;
-    g_status.last_clean_us = 0;
-    g_status.flap_suppressed = false;
-    pthread_mutex_unlock(&g_mutex);
-    
-    int64_t elapsed = now_us() - start;
-    
-    log_event("tripwire_fire", "{\"trigger\":\"%s\",\"detail\":\"%s\",\"latency_us\":%ld}",
-              TRIGGER_NAMES[reason], detail ? detail : "", elapsed);
 }
 
 /*=============================================================================
- * SWITCHING (SLOW PATH)
- * 
- * After duplication is active, we arbitrate which path to switch to.
- * This is the "slow" path - we have time because duplication protects us.
+ * FLIGHT RECORDER
  * 
- * Rules:
- * 1. Wait preroll period before switching (let things stabilize)
- * 2. Switch at most ONCE per protection window (no flapping)
- * 3. Stay in protection for min_hold time
- * 4. Exit only after clean_exit time with no issues
+ * With "pcap_enabled", br-lan and the active uplink's veth are kept in
+ * TPACKET_V3 rings (flightrec.h) and every tripwire fire and switch writes
+ * fr_<time>_<reason>_{lan,active}.pcap to flightrec_dir, from
+ * flightrec_pre_sec before to flightrec_post_sec after. Incidents that
+ * overlap share one slice; the oldest slices go once the directory holds
+ * more than flightrec_keep_mb. /api/pcap/start is still there for long
+ * manual captures.
  *===========================================================================*/
 
-static void slowpath_arbitrate(void) {
-    int64_t now = now_us();
-    int64_t elapsed_ms = (now - g_status.protect_start_us) / 1000;
-    
-    /* Still in preroll? */
-    if (elapsed_ms < g_config.preroll_ms) {
-        g_status.state = STATE_SWITCHING;
-        return;
-    }
-    
-    /* Already switched this window? */
-    if (g_status.switches_this_window >= 1) {
-        g_status.flap_suppressed = true;
-        return;
-    }
-    
-    /* Select best uplink */
-    uplink_id_t best = select_best_uplink();
-    
-    /* Execute switch if different from current */
-    if (best != g_status.active_uplink) {
-        execute_switch(best);
-    }
-    
-    g_status.state = STATE_HOLDING;
+/* Recorder thread, once the post window is in */
+static void flightrec_on_dump(void* ctx, const char* json) {
+    (void)ctx;
+    log_event("flightrec_dump", "%s", json);
 }
 
-static uplink_id_t select_best_uplink(void) {
-    /*
-     * Score each available uplink and select the best.
-     * Lower RTT, lower risk, lower loss = better score.
-     */
-    uplink_id_t best = g_status.active_uplink;
-    double best_score = -9999;
-    
-    for (int i = 0; i < UPLINK_COUNT; i++) {
-        uplink_t* u = &g_uplinks[i];
-        if (!u->enabled || !u->available) continue;
-        
-        /* Base score: 100 - RTT */
-        double score = 100.0 - u->rtt_ms;
-        
-        /* Penalty for risk */
-        score -= u->risk_now * 50.0;
-        
-        /* Penalty for loss */
-        score -= u->loss_pct * 10.0;
-        
-        /* Bonus for good Starlink state */
-        if (u->type == UPLINK_TYPE_STARLINK && u->starlink.online && !u->starlink.obstructed) {
-            score += 20.0;
-        }
-        
-        /* Bonus for strong LTE signal */
-        if (u->type == UPLINK_TYPE_LTE && u->cellular.rsrp > -90) {
-            score += 15.0;
-        }
-        
-        if (score > best_score) {
-            best_score = score;
-            best = i;
-        }
+static void flightrec_setup(void) {
+    flightrec_init(&g_flightrec);
+    if (!g_cfg->pcap_enabled) return;
+    
+    g_flightrec_active = g_status.active_uplink;
+    if (flightrec_start(&g_flightrec, FLIGHTREC_LAN_DEV, g_uplinks[g_flightrec_active].veth,
+                        g_cfg->flightrec_ring_mb, g_cfg->flightrec_snaplen,
+                        g_cfg->flightrec_pre_sec * 1000, g_cfg->flightrec_post_sec * 1000,
+                        g_cfg->flightrec_dir, g_cfg->flightrec_keep_mb, flightrec_on_dump, NULL) == 0) {
+        log_event("flightrec", "{\"lan\":\"%s\",\"active\":\"%s\",\"ring_mb\":%d,\"snaplen\":%d,\"dir\":\"%s\",\"keep_mb\":%d}",
+                  FLIGHTREC_LAN_DEV, g_uplinks[g_flightrec_active].veth, g_cfg->flightrec_ring_mb,
+                  g_cfg->flightrec_snaplen, g_cfg->flightrec_dir, g_cfg->flightrec_keep_mb);
+    } else {
+        log_event("flightrec_error", "{\"error\":\"%s\"}", strerror(errno));
     }
-    
-    return best;
 }
 
-static void execute_switch(uplink_id_t target) {
-    uplink_id_t old = g_status.active_uplink;
-    
-    log_event("switch", "{\"from\":\"%s\",\"to\":\"%s\"}",
-              UPLINK_NAMES[old], UPLINK_NAMES[target]);
-    
-    /* Update routing to use new uplink's veth */
-    /* In V1, this is handled by changing which veth is "primary" */
-    
-    pthread_mutex_lock(&g_mutex);
-    g_uplinks[old].is_active = false;
-    g_uplinks[target].is_active = true;
-    g_status.active_uplink = target;
-    g_status.switches_this_window++;
-    g_status.switch_start_us = now_us();
-    pthread_mutex_unlock(&g_mutex);
+/* Keep the active ring on the active uplink */
+static void flightrec_observe(void) {
+    if (g_flightrec_active < 0 || (int)g_status.active_uplink == g_flightrec_active) return;
+    g_flightrec_active = g_status.active_uplink;
+    flightrec_follow(&g_flightrec, g_uplinks[g_flightrec_active].veth);
 }
 
 /*=============================================================================
- * PROTECTION MODE TICK
+ * FLOW MONITOR
  * 
- * Called every loop iteration when in protection mode.
- * Manages hold timer and clean exit logic.
+ * Client sessions through flowmon_netns for flows.json (Web UI /api/flows),
+ * from conntrack events and counters (flowmon.h). Every active uplink
+ * change counts as a failover for the flows carrying traffic across it.
+ * SIP call state still comes from scripts/flow-monitor.py (sip.json).
  *===========================================================================*/
 
-static void protection_tick(void) {
-    int64_t now = now_us();
-    int64_t protect_elapsed_sec = (now - g_status.protect_start_us) / 1000000;
+static void flowmon_setup(void) {
+    flowmon_init(&g_flowmon);
+    if (!g_cfg->flowmon_enabled) return;
     
-    /* Update countdown displays */
-    g_status.hold_remaining_sec = g_config.min_hold_sec - protect_elapsed_sec;
-    if (g_status.hold_remaining_sec < 0) g_status.hold_remaining_sec = 0;
-    
-    /* Is current path clean? */
-    uplink_t* active = &g_uplinks[g_status.active_uplink];
-    bool is_clean = (active->consec_fail == 0 && 
-                     active->rtt_ms < active->rtt_baseline + 30 &&
-                     active->loss_pct < 2.0);
-    
-    if (is_clean) {
-        if (g_status.last_clean_us == 0) {
-            g_status.last_clean_us = now;
-        }
-        int64_t clean_sec = (now - g_status.last_clean_us) / 1000000;
-        g_status.clean_remaining_sec = g_config.clean_exit_sec - clean_sec;
-        if (g_status.clean_remaining_sec < 0) g_status.clean_remaining_sec = 0;
-        
-        /* Exit if hold passed AND clean enough */
-        if (protect_elapsed_sec >= g_config.min_hold_sec &&
-            clean_sec >= g_config.clean_exit_sec) {
-            
-            /* Exit protection */
-            if (g_status.mode != MODE_MIRROR) {
-                dup_disable();
-            }
-            
-            g_status.state = STATE_NORMAL;
-            g_status.last_trigger = TRIGGER_NONE;
-            
-            log_event("protection_exit", "{\"duration_sec\":%ld,\"clean_sec\":%ld}",
-                      protect_elapsed_sec, clean_sec);
-        }
+    if (flowmon_start(&g_flowmon, g_cfg->flowmon_netns, FLOWMON_FILE) == 0) {
+        g_flowmon_active = g_status.active_uplink;
+        log_event("flowmon", "{\"netns\":\"%s\",\"file\":\"%s\"}", g_cfg->flowmon_netns, FLOWMON_FILE);
     } else {
-        g_status.last_clean_us = 0;
-        g_status.clean_remaining_sec = g_config.clean_exit_sec;
+        log_event("flowmon_error", "{\"netns\":\"%s\",\"error\":\"%s\"}",
+                  g_cfg->flowmon_netns, strerror(errno));
     }
 }
 
+static void flowmon_observe(void) {
+    if (g_flowmon_active < 0 || (int)g_status.active_uplink == g_flowmon_active) return;
+    g_flowmon_active = g_status.active_uplink;
+    flowmon_failover(&g_flowmon);
+}
+
 /*=============================================================================
- * UPLINK POLLING
+ * RTP MONITOR
+ * 
+ * Per-SSRC loss, jitter and E-model MOS of the RTP crossing rtpmon_netns,
+ * in rtp.json (Web UI /api/rtp) and as rtp_stream_end events when a call
+ * ends. Switches and duplication windows are marked so every lost burst is
+ * blamed on one of them or on neither; each switch gets an rtp_switch event
+ * with what it cost the calls running across it.
  *===========================================================================*/
 
-static double probe_rtt(const char* netns, const char* target) {
-    char cmd[256];
-    char result[64];
+/* Monitor thread */
+static void rtpmon_on_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    log_event(type, "%s", json);
+}
+
+static void rtpmon_setup(void) {
+    rtpmon_init(&g_rtpmon);
+    if (!g_cfg->rtpmon_enabled) return;
     
-    if (netns && strlen(netns) > 0) {
-        snprintf(cmd, sizeof(cmd), 
-            "ip netns exec %s ping -c1 -W1 %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
-            netns, target);
+    if (rtpmon_start(&g_rtpmon, g_cfg->rtpmon_netns, RTPMON_FILE, rtpmon_on_event, NULL) == 0) {
+        g_rtpmon_active = g_status.active_uplink;
+        g_rtpmon_dup = g_status.dup_enabled;
+        log_event("rtpmon", "{\"netns\":\"%s\",\"file\":\"%s\"}", g_cfg->rtpmon_netns, RTPMON_FILE);
     } else {
-        snprintf(cmd, sizeof(cmd),
-            "ping -c1 -W1 %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
-            target);
-    }
-    
-    FILE* fp = popen(cmd, "r");
-    if (!fp) return -1.0;
-    
-    double rtt = -1.0;
-    if (fgets(result, sizeof(result), fp)) {
-        rtt = atof(result);
+        log_event("rtpmon_error", "{\"netns\":\"%s\",\"error\":\"%s\"}",
+                  g_cfg->rtpmon_netns, strerror(errno));
     }
-    pclose(fp);
-    return rtt;
 }
 
-/* Probe RTT through a specific interface */
-static double probe_rtt_iface(const char* iface, const char* target) {
-    char cmd[256];
-    char result[64];
-    
-    snprintf(cmd, sizeof(cmd),
-        "ping -c1 -W2 -I %s %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
-        iface, target);
-    
-    FILE* fp = popen(cmd, "r");
-    if (!fp) return -1.0;
+static void rtpmon_observe(void) {
+    if (g_rtpmon_active < 0) return;
     
-    double rtt = -1.0;
-    if (fgets(result, sizeof(result), fp)) {
-        rtt = atof(result);
+    if ((int)g_status.active_uplink != g_rtpmon_active) {
+        g_rtpmon_active = g_status.active_uplink;
+        rtpmon_mark(&g_rtpmon, RTPMON_SWITCH);
     }
-    pclose(fp);
-    return rtt;
+    if (g_status.dup_enabled != g_rtpmon_dup) {
+        g_rtpmon_dup = g_status.dup_enabled;
+        rtpmon_mark(&g_rtpmon, g_rtpmon_dup ? RTPMON_DUP_ON : RTPMON_DUP_OFF);
+    }
+    rtpmon_set_delay(&g_rtpmon, (int)(g_uplinks[g_rtpmon_active].rtt_ms / 2));
 }
 
-/* =============================================================================
- * CHAOS INJECTION READER
- * Reads /run/pathsteer/chaos.json and applies to uplink metrics for demos
- * =============================================================================*/
-static void chaos_read(void) {
-    FILE* fp = fopen("/run/pathsteer/chaos.json", "r");
-    if (!fp) return;
-    char buf[1024];
-    size_t n = fread(buf, 1, sizeof(buf)-1, fp);
-    buf[n] = 0;
-    fclose(fp);
-    
-    /* Reset all chaos values first */
-    for (int i = 0; i < UPLINK_COUNT; i++) {
-        g_uplinks[i].chaos_rtt = 0;
-        g_uplinks[i].chaos_jitter = 0;
-        g_uplinks[i].chaos_loss = 0;
-    }
+/*=============================================================================
+ * RETURN PATH
+ * 
+ * Every switch tells the controller to route the service prefix's return
+ * traffic down the new uplink: one authenticated datagram over each
+ * healthy tunnel, retransmitted until dedupe acks (retpath_ack, with the
+ * tunnel that got through and the RTT). A timeout or a failed apply falls
+ * back to the SSH script, started from the main loop unless a newer switch
+ * went out meanwhile. Off unless a key is provisioned (config.h).
+ *===========================================================================*/
 
-    /* Parse simple JSON - look for each uplink */
-    const char* names[] = {"cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"};
-    const char* internal[] = {"cell_a", "cell_b", "sl_a", "sl_b", "fiber1", "fiber2"};
-    for (int i = 0; i < UPLINK_COUNT; i++) {
-        char pattern[64];
-        snprintf(pattern, sizeof(pattern), "\"%s\"", names[i]);
-        char* p = strstr(buf, pattern);
-        if (p) {
-            char* rtt = strstr(p, "\"rtt\":");
-            char* jitter = strstr(p, "\"jitter\":");
-            char* loss = strstr(p, "\"loss\":");
-            if (rtt) g_uplinks[i].chaos_rtt = atof(rtt + 6);
-            if (jitter) g_uplinks[i].chaos_jitter = atof(jitter + 9);
-            if (loss) g_uplinks[i].chaos_loss = atof(loss + 7);
-        }
+/* Sender thread: the fallback is left to retpath_step(), which must not
+ * hold up retransmits of a newer switch */
+static void retpath_on_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    log_event(type, "%s", json);
+    if (strcmp(type, "retpath_timeout") == 0 || strcmp(type, "retpath_failed") == 0) {
+        char uplink[32];
+        if (json_get_string(json, "uplink", uplink, sizeof(uplink)) != 0) return;
+        int i = uplinkidx_name(&g_uplink_idx, uplink);
+        if (i < 0) return;
+        atomic_store(&g_retpath_fallback, atomic_load(&g_retpath.switches) << 8 | (uint64_t)(i + 1));
     }
 }
 
+/* controller-route-switch.sh, not waited for */
+static void retpath_fallback(const char* uplink) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), RETPATH_FALLBACK_SCRIPT " %s >/dev/null 2>&1 &", uplink);
+    int rc = system(cmd);
+    log_event("retpath_fallback", "{\"uplink\":\"%s\",\"rc\":%d}", uplink, rc);
+}
 
-static void uplink_poll(uplink_t* u) {
-    if (!u->enabled) return;
+/* Main loop: the fallback the sender asked for, unless a switch went out since */
+static void retpath_step(void) {
+    uint64_t want = atomic_exchange(&g_retpath_fallback, 0);
+    if (!want) return;
     
-    int64_t start = now_us();
-    double rtt;
-    if (u->type == UPLINK_TYPE_LTE) {
-        /* Cellular: ping WG peer through WG interface */
-        const char* wg_iface = (u->id == UPLINK_CELL_A) ? "wg-ca-cA" : "wg-cb-cA";
-        const char* wg_peer = (u->id == UPLINK_CELL_A) ? "10.200.1.1" : "10.200.2.1";
-        rtt = probe_rtt_iface(wg_iface, wg_peer);
-    } else {
-        rtt = probe_rtt(u->netns, "8.8.8.8");
-    }
-    
-    /* Record in history */
-    int idx = u->history_idx % HISTORY_SIZE;
-    u->history[idx].rtt_ms = rtt;
-    u->history[idx].success = (rtt > 0);
-    u->history[idx].timestamp_us = start;
-    u->history_idx++;
-    
-    /* Update metrics */
-    if (rtt > 0) {
-        u->rtt_ms = rtt;
-        /* Apply chaos injection */
-        u->rtt_ms += u->chaos_rtt + (u->chaos_jitter * ((double)rand()/RAND_MAX - 0.5) * 2);
-        if (!u->force_failed) u->available = true;
-        u->consec_fail = 0;
-        
-        /* Update baseline (slow EMA) */
-        if (u->rtt_baseline == 0) {
-            u->rtt_baseline = rtt;
+    int i = (int)(want & 0xff) - 1;
+    if (want >> 8 != atomic_load(&g_retpath.switches) || i != g_retpath_last) {
+        log_event("retpath_fallback", "{\"uplink\":\"%s\",\"status\":\"superseded\"}", g_uplinks[i].name);
+        return;
+    }
+    retpath_fallback(g_uplinks[i].name);
+}
+
+static void retpath_setup(void) {
+    retpath_client_init(&g_retpath);
+    if (!g_cfg->retpath_enabled) return;
+    
+    uint8_t key[RETPATH_KEY_LEN];
+    if (retpath_load_key(g_cfg->retpath_key_file, key) < 0) {
+        log_event("retpath_error", "{\"key_file\":\"%s\",\"error\":\"%s\"}",
+                  g_cfg->retpath_key_file, strerror(errno));
+        return;
+    }
+    for (int i = 0; i < g_uplink_count; i++) {
+        const char* target = g_cfg->uplinks[i].retpath_target;
+        g_retpath_path[i] = -1;
+        if (strlen(g_uplinks[i].name) > RETPATH_NAME_LEN) {
+            log_event("retpath_error", "{\"uplink\":\"%s\",\"error\":\"name over %d characters, switches to it use %s\"}",
+                      g_uplinks[i].name, RETPATH_NAME_LEN, RETPATH_FALLBACK_SCRIPT);
+        }
+        if (!target[0]) continue;
+        int path = g_retpath.npaths;
+        if (retpath_client_add_path(&g_retpath, g_uplinks[i].name, g_uplinks[i].netns, target) == 0) {
+            g_retpath_path[i] = path;
         } else {
-            u->rtt_baseline = u->rtt_baseline * 0.95 + rtt * 0.05;
+            log_event("retpath_error", "{\"uplink\":\"%s\",\"netns\":\"%s\",\"error\":\"%s\"}",
+                      g_uplinks[i].name, g_uplinks[i].netns, strerror(errno));
         }
+    }
+    if (retpath_client_start(&g_retpath, key, g_cfg->retpath_port, retpath_on_event, NULL) == 0) {
+        log_event("retpath", "{\"port\":%d}", g_cfg->retpath_port);
     } else {
-        u->consec_fail++;
-        if (u->consec_fail > 5) {
-            u->available = false;
-        }
+        log_event("retpath_error", "{\"error\":\"%s\"}", strerror(errno));
     }
+    memset(key, 0, sizeof(key));
+}
+
+static void ops_route_switch(void* ctx, uplink_id_t target) {
+    (void)ctx;
+    if (!g_cfg->retpath_enabled) return;
     
-    /* Calculate loss from history */
-    int success = 0, total = 0;
-    for (int i = 0; i < 20 && i < u->history_idx; i++) {
-        int hi = (u->history_idx - 1 - i) % HISTORY_SIZE;
-        total++;
-        if (u->history[hi].success) success++;
-    }
-    if (total > 0) {
-        u->loss_pct = 100.0 * (total - success) / total;
-        u->loss_pct += u->chaos_loss; if (u->loss_pct > 100.0) u->loss_pct = 100.0;  /* Add chaos injection */
-    /* DEBUG */ if (u->type == UPLINK_TYPE_STARLINK) { syslog(LOG_INFO, "SL %s: rtt=%.1f hidx=%d total=%d success=%d loss=%.1f", u->name, rtt, u->history_idx, total, success, u->loss_pct); }
+    /* Every tunnel that is up, the old and the new one included */
+    uint32_t mask = 0;
+    for (int i = 0; i < g_uplink_count; i++) {
+        if (g_retpath_path[i] >= 0 && g_uplinks[i].enabled && g_uplinks[i].available) {
+            mask |= 1u << g_retpath_path[i];
+        }
     }
+    if (!mask && g_retpath_path[target] >= 0) mask = 1u << g_retpath_path[target];
     
-    /* Poll type-specific data */
-    if (u->type == UPLINK_TYPE_LTE) {
-        cellular_poll(u);
-    } else if (u->type == UPLINK_TYPE_STARLINK) {
-        starlink_poll(u);
+    /* Not started (key) or a name the wire can't carry: the script, unwaited */
+    g_retpath_last = target;
+    if (retpath_switch(&g_retpath, g_uplinks[target].name, mask ? mask : (1u << g_retpath.npaths) - 1) < 0) {
+        retpath_fallback(g_uplinks[target].name);
     }
 }
 
 /*=============================================================================
- * CELLULAR POLLING (using mmcli)
+ * WATCHDOG
+ * 
+ * Every main loop phase against its budget (loop_overrun names the one that
+ * blew it), and a hard deadline on decisions from fresh probes. A hung
+ * ping, grpcurl or gpspipe leaves the tripwire blind; past
+ * watchdog_blind_ms (a ping counts only once past its own timeout,
+ * probe_run()) the watchdog thread duplicates the active uplink onto
+ * the standby the engine would pick itself. Once the loop has decided on
+ * fresh probes again that duplicate is dropped, unless the engine has
+ * since fired and owns duplication.
  *===========================================================================*/
 
-static void cellular_poll(uplink_t* u) {
-    static time_t last_poll_cell_a = 0;
-    static time_t last_poll_cell_b = 0;
-    time_t now = time(NULL);
-    time_t* last_poll;
+/* Watchdog thread (loop_overrun: loop thread) */
+static void watchdog_on_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    log_event(type, "%s", json);
+}
+
+/* Watchdog thread: the loop is stuck, possibly inside the engine */
+static void watchdog_on_blind(void* ctx, wd_phase_t phase, int64_t blind_us) {
+    (void)ctx;
+    int pair = atomic_load(&g_wd_pair);
+    if (pair < 0) return;
+    int src = pair >> 8, dst = pair & 0xff;
+    if (dst == src) return;
+    
+    /* dup_enabled only changes under g_dup_lock: checked and set in one hold,
+     * so the engine can't enable in between and have its filter replaced */
+    pthread_mutex_lock(&g_dup_lock);
+    bool covered = g_status.dup_enabled;
+    if (!covered) {
+        dup_enable_locked(g_uplinks[src].veth, g_uplinks[dst].veth);
+        atomic_store(&g_wd_dup, true);
+    }
+    pthread_mutex_unlock(&g_dup_lock);
+    if (covered) return;
+    
+    log_event("watchdog_dup", "{\"phase\":\"%s\",\"blind_ms\":%.1f,\"src\":\"%s\",\"dst\":\"%s\"}",
+              phase == WD_IDLE ? "idle" : WD_PHASE_NAMES[phase], blind_us / 1000.0,
+              g_uplinks[src].name, g_uplinks[dst].name);
+}
+
+static void watchdog_setup(void) {
+    watchdog_init(&g_watchdog);
+    if (!g_cfg->watchdog_enabled) return;
+    
+    if (watchdog_start(&g_watchdog, g_cfg->watchdog_blind_ms, watchdog_on_event, watchdog_on_blind, NULL) == 0) {
+        log_event("watchdog", "{\"blind_ms\":%d}", g_cfg->watchdog_blind_ms);
+    } else {
+        log_event("watchdog_error", "{\"error\":\"%s\"}", strerror(errno));
+    }
+}
+
+/* After engine_step(); probed: on a fresh probe round */
+static void watchdog_observe(bool probed) {
+    if (!probed) return;
+    
+    uplink_id_t active = g_status.active_uplink;
+    atomic_store(&g_wd_pair, (int)active << 8 | (int)engine_pick_secondary(&g_engine, active));
+    watchdog_fresh(&g_watchdog);
+    
+    if (!watchdog_recovered(&g_watchdog) || !atomic_load(&g_wd_dup)) return;
+    
+    /* The engine has seen the same probes: if it fired, the duplicate is its now */
+    bool release = g_dup_target < 0 && g_status.state == STATE_NORMAL && g_status.mode != MODE_MIRROR;
+    if (release) {
+        dup_disable();
+    } else {
+        atomic_store(&g_wd_dup, false);
+    }
+    log_event("watchdog_release", "{\"kept\":%s}", release ? "false" : "true");
+}
+
+/*=============================================================================
+ * DECISION ENGINE
+ * 
+ * Tripwire, slow-path switching, protection exit and the model tick live in
+ * engine.c behind engine_ops_t, so pathsteer-replay can drive the same code
+ * from recorded traces. Here they get the wall clock, tc, the JSONL log, the
+ * correlation map and online learning.
+ *===========================================================================*/
+
+static int64_t ops_now_us(void* ctx) {
+    (void)ctx;
+    return now_us();
+}
+
+static void ops_log_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    if (strcmp(type, "tripwire_fire") == 0) {
+        g_fires[g_status.last_trigger]++;
+        lat_fire();
+    }
+    if (strcmp(type, "tripwire_fire") == 0 || strcmp(type, "switch") == 0) {
+        flightrec_trigger(&g_flightrec, type);
+    }
+    shadow_score_event(&g_live_score, type);
+    log_event(type, "%s", json);
+}
+
+static void ops_dup_enable(void* ctx, uplink_id_t src, uplink_id_t dst) {
+    (void)ctx;
+    g_fire_dup_start_us = now_us();
+    dup_enable(g_uplinks[src].veth, g_uplinks[dst].veth);
+    g_fire_dup_done_us = now_us();
+    g_fire_src = src;
+    g_dup_target = dst;
+}
+
+static void ops_dup_disable(void* ctx) {
+    (void)ctx;
+    dup_disable();
+}
+
+static double ops_corr(void* ctx, int a, int b, double prior) {
+    (void)ctx;
+    uint64_t key = gps_fresh() ? corrmap_key(g_gps.latitude, g_gps.longitude) : 0;
+    return corrmap_cond(&g_corrmap, key, a, b, prior);
+}
+
+static void ops_learn(void* ctx, const uplink_t* u, int i, const float* x, int64_t now) {
+    (void)ctx;
+    model_learn(u, i, x, now);
+}
+
+static const engine_ops_t g_engine_ops = {
+    .now_us = ops_now_us,
+    .log_event = ops_log_event,
+    .dup_enable = ops_dup_enable,
+    .dup_disable = ops_dup_disable,
+    .corr = ops_corr,
+    .learn = ops_learn,
+    .route_switch = ops_route_switch,
+};
+
+/* Model pointer is set by model_init() / model_reload() */
+static void engine_setup(void) {
+    g_engine.ops = &g_engine_ops;
+    g_engine.ctx = NULL;
+    g_engine.cfg = g_cfg;
+    g_engine.uplinks = g_uplinks;
+    g_engine.n_uplinks = g_uplink_count;
+    g_engine.status = &g_status;
+    g_engine.gps = &g_gps;
+}
+
+/*=============================================================================
+ * SHADOW POLICIES
+ * 
+ * Candidate policies from config "shadow_policies" (config files, only the
+ * decision keys and "model_file" are read) run next to the live one on the
+ * same metrics, logging "shadow" events instead of actuating. In TRAINING
+ * the live thresholds run as a TRIPWIRE shadow, so the would-do stream
+ * covers the tripwire and protection exits, not just the predictor.
+ * Scores of all of them, live included, go to status.json and to a
+ * periodic "shadow_summary" event. See shadow.h.
+ *===========================================================================*/
+
+static shadow_t* shadow_open(const char* name, const char* json, op_mode_t mode) {
+    shadow_t* sh = malloc(sizeof(shadow_t));
+    if (!sh) return NULL;
+    if (shadow_init(sh, name, &g_engine, json, mode) != 0) {
+        free(sh);
+        return NULL;
+    }
+    log_event("shadow_start", "{\"policy\":\"%s\",\"mode\":\"%s\",\"model\":\"%s\","
+              "\"rtt_step_ms\":%d,\"probe_miss_count\":%d,\"preroll_ms\":%d,"
+              "\"min_hold_sec\":%d,\"clean_exit_sec\":%d,\"predict_lead_sec\":%d}",
+              sh->name, MODE_NAMES[mode], sh->model ? sh->model->source : "live",
+              sh->cfg.rtt_step_ms, sh->cfg.probe_miss_count, sh->cfg.preroll_ms,
+              sh->cfg.min_hold_sec, sh->cfg.clean_exit_sec, sh->cfg.predict_lead_sec);
+    return sh;
+}
+
+static void shadow_close(shadow_t* sh) {
+    shadow_free(sh);
+    free(sh);
+}
+
+/* After engine_setup() and model_init() */
+static void shadows_init(void) {
+    for (int i = 0; i < g_shadow_file_count; i++) {
+        const char* path = g_shadow_files[i];
+        FILE* f = fopen(path, "r");
+        if (!f) {
+            log_event("shadow_start", "{\"file\":\"%s\",\"status\":\"open_failed\"}", path);
+            continue;
+        }
+        char json[8192];
+        size_t len = fread(json, 1, sizeof(json) - 1, f);
+        json[len] = '\0';
+        fclose(f);
+
+        /* Policy name: file name without directory and .json */
+        char name[32];
+        const char* base = strrchr(path, '/');
+        snprintf(name, sizeof(name), "%.31s", base ? base + 1 : path);
+        char* dot = strrchr(name, '.');
+        if (dot && dot != name) *dot = '\0';
+
+        /* Keys of status.json "policies": the live policy and the TRAINING shadow */
+        bool clash = strcmp(name, "live") == 0 || strcmp(name, SHADOW_TRAINING_NAME) == 0;
+        for (int k = 0; k < g_shadow_count && !clash; k++) clash = strcmp(name, g_shadows[k]->name) == 0;
+        if (clash) {
+            log_event("shadow_start", "{\"file\":\"%s\",\"status\":\"name_taken\",\"name\":\"%s\"}",
+                      path, name);
+            continue;
+        }
+
+        char err[160];
+        if (json_validate(json, err, sizeof(err)) != 0 || engine_config_check(json, err, sizeof(err)) != 0) {
+            log_event("shadow_start", "{\"file\":\"%s\",\"status\":\"invalid\",\"error\":\"%s\"}",
+                      path, err);
+            continue;
+        }
+
+        char mode[16] = "";
+        json_get_string(json, "mode", mode, sizeof(mode));
+        shadow_t* sh = shadow_open(name, json, strcmp(mode, "mirror") == 0 ? MODE_MIRROR : MODE_TRIPWIRE);
+        if (!sh) {
+            log_event("shadow_start", "{\"file\":\"%s\",\"status\":\"model_failed\"}", path);
+            continue;
+        }
+        g_shadows[g_shadow_count++] = sh;
+    }
+}
+
+static void shadow_training(bool on) {
+    if (on && !g_training_shadow) {
+        g_training_shadow = shadow_open(SHADOW_TRAINING_NAME, "{}", MODE_TRIPWIRE);
+    } else if (!on && g_training_shadow) {
+        shadow_close(g_training_shadow);
+        g_training_shadow = NULL;
+    }
+}
+
+/* {"live":{...},"<policy>":{...},...} */
+static void shadow_scores_json(char* out, size_t len) {
+    char one[512];
+    size_t n = 0;
+
+    shadow_score_json(&g_live_score, &g_status, g_uplinks, one, sizeof(one));
+    n += snprintf(out + n, len - n, "{\"live\":%s", one);
+
+    shadow_t* all[SHADOW_MAX + 1];
+    int count = 0;
+    for (int i = 0; i < g_shadow_count; i++) all[count++] = g_shadows[i];
+    if (g_training_shadow) all[count++] = g_training_shadow;
+
+    for (int i = 0; i < count && n < len; i++) {
+        shadow_score_json(&all[i]->score, &all[i]->status, all[i]->uplinks, one, sizeof(one));
+        n += snprintf(out + n, len - n, ",\"%s\":%s", all[i]->name, one);
+    }
+    if (n < len) snprintf(out + n, len - n, "}");
+}
+
+static void shadows_step(int64_t now) {
+    for (int i = 0; i < g_shadow_count; i++) shadow_step(g_shadows[i]);
+    if (g_training_shadow) shadow_step(g_training_shadow);
+
+    shadow_score_tick(&g_live_score, &g_status, g_uplinks,
+                      g_status.dup_enabled ? g_dup_target : -1, now);
+}
+
+static void shadows_report(const char* type) {
+    if (g_shadow_count == 0 && !g_training_shadow) return;
+
+    char json[4096];
+    shadow_scores_json(json, sizeof(json));
+    log_event(type, "%s", json);
+}
+
+/*=============================================================================
+ * UPLINK POLLING
+ *===========================================================================*/
+
+/* A ping's -W, plus fork, ip netns exec and the pipe: past that it hangs */
+#define PROBE_TIMEOUT_S         1
+#define PROBE_IFACE_TIMEOUT_S   2
+#define PROBE_EXEC_MARGIN_MS    500
+
+/* One ping's output through popen(), a bounded wait for the watchdog */
+static double probe_run(const char* cmd, int timeout_s) {
+    char result[64];
+    
+    watchdog_wait(&g_watchdog, (timeout_s * 1000LL + PROBE_EXEC_MARGIN_MS) * 1000);
+    FILE* fp = popen(cmd, "r");
+    double rtt = -1.0;
+    if (fp) {
+        if (fgets(result, sizeof(result), fp)) {
+            rtt = atof(result);
+        }
+        pclose(fp);
+    }
+    watchdog_wait(&g_watchdog, 0);
+    return rtt;
+}
+
+static double probe_rtt(const char* netns, const char* target) {
+    char cmd[256];
     
-    /* Rate limit: poll every 1 second - safe with persistent CID */
-    if (u->id == UPLINK_CELL_A) {
-        last_poll = &last_poll_cell_a;
+    if (netns && strlen(netns) > 0) {
+        snprintf(cmd, sizeof(cmd), 
+            "ip netns exec %s ping -c1 -W%d %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
+            netns, PROBE_TIMEOUT_S, target);
     } else {
-        last_poll = &last_poll_cell_b;
+        snprintf(cmd, sizeof(cmd),
+            "ping -c1 -W%d %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
+            PROBE_TIMEOUT_S, target);
     }
+    return probe_run(cmd, PROBE_TIMEOUT_S);
+}
+
+/* Probe RTT through a specific interface */
+static double probe_rtt_iface(const char* iface, const char* target) {
+    char cmd[256];
     
-    if (now - *last_poll < 5) {
+    snprintf(cmd, sizeof(cmd),
+        "ping -c1 -W%d -I %s %s 2>/dev/null | grep 'time=' | sed 's/.*time=\\([0-9.]*\\).*/\\1/'",
+        PROBE_IFACE_TIMEOUT_S, iface, target);
+    return probe_run(cmd, PROBE_IFACE_TIMEOUT_S);
+}
+
+/* =============================================================================
+ * CHAOS INJECTION READER
+ * Reads /run/pathsteer/chaos.json and applies to uplink metrics for demos.
+ * Called once per probe round; the file is only parsed when it changes.
+ * For real impairment on a real datapath see pathsteer-emu (bench lab).
+ * =============================================================================*/
+static void chaos_read(void) {
+    static struct timespec mtime;
+    static off_t size = -1;
+    struct stat st;
+    
+    if (stat("/run/pathsteer/chaos.json", &st) != 0) {
+        st.st_size = -1;
+        st.st_mtim.tv_sec = st.st_mtim.tv_nsec = 0;
+    }
+    if (st.st_size == size && st.st_mtim.tv_sec == mtime.tv_sec &&
+        st.st_mtim.tv_nsec == mtime.tv_nsec) {
+        return;
+    }
+    size = st.st_size;
+    mtime = st.st_mtim;
+    
+    /* Reset all chaos values first (also when the file is removed) */
+    for (int i = 0; i < g_uplink_count; i++) {
+        g_uplinks[i].chaos_rtt = 0;
+        g_uplinks[i].chaos_jitter = 0;
+        g_uplinks[i].chaos_loss = 0;
+    }
+    
+    FILE* fp = fopen("/run/pathsteer/chaos.json", "r");
+    if (!fp) return;
+    char buf[4096], err[160];
+    size_t n = fread(buf, 1, sizeof(buf)-1, fp);
+    buf[n] = 0;
+    fclose(fp);
+    if (json_validate(buf, err, sizeof(err)) != 0) {
+        log_event("chaos", "{\"status\":\"invalid\",\"error\":\"%s\"}", err);
+        return;
+    }
+
+    /* {"fa": {"rtt": 50, "jitter": 10, "loss": 5}, ...}: fields from each uplink's own object */
+    for (int i = 0; i < g_uplink_count; i++) {
+        const char* v = json_find(buf, g_uplinks[i].name);
+        if (!v || *v != '{') continue;
+        g_uplinks[i].chaos_rtt = json_get_double(v, "rtt", 0);
+        g_uplinks[i].chaos_jitter = json_get_double(v, "jitter", 0);
+        g_uplinks[i].chaos_loss = json_get_double(v, "loss", 0);
+    }
+}
+
+static void uplink_poll(uplink_t* u) {
+    if (!u->enabled) return;
+    
+    int64_t start = now_us();
+    hdr_record(&g_lat[LAT_PROBE_WAIT], start - g_probe_round_us);
+    double rtt;
+    if (u->wg[0]) {
+        /* Cellular: ping WG peer through WG interface */
+        rtt = probe_rtt_iface(u->wg, u->probe_target);
+    } else {
+        rtt = probe_rtt(u->netns, u->probe_target);
+    }
+    
+    int64_t got = now_us();
+    hdr_record(&g_lat[LAT_PROBE], got - start);
+    
+    /* History, baseline, loss, jitter - shared with replay */
+    engine_probe(u, rtt, start);
+    g_probe_start_us[u->id] = start;
+    g_probe_done_us[u->id] = now_us();
+    hdr_record(&g_lat[LAT_METRIC_UPDATE], g_probe_done_us[u->id] - got);
+    
+    /* Poll type-specific data */
+    if (u->type == UPLINK_TYPE_LTE) {
+        cellular_poll(u);
+        cell_info_poll(u);
+    } else if (u->type == UPLINK_TYPE_STARLINK) {
+        starlink_poll(u);
+    }
+}
+
+/*=============================================================================
+ * CELLULAR POLLING (using mmcli)
+ *===========================================================================*/
+
+static void cellular_poll(uplink_t* u) {
+    int64_t now = now_us();
+    
+    /* Rate limit: poll every 5 seconds - safe with persistent CID */
+    if (now - u->cellular.signal_poll_us < 5000000) {
         return;  /* Too soon, skip */
     }
-    *last_poll = now;
+    u->cellular.signal_poll_us = now;
     
     char cmd[512], line[512];
-    const char* name = (u->id == UPLINK_CELL_A) ? "cell_a" : "cell_b";
-    int dev_num = (u->id == UPLINK_CELL_A) ? 0 : 1;
+    double prev_rsrp = u->cellular.rsrp;
+    double prev_sinr = u->cellular.sinr;
+    int64_t prev_ts = u->cellular.timestamp_us;
     
     /* Use persistent client script to avoid CID exhaustion */
     snprintf(cmd, sizeof(cmd),
         "/opt/pathsteer/scripts/cellular-monitor.sh poll %d %s 2>/dev/null",
-        dev_num, name);
+        u->modem, u->name);
     FILE* fp = popen(cmd, "r");
     if (!fp) return;
     int in_rsrp = 0;
@@ -1152,7 +1383,51 @@ static void cellular_poll(uplink_t* u) {
         }
     }
     pclose(fp);
-    u->cellular.timestamp_us = now_us();
+
+    /* Signal trends (dB/s) for the risk model */
+    int64_t ts = now_us();
+    if (prev_ts > 0 && prev_rsrp != 0 && u->cellular.rsrp != 0) {
+        double dt = (ts - prev_ts) / 1e6;
+        u->cellular.rsrp_trend = 0.5 * u->cellular.rsrp_trend + 0.5 * (u->cellular.rsrp - prev_rsrp) / dt;
+        u->cellular.sinr_trend = 0.5 * u->cellular.sinr_trend + 0.5 * (u->cellular.sinr - prev_sinr) / dt;
+    }
+    u->cellular.timestamp_us = ts;
+}
+
+/*
+ * Serving + neighbour cells for handover prediction. Polled every second
+ * while moving - the margin trend needs that resolution - and rarely when
+ * parked.
+ */
+static void cell_info_poll(uplink_t* u) {
+    cellular_t* c = &u->cellular;
+    int64_t now = now_us();
+    int interval_ms = g_gps.speed_mps >= TRAJ_MIN_SPEED_MPS ? HO_POLL_MOVING_MS : HO_POLL_IDLE_MS;
+    
+    if (now - c->info_poll_us < interval_ms * 1000LL) return;
+    int64_t since = c->info_poll_us;
+    c->info_poll_us = now;
+    
+    char cmd[256], line[256];
+    snprintf(cmd, sizeof(cmd),
+        "/opt/pathsteer/scripts/cellular-monitor.sh cell %d 2>/dev/null", u->modem);
+    
+    FILE* fp = popen(cmd, "r");
+    if (!fp) return;
+    ho_snapshot_t snap;
+    ho_snapshot_reset(&snap);
+    while (fgets(line, sizeof(line), fp)) {
+        ho_parse_line(&snap, line);
+    }
+    pclose(fp);
+    if (!snap.valid) return;
+    
+    bool changed = ho_update(&c->ho, &snap, now_us());
+    snprintf(c->cell_id, sizeof(c->cell_id), "%s", snap.cell_id);
+    snprintf(c->tac, sizeof(c->tac), "%s", snap.tac);
+    snprintf(c->band, sizeof(c->band), "B%d", snap.band);
+    
+    handover_observe(u, changed, since);
 }
 /*=============================================================================
  * STARLINK POLLING (HTTP API)
@@ -1177,9 +1452,9 @@ static void starlink_poll(uplink_t* u) {
     char cmd[256];
     char buf[2048];
     
-    /* Use gRPC script - ns_sl_a or ns_sl_b, dish IP */
-    const char* ns = u->id == UPLINK_SL_A ? "ns_sl_a" : "ns_sl_b";
-    const char* dish_ip = "192.168.100.1";  /* Same for both, accessed from different ns */
+    /* Use gRPC script - the uplink's namespace, dish IP */
+    const char* ns = u->netns;
+    const char* dish_ip = u->dish;      /* Usually the same for all, accessed from different ns */
     
     snprintf(cmd, sizeof(cmd), 
         "/opt/pathsteer/scripts/starlink-stats.sh %s %s 2>/dev/null", ns, dish_ip);
@@ -1215,6 +1490,11 @@ static void starlink_poll(uplink_t* u) {
         u->starlink.obstructed = (frac > 0.10);
         u->starlink.obstruction_pct = frac * 100.0;
     }
+    if ((p = strstr(buf, "\"currently_obstructed\":")) != NULL) {
+        p += 23;
+        while (*p == ' ') p++;
+        u->starlink.obstructed = (strncmp(p, "true", 4) == 0);
+    }
     if ((p = strstr(buf, "\"snr_ok\":")) != NULL) {
         u->starlink.online = (strstr(p, "true") != NULL);
     }
@@ -1227,10 +1507,34 @@ static void starlink_poll(uplink_t* u) {
     
     strcpy(u->starlink.state, u->starlink.online ? "CONNECTED" : "SEARCHING");
     u->starlink.timestamp_us = now_us();
+    
+    /* Obstruction map changes slowly - fetch it once a minute */
+    if (u->starlink.timestamp_us - u->starlink.map_poll_us >= STARLINK_MAP_INTERVAL_SEC * 1000000LL) {
+        u->starlink.map_poll_us = u->starlink.timestamp_us;
+        snprintf(cmd, sizeof(cmd),
+            "/opt/pathsteer/scripts/starlink-stats.sh %s %s map 2>/dev/null", ns, dish_ip);
+        fp = popen(cmd, "r");
+        if (fp) {
+            total = 0;
+            while ((n = fread(buf + total, 1, sizeof(buf) - total - 1, fp)) > 0) {
+                total += n;
+            }
+            buf[total] = '\0';
+            pclose(fp);
+            
+            if (total > 0 && !strstr(buf, "error") &&
+                skymap_merge(&u->starlink.sky, buf, g_gps.heading, u->starlink.timestamp_us) == 0) {
+                log_event("starlink_map", "{\"uplink\":\"%s\",\"maps\":%d}",
+                          u->name, u->starlink.sky.maps);
+            }
+        }
+    }
+    
+    starlink_forecast(u);
 }
 
 static void gps_poll(void) {
-    if (!g_config.gps_enabled) return;
+    if (!g_cfg->gps_enabled) return;
     
     FILE* fp = popen("gpspipe -w -n 1 2>/dev/null | grep -m1 TPV", "r");
     if (!fp) return;
@@ -1253,54 +1557,705 @@ static void gps_poll(void) {
 }
 
 /*=============================================================================
- * PREDICTION ENGINE
+ * RISK INDEX
+ * 
+ * Learned risk per (tile, heading sector, uplink), see riskmap.h.
+ * - Loaded from risk_zones in the training DB at startup
+ * - Looked up on every GPS fix -> uplink risk_ahead / confidence
+ * - Updated at prediction rate from what the uplinks actually did here
+ * - Dirty tiles flushed back to the DB once a minute
  *===========================================================================*/
 
-static void prediction_tick(void) {
-    double max_risk = 0;
+static void risk_index_names(const char** names) {
+    static char slot_names[2 * MAX_UPLINKS][48];
     
-    for (int i = 0; i < UPLINK_COUNT; i++) {
+    for (int i = 0; i < RISK_SLOT_COUNT; i++) names[i] = NULL;
+    for (int i = 0; i < g_uplink_count; i++) {
+        names[i] = g_uplinks[i].name;
+        if (g_uplinks[i].type != UPLINK_TYPE_LTE) continue;
+        
+        snprintf(slot_names[i], sizeof(slot_names[0]), "%.31s_ho", g_uplinks[i].name);
+        snprintf(slot_names[MAX_UPLINKS + i], sizeof(slot_names[0]), "%.31s_hogap", g_uplinks[i].name);
+        names[RISK_SLOT_HO + i] = slot_names[i];
+        names[RISK_SLOT_GAP + i] = slot_names[MAX_UPLINKS + i];
+    }
+}
+
+static void risk_index_init(void) {
+    if (riskmap_init(&g_riskmap, RISKMAP_CAPACITY) != 0) {
+        log_event("risk_index", "{\"status\":\"alloc_failed\"}");
+        return;
+    }
+    if (corrmap_init(&g_corrmap, CORRMAP_CAPACITY) != 0) {
+        log_event("risk_index", "{\"status\":\"corr_alloc_failed\"}");
+    }
+    
+    if (sqlite3_open_v2(g_cfg->training_db, &g_db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        log_event("risk_index", "{\"status\":\"db_open_failed\",\"db\":\"%s\"}",
+                  g_cfg->training_db);
+        sqlite3_close(g_db);
+        g_db = NULL;
+        return;
+    }
+    /* Web UI and training scripts share this DB - don't stall on their locks */
+    sqlite3_busy_timeout(g_db, 50);
+    riskmap_db_init(g_db);
+    corrmap_db_init(g_db);
+    
+    const char* names[RISK_SLOT_COUNT];
+    risk_index_names(names);
+    int loaded = riskmap_load(&g_riskmap, g_db, names, RISK_SLOT_COUNT);
+    if (g_corrmap.slots) corrmap_load(&g_corrmap, g_db, names, g_uplink_count);
+    
+    log_event("risk_index", "{\"status\":\"ready\",\"tiles\":%d,\"db\":\"%s\"}",
+              loaded, g_cfg->training_db);
+}
+
+static bool gps_fresh(void) {
+    return g_gps.valid && (now_us() - g_gps.timestamp_us) < GPS_STALE_MS * 1000LL;
+}
+
+/*
+ * What the uplink actually did - from raw metrics, NOT risk_now, so the map
+ * learns outcomes rather than echoing its own predictions back.
+ */
+static double observed_risk(const uplink_t* u) {
+    if (!u->available || u->consec_fail >= g_cfg->probe_miss_count) return 1.0;
+    
+    double r = 0;
+    if (u->loss_pct > 20) r = 0.7;
+    else if (u->loss_pct > 5) r = 0.4;
+    
+    if (u->rtt_baseline > 0 && u->rtt_ms - u->rtt_baseline >= g_cfg->rtt_step_ms && r < 0.5) {
+        r = 0.5;
+    }
+    return r;
+}
+
+static void risk_index_observe(void) {
+    if (!gps_fresh()) return;
+    
+    uint32_t now_s = (uint32_t)time(NULL);
+    for (int i = 0; i < g_uplink_count; i++) {
         uplink_t* u = &g_uplinks[i];
-        if (!u->enabled) continue;
+        if (!u->enabled || u->history_idx == 0) continue;
         
-        /* Calculate risk_now based on current metrics */
-        u->risk_now = 0;
+        /* Operator-forced failures and chaos injection are not the road */
+        if (u->force_failed || u->chaos_rtt != 0 || u->chaos_loss != 0) continue;
         
-        if (u->rtt_ms > u->rtt_baseline * 1.5) u->risk_now += 0.3;
-        if (u->loss_pct > 50) u->risk_now += 0.5; else if (u->loss_pct > 20) u->risk_now += 0.4; else if (u->loss_pct > 5) u->risk_now += 0.3;
-        if (u->consec_fail > 0) u->risk_now += 0.2 * (u->consec_fail > 5 ? 5 : u->consec_fail);
+        uint64_t key = riskmap_key(g_gps.latitude, g_gps.longitude, g_gps.heading, i);
+        riskmap_update(&g_riskmap, key, observed_risk(u), now_s);
+    }
+}
+
+static void risk_index_flush(void) {
+    if (!g_db) return;
+    
+    const char* names[RISK_SLOT_COUNT];
+    risk_index_names(names);
+    int written = riskmap_flush(&g_riskmap, g_db, names, RISK_SLOT_COUNT);
+    if (written > 0) {
+        log_event("risk_flush", "{\"tiles\":%d,\"total\":%u,\"full_drops\":%u}",
+                  written, g_riskmap.count, g_riskmap.full_drops);
+    }
+    if (g_corrmap.slots) corrmap_flush(&g_corrmap, g_db, names, g_uplink_count);
+}
+
+/*=============================================================================
+ * FAILURE CORRELATION
+ * 
+ * Every prediction tick is one observation window: which uplinks failed
+ * (probe miss or RTT step) since the last one. corrmap.h turns that into a
+ * rolling P(b fails | a fails) per location tile. Secondary selection in
+ * engine.c uses it so the duplicate copy rides a path that doesn't share the active one's
+ * coverage hole.
+ *===========================================================================*/
+
+/* Did u miss a probe or step its RTT during (from, to]? */
+static bool window_failed(const uplink_t* u, int64_t from, int64_t to) {
+    int n = u->history_idx < HISTORY_SIZE ? u->history_idx : HISTORY_SIZE;
+    
+    for (int k = 0; k < n; k++) {
+        const probe_t* pr = &u->history[(u->history_idx - 1 - k) % HISTORY_SIZE];
+        if (pr->timestamp_us <= from) break;
+        if (pr->timestamp_us > to) continue;
+        if (!pr->success) return true;
+        if (u->rtt_baseline > 0 && pr->rtt_ms - u->rtt_baseline >= g_cfg->rtt_step_ms) return true;
+    }
+    return false;
+}
+
+static void corr_observe(void) {
+    int64_t now = now_us();
+    int64_t from = g_corr_last_us;
+    g_corr_last_us = now;
+    if (from == 0) return;
+    
+    uint32_t mask = 0;
+    for (int i = 0; i < g_uplink_count; i++) {
+        uplink_t* u = &g_uplinks[i];
+        if (!u->enabled || u->history_idx == 0) continue;
+        /* Injected failures correlate with whatever the operator chose */
+        if (u->force_failed || u->chaos_rtt != 0 || u->chaos_loss != 0) continue;
+        if (window_failed(u, from, now)) mask |= 1u << i;
+    }
+    
+    uint64_t key = gps_fresh() ? corrmap_key(g_gps.latitude, g_gps.longitude) : 0;
+    corrmap_observe(&g_corrmap, key, mask, (uint32_t)time(NULL));
+}
+
+/*=============================================================================
+ * HANDOVER PREDICTION
+ * 
+ * Two signals that a handover gap is coming on a modem:
+ *   - margin: best neighbour RSRP closing on the serving cell's, extrapolated
+ *     (handover.h) to when it clears the A3 offset
+ *   - place: handovers keep happening at the same spots on a road; the risk
+ *     index learns per tile and heading how likely one is and how long the
+ *     gap was (RISK_SLOT_HO / RISK_SLOT_GAP + uplink)
+ * Either one on the active modem raises TRIGGER_PREDICTED (engine.c), once
+ * per approach, unless this place has taught us its handovers are seamless.
+ *===========================================================================*/
+
+/* Longest run of failed probes on u during (from, to], in ms */
+static double handover_gap_ms(const uplink_t* u, int64_t from, int64_t to) {
+    int n = u->history_idx < HISTORY_SIZE ? u->history_idx : HISTORY_SIZE;
+    int64_t run_start = 0, longest = 0;
+    
+    for (int k = n - 1; k >= 0; k--) {
+        const probe_t* pr = &u->history[(u->history_idx - 1 - k) % HISTORY_SIZE];
+        if (pr->timestamp_us <= from || pr->timestamp_us > to) continue;
+        if (pr->success) {
+            run_start = 0;
+            continue;
+        }
+        if (run_start == 0) run_start = pr->timestamp_us;
+        int64_t span = pr->timestamp_us - run_start + PROBE_INTERVAL_MS * 1000LL;
+        if (span > longest) longest = span;
+    }
+    return longest / 1000.0;
+}
+
+static void handover_observe(uplink_t* u, bool changed, int64_t since_us) {
+    cellular_t* c = &u->cellular;
+    int64_t now = now_us();
+    
+    c->ho_eta = ho_eta(&c->ho, g_cfg->ho_hyst_db, now);
+    
+    if (changed) {
+        /* The gap straddles the change; look back one extra second */
+        double gap = handover_gap_ms(u, since_us - 1000000, now);
+        c->ho_fired = false;
+        c->ho_tile_hit = true;
+        log_event("handover", "{\"uplink\":\"%s\",\"from_cell\":\"%s\",\"from_pci\":%u,\"to_cell\":\"%s\",\"to_pci\":%u,\"band\":\"%s\",\"gap_ms\":%.0f,\"lat\":%.6f,\"lon\":%.6f,\"heading\":%.0f}",
+                  u->name, c->ho.prev_cell_id, c->ho.prev_pci, c->cell_id, c->ho.cur.pci,
+                  c->band, gap, g_gps.latitude, g_gps.longitude, g_gps.heading);
         
-        if (u->type == UPLINK_TYPE_STARLINK) {
-            u->risk_now += u->starlink.obstruction_pct * 0.01;  /* 10% obstruction = 0.1 risk */
+        if (gps_fresh() && !u->force_failed && u->chaos_rtt == 0 && u->chaos_loss == 0) {
+            uint64_t gk = riskmap_key(g_gps.latitude, g_gps.longitude, g_gps.heading,
+                                      RISK_SLOT_GAP + u->id);
+            riskmap_update(&g_riskmap, gk, gap / HO_GAP_SCALE_MS, (uint32_t)time(NULL));
         }
+    }
+    
+    c->ho_prob = 0;
+    c->ho_gap_ms = -1;
+    if (!gps_fresh()) return;
+    
+    /* Likelihood is per tile crossing: credit the tile when we leave it */
+    uint64_t key = riskmap_key(g_gps.latitude, g_gps.longitude, g_gps.heading,
+                               RISK_SLOT_HO + u->id);
+    if (key != c->ho_tile_key) {
+        if (c->ho_tile_key != 0 && g_gps.speed_mps >= TRAJ_MIN_SPEED_MPS) {
+            riskmap_update(&g_riskmap, c->ho_tile_key, c->ho_tile_hit ? 1.0 : 0.0, (uint32_t)time(NULL));
+        }
+        c->ho_tile_key = key;
+        c->ho_tile_hit = false;
+    }
+    
+    /* What this place has taught us */
+    const riskmap_entry_t* e = riskmap_lookup(&g_riskmap, key);
+    if (e && riskmap_confidence(e) >= g_cfg->predict_min_conf) {
+        c->ho_prob = e->risk;
+    }
+    e = riskmap_lookup(&g_riskmap, riskmap_key(g_gps.latitude, g_gps.longitude, g_gps.heading,
+                                               RISK_SLOT_GAP + u->id));
+    if (e) c->ho_gap_ms = e->risk * HO_GAP_SCALE_MS;
+}
+
+/*=============================================================================
+ * RISK MODEL
+ *
+ * risk_now comes from a logistic model over per-uplink features (model.h).
+ *
+ * Labels: every feature snapshot waits MODEL_LABEL_MS, then gets y=1 if the
+ * tripwire would have fired on that uplink in the meantime (probe-miss run
+ * or RTT step in the history ring). Each labelled snapshot is one online
+ * SGD step, and is kept (all positives, 1 in MODEL_NEG_KEEP negatives) for
+ * the offline trainer in the model_samples table.
+ *
+ * Hot swap: a new model file is loaded into a fresh model_t and swapped in
+ * whole. Online updates are saved next to it as <model_file>.online.
+ *===========================================================================*/
+
+typedef struct {
+    float       x[MODEL_FEATURES];
+    int64_t     t_us;
+} model_pending_t;
+
+typedef struct {
+    int         uplink;
+    float       x[MODEL_FEATURES];
+    float       y;
+    float       weight;
+    int64_t     t_us;
+} model_sample_t;
+
+static model_pending_t  g_model_pending[MAX_UPLINKS][MODEL_PENDING];
+static int              g_model_head[MAX_UPLINKS];      /* Oldest pending */
+static int              g_model_count[MAX_UPLINKS];
+static model_sample_t   g_model_samples[MODEL_SAMPLE_BUF];
+static int              g_model_nsamples;
+static uint32_t         g_model_negs;
+static int64_t          g_model_mtime;
+static uint64_t         g_model_saved_updates;
+
+static int64_t file_mtime(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_mtime : 0;
+}
+
+static void model_online_path(char* out, size_t len) {
+    snprintf(out, len, "%s.online", g_cfg->model_file);
+}
+
+static void model_init(void) {
+    g_model = malloc(sizeof(model_t));
+    if (!g_model) {
+        fprintf(stderr, "model: out of memory\n");
+        exit(1);
+    }
+    model_defaults(g_model);
+
+    /* Resume online learning unless a newer offline model was installed */
+    char online[300];
+    model_online_path(online, sizeof(online));
+    g_model_mtime = file_mtime(g_cfg->model_file);
+    if (file_mtime(online) > g_model_mtime) {
+        model_load(g_model, online);
+    } else if (g_model_mtime > 0) {
+        model_load(g_model, g_cfg->model_file);
+    }
+    if (!g_cfg->model_online) g_model->lr = 0;
+    g_model_saved_updates = g_model->updates;
+    g_engine.model = g_model;
+
+    if (g_db) {
+        char sql[1024];
+        int len = snprintf(sql, sizeof(sql),
+            "CREATE TABLE IF NOT EXISTS model_samples (ts INTEGER, uplink TEXT, label INTEGER, weight REAL");
+        for (int f = 0; f < MODEL_FEATURES; f++) {
+            len += snprintf(sql + len, sizeof(sql) - len, ", %s REAL", MODEL_FEATURE_NAMES[f]);
+        }
+        snprintf(sql + len, sizeof(sql) - len, ")");
+        sqlite3_exec(g_db, sql, NULL, NULL, NULL);
+
+        /* Tables from before a feature was added: add its column (error if present) */
+        for (int f = 0; f < MODEL_FEATURES; f++) {
+            snprintf(sql, sizeof(sql), "ALTER TABLE model_samples ADD COLUMN %s REAL",
+                     MODEL_FEATURE_NAMES[f]);
+            sqlite3_exec(g_db, sql, NULL, NULL, NULL);
+        }
+    }
+
+    log_event("model", "{\"status\":\"ready\",\"source\":\"%s\",\"online\":%s}",
+              g_model->source, g_cfg->model_online ? "true" : "false");
+}
+
+/* Swap in a new offline model if the file changed */
+static void model_reload(void) {
+    int64_t mtime = file_mtime(g_cfg->model_file);
+    if (mtime == 0 || mtime == g_model_mtime) return;
+    g_model_mtime = mtime;
+
+    model_t* next = malloc(sizeof(model_t));
+    if (!next) return;
+    if (model_load(next, g_cfg->model_file) != 0) {
+        log_event("model_swap", "{\"status\":\"load_failed\",\"file\":\"%s\"}", g_cfg->model_file);
+        free(next);
+        return;
+    }
+    if (!g_cfg->model_online) next->lr = 0;
+
+    model_t* old = g_model;
+    __atomic_store_n(&g_model, next, __ATOMIC_RELEASE);
+    g_engine.model = next;
+    free(old);
+    g_model_saved_updates = 0;
+
+    log_event("model_swap", "{\"status\":\"ok\",\"source\":\"%s\"}", next->source);
+}
+
+/* Would the tripwire have fired on u during (from, to]? */
+static float model_label(const uplink_t* u, int64_t from, int64_t to) {
+    int run = 0;
+    int n = u->history_idx < HISTORY_SIZE ? u->history_idx : HISTORY_SIZE;
+
+    /* Oldest to newest so consecutive misses are counted in order */
+    for (int k = n - 1; k >= 0; k--) {
+        const probe_t* pr = &u->history[(u->history_idx - 1 - k) % HISTORY_SIZE];
+        if (pr->timestamp_us <= from || pr->timestamp_us > to) continue;
+        if (!pr->success) {
+            if (++run >= g_cfg->probe_miss_count) return 1.0f;
+        } else {
+            run = 0;
+            if (u->rtt_baseline > 0 && pr->rtt_ms - u->rtt_baseline >= g_cfg->rtt_step_ms) return 1.0f;
+        }
+    }
+    return 0.0f;
+}
+
+static void model_learn(const uplink_t* u, int i, const float* x, int64_t now) {
+    model_pending_t* ring = g_model_pending[i];
+
+    /* Label everything whose window has closed */
+    while (g_model_count[i] > 0 && now - ring[g_model_head[i]].t_us >= MODEL_LABEL_MS * 1000LL) {
+        model_pending_t* pe = &ring[g_model_head[i]];
+        float y = model_label(u, pe->t_us, pe->t_us + MODEL_LABEL_MS * 1000LL);
+
+        model_sgd(g_model, pe->x, y);
+
+        bool keep = y > 0 || (++g_model_negs % MODEL_NEG_KEEP) == 0;
+        if (keep && g_model_nsamples < MODEL_SAMPLE_BUF) {
+            model_sample_t* ms = &g_model_samples[g_model_nsamples++];
+            ms->uplink = i;
+            memcpy(ms->x, pe->x, sizeof(ms->x));
+            ms->y = y;
+            ms->weight = y > 0 ? 1.0f : MODEL_NEG_KEEP;
+            ms->t_us = pe->t_us;
+        }
+
+        g_model_head[i] = (g_model_head[i] + 1) % MODEL_PENDING;
+        g_model_count[i]--;
+    }
+
+    /* Operator-forced failures and chaos injection teach nothing */
+    if (u->force_failed || u->chaos_rtt != 0 || u->chaos_loss != 0 || u->history_idx == 0) return;
+    if (g_model_count[i] == MODEL_PENDING) return;
+
+    int slot = (g_model_head[i] + g_model_count[i]) % MODEL_PENDING;
+    memcpy(ring[slot].x, x, sizeof(ring[slot].x));
+    ring[slot].t_us = now;
+    g_model_count[i]++;
+}
+
+/* Persist online weights and buffered training samples */
+static void model_flush(void) {
+    if (g_model->updates != g_model_saved_updates) {
+        char online[300];
+        model_online_path(online, sizeof(online));
+        if (model_save(g_model, online) == 0) {
+            g_model_saved_updates = g_model->updates;
+        }
+    }
+
+    if (!g_db || g_model_nsamples == 0) {
+        g_model_nsamples = 0;
+        return;
+    }
+
+    char sql[1024];
+    int len = snprintf(sql, sizeof(sql), "INSERT INTO model_samples (ts, uplink, label, weight");
+    for (int f = 0; f < MODEL_FEATURES; f++) {
+        len += snprintf(sql + len, sizeof(sql) - len, ", %s", MODEL_FEATURE_NAMES[f]);
+    }
+    len += snprintf(sql + len, sizeof(sql) - len, ") VALUES (?, ?, ?, ?");
+    for (int f = 0; f < MODEL_FEATURES; f++) {
+        len += snprintf(sql + len, sizeof(sql) - len, ", ?");
+    }
+    snprintf(sql + len, sizeof(sql) - len, ")");
+
+    sqlite3_stmt* st = NULL;
+    if (sqlite3_prepare_v2(g_db, sql, -1, &st, NULL) != SQLITE_OK) {
+        g_model_nsamples = 0;
+        return;
+    }
+
+    sqlite3_exec(g_db, "BEGIN", NULL, NULL, NULL);
+    for (int k = 0; k < g_model_nsamples; k++) {
+        model_sample_t* ms = &g_model_samples[k];
+        sqlite3_bind_int64(st, 1, ms->t_us / 1000000);
+        sqlite3_bind_text(st, 2, g_uplinks[ms->uplink].name, -1, SQLITE_STATIC);
+        sqlite3_bind_int(st, 3, ms->y > 0 ? 1 : 0);
+        sqlite3_bind_double(st, 4, ms->weight);
+        for (int f = 0; f < MODEL_FEATURES; f++) {
+            sqlite3_bind_double(st, 5 + f, ms->x[f]);
+        }
+        sqlite3_step(st);
+        sqlite3_reset(st);
+    }
+    sqlite3_exec(g_db, "COMMIT", NULL, NULL, NULL);
+    sqlite3_finalize(st);
+
+    g_model_nsamples = 0;
+}
+
+/*=============================================================================
+ * TRAJECTORY LOOK-AHEAD
+ * 
+ * Project the vehicle 0..horizon seconds ahead (speed + turn rate, dead
+ * reckoned from the last fix) and walk the risk index along that corridor.
+ * Per uplink we keep the worst tile ahead and when we reach the first tile
+ * over each threshold. The active uplink's ETAs drive the state machine:
+ *   - risky tile within horizon   -> PREPARE
+ *   - high-risk tile within lead  -> fire TRIGGER_PREDICTED (dup before outage)
+ * 
+ * On a known route (routes.h) the corridor comes from the baked 1-D profile
+ * instead: map-match once per fix, then read bins ahead sequentially. The
+ * tile walk only covers uplinks the route file has no data for.
+ *===========================================================================*/
+
+/* (Re)map the route file - at startup and whenever pathsteer-routes rebuilds it */
+static void routes_load(void) {
+    routes_close(&g_routes);
+    if (routes_open(&g_routes, g_cfg->routes_file) != 0) {
+        for (int i = 0; i < MAX_UPLINKS; i++) g_route_col[i] = -1;
+        return;
+    }
+    
+    int cols = 0;
+    for (int i = 0; i < g_uplink_count; i++) {
+        g_route_col[i] = routes_column(&g_routes, g_uplinks[i].name);
+        if (g_route_col[i] >= 0) cols++;
+    }
+    log_event("routes_load", "{\"file\":\"%s\",\"routes\":%u,\"uplinks\":%d,\"bin_m\":%.0f}",
+              g_cfg->routes_file, g_routes.hdr->n_routes, cols, g_routes.hdr->bin_m);
+}
+
+/* Called after every GPS poll */
+static void trajectory_fix(void) {
+    if (!g_gps.valid || g_gps.timestamp_us == g_traj.last.t_us) return;
+    
+    traj_fix_t fix = {
+        .lat = g_gps.latitude,
+        .lon = g_gps.longitude,
+        .heading = g_gps.heading,
+        .speed_mps = g_gps.speed_mps,
+        .t_us = g_gps.timestamp_us,
+    };
+    traj_update(&g_traj, &fix);
+    
+    /* Heading is meaningless when parked - keep the last match */
+    if (fix.speed_mps >= TRAJ_MIN_SPEED_MPS) {
+        int was = g_routes.route;
+        routes_match(&g_routes, fix.lat, fix.lon, fix.heading);
+        if (g_routes.route != was) {
+            log_event("route_match", "{\"route\":%d,\"bin\":%u,\"dir\":%d,\"offset_m\":%.0f}",
+                      g_routes.route, g_routes.pos, g_routes.dir, g_routes.offset_m);
+        }
+    }
+}
+
+/* Known route: sequential scan of the profile ahead. Marks uplinks covered. */
+static void predictor_route_walk(double age, bool* covered) {
+    double v = g_traj.last.speed_mps;
+    double bin_m = g_routes.hdr->bin_m;
+    uint32_t skip = (uint32_t)(age * v / bin_m);  /* Dead-reckoned progress since fix */
+    uint32_t n = (uint32_t)(g_cfg->predict_horizon_sec * v / bin_m) + 1;
+    uint32_t trips = routes_trips(&g_routes);
+    double conf = trips / (trips + ROUTE_CONF_K);
+    if (conf < g_cfg->predict_min_conf) return;
+    
+    for (int i = 0; i < g_uplink_count; i++) {
+        uplink_t* u = &g_uplinks[i];
+        int col = g_route_col[i];
+        if (!u->enabled || col < 0) continue;
         
-        if (u->type == UPLINK_TYPE_LTE && u->cellular.rsrp < -110) {
-            u->risk_now += 0.4;
+        for (uint32_t k = 0; k < n; k++) {
+            double r = routes_risk_at(&g_routes, col, skip + k);
+            if (r < 0) continue;
+            covered[i] = true;
+            
+            double t = k * bin_m / v;
+            if (r > u->risk_ahead) u->risk_ahead = r;
+            if (u->eta_prepare < 0 && r >= g_cfg->risk_prepare) u->eta_prepare = t;
+            if (u->eta_protect < 0 && r >= g_cfg->risk_protect) u->eta_protect = t;
         }
+        if (covered[i]) u->confidence = conf;
+    }
+}
+
+static void predictor_tick(void) {
+    for (int i = 0; i < g_uplink_count; i++) {
+        g_uplinks[i].risk_ahead = 0;
+        g_uplinks[i].confidence = 0;
+        g_uplinks[i].eta_prepare = -1;
+        g_uplinks[i].eta_protect = -1;
+    }
+    
+    /* Dead reckoning: start the corridor at where we are now, not the last fix */
+    double age = traj_age_sec(&g_traj, now_us());
+    if (age > TRAJ_DR_MAX_SEC) return;
+    
+    double v = g_traj.last.speed_mps;
+    bool moving = v >= TRAJ_MIN_SPEED_MPS;
+    double step = moving ? PREDICT_STEP_M / v : 1.0;
+    if (step < 0.5) step = 0.5;
+    
+    bool covered[MAX_UPLINKS] = {false};
+    if (moving && g_routes.route >= 0) {
+        predictor_route_walk(age, covered);
+    }
+    
+    uint64_t prev_key[MAX_UPLINKS] = {0};
+    for (double t = 0; t <= g_cfg->predict_horizon_sec; t += step) {
+        double lat, lon, hdg;
+        if (!traj_project(&g_traj, age + t, &lat, &lon, &hdg)) return;
         
-        if (u->risk_now > 1.0) u->risk_now = 1.0; // Capped
+        for (int i = 0; i < g_uplink_count; i++) {
+            uplink_t* u = &g_uplinks[i];
+            if (!u->enabled || covered[i]) continue;
+            
+            uint64_t key = riskmap_key(lat, lon, hdg, i);
+            if (key == prev_key[i]) continue;  /* Same tile as last sample */
+            prev_key[i] = key;
+            
+            const riskmap_entry_t* e = riskmap_lookup(&g_riskmap, key);
+            double conf = riskmap_confidence(e);
+            if (!e || conf < g_cfg->predict_min_conf) continue;
+            
+            if (e->risk > u->risk_ahead) {
+                u->risk_ahead = e->risk;
+                u->confidence = conf;
+            }
+            if (u->eta_prepare < 0 && e->risk >= g_cfg->risk_prepare) u->eta_prepare = t;
+            if (u->eta_protect < 0 && e->risk >= g_cfg->risk_protect) u->eta_protect = t;
+        }
         
+        if (!moving) break;  /* Parked: only the current tile matters */
+    }
+}
+
+/*=============================================================================
+ * STARLINK OBSTRUCTION FORECAST
+ * 
+ * Sets obstruction_eta from the dish's sky map (skymap.h) and where the
+ * vehicle will be pointing over the next SL_FORECAST_SEC:
+ *   - turn: projected heading swings the serving sky behind a vehicle-fixed
+ *     obstruction -> outage starts mid-slot, when the turn gets there
+ *   - slot: the next satellite reassignment happens while the serving sky
+ *     is partly blocked -> the new satellite may start out obstructed
+ * engine_tripwire_check() duplicates when the ETA is under 5 s, so the
+ * micro-outage is already covered when it begins.
+ *===========================================================================*/
+
+static void starlink_forecast(uplink_t* u) {
+    starlink_t* sl = &u->starlink;
+    int prev = sl->obstruction_eta;
+    
+    sl->obstruction_eta = -1;
+    sl->blockage = 0;
+    if (!sl->sky.valid || !gps_fresh()) return;
+    
+    int64_t now = now_us();
+    double heading = g_gps.heading;
+    double age = traj_age_sec(&g_traj, now);
+    sl->blockage = skymap_blockage(&sl->sky, heading, g_cfg->sl_sky_az, g_cfg->sl_sky_spread);
+    
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    double slot = skymap_next_slot(ts.tv_sec + ts.tv_nsec / 1e9, g_cfg->sl_slot_offset);
+    
+    double eta = -1;
+    const char* cause = NULL;
+    for (int t = 1; t <= SL_FORECAST_SEC; t++) {
+        double lat, lon, h = heading;
+        if (!traj_project(&g_traj, age + t, &lat, &lon, &h)) h = heading;
+        double b = skymap_blockage(&sl->sky, h, g_cfg->sl_sky_az, g_cfg->sl_sky_spread);
         
-        if (u->is_active && u->risk_now > max_risk) {
-            max_risk = u->risk_now;
+        if (b >= g_cfg->sl_block_turn && sl->blockage < g_cfg->sl_block_turn) {
+            eta = t;
+            cause = "turn";
+            break;
+        }
+        if (slot <= t && slot > t - 1 && b >= g_cfg->sl_block_slot) {
+            eta = slot;
+            cause = "slot";
+            break;
         }
     }
+    if (eta < 0) return;
     
-    g_status.global_risk = max_risk;
+    sl->obstruction_eta = (int)ceil(eta);
+    if (sl->obstruction_eta < 1) sl->obstruction_eta = 1;
     
-    if (max_risk >= 0.7) {
-        strcpy(g_status.recommendation, "PROTECT");
-    } else if (max_risk >= 0.4) {
-        strcpy(g_status.recommendation, "PREPARE");
-    } else {
-        strcpy(g_status.recommendation, "NORMAL");
+    if (prev < 0) {
+        log_event("starlink_forecast", "{\"uplink\":\"%s\",\"cause\":\"%s\",\"eta_sec\":%.1f,\"blockage\":%.2f,\"heading\":%.0f}",
+                  u->name, cause, eta, sl->blockage, heading);
+    }
+}
+
+/*=============================================================================
+ * REPLAY TRACE
+ * 
+ * With trace_log on, every probe round is logged as a "trace" event: the raw
+ * probe result per uplink plus what the decision engine reads that doesn't
+ * come from probes (signal, handover tracker, dish state, look-ahead ETAs).
+ * pathsteer-replay feeds these back through engine.c, see sim.h.
+ *===========================================================================*/
+
+static void trace_write(int64_t t_us) {
+    char buf[3072];
+    size_t len = 0;
+    
+#define TRACE_ADD(...) do { \
+        if (len < sizeof(buf)) len += snprintf(buf + len, sizeof(buf) - len, __VA_ARGS__); \
+    } while (0)
+    
+    TRACE_ADD("{\"t\":%ld,\"lat\":%.6f,\"lon\":%.6f,\"spd\":%.1f,\"hdg\":%.0f,\"u\":{",
+              t_us, g_gps.latitude, g_gps.longitude, g_gps.speed_mps, g_gps.heading);
+    
+    bool first = true;
+    for (int i = 0; i < g_uplink_count; i++) {
+        const uplink_t* u = &g_uplinks[i];
+        if (!u->enabled || u->history_idx == 0) continue;
+        
+        const probe_t* pr = &u->history[(u->history_idx - 1) % HISTORY_SIZE];
+        TRACE_ADD("%s\"%s\":{\"rtt\":%.1f,\"ra\":%.2f,\"conf\":%.2f,\"ep\":%.1f,\"eq\":%.1f",
+                  first ? "" : ",", u->name, pr->success ? pr->rtt_ms : 0.0,
+                  u->risk_ahead, u->confidence, u->eta_prepare, u->eta_protect);
+        first = false;
+        
+        if (u->force_failed) TRACE_ADD(",\"ff\":1");
+        if (u->chaos_rtt != 0 || u->chaos_jitter != 0 || u->chaos_loss != 0) {
+            TRACE_ADD(",\"crtt\":%.1f,\"cjit\":%.1f,\"closs\":%.1f",
+                      u->chaos_rtt, u->chaos_jitter, u->chaos_loss);
+        }
+        if (u->type == UPLINK_TYPE_LTE) {
+            const cellular_t* c = &u->cellular;
+            TRACE_ADD(",\"rsrp\":%.1f,\"sinr\":%.1f,\"rsrp_tr\":%.2f,\"sinr_tr\":%.2f"
+                      ",\"hop\":%d,\"hom\":%.1f,\"hot\":%.2f,\"hoage\":%ld,\"hoprob\":%.2f,\"hogap\":%.0f",
+                      c->rsrp, c->sinr, c->rsrp_trend, c->sinr_trend,
+                      c->ho.cur.valid ? c->ho.best_pci : -1, c->ho.margin, c->ho.margin_trend,
+                      c->ho.t_us > 0 ? (t_us - c->ho.t_us) / 1000 : 0L, c->ho_prob, c->ho_gap_ms);
+        } else if (u->type == UPLINK_TYPE_STARLINK) {
+            const starlink_t* s = &u->starlink;
+            TRACE_ADD(",\"online\":%d,\"obs\":%d,\"obs_pct\":%.2f,\"obs_eta\":%d",
+                      s->online, s->obstructed, s->obstruction_pct, s->obstruction_eta);
+        }
+        TRACE_ADD("}");
     }
+    TRACE_ADD("}}");
+#undef TRACE_ADD
+    
+    if (len < sizeof(buf)) log_event("trace", "%s", buf);
 }
 
 /*=============================================================================
  * STATUS OUTPUT
  * 
- * Write current status to JSON file for Web UI consumption.
+ * Write current status to JSON file for Web UI consumption (status.c).
  * Updated at 10 Hz.
  *===========================================================================*/
 
@@ -1308,58 +2263,230 @@ static void status_write(void) {
     FILE* fp = fopen("/run/pathsteer/status.json", "w");
     if (!fp) return;
     
+    char pops[POPSEL_MAX_POPS * (POPSEL_MAX_PATHS * 64 + 160) + 8];
+    char lat[LAT_COUNT * 256 + 64];
+    char wd[WD_PHASE_COUNT * 96 + 128];
+    char scores[4096];
+    status_view_t v = {
+        .engine = &g_engine,
+        .route = g_routes.route,
+        .pop_auto = atomic_load(&g_popsel.running) && !g_pop_pinned,
+        .c8000_session = atomic_load(&g_c8000.up),
+        .latency = lat,
+    };
+    
     pthread_mutex_lock(&g_mutex);
+    if (atomic_load(&g_popsel.running)) {
+        popsel_json(&g_popsel, pops, sizeof(pops));
+        v.controllers = pops;
+    }
+    lat_json(lat, sizeof(lat));
+    if (g_cfg->watchdog_enabled) {
+        watchdog_json(&g_watchdog, wd, sizeof(wd));
+        v.watchdog = wd;
+    }
+    if (g_shadow_count > 0 || g_training_shadow) {
+        shadow_scores_json(scores, sizeof(scores));
+        v.policies = scores;
+    }
+    status_render(fp, &v);
+    pthread_mutex_unlock(&g_mutex);
+    fclose(fp);
+}
+
+/*=============================================================================
+ * PROMETHEUS METRICS
+ * 
+ * Rendered by the main loop every METRICS_RENDER_MS into the exporter's
+ * static buffers (../common/metrics.h); its thread only copies the last
+ * rendering to scrapers. Same numbers as status.json, as counters where
+ * they accumulate.
+ *===========================================================================*/
+
+/* Bucket bounds for the latency histograms, us */
+static const int64_t METRICS_LAT_LE[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000
+};
+
+static const char* const METRICS_MODE_NAMES[] = {"training", "tripwire", "mirror"};
+
+/* Every loop iteration: count state machine transitions */
+static void metrics_observe(void) {
+    if (g_status.state != g_last_state) {
+        g_transitions[g_last_state][g_status.state]++;
+        g_last_state = g_status.state;
+    }
+}
+
+static uint64_t dev_tx_bytes(const char* dev) {
+    char path[96];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/tx_bytes", dev);
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    unsigned long long v = 0;
+    if (fscanf(f, "%llu", &v) != 1) v = 0;
+    fclose(f);
+    return v;
+}
+
+/* mirred copies everything leaving the source device: its tx while duplicating */
+static void dup_bytes_sample(void) {
+    if (!g_status.dup_enabled) {
+        g_dup_tx_dev[0] = '\0';
+        return;
+    }
+    uint64_t tx = dev_tx_bytes(g_dup_src);
+    if (strcmp(g_dup_tx_dev, g_dup_src) == 0 && tx >= g_dup_tx_last) g_dup_bytes += tx - g_dup_tx_last;
+    snprintf(g_dup_tx_dev, sizeof(g_dup_tx_dev), "%s", g_dup_src);
+    g_dup_tx_last = tx;
+}
+
+static void metrics_render(void) {
+    metrics_t* m = &g_metrics;
+    
+    dup_bytes_sample();
+    metrics_begin(m);
     
-    /* Convert speed to mph for display */
-    double speed_mph = g_gps.speed_mps * 2.237;
-    
-    fprintf(fp, "{\n");
-    fprintf(fp, "  \"mode\": \"%s\",\n", MODE_NAMES[g_status.mode]);
-    fprintf(fp, "  \"state\": \"%s\",\n", STATE_NAMES[g_status.state]);
-    fprintf(fp, "  \"trigger\": \"%s\",\n", TRIGGER_NAMES[g_status.last_trigger]);
-    fprintf(fp, "  \"trigger_detail\": \"%s\",\n", g_status.trigger_detail);
-    fprintf(fp, "  \"active_uplink\": \"%s\",\n", UPLINK_NAMES[g_status.active_uplink]);
-    fprintf(fp, "  \"active_controller\": %d,\n", g_status.active_controller);
-    fprintf(fp, "  \"dup_enabled\": %s,\n", g_status.dup_enabled ? "true" : "false");
-    fprintf(fp, "  \"hold_remaining\": %d,\n", g_status.hold_remaining_sec);
-    fprintf(fp, "  \"clean_remaining\": %d,\n", g_status.clean_remaining_sec);
-    fprintf(fp, "  \"switches_this_window\": %d,\n", g_status.switches_this_window);
-    fprintf(fp, "  \"flap_suppressed\": %s,\n", g_status.flap_suppressed ? "true" : "false");
-    fprintf(fp, "  \"global_risk\": %.2f,\n", g_status.global_risk);
-    fprintf(fp, "  \"recommendation\": \"%s\",\n", g_status.recommendation);
-    fprintf(fp, "  \"run_id\": \"%s\",\n", g_status.run_id);
-    
-    /* GPS */
-    fprintf(fp, "  \"gps\": {\"valid\": %s, \"lat\": %.6f, \"lon\": %.6f, \"speed_mph\": %.1f, \"heading\": %.1f},\n",
-            g_gps.valid ? "true" : "false", g_gps.latitude, g_gps.longitude, speed_mph, g_gps.heading);
+    metrics_type(m, "pathsteer_info", "gauge", "Daemon version and run");
+    metrics_printf(m, "pathsteer_info{version=\"%s\",node=\"%s\",run=\"%s\"} 1\n",
+                   VERSION, g_cfg->node_id, g_status.run_id);
+    
+    /* State machine */
+    metrics_type(m, "pathsteer_mode", "gauge", "Operating mode, 1 = current");
+    for (int i = 0; i <= MODE_MIRROR; i++) {
+        metrics_printf(m, "pathsteer_mode{mode=\"%s\"} %d\n", METRICS_MODE_NAMES[i], g_status.mode == (op_mode_t)i);
+    }
+    metrics_type(m, "pathsteer_state", "gauge", "State machine state, 1 = current");
+    for (int i = 0; i < STATE_COUNT; i++) {
+        metrics_printf(m, "pathsteer_state{state=\"%s\"} %d\n", STATE_NAMES[i], g_status.state == (sys_state_t)i);
+    }
+    metrics_type(m, "pathsteer_state_transitions_total", "counter", "State machine transitions");
+    for (int from = 0; from < STATE_COUNT; from++) {
+        for (int to = 0; to < STATE_COUNT; to++) {
+            if (g_transitions[from][to] == 0) continue;
+            metrics_printf(m, "pathsteer_state_transitions_total{from=\"%s\",to=\"%s\"} %llu\n",
+                           STATE_NAMES[from], STATE_NAMES[to], (unsigned long long)g_transitions[from][to]);
+        }
+    }
+    metrics_type(m, "pathsteer_tripwire_fires_total", "counter", "Tripwire fires by trigger");
+    for (int t = 1; t < TRIGGER_COUNT; t++) {
+        metrics_printf(m, "pathsteer_tripwire_fires_total{trigger=\"%s\"} %llu\n",
+                       TRIGGER_NAMES[t], (unsigned long long)g_fires[t]);
+    }
+    metrics_type(m, "pathsteer_switches_total", "counter", "Active uplink switches");
+    metrics_printf(m, "pathsteer_switches_total %d\n", g_live_score.switches);
+    metrics_type(m, "pathsteer_outages_total", "counter", "Active uplink outages, covered by a live duplicate or not");
+    metrics_printf(m, "pathsteer_outages_total{covered=\"true\"} %d\n", g_live_score.outages_covered);
+    metrics_printf(m, "pathsteer_outages_total{covered=\"false\"} %d\n", g_live_score.outages_missed);
+    metrics_type(m, "pathsteer_protect_seconds_total", "counter", "Time in PROTECT, SWITCHING or HOLDING");
+    metrics_printf(m, "pathsteer_protect_seconds_total %.3f\n", g_live_score.protect_sec);
+    
+    /* Duplication */
+    metrics_type(m, "pathsteer_dup_enabled", "gauge", "Duplication on");
+    metrics_printf(m, "pathsteer_dup_enabled %d\n", g_status.dup_enabled ? 1 : 0);
+    metrics_type(m, "pathsteer_dup_seconds_total", "counter", "Time duplicating");
+    metrics_printf(m, "pathsteer_dup_seconds_total %.3f\n", g_live_score.dup_sec);
+    metrics_type(m, "pathsteer_dup_bytes_total", "counter", "Bytes mirrored to the duplicate path (sampled per render)");
+    metrics_printf(m, "pathsteer_dup_bytes_total %llu\n", (unsigned long long)g_dup_bytes);
     
     /* Uplinks */
-    fprintf(fp, "  \"uplinks\": [\n");
-    for (int i = 0; i < UPLINK_COUNT; i++) {
-        uplink_t* u = &g_uplinks[i];
-        fprintf(fp, "    {\"name\": \"%s\", \"enabled\": %s, \"available\": %s, \"active\": %s,\n",
-                u->name, u->enabled ? "true" : "false", 
-                u->available ? "true" : "false", u->is_active ? "true" : "false");
-        fprintf(fp, "     \"rtt_ms\": %.1f, \"rtt_baseline\": %.1f, \"loss_pct\": %.1f,\n",
-                u->rtt_ms, u->rtt_baseline, u->loss_pct);
-        fprintf(fp, "     \"risk_now\": %.2f, \"consec_fail\": %d", u->risk_now, u->consec_fail);
-        
-        if (u->type == UPLINK_TYPE_LTE) {
-            fprintf(fp, ",\n     \"cellular\": {\"rsrp\": %.1f, \"sinr\": %.1f, \"carrier\": \"%s\"}",
-                    u->cellular.rsrp, u->cellular.sinr, u->cellular.carrier);
+    static const struct { const char* name; const char* type; const char* help; } UPLINK_METRICS[] = {
+        {"pathsteer_uplink_enabled", "gauge", "Uplink configured"},
+        {"pathsteer_uplink_available", "gauge", "Uplink usable"},
+        {"pathsteer_uplink_active", "gauge", "Uplink is the active path"},
+        {"pathsteer_uplink_rtt_ms", "gauge", "Probe RTT"},
+        {"pathsteer_uplink_rtt_baseline_ms", "gauge", "Baseline RTT"},
+        {"pathsteer_uplink_loss_pct", "gauge", "Recent probe loss"},
+        {"pathsteer_uplink_jitter_ms", "gauge", "RTT jitter"},
+        {"pathsteer_uplink_consec_fail", "gauge", "Consecutive failed probes"},
+        {"pathsteer_uplink_risk_now", "gauge", "Current risk 0-1"},
+        {"pathsteer_uplink_risk_ahead", "gauge", "Predicted risk 0-1"},
+    };
+    for (size_t k = 0; k < sizeof(UPLINK_METRICS) / sizeof(UPLINK_METRICS[0]); k++) {
+        metrics_type(m, UPLINK_METRICS[k].name, UPLINK_METRICS[k].type, UPLINK_METRICS[k].help);
+        for (int i = 0; i < g_uplink_count; i++) {
+            const uplink_t* u = &g_uplinks[i];
+            double v[] = {
+                u->enabled, u->available, u->is_active, u->rtt_ms, u->rtt_baseline, u->loss_pct,
+                u->jitter_ms, u->consec_fail, u->risk_now, u->risk_ahead
+            };
+            metrics_printf(m, "%s{uplink=\"%s\"} %g\n", UPLINK_METRICS[k].name, u->name, v[k]);
         }
-        if (u->type == UPLINK_TYPE_STARLINK) {
-            fprintf(fp, ",\n     \"starlink\": {\"state\": \"%s\", \"latency\": %.1f, \"obstructed\": %s, \"obstruction_pct\": %.2f, \"eta\": %d}",
-                    u->starlink.state, u->starlink.latency_ms, 
-                    u->starlink.obstructed ? "true" : "false", u->starlink.obstruction_pct, u->starlink.obstruction_eta);
+    }
+    
+    /* Hot-path latency */
+    metrics_type(m, "pathsteer_latency_us", "histogram", "Hot-path stage latency, microseconds");
+    for (int i = 0; i < LAT_COUNT; i++) {
+        for (size_t b = 0; b < sizeof(METRICS_LAT_LE) / sizeof(METRICS_LAT_LE[0]); b++) {
+            metrics_printf(m, "pathsteer_latency_us_bucket{stage=\"%s\",le=\"%lld\"} %llu\n",
+                           LAT_NAMES[i], (long long)METRICS_LAT_LE[b],
+                           (unsigned long long)hdr_count_le(&g_lat[i], METRICS_LAT_LE[b]));
+        }
+        metrics_printf(m, "pathsteer_latency_us_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n", LAT_NAMES[i],
+                       (unsigned long long)atomic_load_explicit(&g_lat[i].total, memory_order_relaxed));
+        metrics_printf(m, "pathsteer_latency_us_sum{stage=\"%s\"} %llu\n", LAT_NAMES[i],
+                       (unsigned long long)atomic_load_explicit(&g_lat[i].sum_us, memory_order_relaxed));
+        metrics_printf(m, "pathsteer_latency_us_count{stage=\"%s\"} %llu\n", LAT_NAMES[i],
+                       (unsigned long long)atomic_load_explicit(&g_lat[i].total, memory_order_relaxed));
+    }
+    metrics_type(m, "pathsteer_loop_overruns_total", "counter", "Main loop iterations over 10 ms of work");
+    metrics_printf(m, "pathsteer_loop_overruns_total %llu\n",
+                   (unsigned long long)atomic_load_explicit(&g_loop_overruns, memory_order_relaxed));
+    if (g_cfg->watchdog_enabled) {
+        metrics_type(m, "pathsteer_loop_phase_overruns_total", "counter", "Main loop phases over their watchdog budget");
+        for (int i = 0; i < WD_PHASE_COUNT; i++) {
+            metrics_printf(m, "pathsteer_loop_phase_overruns_total{phase=\"%s\"} %llu\n", WD_PHASE_NAMES[i],
+                           (unsigned long long)atomic_load(&g_watchdog.overruns[i]));
         }
-        fprintf(fp, "}%s\n", i < UPLINK_COUNT - 1 ? "," : "");
+        metrics_type(m, "pathsteer_watchdog_blind_total", "counter", "Spells without a decision on fresh probes past watchdog_blind_ms");
+        metrics_printf(m, "pathsteer_watchdog_blind_total %llu\n",
+                       (unsigned long long)atomic_load(&g_watchdog.blind_spells));
     }
-    fprintf(fp, "  ]\n");
-    fprintf(fp, "}\n");
     
-    pthread_mutex_unlock(&g_mutex);
-    fclose(fp);
+    /* Controller PoPs */
+    metrics_type(m, "pathsteer_controller_active", "gauge", "Controller PoP the C8000 uses, 1 = current");
+    for (int j = 0; j < g_cfg->controller_count; j++) {
+        metrics_printf(m, "pathsteer_controller_active{pop=\"%s\"} %d\n", g_cfg->controller_names[j],
+                       g_status.active_controller == j);
+    }
+    if (atomic_load(&g_popsel.running)) {
+        metrics_type(m, "pathsteer_pop_rtt_ms", "gauge", "Smoothed RTT to a PoP over an uplink, -1 = none");
+        for (int j = 0; j < g_popsel.npops; j++) {
+            for (int i = 0; i < g_popsel.npaths; i++) {
+                metrics_printf(m, "pathsteer_pop_rtt_ms{pop=\"%s\",uplink=\"%s\"} %.2f\n", g_popsel.pops[j].name,
+                               g_popsel.paths[i].name, g_popsel.pairs[i][j].rtt_ms);
+            }
+        }
+        metrics_type(m, "pathsteer_pop_loss_ratio", "gauge", "Probe loss to a PoP over an uplink");
+        for (int j = 0; j < g_popsel.npops; j++) {
+            for (int i = 0; i < g_popsel.npaths; i++) {
+                metrics_printf(m, "pathsteer_pop_loss_ratio{pop=\"%s\",uplink=\"%s\"} %.3f\n", g_popsel.pops[j].name,
+                               g_popsel.paths[i].name, g_popsel.pairs[i][j].loss);
+            }
+        }
+        metrics_type(m, "pathsteer_pop_selects_total", "counter", "Automatic PoP choices by reason");
+        metrics_printf(m, "pathsteer_pop_selects_total{reason=\"failover\"} %llu\n",
+                       (unsigned long long)atomic_load(&g_popsel.failovers));
+        metrics_printf(m, "pathsteer_pop_selects_total{reason=\"nearer\"} %llu\n",
+                       (unsigned long long)atomic_load(&g_popsel.nearer));
+    }
+    if (atomic_load(&g_c8000.running)) {
+        metrics_type(m, "pathsteer_c8000_session_up", "gauge", "NETCONF session to the C8000 established");
+        metrics_printf(m, "pathsteer_c8000_session_up %d\n", atomic_load(&g_c8000.up) ? 1 : 0);
+        metrics_type(m, "pathsteer_c8000_connects_total", "counter", "NETCONF session attempts");
+        metrics_printf(m, "pathsteer_c8000_connects_total %llu\n", (unsigned long long)atomic_load(&g_c8000.connects));
+        metrics_type(m, "pathsteer_c8000_rpcs_total", "counter", "PoP switch RPCs by result");
+        metrics_printf(m, "pathsteer_c8000_rpcs_total{result=\"ok\"} %llu\n", (unsigned long long)atomic_load(&g_c8000.rpcs_ok));
+        metrics_printf(m, "pathsteer_c8000_rpcs_total{result=\"error\"} %llu\n", (unsigned long long)atomic_load(&g_c8000.rpcs_failed));
+        metrics_type(m, "pathsteer_c8000_rpc_ms", "gauge", "Last PoP switch RPC round trip");
+        metrics_printf(m, "pathsteer_c8000_rpc_ms %.1f\n", atomic_load(&g_c8000.last_rpc_us) / 1000.0);
+    }
+    metrics_type(m, "pathsteer_metrics_scrapes_total", "counter", "Scrapes served");
+    metrics_printf(m, "pathsteer_metrics_scrapes_total %llu\n",
+                   (unsigned long long)atomic_load(&g_metrics.scrapes));
+    
+    metrics_publish(m);
 }
 
 /*=============================================================================
@@ -1385,70 +2512,71 @@ static void commands_process(void) {
                 g_status.mode = MODE_TRIPWIRE;
             } else if (strcmp(mode, "mirror") == 0) {
                 g_status.mode = MODE_MIRROR;
-                dup_enable("br-lan", g_uplinks[1].veth);  /* Always dup in mirror */
+                /* Always dup in mirror, to the same secondary a fire would pick */
+                uplink_id_t dst = engine_pick_secondary(&g_engine, g_status.active_uplink);
+                if (dst != g_status.active_uplink) {
+                    dup_enable("br-lan", g_uplinks[dst].veth);
+                    g_dup_target = dst;
+                }
             }
+            shadow_training(g_status.mode == MODE_TRAINING);
             log_event("mode_change", "{\"mode\":\"%s\"}", MODE_NAMES[g_status.mode]);
             
         } else if (strncmp(cmd, "force:", 6) == 0) {
-            const char* uplink = cmd + 6;
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-                if (strcmp(UPLINK_NAMES[i], uplink) == 0) {
-                    g_uplinks[i].force_failed = false;  /* Clear any force_fail */
-                    g_uplinks[i].available = true;
-                    execute_switch(i);
-                    break;
-                }
+            int i = uplinkidx_name(&g_uplink_idx, cmd + 6);
+            if (i >= 0) {
+                g_uplinks[i].force_failed = false;  /* Clear any force_fail */
+                g_uplinks[i].available = true;
+                engine_switch(&g_engine, i);
             }
             
         } else if (strcmp(cmd, "trigger") == 0) {
-            tripwire_fire(TRIGGER_MANUAL, "operator");
+            engine_tripwire_fire(&g_engine, TRIGGER_MANUAL, "operator");
             
+        } else if (strcmp(cmd, "c8000:auto") == 0) {
+            g_pop_pinned = false;
+            log_event("pop_auto", "{\"enabled\":%s}", g_cfg->pop_auto ? "true" : "false");
         } else if (strncmp(cmd, "c8000:", 6) == 0) {
-            int ctrl = atoi(cmd + 6);
-            c8000_switch(ctrl);
+            /* The operator's PoP stays until c8000:auto */
+            char* end;
+            long ctrl = strtol(cmd + 6, &end, 10);
+            if (end == cmd + 6 || *end || ctrl < 0 || ctrl >= g_cfg->controller_count) {
+                log_event("c8000_error", "{\"error\":\"no such controller\",\"controllers\":%d}",
+                          g_cfg->controller_count);
+            } else if (c8000_switch((int)ctrl, "operator") == 0) {
+                g_pop_pinned = true;
+            }
         } else if (strncmp(cmd, "enable:", 7) == 0) {
-            const char* uplink = cmd + 7;
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-                if (strcmp(UPLINK_NAMES[i], uplink) == 0) {
-                    g_uplinks[i].enabled = true;
-                    log_event("uplink_enabled", "{\"uplink\":\"%s\"}", uplink);
-                    break;
-                }
+            int i = uplinkidx_name(&g_uplink_idx, cmd + 7);
+            if (i >= 0) {
+                g_uplinks[i].enabled = true;
+                log_event("uplink_enabled", "{\"uplink\":\"%s\"}", g_uplinks[i].name);
             }
         } else if (strncmp(cmd, "disable:", 8) == 0) {
-            const char* uplink = cmd + 8;
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-                if (strcmp(UPLINK_NAMES[i], uplink) == 0) {
-                    g_uplinks[i].enabled = false;
-                    log_event("uplink_disabled", "{\"uplink\":\"%s\"}", uplink);
-                    break;
-                }
+            int i = uplinkidx_name(&g_uplink_idx, cmd + 8);
+            if (i >= 0) {
+                g_uplinks[i].enabled = false;
+                log_event("uplink_disabled", "{\"uplink\":\"%s\"}", g_uplinks[i].name);
             }
         /* Force fail command - marks uplink unavailable to trigger failover */
         } else if (strncmp(cmd, "fail:", 5) == 0) {
-            const char* uplink = cmd + 5;
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-                if (strcmp(UPLINK_NAMES[i], uplink) == 0) {
-                    /* Mark as unavailable - this triggers path selection */
-                    g_uplinks[i].available = false;
-                    g_uplinks[i].force_failed = true;  /* Sticky until cleared */
-                    g_uplinks[i].consec_fail = 10;  /* High fail count forces switch */
-                    log_event("uplink_force_fail", "{\"uplink\":\"%s\"}", uplink);
-                    break;
-                }
+            int i = uplinkidx_name(&g_uplink_idx, cmd + 5);
+            if (i >= 0) {
+                /* Mark as unavailable - this triggers path selection */
+                g_uplinks[i].available = false;
+                g_uplinks[i].force_failed = true;  /* Sticky until cleared */
+                g_uplinks[i].consec_fail = 10;  /* High fail count forces switch */
+                log_event("uplink_force_fail", "{\"uplink\":\"%s\"}", g_uplinks[i].name);
             }
         }
         /* Unfail command - clears force_failed flag, restores uplink */
         else if (strncmp(cmd, "unfail:", 7) == 0) {
-            const char* uplink = cmd + 7;
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-                if (strcmp(UPLINK_NAMES[i], uplink) == 0) {
-                    g_uplinks[i].force_failed = false;
-                    g_uplinks[i].available = true;
-                    g_uplinks[i].consec_fail = 0;
-                    log_event("uplink_unfail", "{\"uplink\":\"%s\"}", uplink);
-                    break;
-                }
+            int i = uplinkidx_name(&g_uplink_idx, cmd + 7);
+            if (i >= 0) {
+                g_uplinks[i].force_failed = false;
+                g_uplinks[i].available = true;
+                g_uplinks[i].consec_fail = 0;
+                log_event("uplink_unfail", "{\"uplink\":\"%s\"}", g_uplinks[i].name);
             }
         }
     }
@@ -1459,20 +2587,169 @@ static void commands_process(void) {
 
 /*=============================================================================
  * C8000 CONTROL
+ * 
+ * popsel probes every controller PoP over every uplink and names the
+ * nearest healthy one; c8000_step() moves the C8000 there (unless the
+ * operator pinned a PoP with c8000:N) over the standing NETCONF session.
+ * The session reports <ok/> asynchronously; only then does
+ * active_controller change and popsel's holddown start. Without a session
+ * the SSH script runs on a thread of its own, one at a time, and reports
+ * success the same way (g_c8000.applied).
  *===========================================================================*/
 
-static int c8000_switch(int controller) {
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "%s/scripts/c8000-switch.sh ctrl_%c",
-             "/opt/pathsteer", controller == 0 ? 'a' : 'b');
+static void c8000_on_event(void* ctx, const char* type, const char* json) {
+    (void)ctx;
+    log_event(type, "%s", json);
+}
+
+/* <rpc_dir>/<name>.xml, NULL if missing */
+static char* c8000_rpc_load(const char* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.xml", g_cfg->c8000_rpc_dir, name);
+    FILE* f = fopen(path, "r");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* rpc = size > 0 ? malloc(size + 1) : NULL;
+    if (rpc && fread(rpc, 1, size, f) != (size_t)size) {
+        free(rpc);
+        rpc = NULL;
+    }
+    if (rpc) rpc[size] = '\0';
+    fclose(f);
+    return rpc;
+}
+
+static void c8000_setup(void) {
+    c8000_init(&g_c8000);
+    popsel_init(&g_popsel);
     
-    log_event("c8000_switch", "{\"controller\":%d}", controller);
+    int rpcs = 0;
+    for (int i = 0; i < g_cfg->controller_count; i++) {
+        g_c8000_rpc[i] = c8000_rpc_load(g_cfg->controller_names[i]);
+        if (g_c8000_rpc[i]) rpcs++;
+    }
+    if (g_cfg->c8000_host[0] && rpcs > 0) {
+        if (c8000_start(&g_c8000, g_cfg->c8000_host, g_cfg->c8000_port, g_cfg->c8000_user,
+                        g_cfg->c8000_pass, c8000_on_event, NULL) == 0) {
+            log_event("c8000", "{\"host\":\"%s\",\"port\":%d,\"rpcs\":%d}",
+                      g_cfg->c8000_host, g_cfg->c8000_port, rpcs);
+        } else {
+            log_event("c8000_error", "{\"error\":\"%s\"}", strerror(errno));
+        }
+    }
     
-    int ret = system(cmd);
-    if (ret == 0) {
-        g_status.active_controller = controller;
+    if (!g_cfg->pop_auto) return;
+    for (int i = 0; i < g_cfg->controller_count; i++) {
+        if (!g_cfg->controller_hosts[i][0]) return;     /* Unprobed PoPs: no automatic choice */
+        if (popsel_add_pop(&g_popsel, g_cfg->controller_names[i], g_cfg->controller_hosts[i]) < 0) {
+            log_event("popsel_error", "{\"controller\":\"%s\",\"host\":\"%s\",\"error\":\"%s\"}",
+                      g_cfg->controller_names[i], g_cfg->controller_hosts[i], strerror(errno));
+            return;
+        }
+    }
+    for (int i = 0; i < g_uplink_count; i++) {
+        /* Cellular sits in our namespace: its tunnel, as uplink_poll() pings */
+        const uplink_t* u = &g_uplinks[i];
+        const char* dev = u->wg[0] ? u->wg : u->interface;
+        if (popsel_add_path(&g_popsel, u->name, u->netns, dev) < 0) {
+            log_event("popsel_error", "{\"uplink\":\"%s\",\"netns\":\"%s\",\"dev\":\"%s\",\"error\":\"%s\"}",
+                      u->name, u->netns, dev, strerror(errno));
+        }
+    }
+    g_popsel.hold_ms = g_cfg->pop_hold_ms;
+    g_popsel.holddown_ms = g_cfg->pop_holddown_ms;
+    g_popsel.hyst_ms = g_cfg->pop_hyst_ms;
+    g_popsel.hyst_pct = g_cfg->pop_hyst_pct;
+    if (popsel_start(&g_popsel, c8000_on_event, NULL) == 0) {
+        log_event("popsel", "{\"pops\":%d,\"paths\":%d,\"hold_ms\":%d,\"holddown_ms\":%d}",
+                  g_popsel.npops, g_popsel.npaths, g_cfg->pop_hold_ms, g_cfg->pop_holddown_ms);
+    } else {
+        log_event("popsel_error", "{\"error\":\"%s\"}", strerror(errno));
     }
-    return ret;
+}
+
+/* Loop side: applied switches, and popsel's choice */
+static void c8000_step(void) {
+    int applied = atomic_exchange(&g_c8000.applied, -1);
+    if (applied >= 0) {
+        g_status.active_controller = applied;
+        popsel_set_current(&g_popsel, applied);
+    }
+    if (!atomic_load(&g_popsel.running)) return;
+    
+    /* Paths are the uplinks whose namespace could be entered */
+    uint32_t mask = 0;
+    for (int i = 0; i < g_popsel.npaths; i++) {
+        int u = uplinkidx_name(&g_uplink_idx, g_popsel.paths[i].name);
+        if (u >= 0 && g_uplinks[u].enabled && g_uplinks[u].available) mask |= 1u << i;
+    }
+    atomic_store(&g_popsel.mask, mask);
+    
+    int want = popsel_want(&g_popsel);
+    if (g_pop_pinned || want < 0 || c8000_pending(&g_c8000) >= 0 || atomic_load(&g_c8000_script)) return;
+    if (want == g_status.active_controller && atomic_load(&g_popsel.current) >= 0) return;
+    int64_t now = now_us();
+    if (want == g_pop_tried && now - g_pop_tried_us < POP_RETRY_MS * 1000LL) return;
+    g_pop_tried = want;
+    g_pop_tried_us = now;
+    c8000_switch(want, "auto");
+}
+
+/* The script's run, owned by its thread: it outlives this config snapshot */
+typedef struct {
+    int     controller;
+    char    cmd[512];
+} c8000_script_t;
+
+/* Detached: the script takes seconds, the loop is 10 ms */
+static void* c8000_script_thread(void* arg) {
+    c8000_script_t* run = arg;
+    int ret = system(run->cmd);
+    if (ret == 0) atomic_store(&g_c8000.applied, run->controller);
+    log_event("c8000_script", "{\"controller\":%d,\"rc\":%d}", run->controller, ret);
+    free(run);
+    atomic_store(&g_c8000_script, false);
+    return NULL;
+}
+
+/* 0 once the switch is on its way (applied later), -1 if not started */
+static int c8000_switch(int controller, const char* reason) {
+    if (controller < 0 || controller >= g_cfg->controller_count) return -1;
+    const char* name = g_cfg->controller_names[controller];
+    
+    if (atomic_load(&g_c8000.running) && g_c8000_rpc[controller]) {
+        log_event("c8000_switch", "{\"controller\":%d,\"name\":\"%s\",\"reason\":\"%s\",\"via\":\"netconf\"}",
+                  controller, name, reason);
+        c8000_request(&g_c8000, controller, g_c8000_rpc[controller]);
+        return 0;
+    }
+    
+    if (atomic_exchange(&g_c8000_script, true)) {
+        log_event("c8000_error", "{\"controller\":%d,\"error\":\"script still running\"}", controller);
+        return -1;
+    }
+    log_event("c8000_switch", "{\"controller\":%d,\"name\":\"%s\",\"reason\":\"%s\",\"via\":\"script\"}",
+              controller, name, reason);
+    c8000_script_t* run = malloc(sizeof(*run));
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (run) {
+        run->controller = controller;
+        snprintf(run->cmd, sizeof(run->cmd), "%s %s", C8000_SCRIPT, name);
+    }
+    int rc = run ? pthread_create(&th, &attr, c8000_script_thread, run) : ENOMEM;
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(run);
+        atomic_store(&g_c8000_script, false);
+        log_event("c8000_error", "{\"controller\":%d,\"error\":\"%s\"}", controller, strerror(rc));
+        return -1;
+    }
+    return 0;
 }
 
 /*=============================================================================
@@ -1482,6 +2759,8 @@ static int c8000_switch(int controller) {
 static void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
         g_running = 0;
+    } else if (sig == SIGHUP) {
+        g_reload = 1;
     }
 }
 
@@ -1491,65 +2770,20 @@ static void signal_handler(int sig) {
 
 static void uplinks_init(void) {
     memset(g_uplinks, 0, sizeof(g_uplinks));
+    g_uplink_count = g_cfg->uplink_count;
+    
+    for (int i = 0; i < g_uplink_count; i++) {
+        const uplink_conf_t* c = &g_cfg->uplinks[i];
+        uplink_t* u = &g_uplinks[i];
+        config_uplink_init(u, i, c);
+    }
     
-    /* Cell A - T-Mobile */
-    g_uplinks[UPLINK_CELL_A].id = UPLINK_CELL_A;
-    g_uplinks[UPLINK_CELL_A].type = UPLINK_TYPE_LTE;
-    strcpy(g_uplinks[UPLINK_CELL_A].name, "cell_a");
-    strcpy(g_uplinks[UPLINK_CELL_A].interface, "wwan0");
-    g_uplinks[UPLINK_CELL_A].netns[0] = '\0';
-    strcpy(g_uplinks[UPLINK_CELL_A].veth, "veth_cell_a");
-    strcpy(g_uplinks[UPLINK_CELL_A].cellular.carrier, "T-Mobile");
-    g_uplinks[UPLINK_CELL_A].enabled = true;
-    g_uplinks[UPLINK_CELL_A].is_active = true;  /* Default active */
-    
-    /* Cell B - AT&T */
-    g_uplinks[UPLINK_CELL_B].id = UPLINK_CELL_B;
-    g_uplinks[UPLINK_CELL_B].type = UPLINK_TYPE_LTE;
-    strcpy(g_uplinks[UPLINK_CELL_B].name, "cell_b");
-    strcpy(g_uplinks[UPLINK_CELL_B].interface, "wwan1");
-    g_uplinks[UPLINK_CELL_B].netns[0] = '\0';
-    strcpy(g_uplinks[UPLINK_CELL_B].veth, "veth_cell_b");
-    strcpy(g_uplinks[UPLINK_CELL_B].cellular.carrier, "AT&T");
-    g_uplinks[UPLINK_CELL_B].enabled = true;
-    
-    /* Starlink A - Roof */
-    g_uplinks[UPLINK_SL_A].id = UPLINK_SL_A;
-    g_uplinks[UPLINK_SL_A].type = UPLINK_TYPE_STARLINK;
-    strcpy(g_uplinks[UPLINK_SL_A].name, "sl_a");
-    strcpy(g_uplinks[UPLINK_SL_A].interface, "enp3s0");
-    strcpy(g_uplinks[UPLINK_SL_A].netns, "ns_sl_a");
-    strcpy(g_uplinks[UPLINK_SL_A].veth, "veth_sl_a");
-    g_uplinks[UPLINK_SL_A].enabled = true;
-    
-    /* Starlink B - Rear */
-    g_uplinks[UPLINK_SL_B].id = UPLINK_SL_B;
-    g_uplinks[UPLINK_SL_B].type = UPLINK_TYPE_STARLINK;
-    strcpy(g_uplinks[UPLINK_SL_B].name, "sl_b");
-    strcpy(g_uplinks[UPLINK_SL_B].interface, "enp4s0");
-    strcpy(g_uplinks[UPLINK_SL_B].netns, "ns_sl_b");
-    strcpy(g_uplinks[UPLINK_SL_B].veth, "veth_sl_b");
-    g_uplinks[UPLINK_SL_B].enabled = true;
-    
-    /* Fiber A - Google */
-    g_uplinks[UPLINK_FIBER1].id = UPLINK_FIBER1;
-    g_uplinks[UPLINK_FIBER1].type = UPLINK_TYPE_FIBER;
-    strcpy(g_uplinks[UPLINK_FIBER1].name, "fa");
-    strcpy(g_uplinks[UPLINK_FIBER1].interface, "enp1s0");
-    strcpy(g_uplinks[UPLINK_FIBER1].netns, "ns_fa");
-    strcpy(g_uplinks[UPLINK_FIBER1].veth, "veth_fa");
-    g_uplinks[UPLINK_FIBER1].enabled = true;
-
-    /* Fiber B - ATT */
-    g_uplinks[UPLINK_FIBER2].id = UPLINK_FIBER2;
-    g_uplinks[UPLINK_FIBER2].type = UPLINK_TYPE_FIBER;
-    strcpy(g_uplinks[UPLINK_FIBER2].name, "fb");
-    strcpy(g_uplinks[UPLINK_FIBER2].interface, "enp2s0");
-    strcpy(g_uplinks[UPLINK_FIBER2].netns, "ns_fb");
-    strcpy(g_uplinks[UPLINK_FIBER2].veth, "veth_fb");
-    g_uplinks[UPLINK_FIBER2].enabled = true;
-
-    g_status.active_uplink = UPLINK_CELL_A;
+    if (uplinkidx_build(&g_uplink_idx, g_uplinks, g_uplink_count) != 0) {
+        fprintf(stderr, "Config: duplicate uplink name, only the first is addressable\n");
+    }
+    
+    g_status.active_uplink = 0;     /* Default active: the first */
+    g_uplinks[0].is_active = true;
 }
 
 /*=============================================================================
@@ -1569,6 +2803,7 @@ int main(int argc, char** argv) {
     /* Setup */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGHUP, signal_handler);
     signal(SIGPIPE, SIG_IGN);
     
     mkdir("/run/pathsteer", 0755);
@@ -1580,49 +2815,41 @@ int main(int argc, char** argv) {
     strftime(g_status.run_id, sizeof(g_status.run_id), "%Y%m%d_%H%M%S", localtime(&now));
     
     /* Load config */
-    config_load(config_path);
+    if (config_load(config_path) != 0) return 1;
     
     /* Open log */
     char logfile[512];
-    snprintf(logfile, sizeof(logfile), "%s/pathsteer_%s.jsonl", g_config.log_path, g_status.run_id);
+    snprintf(logfile, sizeof(logfile), "%s/pathsteer_%s.jsonl", g_cfg->log_path, g_status.run_id);
     g_logfile = fopen(logfile, "a");
     
     /* Initialize */
     uplinks_init();
+    engine_setup();
     
-    /* Load enabled states from config file */
-    {
-        FILE* cf = fopen(config_path, "r");
-        if (cf) {
-            fseek(cf, 0, SEEK_END);
-            long size = ftell(cf);
-            fseek(cf, 0, SEEK_SET);
-            char* json = malloc(size + 1);
-            fread(json, 1, size, cf);
-            json[size] = 0;
-            fclose(cf);
-            
-            const char* uplink_names[] = {"cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"};
-            for (int i = 0; i < 6; i++) {
-                char search[128];
-                snprintf(search, sizeof(search), "\"%s\"", uplink_names[i]);
-                char* pos = strstr(json, search);
-                if (pos) {
-                    char* enabled = strstr(pos, "\"enabled\"");
-                    if (enabled && enabled < pos + 200) {
-                        if (strstr(enabled, "false") && strstr(enabled, "false") < enabled + 30) {
-                            g_uplinks[i].enabled = false;
-                            printf("Config: %s disabled\n", uplink_names[i]);
-                        }
-                    }
-                }
-            }
-            free(json);
+    dup_init();
+    risk_index_init();
+    routes_load();
+    model_init();
+    shadows_init();
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    
+    metrics_init(&g_metrics);
+    if (g_cfg->metrics_listen[0]) {
+        if (metrics_start(&g_metrics, g_cfg->metrics_listen) == 0) {
+            log_event("metrics", "{\"listen\":\"%s\"}", g_cfg->metrics_listen);
+        } else {
+            log_event("metrics_error", "{\"listen\":\"%s\",\"error\":\"%s\"}",
+                      g_cfg->metrics_listen, strerror(errno));
         }
     }
     
-    dup_init();
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    flightrec_setup();
+    flowmon_setup();
+    rtpmon_setup();
+    retpath_setup();
+    c8000_setup();
+    watchdog_setup();
+    config_watch_setup();
     
     /* Set initial mode */
     g_status.mode = MODE_TRIPWIRE;
@@ -1637,72 +2864,137 @@ int main(int argc, char** argv) {
     int64_t last_gps = 0;
     int64_t last_predict = 0;
     int64_t last_status = 0;
-    int probe_interval = 1000000 / g_config.sample_rate_hz;
+    int64_t last_risk_flush = now_us();
+    int64_t last_model_check = 0;
+    int64_t last_shadow_report = now_us();
+    int64_t last_metrics = 0;
     
     while (g_running) {
         int64_t now_t = now_us();
+        bool probed = false;
         
         /* Probe uplinks */
-        if (now_t - last_probe >= probe_interval) {
-            for (int i = 0; i < UPLINK_COUNT; i++) {
-        chaos_read();  /* Read chaos injection values */
+        watchdog_phase(&g_watchdog, WD_PROBE);
+        if (now_t - last_probe >= 1000000 / g_cfg->sample_rate_hz) {
+            g_probe_round_us = now_us();
+            chaos_read();  /* Read chaos injection values */
+            for (int i = 0; i < g_uplink_count; i++) {
                 uplink_poll(&g_uplinks[i]);
             }
+            if (g_cfg->trace_log) trace_write(now_t);
             last_probe = now_t;
+            probed = true;
         }
         
         /* GPS (1 Hz) */
+        watchdog_phase(&g_watchdog, WD_GPS);
         if (now_t - last_gps >= 1000000) {
             gps_poll();
+            trajectory_fix();
             last_gps = now_t;
         }
         
         /* Prediction (4 Hz) */
+        watchdog_phase(&g_watchdog, WD_PREDICT);
         if (now_t - last_predict >= RISK_INTERVAL_MS * 1000) {
-            prediction_tick();
+            engine_prediction_tick(&g_engine);
+            predictor_tick();
+            risk_index_observe();
+            corr_observe();
             last_predict = now_t;
         }
         
+        /* Risk index write-back */
+        watchdog_phase(&g_watchdog, WD_MAINT);
+        if (now_t - last_risk_flush >= RISK_FLUSH_INTERVAL_SEC * 1000000LL) {
+            risk_index_flush();
+            if (routes_changed(&g_routes, g_cfg->routes_file)) routes_load();
+            model_flush();
+            last_risk_flush = now_t;
+        }
+
+        /* Config hot reload */
+        if (config_changed()) config_reload();
+
+        /* Risk model hot swap */
+        if (now_t - last_model_check >= MODEL_RELOAD_SEC * 1000000LL) {
+            model_reload();
+            last_model_check = now_t;
+        }
+        c8000_step();
+        retpath_step();
+        
         /* State machine */
-        if (g_status.mode != MODE_TRAINING) {
-            switch (g_status.state) {
-                case STATE_NORMAL:
-                case STATE_PREPARE: {
-                    uplink_t* active = &g_uplinks[g_status.active_uplink];
-                    trigger_t t = tripwire_check(active);
-                    if (t != TRIGGER_NONE) {
-                        tripwire_fire(t, TRIGGER_NAMES[t]);
-                    }
-                    break;
-                }
-                case STATE_PROTECT:
-                    slowpath_arbitrate();
-                    /* fall through */
-                case STATE_SWITCHING:
-                case STATE_HOLDING:
-                    protection_tick();
-                    break;
-            }
+        watchdog_phase(&g_watchdog, WD_STATE);
+        int64_t decide_t = now_us();
+        engine_step(&g_engine);
+        int64_t decide = now_us() - decide_t;
+        if (g_fire_dup_start_us >= decide_t) decide -= g_fire_dup_done_us - g_fire_dup_start_us;   /* Own stage */
+        hdr_record(&g_lat[LAT_DECIDE], decide);
+        watchdog_observe(probed);
+        
+        /* Shadow policies, on the same metrics */
+        shadows_step(now_t);
+        if (now_t - last_shadow_report >= SHADOW_REPORT_SEC * 1000000LL) {
+            shadows_report("shadow_summary");
+            last_shadow_report = now_t;
         }
         
         /* Commands */
+        watchdog_phase(&g_watchdog, WD_COMMANDS);
         commands_process();
         
         /* Status output (10 Hz) */
+        watchdog_phase(&g_watchdog, WD_STATUS);
         if (now_t - last_status >= STATUS_INTERVAL_MS * 1000) {
             status_write();
             last_status = now_t;
         }
         
+        /* Flight recorder, flow and RTP monitors follow switches */
+        watchdog_phase(&g_watchdog, WD_OBSERVE);
+        flightrec_observe();
+        flowmon_observe();
+        rtpmon_observe();
+        
+        /* Prometheus exposition (1 Hz) */
+        metrics_observe();
+        if (g_metrics.fd >= 0 && now_t - last_metrics >= METRICS_RENDER_MS * 1000) {
+            metrics_render();
+            last_metrics = now_t;
+        }
+        
+        watchdog_phase(&g_watchdog, WD_IDLE);
+        lat_loop(now_t);
         usleep(10000);  /* 10ms sleep */
     }
     
     /* Shutdown */
+    shadows_report("shadow_summary");
     log_event("shutdown", "{\"run_id\":\"%s\"}", g_status.run_id);
     
+    watchdog_stop(&g_watchdog);
     dup_disable();
+    metrics_stop(&g_metrics);
+    flightrec_stop(&g_flightrec);
+    flowmon_stop(&g_flowmon);
+    rtpmon_stop(&g_rtpmon);
+    retpath_client_stop(&g_retpath);
+    popsel_stop(&g_popsel);
+    c8000_stop(&g_c8000);
+    for (int i = 0; i < g_shadow_count; i++) shadow_close(g_shadows[i]);
+    shadow_training(false);
+    risk_index_flush();
+    riskmap_free(&g_riskmap);
+    corrmap_free(&g_corrmap);
+    routes_close(&g_routes);
+    model_flush();
+    if (g_db) sqlite3_close(g_db);
     curl_global_cleanup();
     if (g_logfile) fclose(g_logfile);
+    if (g_cfg_watch >= 0) close(g_cfg_watch);
+    free((void*)g_cfg_retired);
+    free((void*)g_cfg);
     
     return 0;
 }
@@ -0,0 +1,331 @@
+/*******************************************************************************
+ * popsel.c - PathSteer Guardian PoP (Controller) Selection
+ *
+ * See popsel.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <sys/socket.h>
+
+#include "netns.h"
+#include "popsel.h"
+
+static const char* const REASON_NAMES[] = { "initial", "failover", "nearer" };
+
+static int64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint16_t icmp_checksum(const void* data, size_t len) {
+    const uint8_t* p = data;
+    uint32_t sum = 0;
+    for (; len > 1; p += 2, len -= 2) sum += (uint32_t)(p[0] << 8 | p[1]);
+    if (len) sum += (uint32_t)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return htons((uint16_t)~sum);
+}
+
+/*=============================================================================
+ * SETUP
+ *===========================================================================*/
+
+void popsel_init(popsel_t* ps) {
+    memset(ps, 0, sizeof(*ps));
+    for (int i = 0; i < POPSEL_MAX_PATHS; i++) ps->paths[i].fd = -1;
+    atomic_store(&ps->current, -1);
+    atomic_store(&ps->want, -1);
+    ps->candidate = -1;
+}
+
+int popsel_add_pop(popsel_t* ps, const char* name, const char* host) {
+    if (ps->npops >= POPSEL_MAX_POPS) {
+        errno = ENOSPC;
+        return -1;
+    }
+    struct in_addr a;
+    if (inet_pton(AF_INET, host, &a) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    popsel_pop_t* pop = &ps->pops[ps->npops++];
+    snprintf(pop->name, sizeof(pop->name), "%s", name);
+    snprintf(pop->host, sizeof(pop->host), "%s", host);
+    pop->addr = a.s_addr;
+    pop->rtt_ms = -1;
+    return 0;
+}
+
+int popsel_add_path(popsel_t* ps, const char* name, const char* netns, const char* dev) {
+    if (ps->npaths >= POPSEL_MAX_PATHS) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    int self;
+    if (netns_enter(netns, &self) < 0) return -1;
+    int fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_ICMP);
+    int err = errno;
+    netns_leave(self);
+    if (fd < 0) {
+        errno = err;
+        return -1;
+    }
+    if ((!netns || !netns[0]) && dev && dev[0] &&
+        setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, dev, (socklen_t)strlen(dev) + 1) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    popsel_path_t* p = &ps->paths[ps->npaths];
+    snprintf(p->name, sizeof(p->name), "%s", name);
+    p->fd = fd;
+    p->ident = (uint16_t)((getpid() << 3) + ps->npaths);
+    for (int j = 0; j < POPSEL_MAX_POPS; j++) ps->pairs[ps->npaths][j].rtt_ms = -1;
+    ps->npaths++;
+    return 0;
+}
+
+/*=============================================================================
+ * PROBING
+ *
+ * The echo sequence carries the PoP in its top 4 bits and the pair's probe
+ * counter below; a reply is matched back to its ring slot by that.
+ *===========================================================================*/
+
+static void probe_send(popsel_t* ps, int path, int pop, int64_t now) {
+    popsel_pair_t* pr = &ps->pairs[path][pop];
+    popsel_probe_t* slot = &pr->ring[pr->next % POPSEL_WINDOW];
+    uint16_t seq = (uint16_t)(pop << 12 | (pr->next & 0x0fff));
+    pr->next++;
+
+    struct icmphdr icmp = { .type = ICMP_ECHO };
+    icmp.un.echo.id = htons(ps->paths[path].ident);
+    icmp.un.echo.sequence = htons(seq);
+    icmp.checksum = icmp_checksum(&icmp, sizeof(icmp));
+
+    struct sockaddr_in dst = { .sin_family = AF_INET, .sin_addr.s_addr = ps->pops[pop].addr };
+    slot->seq = seq;
+    slot->sent_us = now;
+    slot->rtt_us = -1;
+    /* A send error (no route over this uplink) is a lost probe */
+    sendto(ps->paths[path].fd, &icmp, sizeof(icmp), 0, (struct sockaddr*)&dst, sizeof(dst));
+}
+
+static void probe_recv(popsel_t* ps, int path, int64_t now) {
+    uint8_t buf[512];
+    struct sockaddr_in from;
+    socklen_t fromlen;
+    ssize_t n;
+
+    while ((fromlen = sizeof(from), n = recvfrom(ps->paths[path].fd, buf, sizeof(buf), 0,
+                                                  (struct sockaddr*)&from, &fromlen)) > 0) {
+        if ((size_t)n < sizeof(struct iphdr)) continue;
+        size_t ihl = (size_t)(((struct iphdr*)buf)->ihl) * 4;
+        if ((size_t)n < ihl + sizeof(struct icmphdr)) continue;
+        struct icmphdr icmp;
+        memcpy(&icmp, buf + ihl, sizeof(icmp));
+        if (icmp.type != ICMP_ECHOREPLY || ntohs(icmp.un.echo.id) != ps->paths[path].ident) continue;
+
+        uint16_t seq = ntohs(icmp.un.echo.sequence);
+        int pop = seq >> 12;
+        if (pop >= ps->npops || ps->pops[pop].addr != from.sin_addr.s_addr) continue;
+
+        popsel_pair_t* pr = &ps->pairs[path][pop];
+        for (int k = 0; k < POPSEL_WINDOW; k++) {
+            popsel_probe_t* slot = &pr->ring[k];
+            if (slot->sent_us == 0 || slot->seq != seq || slot->rtt_us >= 0) continue;
+            int64_t rtt = now - slot->sent_us;
+            if (rtt > POPSEL_TIMEOUT_MS * 1000LL) break;    /* Already counted lost */
+            slot->rtt_us = rtt;
+            double ms = rtt / 1000.0;
+            pr->rtt_ms = pr->rtt_ms < 0 ? ms : pr->rtt_ms + POPSEL_ALPHA * (ms - pr->rtt_ms);
+            break;
+        }
+    }
+}
+
+static void pair_settle(popsel_pair_t* pr, int64_t now) {
+    int settled = 0, lost = 0;
+    for (int k = 0; k < POPSEL_WINDOW; k++) {
+        const popsel_probe_t* slot = &pr->ring[k];
+        if (slot->sent_us == 0) continue;
+        if (slot->rtt_us >= 0) {
+            settled++;
+        } else if (now - slot->sent_us > POPSEL_TIMEOUT_MS * 1000LL) {
+            settled++;
+            lost++;
+        }
+    }
+    pr->settled = settled;
+    pr->loss = settled ? (double)lost / settled : 0.0;
+    pr->healthy = settled >= POPSEL_MIN_SETTLED && pr->loss <= POPSEL_HEALTHY_LOSS && pr->rtt_ms >= 0;
+}
+
+/*=============================================================================
+ * SELECTION
+ *===========================================================================*/
+
+static void select_pop(popsel_t* ps, int64_t now) {
+    uint32_t mask = atomic_load(&ps->mask);
+    int best = -1;
+    for (int j = 0; j < ps->npops; j++) {
+        double rtt = -1;
+        for (int i = 0; i < ps->npaths; i++) {
+            const popsel_pair_t* pr = &ps->pairs[i][j];
+            if (!(mask & (1u << i)) || !pr->healthy) continue;
+            if (rtt < 0 || pr->rtt_ms < rtt) rtt = pr->rtt_ms;
+        }
+        ps->pops[j].rtt_ms = rtt;
+        if (rtt >= 0 && (best < 0 || rtt < ps->pops[best].rtt_ms)) best = j;
+    }
+
+    int cur = atomic_load(&ps->current);
+    int want = atomic_load(&ps->want);
+    int to = -1, reason = 0;
+    if (best < 0 || best == cur) {
+        ps->candidate = -1;
+    } else if (cur < 0) {
+        to = best;
+    } else if (ps->pops[cur].rtt_ms < 0) {
+        to = best;
+        reason = 1;
+    } else {
+        double gain = ps->pops[cur].rtt_ms - ps->pops[best].rtt_ms;
+        if (gain <= ps->hyst_ms || gain <= ps->hyst_pct * ps->pops[cur].rtt_ms) {
+            ps->candidate = -1;
+        } else {
+            if (best != ps->candidate) {
+                ps->candidate = best;
+                ps->candidate_us = now;
+            }
+            if (now - ps->candidate_us >= ps->hold_ms * 1000 &&
+                now - atomic_load(&ps->switched_us) >= ps->holddown_ms * 1000) {
+                to = best;
+                reason = 2;
+            }
+        }
+    }
+    if (to < 0) {
+        /* Stay; a want not acted on yet is withdrawn */
+        if (want >= 0 && want != cur && cur >= 0 && ps->pops[cur].rtt_ms >= 0) atomic_store(&ps->want, cur);
+        return;
+    }
+    if (to == want) return;
+
+    ps->candidate = -1;
+    atomic_store(&ps->want, to);
+    if (reason == 1) atomic_fetch_add(&ps->failovers, 1);
+    if (reason == 2) atomic_fetch_add(&ps->nearer, 1);
+    if (ps->on_event) {
+        char json[256];
+        snprintf(json, sizeof(json), "{\"from\":\"%s\",\"to\":\"%s\",\"reason\":\"%s\",\"rtt_ms\":%.1f,\"from_rtt_ms\":%.1f}",
+                 cur >= 0 ? ps->pops[cur].name : "", ps->pops[to].name, REASON_NAMES[reason],
+                 ps->pops[to].rtt_ms, cur >= 0 ? ps->pops[cur].rtt_ms : -1.0);
+        ps->on_event(ps->ctx, "pop_select", json);
+    }
+}
+
+static void* popsel_thread(void* arg) {
+    popsel_t* ps = arg;
+    struct pollfd pfd[POPSEL_MAX_PATHS];
+    int64_t next_round = mono_us();
+
+    while (atomic_load(&ps->running)) {
+        int64_t now = mono_us();
+        if (now >= next_round) {
+            for (int i = 0; i < ps->npaths; i++) {
+                for (int j = 0; j < ps->npops; j++) {
+                    pair_settle(&ps->pairs[i][j], now);
+                    probe_send(ps, i, j, now);
+                }
+            }
+            select_pop(ps, now);
+            next_round += POPSEL_PROBE_MS * 1000LL;
+            if (next_round < now) next_round = now + POPSEL_PROBE_MS * 1000LL;
+        }
+
+        for (int i = 0; i < ps->npaths; i++) pfd[i] = (struct pollfd){ .fd = ps->paths[i].fd, .events = POLLIN };
+        int timeout = (int)((next_round - now + 999) / 1000);
+        if (poll(pfd, ps->npaths, timeout > 0 ? timeout : 0) <= 0) continue;
+        now = mono_us();
+        for (int i = 0; i < ps->npaths; i++) {
+            if (pfd[i].revents & POLLIN) probe_recv(ps, i, now);
+        }
+    }
+    return NULL;
+}
+
+/*=============================================================================
+ * API
+ *===========================================================================*/
+
+int popsel_start(popsel_t* ps, popsel_event_cb on_event, void* ctx) {
+    if (ps->npops == 0 || ps->npaths == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    ps->on_event = on_event;
+    ps->ctx = ctx;
+
+    atomic_store(&ps->running, true);
+    int rc = pthread_create(&ps->thread, NULL, popsel_thread, ps);
+    if (rc != 0) {
+        atomic_store(&ps->running, false);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+int popsel_want(popsel_t* ps) {
+    return atomic_load(&ps->want);
+}
+
+void popsel_set_current(popsel_t* ps, int pop) {
+    atomic_store(&ps->switched_us, mono_us());
+    atomic_store(&ps->current, pop);
+    atomic_store(&ps->want, pop);
+}
+
+void popsel_stop(popsel_t* ps) {
+    if (atomic_load(&ps->running)) {
+        atomic_store(&ps->running, false);
+        pthread_join(ps->thread, NULL);
+    }
+    for (int i = 0; i < ps->npaths; i++) {
+        if (ps->paths[i].fd >= 0) close(ps->paths[i].fd);
+        ps->paths[i].fd = -1;
+    }
+}
+
+void popsel_json(const popsel_t* ps, char* out, size_t len) {
+    size_t n = snprintf(out, len, "[");
+    for (int j = 0; j < ps->npops && n < len; j++) {
+        const popsel_pop_t* pop = &ps->pops[j];
+        n += snprintf(out + n, len - n, "%s{\"name\": \"%s\", \"host\": \"%s\", \"rtt_ms\": %.1f, \"healthy\": %s, \"paths\": {",
+                      j ? ", " : "", pop->name, pop->host, pop->rtt_ms, pop->rtt_ms >= 0 ? "true" : "false");
+        for (int i = 0; i < ps->npaths && n < len; i++) {
+            const popsel_pair_t* pr = &ps->pairs[i][j];
+            n += snprintf(out + n, len - n, "%s\"%s\": {\"rtt_ms\": %.1f, \"loss\": %.2f}",
+                          i ? ", " : "", ps->paths[i].name, pr->rtt_ms, pr->loss);
+        }
+        if (n < len) n += snprintf(out + n, len - n, "}}");
+    }
+    if (n < len) snprintf(out + n, len - n, "]");
+}
@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * popsel.h - PathSteer Guardian PoP (Controller) Selection
+ *
+ * PURPOSE:
+ *   Which controller PoP the C8000 sends through used to change only when
+ *   an operator said so. popsel measures every PoP over every uplink all
+ *   the time and says which one the vehicle should be on: the nearest
+ *   healthy one, moved away from only for a clear, lasting gain.
+ *
+ * MEASUREMENT:
+ *   A thread sends one ICMP echo per uplink and PoP every POPSEL_PROBE_MS
+ *   from a raw socket in the uplink's namespace. Per pair: smoothed RTT and
+ *   loss over the last POPSEL_WINDOW settled probes. A pair is healthy
+ *   with enough settled probes and loss at most POPSEL_HEALTHY_LOSS; a PoP
+ *   is healthy over any uplink in the mask (the ones traffic may use), and
+ *   its distance is the lowest RTT among those.
+ *
+ * SELECTION:
+ *   - current unknown: the nearest healthy PoP, now
+ *   - current unhealthy: the nearest healthy PoP, now (failover)
+ *   - otherwise the nearest one only if it is closer by more than
+ *     hyst_ms (and hyst_pct of the current RTT), has stayed so for hold_ms,
+ *     and holddown_ms have passed since the last switch (nearer)
+ *   popsel_want() is the answer; the daemon switches and reports back
+ *   with popsel_set_current(). Events: "pop_select" when the answer moves.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_POPSEL_H
+#define PATHSTEER_POPSEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define POPSEL_MAX_POPS         4
+#define POPSEL_MAX_PATHS        10          /* At least MAX_UPLINKS */
+#define POPSEL_PROBE_MS         500         /* Echo per uplink and PoP */
+#define POPSEL_TIMEOUT_MS       1000        /* Not back by then: lost */
+#define POPSEL_WINDOW           20          /* Loss over this many probes */
+#define POPSEL_MIN_SETTLED      4           /* Before a pair can be healthy */
+#define POPSEL_HEALTHY_LOSS     0.2
+#define POPSEL_ALPHA            0.2         /* RTT EWMA */
+
+/* Events from the probe thread: type and its complete JSON object */
+typedef void (*popsel_event_cb)(void* ctx, const char* type, const char* json);
+
+typedef struct {
+    uint16_t    seq;
+    int64_t     sent_us;            /* 0 = slot unused */
+    int64_t     rtt_us;             /* -1 = no reply (yet) */
+} popsel_probe_t;
+
+/* One uplink to one PoP */
+typedef struct {
+    popsel_probe_t  ring[POPSEL_WINDOW];
+    uint16_t        next;           /* Probes sent */
+    double          rtt_ms;         /* EWMA, < 0 = no reply yet */
+    double          loss;           /* Over settled probes in the ring */
+    int             settled;
+    bool            healthy;
+} popsel_pair_t;
+
+typedef struct {
+    char        name[32];
+    char        host[64];
+    uint32_t    addr;               /* Network order */
+    double      rtt_ms;             /* Best healthy pair, < 0 = unhealthy */
+} popsel_pop_t;
+
+typedef struct {
+    char        name[32];
+    int         fd;                 /* Raw ICMP, in the uplink's namespace */
+    uint16_t    ident;
+} popsel_path_t;
+
+typedef struct {
+    popsel_pop_t        pops[POPSEL_MAX_POPS];
+    int                 npops;
+    popsel_path_t       paths[POPSEL_MAX_PATHS];
+    int                 npaths;
+    popsel_event_cb     on_event;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+
+    /* Policy, set before start */
+    int64_t             hold_ms;
+    int64_t             holddown_ms;
+    double              hyst_ms;
+    double              hyst_pct;
+
+    /* Set by the daemon */
+    _Atomic uint32_t    mask;       /* Uplinks traffic may use, bit i = path i */
+    _Atomic int         current;    /* PoP in use, -1 = unknown */
+    _Atomic int64_t     switched_us;
+
+    /* Probe thread's, read unlocked by status and metrics */
+    popsel_pair_t       pairs[POPSEL_MAX_PATHS][POPSEL_MAX_POPS];
+    _Atomic int         want;
+    int                 candidate;  /* Nearer, not yet held long enough */
+    int64_t             candidate_us;
+    _Atomic uint64_t    failovers, nearer;
+} popsel_t;
+
+/* Zero ps with no PoP known; popsel_stop() is then a no-op */
+void popsel_init(popsel_t* ps);
+
+/* PoP name at host (dotted IPv4). -1 with errno. */
+int  popsel_add_pop(popsel_t* ps, const char* name, const char* host);
+
+/* Uplink name, reached from netns; without one (NULL/""), bound to dev so
+ * probes can't leave by our default route. -1 with errno. */
+int  popsel_add_path(popsel_t* ps, const char* name, const char* netns, const char* dev);
+
+int  popsel_start(popsel_t* ps, popsel_event_cb on_event, void* ctx);
+
+/* PoP to be on, -1 = no healthy PoP known yet */
+int  popsel_want(popsel_t* ps);
+
+/* The daemon is now on pop (holddown starts) */
+void popsel_set_current(popsel_t* ps, int pop);
+
+void popsel_stop(popsel_t* ps);
+
+/* [{"name":..,"host":..,"rtt_ms":..,"healthy":..,"paths":{"cell_a":{"rtt_ms":..,"loss":..},..}},..] */
+void popsel_json(const popsel_t* ps, char* out, size_t len);
+
+#endif /* PATHSTEER_POPSEL_H */
@@ -0,0 +1,183 @@
+/*******************************************************************************
+ * replay.c - PathSteer Guardian Decision Replay (pathsteer-replay)
+ *
+ * PURPOSE:
+ *   Re-run the tripwire / protection state machine over recorded drives
+ *   with a different config, mode or model, much faster than real time,
+ *   and see what it would have done (see sim.h):
+ *
+ *     pathsteer-replay --config new.json /var/lib/pathsteer/logs/pathsteer_*.jsonl
+ *     pathsteer-replay --db /opt/pathsteer/data/training.db --summary-only
+ *
+ * OUTPUT (stdout, JSONL):
+ *   One line per engine decision (tripwire_fire, switch, protection_exit,
+ *   prepare, would_do, handover_predicted) and per active-path outage,
+ *   with trace time; then one "summary" line: triggers, time in protect,
+ *   duplication time and bytes, covered / missed outages.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <sqlite3.h>
+
+#include "engine.h"
+#include "sim.h"
+
+#define DEFAULT_RATE_MBPS   5.0
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--config PATH] [--db PATH] [--model PATH]\n"
+            "          [--mode tripwire|mirror|training] [--rate-mbps N] [--tick-ms N]\n"
+            "          [--summary-only] [trace.jsonl ...]\n"
+            "Without trace files, the samples table of --db is replayed.\n", prog);
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = malloc(size + 1);
+    if (buf) {
+        size_t n = fread(buf, 1, size, f);
+        buf[n] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+static double wall_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const char* config_path = NULL;
+    const char* db_path = NULL;
+    const char* model_path = NULL;
+    sim_opts_t opt = {
+        .mode = MODE_TRIPWIRE,
+        .rate_mbps = DEFAULT_RATE_MBPS,
+        .decisions = stdout,
+    };
+    int first_trace = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model_path = argv[++i];
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            const char* m = argv[++i];
+            if (strcmp(m, "tripwire") == 0) opt.mode = MODE_TRIPWIRE;
+            else if (strcmp(m, "mirror") == 0) opt.mode = MODE_MIRROR;
+            else if (strcmp(m, "training") == 0) opt.mode = MODE_TRAINING;
+            else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--rate-mbps") == 0 && i + 1 < argc) {
+            opt.rate_mbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tick-ms") == 0 && i + 1 < argc) {
+            opt.tick_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--summary-only") == 0) {
+            opt.decisions = NULL;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            first_trace = i;
+            break;
+        }
+    }
+    if (first_trace == argc && !db_path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    /* Thresholds: same keys and defaults as the daemon */
+    config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    char* json = config_path ? read_file(config_path) : NULL;
+    if (config_path && !json) {
+        fprintf(stderr, "Cannot open config: %s\n", config_path);
+        return 1;
+    }
+    engine_config_load(&cfg, json ? json : "{}");
+    free(json);
+
+    model_t model;
+    model_defaults(&model);
+    if (model_path && model_load(&model, model_path) != 0) {
+        fprintf(stderr, "Cannot load model: %s\n", model_path);
+        return 1;
+    }
+    model.lr = 0;
+    opt.model = &model;
+
+    /* Traces, and the learned failure correlation if we have the DB */
+    sim_trace_t tr = {0};
+    corrmap_t corr = {0};
+    sqlite3* db = NULL;
+    if (db_path && sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Cannot open %s: %s\n", db_path, sqlite3_errmsg(db));
+        return 1;
+    }
+    if (db && corrmap_init(&corr, CORRMAP_CAPACITY) == 0) {
+        const char* names[UPLINK_COUNT] = {"cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"};
+        if (corrmap_load(&corr, db, names, UPLINK_COUNT) > 0) opt.corr = &corr;
+    }
+
+    for (int i = first_trace; i < argc; i++) {
+        if (sim_load_jsonl(&tr, argv[i]) < 0) {
+            fprintf(stderr, "Cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (first_trace == argc && sim_load_db(&tr, db) < 0) return 1;
+    if (db) sqlite3_close(db);
+
+    if (tr.n == 0) {
+        fprintf(stderr, "No trace records (enable \"trace_log\" in the daemon config)\n");
+        return 1;
+    }
+
+    sim_result_t res;
+    double t0 = wall_sec();
+    sim_run(&tr, &cfg, &opt, &res);
+    double wall = wall_sec() - t0;
+
+    printf("{\"event\":\"summary\",\"data\":{\"records\":%zu,\"segments\":%d,\"sim_sec\":%.1f,"
+           "\"wall_sec\":%.3f,\"speedup\":%.0f,\"mode\":\"%s\",\"fires\":%d,\"triggers\":{",
+           tr.n, res.segments, res.sim_sec, wall, wall > 0 ? res.sim_sec / wall : 0.0,
+           MODE_NAMES[opt.mode], res.fires);
+    bool first = true;
+    for (int t = 1; t < TRIGGER_COUNT; t++) {
+        if (res.triggers[t] == 0) continue;
+        printf("%s\"%s\":%d", first ? "" : ",", TRIGGER_NAMES[t], res.triggers[t]);
+        first = false;
+    }
+    printf("},\"switches\":%d,\"protect_sec\":%.1f,\"protect_pct\":%.2f,"
+           "\"dup_sec\":%.1f,\"dup_mb\":%.1f,\"outages\":%d,\"outages_covered\":%d,"
+           "\"outages_missed\":%d,\"outage_sec\":%.1f}}\n",
+           res.switches, res.protect_sec,
+           res.sim_sec > 0 ? 100.0 * res.protect_sec / res.sim_sec : 0.0,
+           res.dup_sec, res.dup_bytes / 1e6, res.outages, res.outages_covered,
+           res.outages_missed, res.outage_sec);
+
+    corrmap_free(&corr);
+    sim_trace_free(&tr);
+    return 0;
+}
@@ -0,0 +1,303 @@
+/*******************************************************************************
+ * riskmap.c - PathSteer Guardian Geospatial Risk Index
+ *
+ * See riskmap.h for the overview.
+ *
+ * KEY FORMAT (64 bits):
+ *   bit 63      always set (so a valid key is never 0)
+ *   bits 32-48  latitude tile index   ((lat + 90)  / RISKMAP_TILE_DEG)
+ *   bits 8-25   longitude tile index  ((lon + 180) / RISKMAP_TILE_DEG)
+ *   bits 5-7    heading sector
+ *   bits 0-4    uplink index
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <syslog.h>
+
+#include "riskmap.h"
+
+#define KEY_VALID       (1ULL << 63)
+#define KEY_LAT_SHIFT   32
+#define KEY_LON_SHIFT   8
+#define KEY_SEC_SHIFT   5
+#define KEY_LAT_MASK    0x1FFFFULL      /* 17 bits, 90000 tiles */
+#define KEY_LON_MASK    0x3FFFFULL      /* 18 bits, 180000 tiles */
+#define KEY_SEC_MASK    0x7ULL
+#define KEY_UPL_MASK    0x1FULL
+
+/* Refuse new keys past 7/8 load - linear probing degrades quickly beyond */
+#define MAX_LOAD_NUM    7
+#define MAX_LOAD_DEN    8
+
+/*=============================================================================
+ * Table lifecycle
+ *===========================================================================*/
+
+int riskmap_init(riskmap_t* rm, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+
+    rm->slots = calloc(capacity, sizeof(riskmap_entry_t));
+    if (!rm->slots) return -1;
+    rm->mask = capacity - 1;
+    rm->count = 0;
+    rm->full_drops = 0;
+    return 0;
+}
+
+void riskmap_free(riskmap_t* rm) {
+    free(rm->slots);
+    rm->slots = NULL;
+    rm->mask = 0;
+    rm->count = 0;
+}
+
+/*=============================================================================
+ * Keys
+ *===========================================================================*/
+
+uint64_t riskmap_key(double lat, double lon, double heading, int uplink) {
+    uint64_t ilat = (uint64_t)floor((lat + 90.0) / RISKMAP_TILE_DEG) & KEY_LAT_MASK;
+    uint64_t ilon = (uint64_t)floor((lon + 180.0) / RISKMAP_TILE_DEG) & KEY_LON_MASK;
+
+    double h = fmod(heading, 360.0);
+    if (h < 0) h += 360.0;
+    uint64_t sec = (uint64_t)(h / (360.0 / RISKMAP_SECTORS)) & KEY_SEC_MASK;
+
+    return KEY_VALID |
+           (ilat << KEY_LAT_SHIFT) |
+           (ilon << KEY_LON_SHIFT) |
+           (sec << KEY_SEC_SHIFT) |
+           ((uint64_t)uplink & KEY_UPL_MASK);
+}
+
+void riskmap_key_decode(uint64_t key, double* lat, double* lon,
+                        double* heading_min, double* heading_max, int* uplink) {
+    uint64_t ilat = (key >> KEY_LAT_SHIFT) & KEY_LAT_MASK;
+    uint64_t ilon = (key >> KEY_LON_SHIFT) & KEY_LON_MASK;
+    uint64_t sec = (key >> KEY_SEC_SHIFT) & KEY_SEC_MASK;
+    double width = 360.0 / RISKMAP_SECTORS;
+
+    /* Tile center */
+    if (lat) *lat = (ilat + 0.5) * RISKMAP_TILE_DEG - 90.0;
+    if (lon) *lon = (ilon + 0.5) * RISKMAP_TILE_DEG - 180.0;
+    if (heading_min) *heading_min = sec * width;
+    if (heading_max) *heading_max = (sec + 1) * width;
+    if (uplink) *uplink = (int)(key & KEY_UPL_MASK);
+}
+
+/* splitmix64 finalizer - tiles next to each other must not share buckets */
+static inline uint32_t key_hash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (uint32_t)key;
+}
+
+/*=============================================================================
+ * Lookup / Update
+ *===========================================================================*/
+
+const riskmap_entry_t* riskmap_lookup(const riskmap_t* rm, uint64_t key) {
+    if (!rm->slots) return NULL;
+
+    uint32_t i = key_hash(key) & rm->mask;
+    for (;;) {
+        const riskmap_entry_t* e = &rm->slots[i];
+        if (e->key == key) return e;
+        if (e->key == 0) return NULL;
+        i = (i + 1) & rm->mask;
+    }
+}
+
+riskmap_entry_t* riskmap_update(riskmap_t* rm, uint64_t key,
+                                double observed, uint32_t now_s) {
+    if (!rm->slots) return NULL;
+
+    uint32_t i = key_hash(key) & rm->mask;
+    for (;;) {
+        riskmap_entry_t* e = &rm->slots[i];
+        if (e->key == key) break;
+        if (e->key == 0) {
+            if ((uint64_t)(rm->count + 1) * MAX_LOAD_DEN > (uint64_t)(rm->mask + 1) * MAX_LOAD_NUM) {
+                rm->full_drops++;
+                return NULL;
+            }
+            e->key = key;
+            e->risk = 0;
+            e->samples = 0;
+            rm->count++;
+            break;
+        }
+        i = (i + 1) & rm->mask;
+    }
+
+    riskmap_entry_t* e = &rm->slots[i];
+    if (observed < 0) observed = 0;
+    if (observed > 1) observed = 1;
+
+    /* Running mean for the first samples, then a fixed-weight EMA */
+    uint32_t n = e->samples + 1;
+    if (n > RISKMAP_EMA_MAX) n = RISKMAP_EMA_MAX;
+    e->risk += (float)((observed - e->risk) / n);
+    e->samples++;
+    e->updated_s = now_s;
+    e->dirty = 1;
+    return e;
+}
+
+double riskmap_confidence(const riskmap_entry_t* e) {
+    if (!e) return 0;
+    return e->samples / (e->samples + RISKMAP_CONF_K);
+}
+
+/*=============================================================================
+ * Persistence
+ *
+ * risk_zones is created by install.sh (id, geohash UNIQUE, ..., last_updated)
+ * and read by the Web UI. One row per key: geohash is the tile center's
+ * geohash plus the heading sector and uplink, so it stays unique per key;
+ * latitude/longitude/heading_* are the decoded tile so the Web UI can plot
+ * without knowing the key format.
+ *===========================================================================*/
+
+/* 8 characters is a ~38 x 19 m cell, well inside one tile */
+#define GEOHASH_LEN     8
+
+static void geohash_encode(double lat, double lon, char* out) {
+    static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+    double lat_lo = -90, lat_hi = 90, lon_lo = -180, lon_hi = 180;
+    int bit = 0, ch = 0, even = 1, n = 0;
+
+    while (n < GEOHASH_LEN) {
+        if (even) {
+            double mid = (lon_lo + lon_hi) / 2;
+            if (lon >= mid) { ch = (ch << 1) | 1; lon_lo = mid; }
+            else            { ch <<= 1;           lon_hi = mid; }
+        } else {
+            double mid = (lat_lo + lat_hi) / 2;
+            if (lat >= mid) { ch = (ch << 1) | 1; lat_lo = mid; }
+            else            { ch <<= 1;           lat_hi = mid; }
+        }
+        even = !even;
+        if (++bit == 5) {
+            out[n++] = base32[ch];
+            bit = ch = 0;
+        }
+    }
+    out[n] = '\0';
+}
+
+int riskmap_db_init(sqlite3* db) {
+    /* Same schema as install.sh, for a DB the installer has not created */
+    const char* sql =
+        "CREATE TABLE IF NOT EXISTS risk_zones ("
+        " id INTEGER PRIMARY KEY, geohash TEXT UNIQUE, latitude REAL, longitude REAL,"
+        " heading_min REAL, heading_max REAL, uplink TEXT, risk_score REAL,"
+        " sample_count INTEGER, last_updated DATETIME);"
+        "CREATE INDEX IF NOT EXISTS idx_zones_geo ON risk_zones(geohash)";
+    char* err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        syslog(LOG_WARNING, "riskmap: create risk_zones: %s", err ? err : "?");
+        sqlite3_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+static int uplink_index(const char* name, const char* const* names, int n_names) {
+    if (!name) return -1;
+    for (int i = 0; i < n_names; i++) {
+        if (names[i] && strcmp(names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int riskmap_load(riskmap_t* rm, sqlite3* db, const char* const* names, int n_names) {
+    /* Select by decoded columns so rows written by older tools still load */
+    sqlite3_stmt* st = NULL;
+    const char* sql =
+        "SELECT latitude, longitude, uplink, risk_score, sample_count, heading_min "
+        "FROM risk_zones";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        syslog(LOG_WARNING, "riskmap: load: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int loaded = 0;
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        int up = uplink_index((const char*)sqlite3_column_text(st, 2), names, n_names);
+        if (up < 0 || up >= RISKMAP_MAX_UPLINKS) continue;
+
+        double hmin = sqlite3_column_double(st, 5);
+        uint64_t key = riskmap_key(sqlite3_column_double(st, 0),
+                                   sqlite3_column_double(st, 1),
+                                   hmin + 0.5 * (360.0 / RISKMAP_SECTORS), up);
+
+        riskmap_entry_t* e = riskmap_update(rm, key, sqlite3_column_double(st, 3), 0);
+        if (!e) break;
+        e->risk = (float)sqlite3_column_double(st, 3);
+        e->samples = (uint32_t)sqlite3_column_int(st, 4);
+        e->updated_s = 0;
+        e->dirty = 0;
+        loaded++;
+    }
+    sqlite3_finalize(st);
+    return loaded;
+}
+
+int riskmap_flush(riskmap_t* rm, sqlite3* db, const char* const* names, int n_names) {
+    if (!rm->slots) return 0;
+
+    sqlite3_stmt* st = NULL;
+    const char* sql =
+        "INSERT OR REPLACE INTO risk_zones (geohash, latitude, longitude, uplink,"
+        " risk_score, sample_count, heading_min, heading_max, last_updated)"
+        " VALUES (?, ?, ?, ?, ?, ?, ?, ?, datetime(?, 'unixepoch'))";
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        syslog(LOG_WARNING, "riskmap: flush: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+    int written = 0;
+    for (uint32_t i = 0; i <= rm->mask; i++) {
+        riskmap_entry_t* e = &rm->slots[i];
+        if (e->key == 0 || !e->dirty) continue;
+
+        double lat, lon, hmin, hmax;
+        int up;
+        riskmap_key_decode(e->key, &lat, &lon, &hmin, &hmax, &up);
+        if (up >= n_names || !names[up]) continue;
+
+        char gh[GEOHASH_LEN + 1], zone[GEOHASH_LEN + 48];
+        geohash_encode(lat, lon, gh);
+        snprintf(zone, sizeof(zone), "%s/%u/%s", gh,
+                 (unsigned)((e->key >> KEY_SEC_SHIFT) & KEY_SEC_MASK), names[up]);
+
+        sqlite3_bind_text(st, 1, zone, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(st, 2, lat);
+        sqlite3_bind_double(st, 3, lon);
+        sqlite3_bind_text(st, 4, names[up], -1, SQLITE_STATIC);
+        sqlite3_bind_double(st, 5, e->risk);
+        sqlite3_bind_int(st, 6, (int)e->samples);
+        sqlite3_bind_double(st, 7, hmin);
+        sqlite3_bind_double(st, 8, hmax);
+        sqlite3_bind_int64(st, 9, e->updated_s);
+
+        if (sqlite3_step(st) == SQLITE_DONE) {
+            e->dirty = 0;
+            written++;
+        }
+        sqlite3_reset(st);
+    }
+    sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+    sqlite3_finalize(st);
+    return written;
+}
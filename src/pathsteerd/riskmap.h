@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * riskmap.h - PathSteer Guardian Geospatial Risk Index
+ *
+ * PURPOSE:
+ *   Learned per-location link risk, keyed by (tile, heading sector, uplink).
+ *   The earth is cut into fixed lat/lon tiles of RISKMAP_TILE_DEG degrees,
+ *   direction of travel into RISKMAP_SECTORS buckets. Each key holds an
+ *   exponential moving average of the risk we observed there.
+ *
+ * LAYOUT:
+ *   Open-addressed hash table, linear probing, power-of-two capacity.
+ *   A lookup is one hash and (almost always) one cache line - cheap enough
+ *   to run on every GPS fix for every uplink.
+ *
+ * PERSISTENCE:
+ *   Loaded from / flushed to the risk_zones table in the training DB.
+ *   The Web UI reads the same table via /api/risk_zones.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_RISKMAP_H
+#define PATHSTEER_RISKMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+/* Tile edge in degrees (~220 m north-south, ~185 m east-west at 33N) */
+#define RISKMAP_TILE_DEG        0.002
+
+/* Heading buckets (8 x 45 degrees) */
+#define RISKMAP_SECTORS         8
+
+/* Default table capacity (must be a power of two) */
+#define RISKMAP_CAPACITY        (1u << 16)
+
+/* EMA weight floor: after this many samples new data moves risk by 1/N */
+#define RISKMAP_EMA_MAX         32
+
+/* Confidence = samples / (samples + K) */
+#define RISKMAP_CONF_K          8.0
+
+/* Max uplink index that fits in a key */
+#define RISKMAP_MAX_UPLINKS     32
+
+/*-----------------------------------------------------------------------------
+ * Entry - 24 bytes, key 0 marks an empty slot
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    uint64_t    key;            /* Packed tile/sector/uplink, 0 = empty */
+    float       risk;           /* Observed risk EMA 0.0-1.0 */
+    uint32_t    samples;        /* Observations folded into risk */
+    uint32_t    updated_s;      /* Unix seconds of last update */
+    uint8_t     dirty;          /* Changed since last flush */
+} riskmap_entry_t;
+
+typedef struct {
+    riskmap_entry_t*    slots;
+    uint32_t            mask;   /* capacity - 1 */
+    uint32_t            count;  /* Occupied slots */
+    uint32_t            full_drops; /* Inserts refused at max load */
+} riskmap_t;
+
+int  riskmap_init(riskmap_t* rm, uint32_t capacity);
+void riskmap_free(riskmap_t* rm);
+
+/* Key helpers */
+uint64_t riskmap_key(double lat, double lon, double heading, int uplink);
+void     riskmap_key_decode(uint64_t key, double* lat, double* lon,
+                            double* heading_min, double* heading_max, int* uplink);
+
+/* Lookup / update */
+const riskmap_entry_t* riskmap_lookup(const riskmap_t* rm, uint64_t key);
+riskmap_entry_t*       riskmap_update(riskmap_t* rm, uint64_t key,
+                                      double observed, uint32_t now_s);
+double                 riskmap_confidence(const riskmap_entry_t* e);
+
+/* Persistence (risk_zones table). names[i] is the uplink name for index i. */
+int riskmap_db_init(sqlite3* db);
+int riskmap_load(riskmap_t* rm, sqlite3* db, const char* const* names, int n_names);
+int riskmap_flush(riskmap_t* rm, sqlite3* db, const char* const* names, int n_names);
+
+#endif /* PATHSTEER_RISKMAP_H */
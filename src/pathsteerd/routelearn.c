@@ -0,0 +1,488 @@
+/*******************************************************************************
+ * routelearn.c - PathSteer Guardian Route Learner (pathsteer-routes)
+ *
+ * PURPOSE:
+ *   Offline builder for the known-route risk file the daemon mmaps
+ *   (see routes.h). Run it after drives, e.g. nightly from cron:
+ *
+ *     pathsteer-routes --db /opt/pathsteer/data/training.db \
+ *                      --out /var/lib/pathsteer/routes.bin
+ *
+ *   The daemon notices the new file and re-maps it without a restart.
+ *
+ * ALGORITHM:
+ *   1. Load GPS-tagged samples from the training DB, in time order
+ *   2. Split into trips at time gaps / position jumps
+ *   3. Resample each trip every ROUTES_BIN_M meters
+ *   4. Longest trips first: a trip that stays within ROUTES_MATCH_M of an
+ *      existing route (either direction) is merged into it, otherwise it
+ *      starts a new route
+ *   5. Each sample's per-uplink risk is projected onto the nearest route
+ *      bin (and its neighbours, samples are sparser than bins)
+ *   6. Routes driven at least --min-trips times are written out
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "routes.h"
+
+#define DEFAULT_DB          "/opt/pathsteer/data/training.db"
+#define DEFAULT_OUT         "/var/lib/pathsteer/routes.bin"
+#define DEFAULT_MIN_TRIPS   2
+
+/* Trip segmentation */
+#define TRIP_GAP_SEC        300
+#define TRIP_JUMP_M         2000.0
+#define TRIP_MIN_M          1000.0
+
+/* A trip joins a route if this fraction of its points lie on it */
+#define MERGE_FRACTION      0.85
+
+/* Spread each sample over +/- this many bins */
+#define SPREAD_BINS         2
+
+#define DEG2RAD             (M_PI / 180.0)
+#define M_PER_DEG_LAT       111320.0
+
+/* Uplinks present in the samples table */
+static const char* COLUMNS[] = {"cell_a", "cell_b", "sl_a", "sl_b"};
+#define N_COLS  ((int)(sizeof(COLUMNS) / sizeof(COLUMNS[0])))
+
+typedef struct {
+    int64_t     t;
+    double      lat;
+    double      lon;
+    float       risk[N_COLS];   /* < 0 = no data */
+} sample_t;
+
+typedef struct {
+    double      lat;
+    double      lon;
+} pt_t;
+
+typedef struct {
+    int         first;          /* Index into samples */
+    int         count;
+    pt_t*       pts;            /* Resampled polyline */
+    int         n_pts;
+    double      length_m;
+} trip_t;
+
+typedef struct {
+    pt_t*       pts;
+    int         n_pts;
+    double      length_m;
+    double      lat_min, lat_max, lon_min, lon_max;
+    double*     sum;            /* [n_pts][N_COLS] */
+    uint32_t*   cnt;
+    int         trips;
+} route_t;
+
+/*=============================================================================
+ * Geometry
+ *===========================================================================*/
+
+static double dist_m(double lat1, double lon1, double lat2, double lon2) {
+    double dn = (lat2 - lat1) * M_PER_DEG_LAT;
+    double de = (lon2 - lon1) * M_PER_DEG_LAT * cos(lat1 * DEG2RAD);
+    return sqrt(dn * dn + de * de);
+}
+
+/* Nearest route point within max_m, -1 if none */
+static int route_nearest(const route_t* r, double lat, double lon, double max_m) {
+    double margin = max_m / M_PER_DEG_LAT * 2;
+    if (lat < r->lat_min - margin || lat > r->lat_max + margin ||
+        lon < r->lon_min - margin || lon > r->lon_max + margin) {
+        return -1;
+    }
+
+    int best = -1;
+    double best_d = max_m;
+    for (int i = 0; i < r->n_pts; i++) {
+        double d = dist_m(lat, lon, r->pts[i].lat, r->pts[i].lon);
+        if (d <= best_d) {
+            best_d = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/*=============================================================================
+ * Sample risk
+ *
+ * Same spirit as the daemon's observed_risk(): what the link was doing,
+ * from the raw columns training-collect.sh records.
+ *===========================================================================*/
+
+static float cell_risk(double rtt, double rsrp) {
+    if (rtt == 0 && rsrp == 0) return -1;
+
+    float r = 0;
+    if (rsrp != 0) {
+        if (rsrp < -115) r = 0.8f;
+        else if (rsrp < -110) r = 0.5f;
+        else if (rsrp < -100) r = 0.2f;
+    }
+    if (rtt > 300) r = fmaxf(r, 0.6f);
+    else if (rtt > 150) r = fmaxf(r, 0.3f);
+    return r;
+}
+
+static float sl_risk(double rtt, int obstructed) {
+    if (obstructed) return 1.0f;
+    if (rtt == 0) return -1;
+    return rtt > 200 ? 0.5f : 0.0f;
+}
+
+/*=============================================================================
+ * Load
+ *===========================================================================*/
+
+static sample_t* load_samples(sqlite3* db, int* n_out) {
+    const char* sql =
+        "SELECT CAST(strftime('%s', timestamp) AS INTEGER), lat, lon,"
+        " cell_a_rtt, cell_a_rsrp, cell_b_rtt, cell_b_rsrp,"
+        " sl_a_rtt, sl_a_obstructed, sl_b_rtt, sl_b_obstructed,"
+        " active_uplink, risk"
+        " FROM samples WHERE lat IS NOT NULL AND lat != 0 AND lon != 0"
+        " ORDER BY timestamp";
+    sqlite3_stmt* st;
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        fprintf(stderr, "query samples: %s\n", sqlite3_errmsg(db));
+        return NULL;
+    }
+
+    int cap = 4096, n = 0;
+    sample_t* s = malloc(cap * sizeof(*s));
+    while (s && sqlite3_step(st) == SQLITE_ROW) {
+        if (n == cap) {
+            cap *= 2;
+            sample_t* tmp = realloc(s, cap * sizeof(*s));
+            if (!tmp) { free(s); s = NULL; break; }
+            s = tmp;
+        }
+        sample_t* x = &s[n++];
+        x->t = sqlite3_column_int64(st, 0);
+        x->lat = sqlite3_column_double(st, 1);
+        x->lon = sqlite3_column_double(st, 2);
+        x->risk[0] = cell_risk(sqlite3_column_double(st, 3), sqlite3_column_double(st, 4));
+        x->risk[1] = cell_risk(sqlite3_column_double(st, 5), sqlite3_column_double(st, 6));
+        x->risk[2] = sl_risk(sqlite3_column_double(st, 7), sqlite3_column_int(st, 8));
+        x->risk[3] = sl_risk(sqlite3_column_double(st, 9), sqlite3_column_int(st, 10));
+
+        /* The daemon's own risk for whatever was active at the time */
+        const char* active = (const char*)sqlite3_column_text(st, 11);
+        double risk = sqlite3_column_double(st, 12);
+        for (int c = 0; active && c < N_COLS; c++) {
+            if (strcmp(active, COLUMNS[c]) == 0 && risk > x->risk[c]) {
+                x->risk[c] = (float)risk;
+            }
+        }
+    }
+    sqlite3_finalize(st);
+    *n_out = n;
+    return s;
+}
+
+/*=============================================================================
+ * Trips
+ *===========================================================================*/
+
+/* Resample samples[first..first+count) every ROUTES_BIN_M meters */
+static void trip_resample(trip_t* t, const sample_t* s) {
+    int cap = (int)(t->length_m / ROUTES_BIN_M) + 2;
+    t->pts = malloc(cap * sizeof(pt_t));
+    t->n_pts = 0;
+    if (!t->pts) return;
+
+    double next = 0, walked = 0;
+    for (int i = t->first; i < t->first + t->count - 1 && t->n_pts < cap; i++) {
+        double seg = dist_m(s[i].lat, s[i].lon, s[i + 1].lat, s[i + 1].lon);
+        while (next <= walked + seg && t->n_pts < cap) {
+            double f = seg > 0 ? (next - walked) / seg : 0;
+            t->pts[t->n_pts].lat = s[i].lat + f * (s[i + 1].lat - s[i].lat);
+            t->pts[t->n_pts].lon = s[i].lon + f * (s[i + 1].lon - s[i].lon);
+            t->n_pts++;
+            next += ROUTES_BIN_M;
+        }
+        walked += seg;
+    }
+}
+
+static trip_t* split_trips(const sample_t* s, int n, int* n_out) {
+    trip_t* trips = calloc(n > 0 ? n : 1, sizeof(trip_t));
+    int nt = 0;
+    if (!trips) return NULL;
+
+    int start = 0;
+    double len = 0;
+    for (int i = 1; i <= n; i++) {
+        bool cut = (i == n);
+        double d = 0;
+        if (!cut) {
+            d = dist_m(s[i - 1].lat, s[i - 1].lon, s[i].lat, s[i].lon);
+            cut = (s[i].t - s[i - 1].t > TRIP_GAP_SEC) || d > TRIP_JUMP_M;
+        }
+        if (cut) {
+            if (len >= TRIP_MIN_M) {
+                trips[nt].first = start;
+                trips[nt].count = i - start;
+                trips[nt].length_m = len;
+                trip_resample(&trips[nt], s);
+                nt++;
+            }
+            start = i;
+            len = 0;
+        } else {
+            len += d;
+        }
+    }
+    *n_out = nt;
+    return trips;
+}
+
+static int trip_cmp_len(const void* a, const void* b) {
+    double la = ((const trip_t*)a)->length_m, lb = ((const trip_t*)b)->length_m;
+    return (la < lb) - (la > lb);
+}
+
+/*=============================================================================
+ * Clustering
+ *===========================================================================*/
+
+static double trip_fraction_on(const trip_t* t, const route_t* r) {
+    int on = 0, total = 0;
+    for (int i = 0; i < t->n_pts; i += 4) {
+        total++;
+        if (route_nearest(r, t->pts[i].lat, t->pts[i].lon, ROUTES_MATCH_M) >= 0) on++;
+    }
+    return total ? (double)on / total : 0;
+}
+
+static int route_from_trip(route_t* r, trip_t* t) {
+    memset(r, 0, sizeof(*r));
+    r->pts = t->pts;            /* Take ownership */
+    r->n_pts = t->n_pts;
+    r->length_m = t->length_m;
+    t->pts = NULL;
+
+    r->sum = calloc((size_t)r->n_pts * N_COLS, sizeof(double));
+    r->cnt = calloc((size_t)r->n_pts * N_COLS, sizeof(uint32_t));
+    if (!r->sum || !r->cnt) return -1;
+
+    r->lat_min = r->lat_max = r->pts[0].lat;
+    r->lon_min = r->lon_max = r->pts[0].lon;
+    for (int i = 1; i < r->n_pts; i++) {
+        r->lat_min = fmin(r->lat_min, r->pts[i].lat);
+        r->lat_max = fmax(r->lat_max, r->pts[i].lat);
+        r->lon_min = fmin(r->lon_min, r->pts[i].lon);
+        r->lon_max = fmax(r->lon_max, r->pts[i].lon);
+    }
+    return 0;
+}
+
+static void route_accumulate(route_t* r, const trip_t* t, const sample_t* s) {
+    for (int i = t->first; i < t->first + t->count; i++) {
+        int bin = route_nearest(r, s[i].lat, s[i].lon, ROUTES_MATCH_M);
+        if (bin < 0) continue;
+        for (int b = bin - SPREAD_BINS; b <= bin + SPREAD_BINS; b++) {
+            if (b < 0 || b >= r->n_pts) continue;
+            for (int c = 0; c < N_COLS; c++) {
+                if (s[i].risk[c] < 0) continue;
+                r->sum[(size_t)b * N_COLS + c] += s[i].risk[c];
+                r->cnt[(size_t)b * N_COLS + c]++;
+            }
+        }
+    }
+    r->trips++;
+}
+
+/*=============================================================================
+ * Output
+ *===========================================================================*/
+
+static uint64_t align8(uint64_t x) {
+    return (x + 7) & ~7ULL;
+}
+
+static int write_routes(const char* path, route_t* routes, int n_routes, int min_trips) {
+    int n_out = 0;
+    for (int i = 0; i < n_routes; i++) {
+        if (routes[i].trips >= min_trips) n_out++;
+    }
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        perror(tmp);
+        return -1;
+    }
+
+    routes_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = ROUTES_MAGIC;
+    hdr.version = ROUTES_VERSION;
+    hdr.n_routes = n_out;
+    hdr.n_uplinks = N_COLS;
+    hdr.bin_m = ROUTES_BIN_M;
+    hdr.built_s = (uint32_t)time(NULL);
+    for (int c = 0; c < N_COLS; c++) {
+        snprintf(hdr.uplink_names[c], sizeof(hdr.uplink_names[c]), "%s", COLUMNS[c]);
+    }
+
+    /* Lay out descriptors first so payload offsets are known */
+    route_desc_t* desc = calloc(n_out > 0 ? n_out : 1, sizeof(route_desc_t));
+    if (!desc) {
+        fclose(f);
+        return -1;
+    }
+    uint64_t off = align8(sizeof(hdr) + (uint64_t)n_out * sizeof(route_desc_t));
+    for (int i = 0, k = 0; i < n_routes; i++) {
+        if (routes[i].trips < min_trips) continue;
+        desc[k].id = k;
+        desc[k].n_bins = routes[i].n_pts;
+        desc[k].trips = routes[i].trips;
+        desc[k].length_m = (float)routes[i].length_m;
+        desc[k].points_off = off;
+        off = align8(off + (uint64_t)routes[i].n_pts * sizeof(route_point_t));
+        desc[k].profile_off = off;
+        off = align8(off + (uint64_t)routes[i].n_pts * N_COLS);
+        k++;
+    }
+
+    static const uint8_t zeros[8];
+    uint64_t pos = 0;
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(desc, sizeof(route_desc_t), n_out, f);
+    pos = sizeof(hdr) + (uint64_t)n_out * sizeof(route_desc_t);
+
+    for (int i = 0, k = 0; i < n_routes; i++) {
+        route_t* r = &routes[i];
+        if (r->trips < min_trips) continue;
+
+        fwrite(zeros, 1, desc[k].points_off - pos, f);
+        for (int p = 0; p < r->n_pts; p++) {
+            route_point_t rp = {(float)r->pts[p].lat, (float)r->pts[p].lon};
+            fwrite(&rp, sizeof(rp), 1, f);
+        }
+        pos = desc[k].points_off + (uint64_t)r->n_pts * sizeof(route_point_t);
+
+        fwrite(zeros, 1, desc[k].profile_off - pos, f);
+        for (int p = 0; p < r->n_pts; p++) {
+            uint8_t row[N_COLS];
+            for (int c = 0; c < N_COLS; c++) {
+                uint32_t n = r->cnt[(size_t)p * N_COLS + c];
+                double v = n ? r->sum[(size_t)p * N_COLS + c] / n : -1;
+                row[c] = v < 0 ? ROUTES_RISK_UNKNOWN : (uint8_t)lround(fmin(v, 1.0) * 254);
+            }
+            fwrite(row, 1, N_COLS, f);
+        }
+        pos = desc[k].profile_off + (uint64_t)r->n_pts * N_COLS;
+        k++;
+    }
+    free(desc);
+
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror(path);
+        unlink(tmp);
+        return -1;
+    }
+    return n_out;
+}
+
+/*=============================================================================
+ * Main
+ *===========================================================================*/
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--db PATH] [--out PATH] [--min-trips N]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    const char* db_path = DEFAULT_DB;
+    const char* out_path = DEFAULT_OUT;
+    int min_trips = DEFAULT_MIN_TRIPS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--min-trips") == 0 && i + 1 < argc) {
+            min_trips = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    sqlite3* db;
+    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Cannot open %s: %s\n", db_path, sqlite3_errmsg(db));
+        return 1;
+    }
+
+    int n_samples = 0;
+    sample_t* samples = load_samples(db, &n_samples);
+    sqlite3_close(db);
+    if (!samples) return 1;
+
+    int n_trips = 0;
+    trip_t* trips = split_trips(samples, n_samples, &n_trips);
+    if (!trips) return 1;
+    qsort(trips, n_trips, sizeof(trip_t), trip_cmp_len);
+
+    route_t* routes = calloc(n_trips > 0 ? n_trips : 1, sizeof(route_t));
+    int n_routes = 0;
+    if (!routes) return 1;
+
+    for (int i = 0; i < n_trips; i++) {
+        trip_t* t = &trips[i];
+        if (t->n_pts < 2) continue;
+
+        route_t* home = NULL;
+        double best = MERGE_FRACTION;
+        for (int r = 0; r < n_routes; r++) {
+            double f = trip_fraction_on(t, &routes[r]);
+            if (f >= best) {
+                best = f;
+                home = &routes[r];
+            }
+        }
+        if (!home) {
+            if (route_from_trip(&routes[n_routes], t) != 0) return 1;
+            home = &routes[n_routes++];
+        }
+        route_accumulate(home, t, samples);
+    }
+
+    int written = write_routes(out_path, routes, n_routes, min_trips);
+    if (written < 0) return 1;
+
+    printf("samples=%d trips=%d routes=%d written=%d (min_trips=%d) -> %s\n",
+           n_samples, n_trips, n_routes, written, min_trips, out_path);
+
+    for (int i = 0; i < n_trips; i++) free(trips[i].pts);
+    for (int i = 0; i < n_routes; i++) {
+        free(routes[i].pts);
+        free(routes[i].sum);
+        free(routes[i].cnt);
+    }
+    free(trips);
+    free(routes);
+    free(samples);
+    return 0;
+}
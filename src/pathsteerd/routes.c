@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * routes.c - PathSteer Guardian Known-Route Risk Profiles (runtime side)
+ *
+ * See routes.h for the file format. The builder is routelearn.c.
+ *
+ * Map matching is a local search around the last matched bin; only when we
+ * lose the route (or have none) do we scan every polyline point. With a few
+ * dozen routes that global scan is well under a millisecond, once per fix.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "routes.h"
+
+#define DEG2RAD         (M_PI / 180.0)
+#define M_PER_DEG_LAT   111320.0
+
+/* Version 1 files: the header held 8 uplink names */
+#define ROUTES_V1_MAX_UPLINKS   8
+#define ROUTES_V1_HDR_LEN       (offsetof(routes_hdr_t, uplink_names) + \
+                                 ROUTES_V1_MAX_UPLINKS * sizeof(((routes_hdr_t*)0)->uplink_names[0]))
+
+/*=============================================================================
+ * Geometry
+ *===========================================================================*/
+
+static double dist_m(double lat1, double lon1, double lat2, double lon2) {
+    double dn = (lat2 - lat1) * M_PER_DEG_LAT;
+    double de = (lon2 - lon1) * M_PER_DEG_LAT * cos(lat1 * DEG2RAD);
+    return sqrt(dn * dn + de * de);
+}
+
+static double angle_diff(double a, double b) {
+    double d = fmod(fabs(a - b), 360.0);
+    return d > 180.0 ? 360.0 - d : d;
+}
+
+/* Bearing of the polyline at bin i, in the direction of increasing bins */
+static double route_bearing(const routes_t* rt, const route_desc_t* r, uint32_t i) {
+    const route_point_t* p = (const route_point_t*)((const uint8_t*)rt->base + r->points_off);
+    uint32_t a = i, b = i + 1;
+    if (b >= r->n_bins) {
+        if (i == 0) return 0;
+        a = i - 1;
+        b = i;
+    }
+    double dn = (p[b].lat - p[a].lat) * M_PER_DEG_LAT;
+    double de = (p[b].lon - p[a].lon) * M_PER_DEG_LAT * cos(p[a].lat * DEG2RAD);
+    double h = atan2(de, dn) / DEG2RAD;
+    return h < 0 ? h + 360.0 : h;
+}
+
+/*=============================================================================
+ * File lifecycle
+ *===========================================================================*/
+
+int routes_open(routes_t* rt, const char* path) {
+    memset(rt, 0, sizeof(*rt));
+    rt->route = -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ROUTES_V1_HDR_LEN) {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const routes_hdr_t* h = base;
+    bool v1 = h->version == 1;
+    size_t hdr_len = v1 ? ROUTES_V1_HDR_LEN : sizeof(*h);
+    size_t need = hdr_len + (size_t)h->n_routes * sizeof(route_desc_t);
+    if (h->magic != ROUTES_MAGIC || (h->version != ROUTES_VERSION && !v1) ||
+        h->n_uplinks == 0 || h->n_uplinks > (v1 ? ROUTES_V1_MAX_UPLINKS : ROUTES_MAX_UPLINKS) ||
+        need > (size_t)st.st_size) {
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    /* Every route must lie inside the file */
+    const route_desc_t* routes = (const route_desc_t*)((const uint8_t*)base + hdr_len);
+    for (uint32_t i = 0; i < h->n_routes; i++) {
+        const route_desc_t* r = &routes[i];
+        if (r->points_off + (uint64_t)r->n_bins * sizeof(route_point_t) > (uint64_t)st.st_size ||
+            r->profile_off + (uint64_t)r->n_bins * h->n_uplinks > (uint64_t)st.st_size) {
+            munmap(base, st.st_size);
+            return -1;
+        }
+    }
+
+    rt->base = base;
+    rt->size = st.st_size;
+    rt->mtime = st.st_mtime;
+    rt->hdr = h;
+    rt->routes = routes;
+    return 0;
+}
+
+void routes_close(routes_t* rt) {
+    if (rt->base) munmap(rt->base, rt->size);
+    memset(rt, 0, sizeof(*rt));
+    rt->route = -1;
+}
+
+bool routes_changed(const routes_t* rt, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    return st.st_mtime != rt->mtime;
+}
+
+int routes_column(const routes_t* rt, const char* uplink_name) {
+    if (!rt->base) return -1;
+    for (uint32_t i = 0; i < rt->hdr->n_uplinks; i++) {
+        if (strncmp(rt->hdr->uplink_names[i], uplink_name,
+                    sizeof(rt->hdr->uplink_names[i])) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+uint32_t routes_trips(const routes_t* rt) {
+    return rt->route >= 0 ? rt->routes[rt->route].trips : 0;
+}
+
+/*=============================================================================
+ * Map matching
+ *===========================================================================*/
+
+/* Heading vs. polyline: +1 along, -1 against, 0 neither */
+static int match_dir(const routes_t* rt, const route_desc_t* r, uint32_t bin, double heading) {
+    double b = route_bearing(rt, r, bin);
+    if (angle_diff(b, heading) <= ROUTES_MATCH_HDG_DEG) return 1;
+    if (angle_diff(b + 180.0, heading) <= ROUTES_MATCH_HDG_DEG) return -1;
+    return 0;
+}
+
+bool routes_match(routes_t* rt, double lat, double lon, double heading) {
+    if (!rt->base) return false;
+
+    /* Tracking: search a window around where we were, biased forward */
+    if (rt->route >= 0) {
+        const route_desc_t* r = &rt->routes[rt->route];
+        const route_point_t* p = (const route_point_t*)((const uint8_t*)rt->base + r->points_off);
+        int64_t back = rt->dir > 0 ? ROUTES_WINDOW_BACK : ROUTES_WINDOW_FWD;
+        int64_t fwd = rt->dir > 0 ? ROUTES_WINDOW_FWD : ROUTES_WINDOW_BACK;
+        int64_t lo = (int64_t)rt->pos - back;
+        int64_t hi = (int64_t)rt->pos + fwd;
+        if (lo < 0) lo = 0;
+        if (hi >= (int64_t)r->n_bins) hi = (int64_t)r->n_bins - 1;
+
+        double best_d = ROUTES_MATCH_M;
+        int64_t best = -1;
+        for (int64_t i = lo; i <= hi; i++) {
+            double d = dist_m(lat, lon, p[i].lat, p[i].lon);
+            if (d <= best_d) {
+                best_d = d;
+                best = i;
+            }
+        }
+
+        if (best >= 0 && match_dir(rt, r, (uint32_t)best, heading) == rt->dir) {
+            rt->pos = (uint32_t)best;
+            rt->misses = 0;
+            rt->offset_m = best_d;
+            return true;
+        }
+
+        /* Ride out a GPS glitch before letting go */
+        if (++rt->misses < ROUTES_MAX_MISSES) return true;
+        rt->route = -1;
+    }
+
+    /* Acquisition: nearest heading-consistent point on any route */
+    double best_d = ROUTES_MATCH_M;
+    for (uint32_t ri = 0; ri < rt->hdr->n_routes; ri++) {
+        const route_desc_t* r = &rt->routes[ri];
+        const route_point_t* p = (const route_point_t*)((const uint8_t*)rt->base + r->points_off);
+        for (uint32_t i = 0; i < r->n_bins; i++) {
+            double d = dist_m(lat, lon, p[i].lat, p[i].lon);
+            if (d > best_d) continue;
+            int dir = match_dir(rt, r, i, heading);
+            if (dir == 0) continue;
+            best_d = d;
+            rt->route = (int)ri;
+            rt->pos = i;
+            rt->dir = dir;
+        }
+    }
+
+    rt->misses = 0;
+    rt->offset_m = best_d;
+    return rt->route >= 0;
+}
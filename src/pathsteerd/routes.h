@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * routes.h - PathSteer Guardian Known-Route Risk Profiles
+ *
+ * PURPOSE:
+ *   Vehicles drive the same roads every day. pathsteer-routes (routelearn.c)
+ *   clusters GPS traces from the training DB into known routes and bakes a
+ *   dense 1-D risk profile per uplink along each one. The daemon mmaps the
+ *   result, map-matches its position onto a route and reads the upcoming
+ *   risk with a sequential scan - no 2-D lookups while on a known road.
+ *
+ * FILE LAYOUT (native endian, all offsets from start of file):
+ *   routes_hdr_t
+ *   route_desc_t[n_routes]
+ *   per route, at points_off:  route_point_t[n_bins]
+ *   per route, at profile_off: uint8_t[n_bins][n_uplinks]
+ *
+ *   The polyline is resampled every bin_m meters, so point i and profile
+ *   row i describe the same stretch of road. Risk is 0..254 (x/254),
+ *   ROUTES_RISK_UNKNOWN where no drive has produced data.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_ROUTES_H
+#define PATHSTEER_ROUTES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ROUTES_MAGIC            0x53545250u     /* "PRTS" */
+#define ROUTES_VERSION          2           /* 1: room for 8 uplink names, still read */
+#define ROUTES_MAX_UPLINKS      10          /* At least MAX_UPLINKS */
+#define ROUTES_RISK_UNKNOWN     0xFF
+
+/* Profile resolution */
+#define ROUTES_BIN_M            25.0
+
+/* Map matching: max distance from the polyline, and heading tolerance */
+#define ROUTES_MATCH_M          40.0
+#define ROUTES_MATCH_HDG_DEG    60.0
+
+/* Drop the match after this many fixes off the route */
+#define ROUTES_MAX_MISSES       3
+
+/* Local search window around the last matched bin */
+#define ROUTES_WINDOW_BACK      8
+#define ROUTES_WINDOW_FWD       40
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    n_routes;
+    uint32_t    n_uplinks;                      /* Columns per profile row */
+    float       bin_m;
+    uint32_t    built_s;                        /* Unix time of build */
+    char        uplink_names[ROUTES_MAX_UPLINKS][16];
+} routes_hdr_t;
+
+typedef struct {
+    uint32_t    id;
+    uint32_t    n_bins;
+    uint64_t    points_off;
+    uint64_t    profile_off;
+    uint32_t    trips;                          /* Drives merged into this route */
+    float       length_m;
+} route_desc_t;
+
+typedef struct {
+    float       lat;
+    float       lon;
+} route_point_t;
+
+/*-----------------------------------------------------------------------------
+ * Runtime handle (daemon side)
+ *---------------------------------------------------------------------------*/
+typedef struct {
+    void*                   base;       /* mmap of the file, NULL if none */
+    size_t                  size;
+    int64_t                 mtime;      /* For reload on rebuild */
+    const routes_hdr_t*     hdr;
+    const route_desc_t*     routes;
+
+    /* Match state */
+    int                     route;      /* Matched route index, -1 if none */
+    uint32_t                pos;        /* Current bin */
+    int                     dir;        /* +1 along polyline, -1 against */
+    int                     misses;
+    double                  offset_m;   /* Distance from polyline at match */
+} routes_t;
+
+int  routes_open(routes_t* rt, const char* path);
+void routes_close(routes_t* rt);
+bool routes_changed(const routes_t* rt, const char* path);
+
+/* Profile column for an uplink name, -1 if the file has none */
+int  routes_column(const routes_t* rt, const char* uplink_name);
+
+/* Feed a GPS fix. Returns true while matched to a route. */
+bool routes_match(routes_t* rt, double lat, double lon, double heading);
+
+/* Trips behind the matched route (0 if unmatched) */
+uint32_t routes_trips(const routes_t* rt);
+
+/*
+ * Risk 0.0-1.0 of the bin `ahead` bins in front of the matched position,
+ * in the direction of travel. Negative if unknown or past the route end.
+ */
+static inline double routes_risk_at(const routes_t* rt, int col, uint32_t ahead) {
+    if (rt->route < 0 || col < 0) return -1;
+    const route_desc_t* r = &rt->routes[rt->route];
+    int64_t bin = (int64_t)rt->pos + (int64_t)rt->dir * ahead;
+    if (bin < 0 || bin >= (int64_t)r->n_bins) return -1;
+    const uint8_t* row = (const uint8_t*)rt->base + r->profile_off +
+                         (uint64_t)bin * rt->hdr->n_uplinks;
+    uint8_t v = row[col];
+    return v == ROUTES_RISK_UNKNOWN ? -1 : v / 254.0;
+}
+
+#endif /* PATHSTEER_ROUTES_H */
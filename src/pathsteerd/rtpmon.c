@@ -0,0 +1,624 @@
+/*******************************************************************************
+ * rtpmon.c - PathSteer Guardian RTP Stream Quality Monitor
+ *
+ * See rtpmon.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "netns.h"
+#include "rtpmon.h"
+
+#define RTPMON_SNAPLEN          128         /* IPv6 + UDP + RTP header */
+#define RTPMON_RCVBUF           (1 << 20)
+#define RTPMON_SEQ_WINDOW       128         /* Late packets recognised this far back */
+#define RTPMON_MAX_DROPOUT      3000        /* Larger jumps are a restart, not loss */
+
+static const char* LOSS_NAMES[] = { "switch", "dup", "other" };
+
+static int64_t realtime_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*=============================================================================
+ * E-Model (ITU-T G.107)
+ *===========================================================================*/
+
+double rtpmon_mos(const rtpmon_loss_stats_t* s, uint8_t pt, double jitter_ms, double delay_ms) {
+    /* Equipment impairment and packet-loss robustness per codec (G.113) */
+    double ie = 0.0, bpl = 25.1;            /* G.711 with PLC */
+    if (pt == 18) {
+        ie = 11.0;                          /* G.729(A) */
+        bpl = 19.0;
+    }
+
+    uint64_t expected = s->received + s->lost;
+    double ppl = expected ? 100.0 * s->lost / expected : 0.0;
+
+    /* BurstR = 1 / (p + q): 1 for random loss, > 1 when losses cluster */
+    double p = s->received ? (double)s->rl / s->received : 0.0;
+    double q = s->lost ? (double)s->lr / s->lost : 1.0;
+    double burst_r = p + q > 0 ? 1.0 / (p + q) : 1.0;
+    if (burst_r < 0.1) burst_r = 0.1;
+    double ie_eff = ie + (95.0 - ie) * ppl / (ppl / burst_r + bpl);
+
+    /* Mouth-to-ear: path + jitter buffer + one frame */
+    double d = delay_ms + 2.0 * jitter_ms + RTPMON_FRAME_MS;
+    double id = 0.024 * d + (d > 177.3 ? 0.11 * (d - 177.3) : 0.0);
+
+    double r = 93.2 - id - ie_eff;
+    if (r <= 0) return 1.0;
+    if (r >= 100) return 4.5;
+    return 1.0 + 0.035 * r + r * (r - 60.0) * (100.0 - r) * 7e-6;
+}
+
+/*=============================================================================
+ * Attribution
+ *===========================================================================*/
+
+static bool in_dup(const rtpmon_t* rm, int64_t t) {
+    for (int i = 0; i < RTPMON_MARKS; i++) {
+        if (rm->dup_on_us[i] && t >= rm->dup_on_us[i] && (!rm->dup_off_us[i] || t <= rm->dup_off_us[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void blame(rtpmon_t* rm, rtpmon_stream_t* s, int64_t t, uint32_t n, int64_t* hit_switch) {
+    for (int i = 0; i < RTPMON_MARKS; i++) {
+        rtpmon_switch_t* sw = &rm->switches[i];
+        if (sw->t_us && t >= sw->t_us - RTPMON_SWITCH_PRE_MS * 1000LL &&
+            t <= sw->t_us + RTPMON_SWITCH_POST_MS * 1000LL) {
+            s->lost_by[RTPMON_LOSS_SWITCH] += n;
+            sw->lost += n;
+            if (*hit_switch != sw->t_us) {
+                sw->streams++;
+                *hit_switch = sw->t_us;
+            }
+            return;
+        }
+    }
+    s->lost_by[in_dup(rm, t) ? RTPMON_LOSS_DUP : RTPMON_LOSS_OTHER] += n;
+}
+
+/* Classify bursts old enough that any switch they caused has been marked */
+static void classify(rtpmon_t* rm, rtpmon_stream_t* s, int64_t now, bool all) {
+    int64_t hit_switch = 0;
+    while (s->burst_count > 0) {
+        int i = s->burst_head;
+        if (!all && now - s->burst_us[i] <= RTPMON_SWITCH_PRE_MS * 1000LL) break;
+        if (s->burst_n[i]) blame(rm, s, s->burst_us[i], s->burst_n[i], &hit_switch);
+        s->burst_head = (i + 1) % RTPMON_BURSTS;
+        s->burst_count--;
+    }
+}
+
+static void burst_add(rtpmon_t* rm, rtpmon_stream_t* s, int64_t t, uint32_t n) {
+    if (s->burst_count == RTPMON_BURSTS) {
+        int64_t hit_switch = 0;
+        blame(rm, s, s->burst_us[s->burst_head], s->burst_n[s->burst_head], &hit_switch);
+        s->burst_head = (s->burst_head + 1) % RTPMON_BURSTS;
+        s->burst_count--;
+    }
+    int i = (s->burst_head + s->burst_count) % RTPMON_BURSTS;
+    s->burst_us[i] = t;
+    s->burst_n[i] = n;
+    s->burst_count++;
+}
+
+/* A packet counted lost turned up late: take it back from the newest burst */
+static void burst_unlose(rtpmon_stream_t* s) {
+    for (int k = s->burst_count - 1; k >= 0; k--) {
+        int i = (s->burst_head + k) % RTPMON_BURSTS;
+        if (s->burst_n[i]) {
+            s->burst_n[i]--;
+            return;
+        }
+    }
+}
+
+/*=============================================================================
+ * Streams
+ *===========================================================================*/
+
+typedef struct {
+    uint8_t     family;
+    uint8_t     src[16], dst[16];
+    uint16_t    sport, dport;
+    uint8_t     pt;
+    uint16_t    seq;
+    uint32_t    ts;
+    uint32_t    ssrc;
+    int         ifindex;
+} rtp_pkt_t;
+
+static rtpmon_stream_t* stream_get(rtpmon_t* rm, const rtp_pkt_t* p, int64_t now) {
+    rtpmon_stream_t* free_slot = NULL;
+    for (int i = 0; i < RTPMON_MAX; i++) {
+        rtpmon_stream_t* s = &rm->streams[i];
+        if (!s->used) {
+            if (!free_slot) free_slot = s;
+            continue;
+        }
+        if (s->ssrc == p->ssrc && s->sport == p->sport && s->dport == p->dport &&
+            memcmp(s->src, p->src, 16) == 0) {
+            return s;
+        }
+    }
+    if (!free_slot) {
+        rm->untracked++;
+        return NULL;
+    }
+
+    rtpmon_stream_t* s = free_slot;
+    memset(s, 0, sizeof(*s));
+    s->used = true;
+    s->ssrc = p->ssrc;
+    s->pt = p->pt;
+    s->family = p->family;
+    s->sport = p->sport;
+    s->dport = p->dport;
+    memcpy(s->src, p->src, 16);
+    memcpy(s->dst, p->dst, 16);
+    for (int i = 0; i < rm->nifs; i++) {
+        if (rm->if_index[i] == p->ifindex) snprintf(s->ifname, sizeof(s->ifname), "%s", rm->if_name[i]);
+    }
+    s->start_us = s->window_start_us = now;
+    s->first_ts = p->ts;
+    s->first_arrival_us = now;
+    s->min_mos = 5.0;
+    s->window_mos = -1;
+    /* Static audio payload types run an 8 kHz RTP clock */
+    if (p->pt == 0 || p->pt == 8 || p->pt == 9 || p->pt == 18) s->clock_hz = 8000;
+    return s;
+}
+
+static double jitter_ms(const rtpmon_stream_t* s) {
+    return s->clock_hz ? s->jitter * 1000.0 / s->clock_hz : 0.0;
+}
+
+static void stream_packet(rtpmon_t* rm, rtpmon_stream_t* s, const rtp_pkt_t* p, int64_t now) {
+    s->last_us = now;
+
+    /* Sequence: RFC 3550 A.1, with a bitmap to tell late from duplicate */
+    if (!s->seq_init) {
+        s->seq_init = true;
+        s->base_seq = s->max_seq = p->seq;
+        s->seen[0] = 1;
+        s->total.received++;
+        s->window.received++;
+    } else {
+        uint16_t delta = (uint16_t)(p->seq - (uint16_t)s->max_seq);
+        if (delta == 0) {
+            s->duplicates++;
+            return;
+        } else if (delta < RTPMON_MAX_DROPOUT) {
+            /* Ahead: anything skipped is lost until it turns up */
+            uint32_t gap = delta - 1u;
+            if (delta >= 64) {
+                s->seen[1] = delta >= RTPMON_SEQ_WINDOW ? 0 : s->seen[0] << (delta - 64);
+                s->seen[0] = 0;
+            } else {
+                s->seen[1] = (s->seen[1] << delta) | (s->seen[0] >> (64 - delta));
+                s->seen[0] <<= delta;
+            }
+            s->seen[0] |= 1;
+            s->max_seq += delta;
+            s->total.received++;
+            s->window.received++;
+            if (gap) {
+                s->total.lost += gap;
+                s->window.lost += gap;
+                s->total.rl++;
+                s->total.lr++;
+                s->total.bursts++;
+                s->window.rl++;
+                s->window.lr++;
+                s->window.bursts++;
+                if (gap > s->total.max_burst) s->total.max_burst = gap;
+                if (gap > s->window.max_burst) s->window.max_burst = gap;
+                burst_add(rm, s, now, gap);
+            }
+        } else {
+            uint16_t back = (uint16_t)((uint16_t)s->max_seq - p->seq);
+            if (back < RTPMON_SEQ_WINDOW) {
+                uint64_t* word = &s->seen[back / 64];
+                uint64_t bit = 1ULL << (back % 64);
+                if (*word & bit) {
+                    s->duplicates++;
+                } else {
+                    /* Late: it was counted lost */
+                    *word |= bit;
+                    s->reordered++;
+                    s->total.received++;
+                    s->window.received++;
+                    if (s->total.lost) s->total.lost--;
+                    if (s->window.lost) s->window.lost--;
+                    burst_unlose(s);
+                }
+                return;
+            }
+            /* Restarted sender: resync without counting loss */
+            s->max_seq = s->base_seq = p->seq;
+            s->seen[0] = 1;
+            s->seen[1] = 0;
+            s->total.received++;
+            s->window.received++;
+        }
+    }
+
+    /* RTP clock from the timestamp rate, snapped to the usual ones */
+    if (!s->clock_hz && now - s->first_arrival_us >= 1000000) {
+        static const uint32_t CLOCKS[] = { 8000, 16000, 32000, 48000, 90000 };
+        double hz = (int32_t)(p->ts - s->first_ts) * 1e6 / (now - s->first_arrival_us);
+        uint32_t best = CLOCKS[0];
+        for (size_t i = 1; i < sizeof(CLOCKS) / sizeof(CLOCKS[0]); i++) {
+            if (fabs(hz - CLOCKS[i]) < fabs(hz - best)) best = CLOCKS[i];
+        }
+        s->clock_hz = best;
+    }
+
+    /* RFC 3550 6.4.1 interarrival jitter */
+    if (s->clock_hz) {
+        int64_t arrival = (now - s->first_arrival_us) * (int64_t)s->clock_hz / 1000000;
+        int64_t transit = arrival - (int32_t)(p->ts - s->first_ts);
+        if (s->jitter_init) {
+            int64_t d = transit - s->last_transit;
+            s->jitter += (fabs((double)d) - s->jitter) / 16.0;
+        }
+        s->last_transit = transit;
+        s->jitter_init = true;
+    }
+
+    /* Interval MOS */
+    if (now - s->window_start_us >= RTPMON_WINDOW_MS * 1000LL) {
+        s->window_mos = rtpmon_mos(&s->window, s->pt, jitter_ms(s), atomic_load(&rm->delay_ms));
+        if (s->window_mos < s->min_mos) s->min_mos = s->window_mos;
+        memset(&s->window, 0, sizeof(s->window));
+        s->window_start_us = now;
+    }
+}
+
+static void endpoint(const rtpmon_stream_t* s, const uint8_t* addr, unsigned port, char* out, size_t len) {
+    char ip[INET6_ADDRSTRLEN];
+    inet_ntop(s->family, addr, ip, sizeof(ip));
+    snprintf(out, len, s->family == AF_INET6 ? "[%s]:%u" : "%s:%u", ip, port);
+}
+
+/* Stream fields shared by rtp.json and rtp_stream_end */
+static int stream_json(const rtpmon_t* rm, const rtpmon_stream_t* s, char* out, size_t len) {
+    char src[64], dst[64];
+    endpoint(s, s->src, s->sport, src, sizeof(src));
+    endpoint(s, s->dst, s->dport, dst, sizeof(dst));
+    uint64_t expected = s->total.received + s->total.lost;
+    double jit = jitter_ms(s);
+    double mos = rtpmon_mos(&s->total, s->pt, jit, atomic_load(&rm->delay_ms));
+    return snprintf(out, len,
+        "{\"ssrc\":\"%08x\",\"pt\":%u,\"src\":\"%s\",\"dst\":\"%s\",\"iface\":\"%s\",\"clock_hz\":%u,"
+        "\"duration_s\":%.1f,\"received\":%llu,\"lost\":%llu,\"loss_pct\":%.2f,\"duplicates\":%llu,"
+        "\"reordered\":%llu,\"jitter_ms\":%.1f,\"bursts\":%llu,\"max_burst\":%u,\"mos\":%.2f,"
+        "\"mos_window\":%.2f,\"mos_min\":%.2f,\"lost_switch\":%llu,\"lost_dup\":%llu,\"lost_other\":%llu}",
+        s->ssrc, s->pt, src, dst, s->ifname, s->clock_hz, (s->last_us - s->start_us) / 1e6,
+        (unsigned long long)s->total.received, (unsigned long long)s->total.lost,
+        expected ? 100.0 * s->total.lost / expected : 0.0, (unsigned long long)s->duplicates,
+        (unsigned long long)s->reordered, jit, (unsigned long long)s->total.bursts, s->total.max_burst,
+        mos, s->window_mos >= 0 ? s->window_mos : mos, s->min_mos < 5.0 ? s->min_mos : mos,
+        (unsigned long long)s->lost_by[RTPMON_LOSS_SWITCH], (unsigned long long)s->lost_by[RTPMON_LOSS_DUP],
+        (unsigned long long)s->lost_by[RTPMON_LOSS_OTHER]);
+}
+
+/*=============================================================================
+ * Packets
+ *===========================================================================*/
+
+/* Received UDP whose payload starts with RTP version 2, cut to RTPMON_SNAPLEN */
+static int attach_filter(int fd) {
+    struct sock_filter code[] = {
+        /*  0 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_PKTTYPE),
+        /*  1 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, 17, 0),
+        /*  2 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+        /*  3 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0),
+        /*  4 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x60, 8, 0),
+        /*  5 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x40, 0, 13),
+        /*  6 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),                 /* IPv4 protocol */
+        /*  7 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 11),
+        /*  8 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),
+        /*  9 */ BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 9, 0),     /* Later fragment */
+        /* 10 */ BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                /* X = IPv4 header length */
+        /* 11 */ BPF_STMT(BPF_LD | BPF_B | BPF_IND, 8),                 /* First UDP payload byte */
+        /* 12 */ BPF_JUMP(BPF_JMP | BPF_JA, 3, 0, 0),
+        /* 13 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 6),                 /* IPv6 next header */
+        /* 14 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 4),
+        /* 15 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 48),
+        /* 16 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xc0),
+        /* 17 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x80, 0, 1),
+        /* 18 */ BPF_STMT(BPF_RET | BPF_K, RTPMON_SNAPLEN),
+        /* 19 */ BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog prog = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+static bool parse_packet(const uint8_t* b, size_t len, rtp_pkt_t* p) {
+    memset(p, 0, sizeof(*p));
+    const uint8_t* udp;
+    if (len >= 20 && (b[0] >> 4) == 4) {
+        size_t ihl = (b[0] & 0x0f) * 4u;
+        if (b[9] != IPPROTO_UDP || len < ihl + 8) return false;
+        p->family = AF_INET;
+        memcpy(p->src, b + 12, 4);
+        memcpy(p->dst, b + 16, 4);
+        udp = b + ihl;
+    } else if (len >= 48 && (b[0] >> 4) == 6) {
+        if (b[6] != IPPROTO_UDP) return false;
+        p->family = AF_INET6;
+        memcpy(p->src, b + 8, 16);
+        memcpy(p->dst, b + 24, 16);
+        udp = b + 40;
+    } else {
+        return false;
+    }
+
+    const uint8_t* rtp = udp + 8;
+    if ((size_t)(rtp - b) + 12 > len) return false;
+    p->sport = (uint16_t)(udp[0] << 8 | udp[1]);
+    p->dport = (uint16_t)(udp[2] << 8 | udp[3]);
+    if (p->sport < 1024 || p->dport < 1024) return false;   /* DNS, NTP... */
+
+    /* RTCP shares the version bits: payload types 72-76 with the marker */
+    p->pt = rtp[1] & 0x7f;
+    if ((rtp[0] & 0xc0) != 0x80 || (p->pt >= 72 && p->pt <= 76)) return false;
+    p->seq = (uint16_t)(rtp[2] << 8 | rtp[3]);
+    p->ts = (uint32_t)rtp[4] << 24 | (uint32_t)rtp[5] << 16 | (uint32_t)rtp[6] << 8 | rtp[7];
+    p->ssrc = (uint32_t)rtp[8] << 24 | (uint32_t)rtp[9] << 16 | (uint32_t)rtp[10] << 8 | rtp[11];
+    return true;
+}
+
+static void recv_packets(rtpmon_t* rm) {
+    for (;;) {
+        uint8_t buf[RTPMON_SNAPLEN];
+        char ctrl[CMSG_SPACE(sizeof(struct timespec))];
+        struct sockaddr_ll sll;
+        struct iovec iov = { buf, sizeof(buf) };
+        struct msghdr msg = {
+            .msg_name = &sll, .msg_namelen = sizeof(sll),
+            .msg_iov = &iov, .msg_iovlen = 1,
+            .msg_control = ctrl, .msg_controllen = sizeof(ctrl),
+        };
+        ssize_t n = recvmsg(rm->fd, &msg, MSG_DONTWAIT | MSG_TRUNC);
+        if (n < 0) return;
+
+        int64_t now = 0;
+        for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+            }
+        }
+        if (!now) now = realtime_us();
+
+        rtp_pkt_t p;
+        if (sll.sll_pkttype == PACKET_OUTGOING) continue;
+        if (!parse_packet(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf), &p)) continue;
+        p.ifindex = sll.sll_ifindex;
+
+        rtpmon_stream_t* s = stream_get(rm, &p, now);
+        if (s) stream_packet(rm, s, &p, now);
+    }
+}
+
+/*=============================================================================
+ * Marks, Reports and rtp.json
+ *===========================================================================*/
+
+static void drain_marks(rtpmon_t* rm) {
+    rtpmon_mark_t marks[RTPMON_MARKS];
+    int64_t when[RTPMON_MARKS];
+    pthread_mutex_lock(&rm->lock);
+    int n = rm->nqueue;
+    memcpy(marks, rm->queue, n * sizeof(marks[0]));
+    memcpy(when, rm->queue_us, n * sizeof(when[0]));
+    rm->nqueue = 0;
+    pthread_mutex_unlock(&rm->lock);
+
+    for (int i = 0; i < n; i++) {
+        if (marks[i] == RTPMON_SWITCH) {
+            rtpmon_switch_t* sw = &rm->switches[rm->switch_head];
+            rm->switch_head = (rm->switch_head + 1) % RTPMON_MARKS;
+            memset(sw, 0, sizeof(*sw));
+            sw->t_us = when[i];
+            for (int j = 0; j < RTPMON_MAX; j++) {
+                if (rm->streams[j].used && when[i] - rm->streams[j].last_us < RTPMON_IDLE_MS * 1000LL) sw->live++;
+            }
+        } else if (marks[i] == RTPMON_DUP_ON) {
+            rm->dup_on_us[rm->dup_head] = when[i];
+            rm->dup_off_us[rm->dup_head] = 0;
+            rm->dup_head = (rm->dup_head + 1) % RTPMON_MARKS;
+        } else {
+            int last = (rm->dup_head + RTPMON_MARKS - 1) % RTPMON_MARKS;
+            if (rm->dup_on_us[last] && !rm->dup_off_us[last]) rm->dup_off_us[last] = when[i];
+        }
+    }
+}
+
+static void tick(rtpmon_t* rm, int64_t now) {
+    char json[1024];
+
+    for (int i = 0; i < RTPMON_MAX; i++) {
+        rtpmon_stream_t* s = &rm->streams[i];
+        if (!s->used) continue;
+        bool ended = now - s->last_us > RTPMON_IDLE_MS * 1000LL;
+        classify(rm, s, now, ended);
+        if (!ended) continue;
+        if (s->total.received >= RTPMON_MIN_PACKETS && rm->on_event) {
+            stream_json(rm, s, json, sizeof(json));
+            rm->on_event(rm->ctx, "rtp_stream_end", json);
+        }
+        s->used = false;
+    }
+
+    /* Per switch: what it cost voice, once every burst near it is classified */
+    for (int i = 0; i < RTPMON_MARKS; i++) {
+        rtpmon_switch_t* sw = &rm->switches[i];
+        if (!sw->t_us || sw->reported) continue;
+        if (now - sw->t_us < (RTPMON_SWITCH_POST_MS + 2 * RTPMON_SWITCH_PRE_MS) * 1000LL) continue;
+        sw->reported = true;
+        if (sw->live && rm->on_event) {
+            snprintf(json, sizeof(json), "{\"streams_live\":%d,\"streams_hit\":%d,\"lost\":%llu}",
+                     sw->live, sw->streams, (unsigned long long)sw->lost);
+            rm->on_event(rm->ctx, "rtp_switch", json);
+        }
+    }
+}
+
+static void write_json(rtpmon_t* rm, int64_t now) {
+    char tmp[160];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", rm->path);
+    FILE* fp = fopen(tmp, "w");
+    if (!fp) return;
+
+    fprintf(fp, "{\"updated\":%.3f,\"delay_ms\":%d,\"untracked\":%llu,\"streams\":[",
+            now / 1e6, atomic_load(&rm->delay_ms), (unsigned long long)rm->untracked);
+    int n = 0;
+    char json[1024];
+    for (int i = 0; i < RTPMON_MAX; i++) {
+        const rtpmon_stream_t* s = &rm->streams[i];
+        if (!s->used) continue;
+        stream_json(rm, s, json, sizeof(json));
+        fprintf(fp, "%s%s", n++ ? "," : "", json);
+    }
+
+    fprintf(fp, "],\"switches\":[");
+    n = 0;
+    for (int k = 1; k <= RTPMON_MARKS; k++) {
+        const rtpmon_switch_t* sw = &rm->switches[(rm->switch_head + RTPMON_MARKS - k) % RTPMON_MARKS];
+        if (!sw->t_us) continue;
+        fprintf(fp, "%s{\"t\":%.3f,\"final\":%s,\"streams_live\":%d,\"streams_hit\":%d,\"lost\":%llu}",
+                n++ ? "," : "", sw->t_us / 1e6, sw->reported ? "true" : "false", sw->live, sw->streams,
+                (unsigned long long)sw->lost);
+    }
+    fprintf(fp, "],\"loss_causes\":[\"%s\",\"%s\",\"%s\"]}\n", LOSS_NAMES[0], LOSS_NAMES[1], LOSS_NAMES[2]);
+    fclose(fp);
+    rename(tmp, rm->path);
+}
+
+/*=============================================================================
+ * Thread and API
+ *===========================================================================*/
+
+static void* rtpmon_thread(void* arg) {
+    rtpmon_t* rm = arg;
+    int64_t last_write = 0;
+
+    while (atomic_load(&rm->running)) {
+        struct pollfd pfd = { .fd = rm->fd, .events = POLLIN };
+        if (poll(&pfd, 1, 100) > 0) recv_packets(rm);
+
+        int64_t now = realtime_us();
+        drain_marks(rm);
+        if (now - last_write >= RTPMON_WRITE_MS * 1000LL) {
+            tick(rm, now);
+            write_json(rm, now);
+            last_write = now;
+        }
+    }
+    return NULL;
+}
+
+void rtpmon_init(rtpmon_t* rm) {
+    memset(rm, 0, sizeof(*rm));
+    rm->fd = -1;
+    pthread_mutex_init(&rm->lock, NULL);
+}
+
+int rtpmon_start(rtpmon_t* rm, const char* netns, const char* path, rtpmon_event_cb on_event, void* ctx) {
+    snprintf(rm->path, sizeof(rm->path), "%s", path);
+    rm->on_event = on_event;
+    rm->ctx = ctx;
+
+    /* Socket and interface names belong to the namespace we are in */
+    int self;
+    if (netns_enter(netns, &self) < 0) return -1;
+
+    rm->fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    int err = errno;
+    if (rm->fd >= 0) {
+        int one = 1, rcvbuf = RTPMON_RCVBUF;
+        if (attach_filter(rm->fd) < 0 ||
+            setsockopt(rm->fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) < 0) {
+            err = errno;
+            close(rm->fd);
+            rm->fd = -1;
+        } else {
+            setsockopt(rm->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+    }
+    struct if_nameindex* ifs = rm->fd >= 0 ? if_nameindex() : NULL;
+    for (struct if_nameindex* i = ifs; i && i->if_index && rm->nifs < RTPMON_IFS; i++) {
+        rm->if_index[rm->nifs] = (int)i->if_index;
+        snprintf(rm->if_name[rm->nifs], sizeof(rm->if_name[0]), "%s", i->if_name);
+        rm->nifs++;
+    }
+    if (ifs) if_freenameindex(ifs);
+
+    netns_leave(self);
+    if (rm->fd < 0) {
+        errno = err;
+        return -1;
+    }
+
+    atomic_store(&rm->running, true);
+    int rc = pthread_create(&rm->thread, NULL, rtpmon_thread, rm);
+    if (rc != 0) {
+        atomic_store(&rm->running, false);
+        close(rm->fd);
+        rm->fd = -1;
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void rtpmon_mark(rtpmon_t* rm, rtpmon_mark_t mark) {
+    if (!atomic_load(&rm->running)) return;
+    pthread_mutex_lock(&rm->lock);
+    if (rm->nqueue < RTPMON_MARKS) {
+        rm->queue[rm->nqueue] = mark;
+        rm->queue_us[rm->nqueue] = realtime_us();
+        rm->nqueue++;
+    }
+    pthread_mutex_unlock(&rm->lock);
+}
+
+void rtpmon_set_delay(rtpmon_t* rm, int ms) {
+    atomic_store(&rm->delay_ms, ms);
+}
+
+void rtpmon_stop(rtpmon_t* rm) {
+    if (!atomic_load(&rm->running)) return;
+    atomic_store(&rm->running, false);
+    pthread_join(rm->thread, NULL);
+    close(rm->fd);
+    rm->fd = -1;
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * rtpmon.h - PathSteer Guardian RTP Stream Quality Monitor
+ *
+ * PURPOSE:
+ *   Measure what calls through ns_vip actually heard: per RTP stream
+ *   (SSRC), sequence gaps, RFC 3550 interarrival jitter and the loss
+ *   burstiness that packet loss concealment cares about, turned into an
+ *   ITU-T G.107 E-model MOS, and every lost burst blamed on an uplink
+ *   switch, a duplication window or neither. That tells whether
+ *   protection held up for voice, not just whether probes did.
+ *
+ * CAPTURE:
+ *   One AF_PACKET socket on all interfaces of the namespace. A classic BPF
+ *   filter passes only received (not forwarded-out) UDP datagrams whose
+ *   payload starts like RTP version 2, so bulk traffic never leaves the
+ *   kernel. Per packet the thread does a header parse and a lookup among
+ *   at most RTPMON_MAX streams; SRTP works too, its headers are clear.
+ *
+ * E-MODEL:
+ *   R = 93.2 - Id - Ie,eff (G.107 defaults otherwise), with
+ *     Id      from one-way delay: the active path (rtpmon_set_delay) plus a
+ *             jitter buffer of 2 x jitter + one 20 ms frame
+ *     Ie,eff  = Ie + (95 - Ie) * Ppl / (Ppl / BurstR + Bpl), where BurstR
+ *             comes from the observed received->lost / lost->received
+ *             transition rates (G.107 Annex: 1 / (p + q))
+ *   Ie and Bpl come from the payload type: G.711 0/25.1, G.729 11/19,
+ *   unknown dynamic types as G.711. MOS is computed per RTPMON_WINDOW_MS
+ *   and over the whole stream.
+ *
+ * ATTRIBUTION:
+ *   A lost burst within [-RTPMON_SWITCH_PRE_MS, +RTPMON_SWITCH_POST_MS]
+ *   of a switch counts against that switch; otherwise against duplication
+ *   if one was on, else "other". Bursts are held RTPMON_SWITCH_PRE_MS
+ *   before being classified so the loss that caused a switch is blamed on
+ *   it.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_RTPMON_H
+#define PATHSTEER_RTPMON_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RTPMON_MAX              64          /* Concurrent streams */
+#define RTPMON_IDLE_MS          5000        /* Silent this long: stream ended */
+#define RTPMON_MIN_PACKETS      50          /* Shorter streams aren't reported */
+#define RTPMON_WINDOW_MS        5000        /* Interval MOS */
+#define RTPMON_WRITE_MS         1000        /* rtp.json period */
+#define RTPMON_SWITCH_PRE_MS    1000
+#define RTPMON_SWITCH_POST_MS   2000
+#define RTPMON_MARKS            16          /* Switches / dup windows remembered */
+#define RTPMON_BURSTS           32          /* Bursts awaiting attribution, per stream */
+#define RTPMON_FRAME_MS         20.0        /* Assumed packetization */
+#define RTPMON_IFS              64          /* Interface names resolved at start */
+
+typedef enum {
+    RTPMON_SWITCH,
+    RTPMON_DUP_ON,
+    RTPMON_DUP_OFF,
+} rtpmon_mark_t;
+
+/* Loss blame */
+typedef enum {
+    RTPMON_LOSS_SWITCH,
+    RTPMON_LOSS_DUP,
+    RTPMON_LOSS_OTHER,
+    RTPMON_LOSS_COUNT
+} rtpmon_loss_t;
+
+/* Loss / burstiness counters, over a window or a whole stream */
+typedef struct {
+    uint64_t    received;
+    uint64_t    lost;
+    uint64_t    rl;                 /* Received -> lost transitions */
+    uint64_t    lr;                 /* Lost -> received */
+    uint64_t    bursts;
+    uint32_t    max_burst;
+} rtpmon_loss_stats_t;
+
+typedef struct {
+    bool        used;
+    uint32_t    ssrc;
+    uint8_t     pt;
+    uint8_t     family;
+    uint16_t    sport, dport;
+    uint8_t     src[16], dst[16];
+    char        ifname[16];         /* Interface it arrived on */
+
+    int64_t     start_us;
+    int64_t     last_us;
+    uint32_t    max_seq;            /* Extended highest sequence */
+    uint32_t    base_seq;
+    bool        seq_init;
+    uint64_t    seen[2];            /* Bit n: max_seq - n arrived */
+    uint64_t    duplicates;         /* Seen again (duplication's second copy) */
+    uint64_t    reordered;
+
+    /* RFC 3550 jitter, in RTP units until the clock is known */
+    uint32_t    clock_hz;           /* 0 = still estimating */
+    uint32_t    first_ts;
+    int64_t     first_arrival_us;
+    int64_t     last_transit;       /* Arrival (RTP units) - timestamp */
+    double      jitter;             /* RTP units */
+    bool        jitter_init;
+
+    rtpmon_loss_stats_t total;
+    rtpmon_loss_stats_t window;
+    int64_t     window_start_us;
+    double      window_mos;
+    double      min_mos;
+    uint64_t    lost_by[RTPMON_LOSS_COUNT];
+
+    /* Bursts awaiting attribution */
+    int64_t     burst_us[RTPMON_BURSTS];
+    uint32_t    burst_n[RTPMON_BURSTS];
+    int         burst_head, burst_count;
+} rtpmon_stream_t;
+
+typedef struct {
+    int64_t     t_us;
+    uint64_t    lost;               /* Packets blamed on it, all streams */
+    int         streams;            /* Streams it cost packets */
+    int         live;               /* Streams running across it */
+    bool        reported;
+} rtpmon_switch_t;
+
+/* Called from the monitor thread: "rtp_stream_end" / "rtp_switch" events */
+typedef void (*rtpmon_event_cb)(void* ctx, const char* type, const char* json);
+
+typedef struct {
+    int                 fd;
+    char                path[128];  /* rtp.json */
+    rtpmon_event_cb     on_event;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+    _Atomic int         delay_ms;   /* Active path one-way delay */
+
+    pthread_mutex_t     lock;       /* Marks from the daemon */
+    rtpmon_mark_t       queue[RTPMON_MARKS];
+    int64_t             queue_us[RTPMON_MARKS];
+    int                 nqueue;
+
+    /* Monitor thread only */
+    rtpmon_stream_t     streams[RTPMON_MAX];
+    rtpmon_switch_t     switches[RTPMON_MARKS];
+    int                 switch_head;
+    int64_t             dup_on_us[RTPMON_MARKS];    /* Duplication windows */
+    int64_t             dup_off_us[RTPMON_MARKS];   /* 0 = still on */
+    int                 dup_head;
+    uint64_t            untracked;  /* Packets of streams beyond RTPMON_MAX */
+    int                 if_index[RTPMON_IFS];
+    char                if_name[RTPMON_IFS][16];
+    int                 nifs;
+} rtpmon_t;
+
+/* Zero rm; rtpmon_stop() is then a no-op */
+void rtpmon_init(rtpmon_t* rm);
+
+/* Capture in netns (NULL/"" = ours), write path every RTPMON_WRITE_MS.
+ * -1 with errno on failure.
+ */
+int  rtpmon_start(rtpmon_t* rm, const char* netns, const char* path, rtpmon_event_cb on_event, void* ctx);
+
+/* A switch happened / duplication went on or off, now */
+void rtpmon_mark(rtpmon_t* rm, rtpmon_mark_t mark);
+
+/* One-way delay of the active path, for the E-model */
+void rtpmon_set_delay(rtpmon_t* rm, int ms);
+
+void rtpmon_stop(rtpmon_t* rm);
+
+/* G.107 MOS for the given loss statistics, jitter and one-way delay */
+double rtpmon_mos(const rtpmon_loss_stats_t* s, uint8_t pt, double jitter_ms, double delay_ms);
+
+#endif /* PATHSTEER_RTPMON_H */
@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * shadow.c - PathSteer Guardian Shadow Policies
+ *
+ * See shadow.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "shadow.h"
+
+/*=============================================================================
+ * Scoring
+ *===========================================================================*/
+
+/* Down as of the last probe, like a lost probe in a replay trace - not the
+ * tripwire's debounced "available", which lags the outage it detects */
+static bool score_down(const uplink_t* u) {
+    if (u->force_failed) return true;
+    if (u->history_idx == 0) return false;
+    return !u->history[(u->history_idx - 1) % HISTORY_SIZE].success;
+}
+
+static void score_outage_end(shadow_score_t* sc) {
+    if (!sc->down) return;
+    sc->down = false;
+    if (sc->down_us < SHADOW_OUTAGE_MIN_MS * 1000LL) return;
+
+    sc->outages++;
+    if (sc->down_covered) sc->outages_covered++;
+    else sc->outages_missed++;
+}
+
+void shadow_score_tick(shadow_score_t* sc, const status_t* s, const uplink_t* uplinks,
+                       int dup_dst, int64_t now) {
+    int64_t tick_us = sc->last_us ? now - sc->last_us : 0;
+    sc->last_us = now;
+    if (tick_us <= 0) return;
+
+    double dt = tick_us / 1e6;
+    sc->sec += dt;
+    if (s->state == STATE_PROTECT || s->state == STATE_SWITCHING || s->state == STATE_HOLDING) {
+        sc->protect_sec += dt;
+    }
+    if (s->dup_enabled) sc->dup_sec += dt;
+
+    if (!score_down(&uplinks[s->active_uplink])) {
+        score_outage_end(sc);
+        return;
+    }
+
+    bool dup_ok = s->dup_enabled && dup_dst >= 0 && dup_dst != (int)s->active_uplink &&
+                  !score_down(&uplinks[dup_dst]);
+    if (!sc->down) {
+        sc->down = true;
+        sc->down_covered = true;
+        sc->down_us = 0;
+    }
+    sc->down_us += tick_us;
+    if (!dup_ok) {
+        sc->down_covered = false;
+        sc->outage_sec += dt;
+    }
+}
+
+void shadow_score_event(shadow_score_t* sc, const char* type) {
+    if (strcmp(type, "tripwire_fire") == 0) sc->fires++;
+    else if (strcmp(type, "switch") == 0) sc->switches++;
+}
+
+void shadow_score_json(const shadow_score_t* sc, const status_t* s, const uplink_t* uplinks,
+                       char* out, size_t len) {
+    snprintf(out, len,
+             "{\"state\":\"%s\",\"active\":\"%s\",\"dup\":%s,\"sec\":%.0f,\"protect_pct\":%.2f,"
+             "\"dup_pct\":%.2f,\"outage_sec\":%.1f,\"outages\":%d,\"covered\":%d,\"missed\":%d,"
+             "\"fires\":%d,\"switches\":%d}",
+             STATE_NAMES[s->state], uplinks[s->active_uplink].name, s->dup_enabled ? "true" : "false",
+             sc->sec, sc->sec > 0 ? 100.0 * sc->protect_sec / sc->sec : 0.0,
+             sc->sec > 0 ? 100.0 * sc->dup_sec / sc->sec : 0.0, sc->outage_sec,
+             sc->outages, sc->outages_covered, sc->outages_missed, sc->fires, sc->switches);
+}
+
+/*=============================================================================
+ * Engine ops: live clock, log and correlation; duplication only recorded
+ *===========================================================================*/
+
+static int64_t sh_now_us(void* ctx) {
+    shadow_t* sh = ctx;
+    return sh->live->ops->now_us(sh->live->ctx);
+}
+
+static void sh_log_event(void* ctx, const char* type, const char* json) {
+    shadow_t* sh = ctx;
+    char msg[1536];
+
+    shadow_score_event(&sh->score, type);
+    snprintf(msg, sizeof(msg), "{\"policy\":\"%s\",\"event\":\"%s\",\"data\":%s}", sh->name, type, json);
+    sh->live->ops->log_event(sh->live->ctx, "shadow", msg);
+}
+
+static void sh_dup_enable(void* ctx, uplink_id_t src, uplink_id_t dst) {
+    shadow_t* sh = ctx;
+    (void)src;
+    sh->status.dup_enabled = true;
+    sh->status.dup_enabled_at_us = sh_now_us(sh);
+    sh->dup_dst = dst;
+}
+
+static void sh_dup_disable(void* ctx) {
+    shadow_t* sh = ctx;
+    sh->status.dup_enabled = false;
+    sh->dup_dst = -1;
+}
+
+static double sh_corr(void* ctx, int a, int b, double prior) {
+    shadow_t* sh = ctx;
+    return sh->live->ops->corr(sh->live->ctx, a, b, prior);
+}
+
+static const engine_ops_t SHADOW_OPS = {
+    .now_us = sh_now_us,
+    .log_event = sh_log_event,
+    .dup_enable = sh_dup_enable,
+    .dup_disable = sh_dup_disable,
+    .corr = sh_corr,
+    .learn = NULL,      /* Only the live policy trains the model */
+};
+
+/*=============================================================================
+ * Shadow
+ *===========================================================================*/
+
+/* Live metrics in, keeping what this policy owns (active path, its risk) */
+static void shadow_sync(shadow_t* sh) {
+    for (int i = 0; i < sh->engine.n_uplinks; i++) {
+        const uplink_t* src = &sh->live->uplinks[i];
+        uplink_t* dst = &sh->uplinks[i];
+        bool active = dst->is_active;
+        double risk = dst->risk_now;
+
+        memcpy(dst, src, offsetof(uplink_t, history));
+        if (sh->probes[i] != src->history_idx) {
+            memcpy(dst->history, src->history, sizeof(dst->history));
+            sh->probes[i] = src->history_idx;
+        }
+        memcpy(&dst->history_idx, &src->history_idx, sizeof(uplink_t) - offsetof(uplink_t, history_idx));
+
+        dst->is_active = active;
+        dst->risk_now = risk;
+    }
+}
+
+int shadow_init(shadow_t* sh, const char* name, const engine_t* live, const char* json,
+                op_mode_t mode) {
+    memset(sh, 0, sizeof(*sh));
+    snprintf(sh->name, sizeof(sh->name), "%s", name);
+    sh->live = live;
+    sh->dup_dst = -1;
+
+    sh->policy = strdup(json);
+    if (!sh->policy) return -1;
+    sh->cfg = *live->cfg;
+    engine_config_overlay(&sh->cfg, json);
+
+    char model_file[256];
+    if (json_get_string(json, "model_file", model_file, sizeof(model_file)) == 0 &&
+        strcmp(model_file, live->cfg->model_file) != 0) {
+        sh->model = malloc(sizeof(model_t));
+        if (!sh->model || model_load(sh->model, model_file) != 0) {
+            shadow_free(sh);
+            return -1;
+        }
+        sh->model->lr = 0;
+    }
+
+    sh->engine.ops = &SHADOW_OPS;
+    sh->engine.ctx = sh;
+    sh->engine.cfg = &sh->cfg;
+    sh->engine.uplinks = sh->uplinks;
+    sh->engine.n_uplinks = live->n_uplinks;
+    sh->engine.status = &sh->status;
+    sh->engine.gps = live->gps;
+    sh->engine.model = sh->model ? sh->model : live->model;
+
+    /* Start where the live policy is, in NORMAL */
+    for (int i = 0; i < MAX_UPLINKS; i++) sh->probes[i] = -1;
+    shadow_sync(sh);
+    sh->status.mode = mode;
+    sh->status.state = STATE_NORMAL;
+    sh->status.active_uplink = live->status->active_uplink;
+    sh->status.active_controller = live->status->active_controller;
+    strcpy(sh->status.recommendation, "NORMAL");
+    for (int i = 0; i < sh->engine.n_uplinks; i++) {
+        sh->uplinks[i].is_active = (i == (int)sh->status.active_uplink);
+    }
+    return 0;
+}
+
+void shadow_free(shadow_t* sh) {
+    free(sh->model);
+    sh->model = NULL;
+    free(sh->policy);
+    sh->policy = NULL;
+}
+
+void shadow_reconfig(shadow_t* sh) {
+    sh->cfg = *sh->live->cfg;
+    engine_config_overlay(&sh->cfg, sh->policy);
+}
+
+void shadow_step(shadow_t* sh) {
+    int64_t now = sh_now_us(sh);
+
+    shadow_sync(sh);
+    sh->engine.model = sh->model ? sh->model : sh->live->model;   /* Live model may have been swapped */
+
+    if (now - sh->last_predict_us >= RISK_INTERVAL_MS * 1000LL) {
+        engine_prediction_tick(&sh->engine);
+        sh->last_predict_us = now;
+    }
+
+    /* MIRROR duplicates from the start, once there is somewhere to */
+    if (sh->status.mode == MODE_MIRROR && sh->dup_dst < 0) {
+        uplink_id_t dst = engine_pick_secondary(&sh->engine, sh->status.active_uplink);
+        if (dst != sh->status.active_uplink) sh_dup_enable(sh, sh->status.active_uplink, dst);
+    }
+
+    engine_step(&sh->engine);
+    shadow_score_tick(&sh->score, &sh->status, sh->uplinks, sh->dup_dst, now);
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * shadow.h - PathSteer Guardian Shadow Policies
+ *
+ * PURPOSE:
+ *   Run candidate policies (other thresholds, another model) side by side
+ *   with the live one on the same metric stream, without actuating. Each
+ *   shadow is its own engine_t over a private copy of the uplink table and
+ *   status: every main-loop iteration it picks up the live metrics, runs
+ *   the state machine, and logs what it would have done as "shadow" events.
+ *
+ * SCORING:
+ *   The live policy and every shadow are scored the same way, against the
+ *   same probes: time in protection, time duplicating, and outages of each
+ *   policy's own active uplink - covered if its duplicate target stayed up
+ *   throughout. That is what pathsteer-replay reports for a recorded drive
+ *   (sim.h), here continuously on real drives.
+ *
+ * COST:
+ *   One uplink table copy per loop (probe history only when a probe landed),
+ *   one model pass per RISK_INTERVAL_MS and a state machine step. No tc, no
+ *   shell-outs: duplication is only recorded.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_SHADOW_H
+#define PATHSTEER_SHADOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "model.h"
+
+/* Configured shadow policies (config "shadow_policies") */
+#define SHADOW_MAX              4
+
+/* Name of the live-threshold shadow TRAINING mode runs; not a policy file name */
+#define SHADOW_TRAINING_NAME    "tripwire"
+
+/* Active-path failures shorter than this are probe noise, not outages (as sim.h) */
+#define SHADOW_OUTAGE_MIN_MS    200
+
+/* Cumulative outcome of one policy */
+typedef struct {
+    int64_t     last_us;            /* Last tick, 0 = none yet */
+    double      sec;
+    double      protect_sec;        /* PROTECT, SWITCHING or HOLDING */
+    double      dup_sec;            /* Duplication on */
+    double      outage_sec;         /* Active path down and no live duplicate */
+    int         fires;
+    int         switches;
+    int         outages;            /* Active path down >= SHADOW_OUTAGE_MIN_MS */
+    int         outages_covered;
+    int         outages_missed;
+
+    /* Current outage */
+    bool        down;
+    bool        down_covered;
+    int64_t     down_us;
+} shadow_score_t;
+
+/* Account [last tick, now) to status' state; dup_dst < 0 = no duplicate */
+void shadow_score_tick(shadow_score_t* sc, const status_t* s, const uplink_t* uplinks,
+                       int dup_dst, int64_t now);
+
+/* Count fires and switches from an engine event */
+void shadow_score_event(shadow_score_t* sc, const char* type);
+
+/* Score as a JSON object */
+void shadow_score_json(const shadow_score_t* sc, const status_t* s, const uplink_t* uplinks,
+                       char* out, size_t len);
+
+typedef struct {
+    char            name[32];
+    config_t        cfg;            /* Live config, overlaid with the policy */
+    char*           policy;         /* The overlay JSON, malloc'd */
+    model_t*        model;          /* Own model, NULL = follow the live one */
+    const engine_t* live;
+    engine_t        engine;
+    uplink_t        uplinks[MAX_UPLINKS];
+    status_t        status;
+    int             dup_dst;        /* -1 = not duplicating */
+    int             probes[MAX_UPLINKS];    /* Live history_idx at last sync */
+    int64_t         last_predict_us;
+    shadow_score_t  score;
+} shadow_t;
+
+/*
+ * Shadow live with json's thresholds over live's config. A "model_file"
+ * other than the live one gets its own (frozen) model. mode is
+ * MODE_TRIPWIRE or MODE_MIRROR. Returns 0, -1 if the model won't load or out of
+ * memory.
+ */
+int  shadow_init(shadow_t* sh, const char* name, const engine_t* live, const char* json,
+                 op_mode_t mode);
+void shadow_free(shadow_t* sh);
+
+/* The live config was swapped (reload): overlay the policy on the new one */
+void shadow_reconfig(shadow_t* sh);
+
+/* One main-loop iteration, after the live engine_step() */
+void shadow_step(shadow_t* sh);
+
+#endif /* PATHSTEER_SHADOW_H */
@@ -0,0 +1,465 @@
+/*******************************************************************************
+ * sim.c - PathSteer Guardian Trace-Driven Engine Simulation
+ *
+ * See sim.h for trace formats and what is (not) recomputed.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "sim.h"
+
+/* Uplink names as the daemon logs them (uplinks_init) */
+static const char* const SIM_NAMES[UPLINK_COUNT] = {
+    "cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"
+};
+
+static uplink_type_t sim_type(int i) {
+    if (i <= UPLINK_CELL_B) return UPLINK_TYPE_LTE;
+    if (i <= UPLINK_SL_B) return UPLINK_TYPE_STARLINK;
+    return UPLINK_TYPE_FIBER;
+}
+
+/*=============================================================================
+ * Trace loading
+ *===========================================================================*/
+
+static sim_record_t* sim_append(sim_trace_t* tr) {
+    if (tr->n == tr->cap) {
+        size_t cap = tr->cap ? tr->cap * 2 : 4096;
+        sim_record_t* tmp = realloc(tr->rec, cap * sizeof(*tmp));
+        if (!tmp) return NULL;
+        tr->rec = tmp;
+        tr->cap = cap;
+    }
+    sim_record_t* r = &tr->rec[tr->n++];
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < UPLINK_COUNT; i++) {
+        r->u[i].eta_prepare = -1;
+        r->u[i].eta_protect = -1;
+        r->u[i].ho_pci = -1;
+        r->u[i].ho_gap_ms = -1;
+        r->u[i].obstr_eta = -1;
+    }
+    return r;
+}
+
+void sim_trace_free(sim_trace_t* tr) {
+    free(tr->rec);
+    memset(tr, 0, sizeof(*tr));
+}
+
+static void sim_parse_uplink(sim_uplink_t* su, const char* o) {
+    su->present = 1;
+    su->rtt = (float)json_get_double(o, "rtt", 0);
+    su->risk_ahead = (float)json_get_double(o, "ra", 0);
+    su->confidence = (float)json_get_double(o, "conf", 0);
+    su->eta_prepare = (float)json_get_double(o, "ep", -1);
+    su->eta_protect = (float)json_get_double(o, "eq", -1);
+    su->force_failed = json_get_int(o, "ff", 0) != 0;
+    su->chaos_rtt = (float)json_get_double(o, "crtt", 0);
+    su->chaos_jitter = (float)json_get_double(o, "cjit", 0);
+    su->chaos_loss = (float)json_get_double(o, "closs", 0);
+    su->rsrp = (float)json_get_double(o, "rsrp", 0);
+    su->sinr = (float)json_get_double(o, "sinr", 0);
+    su->rsrp_trend = (float)json_get_double(o, "rsrp_tr", 0);
+    su->sinr_trend = (float)json_get_double(o, "sinr_tr", 0);
+    su->ho_pci = (int16_t)json_get_int(o, "hop", -1);
+    su->ho_margin = (float)json_get_double(o, "hom", 0);
+    su->ho_trend = (float)json_get_double(o, "hot", 0);
+    su->ho_age_ms = json_get_int(o, "hoage", 0);
+    su->ho_prob = (float)json_get_double(o, "hoprob", 0);
+    su->ho_gap_ms = (float)json_get_double(o, "hogap", -1);
+    su->online = json_get_int(o, "online", 0) != 0;
+    su->obstructed = json_get_int(o, "obs", 0) != 0;
+    su->obstr_pct = (float)json_get_double(o, "obs_pct", 0);
+    su->obstr_eta = (int16_t)json_get_int(o, "obs_eta", -1);
+}
+
+int sim_load_jsonl(sim_trace_t* tr, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[8192];
+    char event[16];
+    int added = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (json_get_string(line, "event", event, sizeof(event)) != 0 || strcmp(event, "trace") != 0) continue;
+        const char* d = json_find(line, "data");
+        if (!d) continue;
+
+        sim_record_t* r = sim_append(tr);
+        if (!r) {
+            fclose(f);
+            return -1;
+        }
+        r->t_us = (int64_t)json_get_double(d, "t", 0);
+        r->lat = json_get_double(d, "lat", 0);
+        r->lon = json_get_double(d, "lon", 0);
+        r->speed_mps = (float)json_get_double(d, "spd", 0);
+        r->heading = (float)json_get_double(d, "hdg", 0);
+
+        const char* u = json_find(d, "u");
+        for (int i = 0; u && i < UPLINK_COUNT; i++) {
+            const char* o = json_find(u, SIM_NAMES[i]);
+            if (o) sim_parse_uplink(&r->u[i], o);
+        }
+        added++;
+    }
+    fclose(f);
+    return added;
+}
+
+int sim_load_db(sim_trace_t* tr, sqlite3* db) {
+    const char* sql =
+        "SELECT CAST(strftime('%s', timestamp) AS INTEGER), lat, lon, speed, heading,"
+        " cell_a_rtt, cell_a_rsrp, cell_a_sinr, cell_b_rtt, cell_b_rsrp, cell_b_sinr,"
+        " sl_a_rtt, sl_a_obstructed, sl_b_rtt, sl_b_obstructed"
+        " FROM samples ORDER BY timestamp";
+    sqlite3_stmt* st;
+    if (sqlite3_prepare_v2(db, sql, -1, &st, NULL) != SQLITE_OK) {
+        fprintf(stderr, "query samples: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    size_t first = tr->n;
+    bool alive[UPLINK_COUNT] = {false};
+    while (sqlite3_step(st) == SQLITE_ROW) {
+        sim_record_t* r = sim_append(tr);
+        if (!r) {
+            sqlite3_finalize(st);
+            return -1;
+        }
+        r->t_us = sqlite3_column_int64(st, 0) * 1000000LL;
+        r->lat = sqlite3_column_double(st, 1);
+        r->lon = sqlite3_column_double(st, 2);
+        r->speed_mps = (float)sqlite3_column_double(st, 3);
+        r->heading = (float)sqlite3_column_double(st, 4);
+
+        for (int c = 0; c < 2; c++) {
+            sim_uplink_t* su = &r->u[UPLINK_CELL_A + c];
+            su->present = 1;
+            su->rtt = (float)sqlite3_column_double(st, 5 + 3 * c);
+            su->rsrp = (float)sqlite3_column_double(st, 6 + 3 * c);
+            su->sinr = (float)sqlite3_column_double(st, 7 + 3 * c);
+        }
+        for (int s = 0; s < 2; s++) {
+            sim_uplink_t* su = &r->u[UPLINK_SL_A + s];
+            su->present = 1;
+            su->rtt = (float)sqlite3_column_double(st, 11 + 2 * s);
+            su->obstructed = sqlite3_column_int(st, 12 + 2 * s) != 0;
+            su->online = su->rtt > 0;
+        }
+        for (int i = 0; i < UPLINK_COUNT; i++) {
+            if (r->u[i].rtt > 0) alive[i] = true;
+        }
+    }
+    sqlite3_finalize(st);
+
+    /* The collector writes 0 for uplinks that weren't configured - drop them */
+    for (size_t k = first; k < tr->n; k++) {
+        for (int i = 0; i < UPLINK_COUNT; i++) {
+            if (!alive[i]) tr->rec[k].u[i].present = 0;
+        }
+    }
+    return (int)(tr->n - first);
+}
+
+/*=============================================================================
+ * Simulated world (engine_ops_t)
+ *===========================================================================*/
+
+typedef struct {
+    const sim_opts_t*   opt;
+    sim_result_t*       res;
+    status_t*           status;
+    const sim_record_t* cur;
+    int64_t             now;
+    int64_t             t0;
+    int                 dup_dst;        /* -1 = none */
+
+    /* Active-path outage in progress */
+    bool                down;
+    bool                down_covered;
+    int64_t             down_start;
+    int64_t             down_us;
+} sim_ctx_t;
+
+static int64_t sim_now_us(void* ctx) {
+    return ((sim_ctx_t*)ctx)->now;
+}
+
+static void sim_emit(sim_ctx_t* c, const char* type, const char* json) {
+    if (!c->opt->decisions) return;
+    fprintf(c->opt->decisions, "{\"t\":%.3f,\"t_us\":%ld,\"event\":\"%s\",\"data\":%s}\n",
+            (c->now - c->t0) / 1e6, c->now, type, json);
+}
+
+static void sim_log_event(void* ctx, const char* type, const char* json) {
+    sim_ctx_t* c = ctx;
+    if (strcmp(type, "tripwire_fire") == 0) {
+        c->res->fires++;
+        c->res->triggers[c->status->last_trigger]++;
+    } else if (strcmp(type, "switch") == 0) {
+        c->res->switches++;
+    }
+    sim_emit(c, type, json);
+}
+
+static void sim_dup_enable(void* ctx, uplink_id_t src, uplink_id_t dst) {
+    sim_ctx_t* c = ctx;
+    (void)src;
+    c->status->dup_enabled = true;
+    c->status->dup_enabled_at_us = c->now;
+    c->dup_dst = dst;
+}
+
+static void sim_dup_disable(void* ctx) {
+    sim_ctx_t* c = ctx;
+    c->status->dup_enabled = false;
+    c->dup_dst = -1;
+}
+
+static double sim_corr(void* ctx, int a, int b, double prior) {
+    sim_ctx_t* c = ctx;
+    if (!c->opt->corr) return prior;
+    uint64_t key = 0;
+    if (c->cur && (c->cur->lat != 0 || c->cur->lon != 0)) key = corrmap_key(c->cur->lat, c->cur->lon);
+    return corrmap_cond(c->opt->corr, key, a, b, prior);
+}
+
+static const engine_ops_t SIM_OPS = {
+    .now_us = sim_now_us,
+    .log_event = sim_log_event,
+    .dup_enable = sim_dup_enable,
+    .dup_disable = sim_dup_disable,
+    .corr = sim_corr,
+    .learn = NULL,
+};
+
+/*=============================================================================
+ * Replay
+ *===========================================================================*/
+
+/* Fresh daemon: uplinks_init() + startup, for the uplinks the trace has */
+static void sim_reset(engine_t* e, sim_ctx_t* c, const bool* seen) {
+    status_t* s = e->status;
+
+    memset(e->uplinks, 0, UPLINK_COUNT * sizeof(uplink_t));
+    for (int i = 0; i < UPLINK_COUNT; i++) {
+        uplink_t* u = &e->uplinks[i];
+        u->id = i;
+        u->type = sim_type(i);
+        snprintf(u->name, sizeof(u->name), "%s", SIM_NAMES[i]);
+        u->enabled = seen[i];
+        u->eta_prepare = -1;
+        u->eta_protect = -1;
+        u->cellular.ho_eta = -1;
+        u->cellular.ho_gap_ms = -1;
+        ho_reset(&u->cellular.ho);
+        u->starlink.obstruction_eta = -1;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->mode = c->opt->mode;
+    s->state = STATE_NORMAL;
+    strcpy(s->recommendation, "NORMAL");
+    s->active_uplink = UPLINK_CELL_A;
+    for (int i = 0; i < UPLINK_COUNT && !seen[s->active_uplink]; i++) s->active_uplink = i;
+    e->uplinks[s->active_uplink].is_active = true;
+
+    c->dup_dst = -1;
+    c->down = false;
+
+    /* MIRROR duplicates to one fixed uplink from the start */
+    if (s->mode == MODE_MIRROR) {
+        for (int k = 1; k < UPLINK_COUNT; k++) {
+            int i = (s->active_uplink + k) % UPLINK_COUNT;
+            if (seen[i]) {
+                sim_dup_enable(c, s->active_uplink, i);
+                break;
+            }
+        }
+    }
+}
+
+/* Feed one trace record in as the metric source */
+static void sim_apply(engine_t* e, gps_t* gps, const sim_record_t* r) {
+    gps->latitude = r->lat;
+    gps->longitude = r->lon;
+    gps->speed_mps = r->speed_mps;
+    gps->heading = r->heading;
+    gps->valid = true;
+    gps->timestamp_us = r->t_us;
+
+    for (int i = 0; i < UPLINK_COUNT; i++) {
+        const sim_uplink_t* su = &r->u[i];
+        uplink_t* u = &e->uplinks[i];
+        if (!su->present || !u->enabled) continue;
+
+        u->force_failed = su->force_failed;
+        if (u->force_failed) u->available = false;
+        u->chaos_rtt = su->chaos_rtt;
+        u->chaos_jitter = su->chaos_jitter;
+        u->chaos_loss = su->chaos_loss;
+        u->risk_ahead = su->risk_ahead;
+        u->confidence = su->confidence;
+        u->eta_prepare = su->eta_prepare;
+        u->eta_protect = su->eta_protect;
+
+        if (u->type == UPLINK_TYPE_LTE) {
+            cellular_t* cl = &u->cellular;
+            cl->rsrp = su->rsrp;
+            cl->sinr = su->sinr;
+            cl->rsrp_trend = su->rsrp_trend;
+            cl->sinr_trend = su->sinr_trend;
+            cl->ho.cur.valid = su->ho_pci >= 0;
+            cl->ho.best_pci = su->ho_pci;
+            cl->ho.margin = su->ho_margin;
+            cl->ho.margin_trend = su->ho_trend;
+            cl->ho.t_us = r->t_us - su->ho_age_ms * 1000LL;
+            cl->ho_prob = su->ho_prob;
+            cl->ho_gap_ms = su->ho_gap_ms;
+        } else if (u->type == UPLINK_TYPE_STARLINK) {
+            starlink_t* sl = &u->starlink;
+            sl->online = su->online;
+            sl->obstructed = su->obstructed;
+            sl->obstruction_pct = su->obstr_pct;
+            sl->obstruction_eta = su->obstr_eta;
+        }
+
+        engine_probe(u, su->rtt, r->t_us);
+    }
+}
+
+static bool sim_down(const sim_record_t* r, int i) {
+    return i < 0 || !r->u[i].present || r->u[i].rtt <= 0 || r->u[i].force_failed;
+}
+
+static void sim_outage_end(sim_ctx_t* c) {
+    if (!c->down) return;
+    c->down = false;
+    if (c->down_us < SIM_OUTAGE_MIN_MS * 1000LL) return;
+
+    c->res->outages++;
+    if (c->down_covered) c->res->outages_covered++;
+    else c->res->outages_missed++;
+
+    char json[160];
+    snprintf(json, sizeof(json), "{\"uplink\":\"%s\",\"start\":%.3f,\"duration_ms\":%ld,\"covered\":%s}",
+             SIM_NAMES[c->status->active_uplink], (c->down_start - c->t0) / 1e6,
+             c->down_us / 1000, c->down_covered ? "true" : "false");
+    sim_emit(c, "outage", json);
+}
+
+/* Score the tick [now, now + tick) against what the trace says happened */
+static void sim_account(sim_ctx_t* c, int64_t tick_us) {
+    sim_result_t* res = c->res;
+    const status_t* s = c->status;
+    double dt = tick_us / 1e6;
+
+    res->sim_sec += dt;
+    if (s->state == STATE_PROTECT || s->state == STATE_SWITCHING || s->state == STATE_HOLDING) {
+        res->protect_sec += dt;
+    }
+    if (s->dup_enabled) {
+        res->dup_sec += dt;
+        res->dup_bytes += c->opt->rate_mbps * 1e6 / 8.0 * dt;
+    }
+
+    if (!sim_down(c->cur, s->active_uplink)) {
+        sim_outage_end(c);
+        return;
+    }
+
+    bool dup_ok = s->dup_enabled && c->dup_dst != (int)s->active_uplink && !sim_down(c->cur, c->dup_dst);
+    if (!c->down) {
+        c->down = true;
+        c->down_covered = true;
+        c->down_start = c->now;
+        c->down_us = 0;
+    }
+    c->down_us += tick_us;
+    if (!dup_ok) {
+        c->down_covered = false;
+        res->outage_sec += dt;
+    }
+}
+
+int sim_run(const sim_trace_t* tr, const config_t* cfg, const sim_opts_t* opt, sim_result_t* res) {
+    memset(res, 0, sizeof(*res));
+    if (tr->n == 0) return -1;
+
+    uplink_t uplinks[UPLINK_COUNT];
+    status_t status;
+    gps_t gps;
+    model_t defaults;
+    sim_ctx_t c;
+
+    if (!opt->model) model_defaults(&defaults);
+    memset(&gps, 0, sizeof(gps));
+    memset(&c, 0, sizeof(c));
+    c.opt = opt;
+    c.res = res;
+    c.status = &status;
+
+    engine_t e = {
+        .ops = &SIM_OPS,
+        .ctx = &c,
+        .cfg = cfg,
+        .uplinks = uplinks,
+        .n_uplinks = UPLINK_COUNT,
+        .status = &status,
+        .gps = &gps,
+        .model = opt->model ? opt->model : &defaults,
+    };
+
+    bool seen[UPLINK_COUNT] = {false};
+    for (size_t k = 0; k < tr->n; k++) {
+        for (int i = 0; i < UPLINK_COUNT; i++) {
+            if (tr->rec[k].u[i].present) seen[i] = true;
+        }
+    }
+
+    int64_t tick = (opt->tick_ms > 0 ? opt->tick_ms : SIM_TICK_MS) * 1000LL;
+    int64_t predict_us = RISK_INTERVAL_MS * 1000LL;
+    size_t k = 0;
+
+    c.now = c.t0 = tr->rec[0].t_us;
+    int64_t last_predict = c.now - predict_us;
+    sim_reset(&e, &c, seen);
+    res->segments = 1;
+
+    /* Same order as the daemon main loop: probe, predict, state machine */
+    for (;;) {
+        while (k < tr->n && tr->rec[k].t_us <= c.now) {
+            c.cur = &tr->rec[k++];
+            sim_apply(&e, &gps, c.cur);
+        }
+        if (c.now - last_predict >= predict_us) {
+            engine_prediction_tick(&e);
+            last_predict = c.now;
+        }
+        engine_step(&e);
+        if (k == tr->n) break;
+
+        int64_t next = tr->rec[k].t_us;
+        if (next < c.cur->t_us || next - c.cur->t_us > SIM_MAX_GAP_SEC * 1000000LL) {
+            sim_outage_end(&c);
+            c.now = next;
+            last_predict = c.now - predict_us;
+            sim_reset(&e, &c, seen);
+            res->segments++;
+            continue;
+        }
+
+        sim_account(&c, tick);
+        c.now += tick;
+    }
+    sim_outage_end(&c);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * sim.h - PathSteer Guardian Trace-Driven Engine Simulation
+ *
+ * PURPOSE:
+ *   Run the decision engine (engine.h) over a recorded drive on a simulated
+ *   clock, as fast as the CPU allows, and score what it did: time in
+ *   protection, duplication cost, and outages on the active path that a
+ *   live duplicate did or did not cover. Used by pathsteer-replay.
+ *
+ * TRACES:
+ *   JSONL  "trace" events from the daemon log (config "trace_log": true),
+ *          one per probe round: raw probe RTT per uplink plus signal,
+ *          handover tracker, dish state and look-ahead ETAs. Full fidelity.
+ *   DB     samples table of the training DB (training-collect.sh). ~5 s
+ *          rows, RTT/RSRP/SINR/obstruction only, no look-ahead - each row
+ *          is replayed as one probe, so tripwire timing is coarse. Good for
+ *          comparing policies over months of drives, not for tuning preroll.
+ *
+ * FIDELITY:
+ *   Probe results go through engine_probe() exactly as live. Look-ahead
+ *   ETAs, learned handover likelihood and the dish forecast are replayed as
+ *   recorded rather than recomputed, so changing predictor thresholds
+ *   (risk_protect, predict_lead_sec, ...) is honoured but a different risk
+ *   map is not. Online model learning is off.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_SIM_H
+#define PATHSTEER_SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+#include "corrmap.h"
+#include "engine.h"
+
+/* Main loop period the daemon runs the state machine at */
+#define SIM_TICK_MS             10
+
+/* A longer silence in the trace (restart, parked overnight) starts a new segment */
+#define SIM_MAX_GAP_SEC         60
+
+/* Active-path failures shorter than this are probe noise, not outages */
+#define SIM_OUTAGE_MIN_MS       200
+
+/* One uplink in one trace record */
+typedef struct {
+    float       rtt;            /* Probe RTT ms, 0 = lost */
+    float       risk_ahead;
+    float       confidence;
+    float       eta_prepare;    /* -1 = clear */
+    float       eta_protect;
+    float       chaos_rtt;
+    float       chaos_jitter;
+    float       chaos_loss;
+    float       rsrp;
+    float       sinr;
+    float       rsrp_trend;
+    float       sinr_trend;
+    float       ho_margin;
+    float       ho_trend;
+    float       ho_prob;
+    float       ho_gap_ms;      /* -1 = unknown */
+    int32_t     ho_age_ms;      /* Cell info age at probe time */
+    int16_t     ho_pci;         /* Best neighbour, -1 = none */
+    int16_t     obstr_eta;      /* -1 = none */
+    float       obstr_pct;
+    uint8_t     present;        /* Uplink enabled and probed */
+    uint8_t     force_failed;
+    uint8_t     online;
+    uint8_t     obstructed;
+} sim_uplink_t;
+
+typedef struct {
+    int64_t     t_us;
+    double      lat;
+    double      lon;
+    float       speed_mps;
+    float       heading;
+    sim_uplink_t u[UPLINK_COUNT];
+} sim_record_t;
+
+typedef struct {
+    sim_record_t*   rec;
+    size_t          n;
+    size_t          cap;
+} sim_trace_t;
+
+/* Append records; return how many were added, -1 on error */
+int  sim_load_jsonl(sim_trace_t* tr, const char* path);
+int  sim_load_db(sim_trace_t* tr, sqlite3* db);
+void sim_trace_free(sim_trace_t* tr);
+
+typedef struct {
+    op_mode_t           mode;
+    int                 tick_ms;        /* 0 = SIM_TICK_MS */
+    double              rate_mbps;      /* Client traffic, prices duplication */
+    const model_t*      model;          /* NULL = model_defaults() */
+    const corrmap_t*    corr;           /* NULL = by-type priors only */
+    FILE*               decisions;      /* JSONL of engine events, NULL = none */
+} sim_opts_t;
+
+typedef struct {
+    double      sim_sec;            /* Trace time covered */
+    double      protect_sec;        /* PROTECT, SWITCHING or HOLDING */
+    double      dup_sec;            /* Duplication on */
+    double      dup_bytes;          /* dup_sec at rate_mbps */
+    double      outage_sec;         /* Active path down and no live duplicate */
+    int         segments;
+    int         fires;
+    int         triggers[TRIGGER_COUNT];
+    int         switches;
+    int         outages;            /* Active path down >= SIM_OUTAGE_MIN_MS */
+    int         outages_covered;    /* ... with a live duplicate throughout */
+    int         outages_missed;
+} sim_result_t;
+
+/* Replay tr under cfg. Thread-safe: all state is local. */
+int sim_run(const sim_trace_t* tr, const config_t* cfg, const sim_opts_t* opt, sim_result_t* res);
+
+#endif /* PATHSTEER_SIM_H */
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * skymap.c - PathSteer Guardian Starlink Sky Obstruction Map
+ *
+ * See skymap.h for the model.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "skymap.h"
+
+static double wrap360(double a) {
+    a = fmod(a, 360.0);
+    return a < 0 ? a + 360.0 : a;
+}
+
+static double angle_diff(double a, double b) {
+    double d = fmod(fabs(a - b), 360.0);
+    return d > 180.0 ? 360.0 - d : d;
+}
+
+void skymap_reset(skymap_t* sm) {
+    memset(sm, 0, sizeof(*sm));
+}
+
+int skymap_merge(skymap_t* sm, const char* json, double heading, int64_t now_us) {
+    const char* p = strstr(json, "\"sky\":");
+    if (!p || !(p = strchr(p, '['))) return -1;
+    p++;
+
+    float in[SKYMAP_SECTORS];
+    for (int i = 0; i < SKYMAP_SECTORS; i++) {
+        char* end;
+        double v = strtod(p, &end);
+        if (end == p) return -1;
+        in[i] = (float)(v < 0 ? 0 : (v > 1 ? 1 : v));
+        p = end;
+        while (*p == ',' || *p == ' ') p++;
+    }
+
+    /*
+     * Earth frame: vehicle sector i points at earth azimuth i*W + heading.
+     * Dish frame: the dish is mounted facing forward, so it already is the
+     * vehicle frame.
+     */
+    bool earth = strstr(json, "\"sky_frame\": \"earth\"") || strstr(json, "\"sky_frame\":\"earth\"");
+    float veh[SKYMAP_SECTORS];
+    for (int i = 0; i < SKYMAP_SECTORS; i++) {
+        if (!earth) {
+            veh[i] = in[i];
+            continue;
+        }
+        double az = wrap360((i + 0.5) * SKYMAP_SECTOR_DEG + heading);
+        veh[i] = in[(int)(az / SKYMAP_SECTOR_DEG) % SKYMAP_SECTORS];
+    }
+
+    /* The dish accumulates its own map, so a dish-frame map replaces ours */
+    for (int i = 0; i < SKYMAP_SECTORS; i++) {
+        if (!earth || !sm->valid) sm->obstr[i] = veh[i];
+        else sm->obstr[i] += SKYMAP_EMA_ALPHA * (veh[i] - sm->obstr[i]);
+    }
+
+    sm->valid = true;
+    sm->maps++;
+    sm->updated_us = now_us;
+    return 0;
+}
+
+double skymap_blockage(const skymap_t* sm, double heading, double sky_az, double spread_deg) {
+    if (!sm->valid || spread_deg <= 0) return 0;
+
+    /* Where the serving sky is, as seen from the vehicle */
+    double rel = wrap360(sky_az - heading);
+
+    /* Triangular weight: full at the centre, zero at +/- spread */
+    double sum = 0, wsum = 0;
+    for (int i = 0; i < SKYMAP_SECTORS; i++) {
+        double d = angle_diff((i + 0.5) * SKYMAP_SECTOR_DEG, rel);
+        if (d >= spread_deg) continue;
+        double w = 1.0 - d / spread_deg;
+        sum += w * sm->obstr[i];
+        wsum += w;
+    }
+    return wsum > 0 ? sum / wsum : 0;
+}
+
+double skymap_next_slot(double t, double offset_sec) {
+    double phase = fmod(t - offset_sec, SKYMAP_SLOT_SEC);
+    if (phase < 0) phase += SKYMAP_SLOT_SEC;
+    return SKYMAP_SLOT_SEC - phase;
+}
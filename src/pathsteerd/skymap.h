@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * skymap.h - PathSteer Guardian Starlink Sky Obstruction Map
+ *
+ * PURPOSE:
+ *   Which part of the sky can this dish see, relative to the vehicle? From
+ *   that and the heading we can tell when the satellite we are likely to be
+ *   served by is about to go behind an obstruction.
+ *
+ * MODEL:
+ *   The dish obstruction map is reduced (by starlink-stats.sh) to the
+ *   obstructed fraction in SKYMAP_SECTORS azimuth wedges. We keep it in the
+ *   vehicle frame - sector 0 dead ahead, clockwise - because on a moving
+ *   dish the obstructions that repeat are the vehicle's own (roof rack,
+ *   trailer, the other dish). Earth-frame maps are rotated by the heading at
+ *   fetch time and merged with an EMA, so vehicle-fixed blockage builds up
+ *   while passing scenery averages out.
+ *
+ *   Satellites are mostly served from one side of the sky (north in the
+ *   northern hemisphere), so blockage at a heading is the obstruction of
+ *   that earth-frame sky region seen from the vehicle.
+ *
+ * SCHEDULE:
+ *   Starlink reassigns satellites on a fixed 15 s grid (seconds 12/27/42/57
+ *   of each minute). A new satellite is where a short outage most often
+ *   starts, so those boundaries are forecast points.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_SKYMAP_H
+#define PATHSTEER_SKYMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SKYMAP_SECTORS          12
+#define SKYMAP_SECTOR_DEG       (360.0 / SKYMAP_SECTORS)
+
+/* Weight of a new earth-frame map against the accumulated one */
+#define SKYMAP_EMA_ALPHA        0.3
+
+/* Satellite reassignment grid */
+#define SKYMAP_SLOT_SEC         15.0
+
+typedef struct {
+    float       obstr[SKYMAP_SECTORS];  /* Vehicle frame, 0..1 */
+    bool        valid;
+    int         maps;                   /* Maps merged so far */
+    int64_t     updated_us;
+} skymap_t;
+
+void skymap_reset(skymap_t* sm);
+
+/*
+ * Merge the script's map output: "sky_frame":"dish"|"earth", "sky":[...].
+ * heading is the vehicle heading when the map was fetched (earth frame only).
+ * Returns 0 on success.
+ */
+int skymap_merge(skymap_t* sm, const char* json, double heading, int64_t now_us);
+
+/*
+ * Obstructed fraction of the serving sky region (centred on earth azimuth
+ * sky_az, +/- spread_deg) when the vehicle points at heading.
+ */
+double skymap_blockage(const skymap_t* sm, double heading, double sky_az, double spread_deg);
+
+/* Seconds from wall-clock time t (epoch seconds) to the next reassignment */
+double skymap_next_slot(double t, double offset_sec);
+
+#endif /* PATHSTEER_SKYMAP_H */
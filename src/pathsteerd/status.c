@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * status.c - PathSteer Guardian Status Document
+ *
+ * See status.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include "status.h"
+
+void status_render(FILE* fp, const status_view_t* v) {
+    engine_t* e = v->engine;
+    const status_t* s = e->status;
+    const gps_t* gps = e->gps;
+    const uplink_t* uplinks = e->uplinks;
+
+    /* Convert speed to mph for display */
+    double speed_mph = gps->speed_mps * 2.237;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"mode\": \"%s\",\n", MODE_NAMES[s->mode]);
+    fprintf(fp, "  \"state\": \"%s\",\n", STATE_NAMES[s->state]);
+    fprintf(fp, "  \"trigger\": \"%s\",\n", TRIGGER_NAMES[s->last_trigger]);
+    fprintf(fp, "  \"trigger_detail\": \"%s\",\n", s->trigger_detail);
+    fprintf(fp, "  \"active_uplink\": \"%s\",\n", uplinks[s->active_uplink].name);
+    fprintf(fp, "  \"active_controller\": %d,\n", s->active_controller);
+    fprintf(fp, "  \"controller_name\": \"%s\",\n", e->cfg->controller_names[s->active_controller]);
+    fprintf(fp, "  \"pop_auto\": %s,\n", v->pop_auto ? "true" : "false");
+    fprintf(fp, "  \"c8000_session\": %s,\n", v->c8000_session ? "true" : "false");
+    if (v->controllers) fprintf(fp, "  \"controllers\": %s,\n", v->controllers);
+    fprintf(fp, "  \"dup_enabled\": %s,\n", s->dup_enabled ? "true" : "false");
+    fprintf(fp, "  \"hold_remaining\": %d,\n", s->hold_remaining_sec);
+    fprintf(fp, "  \"clean_remaining\": %d,\n", s->clean_remaining_sec);
+    fprintf(fp, "  \"switches_this_window\": %d,\n", s->switches_this_window);
+    fprintf(fp, "  \"flap_suppressed\": %s,\n", s->flap_suppressed ? "true" : "false");
+    fprintf(fp, "  \"global_risk\": %.2f,\n", s->global_risk);
+    fprintf(fp, "  \"recommendation\": \"%s\",\n", s->recommendation);
+    fprintf(fp, "  \"predicted_state\": \"%s\",\n", STATE_NAMES[s->predicted_state]);
+    fprintf(fp, "  \"model\": {\"source\": \"%s\", \"updates\": %llu, \"infer_ns\": %lld},\n",
+            e->model->source, (unsigned long long)e->model->updates, (long long)s->model_infer_ns);
+    if (v->latency) fprintf(fp, "  \"latency\": %s,\n", v->latency);
+    if (v->watchdog) fprintf(fp, "  \"watchdog\": %s,\n", v->watchdog);
+    if (v->policies) fprintf(fp, "  \"policies\": %s,\n", v->policies);
+    fprintf(fp, "  \"run_id\": \"%s\",\n", s->run_id);
+
+    /* GPS */
+    fprintf(fp, "  \"gps\": {\"valid\": %s, \"lat\": %.6f, \"lon\": %.6f, \"speed_mph\": %.1f, \"heading\": %.1f, \"route\": %d},\n",
+            gps->valid ? "true" : "false", gps->latitude, gps->longitude, speed_mph, gps->heading,
+            v->route);
+
+    /* Uplinks */
+    fprintf(fp, "  \"uplinks\": [\n");
+    for (int i = 0; i < e->n_uplinks; i++) {
+        const uplink_t* u = &uplinks[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"type\": \"%s\", \"enabled\": %s, \"available\": %s, \"active\": %s,\n",
+                u->name, UPLINK_TYPE_NAMES[u->type], u->enabled ? "true" : "false", 
+                u->available ? "true" : "false", u->is_active ? "true" : "false");
+        fprintf(fp, "     \"rtt_ms\": %.1f, \"rtt_baseline\": %.1f, \"loss_pct\": %.1f,\n",
+                u->rtt_ms, u->rtt_baseline, u->loss_pct);
+        fprintf(fp, "     \"risk_now\": %.2f, \"risk_ahead\": %.2f, \"confidence\": %.2f, \"eta_ahead\": %.1f, \"consec_fail\": %d, \"corr_active\": %.2f",
+                u->risk_now, u->risk_ahead, u->confidence, u->eta_prepare, u->consec_fail,
+                i == (int)s->active_uplink ? 1.0 : engine_corr(e, s->active_uplink, i));
+
+        if (u->type == UPLINK_TYPE_LTE) {
+            fprintf(fp, ",\n     \"cellular\": {\"rsrp\": %.1f, \"sinr\": %.1f, \"carrier\": \"%s\", \"cell_id\": \"%s\", \"pci\": %u, \"band\": \"%s\", \"neighbor_margin\": %.1f, \"ho_eta\": %.2f, \"ho_prob\": %.2f, \"handovers\": %u}",
+                    u->cellular.rsrp, u->cellular.sinr, u->cellular.carrier,
+                    u->cellular.cell_id, u->cellular.ho.cur.pci, u->cellular.band,
+                    u->cellular.ho.margin, u->cellular.ho_eta, u->cellular.ho_prob, u->cellular.ho.handovers);
+        }
+        if (u->type == UPLINK_TYPE_STARLINK) {
+            fprintf(fp, ",\n     \"starlink\": {\"state\": \"%s\", \"latency\": %.1f, \"obstructed\": %s, \"obstruction_pct\": %.2f, \"eta\": %d, \"blockage\": %.2f, \"sky_maps\": %d}",
+                    u->starlink.state, u->starlink.latency_ms, 
+                    u->starlink.obstructed ? "true" : "false", u->starlink.obstruction_pct, u->starlink.obstruction_eta,
+                    u->starlink.blockage, u->starlink.sky.maps);
+        }
+        fprintf(fp, "}%s\n", i < e->n_uplinks - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
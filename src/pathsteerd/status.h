@@ -0,0 +1,39 @@
+/*******************************************************************************
+ * status.h - PathSteer Guardian Status Document
+ *
+ * PURPOSE:
+ *   status.json, the Web UI's view of the daemon: mode, state, the active
+ *   path, GPS and every uplink's metrics and risk. Rendered from the engine
+ *   the main loop drives (its status, uplinks, GPS, config and model).
+ *   Sections only the daemon has (PoP selection, latency histograms,
+ *   watchdog, shadow policies) are passed in rendered, so pathsteer-bench
+ *   can time the rest on synthetic state.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_STATUS_H
+#define PATHSTEER_STATUS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "engine.h"
+
+typedef struct {
+    engine_t*   engine;             /* Status, uplinks, GPS, config, model */
+    int         route;              /* Matched known route, -1 = none */
+    bool        pop_auto;           /* Automatic PoP selection in charge */
+    bool        c8000_session;      /* NETCONF session up */
+
+    /* Rendered JSON values, NULL = section left out */
+    const char* controllers;
+    const char* latency;
+    const char* watchdog;
+    const char* policies;
+} status_view_t;
+
+/* The whole document into fp; the caller keeps the state still */
+void status_render(FILE* fp, const status_view_t* v);
+
+#endif /* PATHSTEER_STATUS_H */
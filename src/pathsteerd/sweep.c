@@ -0,0 +1,609 @@
+/*******************************************************************************
+ * sweep.c - PathSteer Guardian Parameter Sweep (pathsteer-sweep)
+ *
+ * PURPOSE:
+ *   Replay a corpus of recorded drives (see sim.h) under every combination
+ *   of a grid of tripwire / switching / predictor parameters, on all cores,
+ *   and report the Pareto front of unprotected outage time against
+ *   duplication overhead. Any front point can be written out as a config:
+ *
+ *     pathsteer-sweep --config /etc/pathsteer/config.json \
+ *                     --dup-budget 10 --emit tuned.json logs/pathsteer_*.jsonl
+ *
+ * GRID:
+ *   SWEEP_PARAMS below, narrowed or widened with --grid KEY=v1,v2,...
+ *   The default is a coarse 972 combinations, minutes rather than hours;
+ *   refine around the front point it finds with --grid.
+ *   Keys are the daemon config keys. risk_prepare/protect_threshold are not
+ *   swept: replay uses the recorded look-ahead ETAs, so they would not
+ *   change a decision - predict_lead_sec and handover_prob_threshold are
+ *   the predictor knobs replay honours.
+ *
+ * THREADING:
+ *   One job per combination, each a full sim_run() over the corpus (the
+ *   corpus, model and correlation map are shared read-only). Every worker
+ *   starts with an equal slice of the job range and takes from its low end;
+ *   a worker that runs dry steals the upper half of the fullest-looking
+ *   victim's remaining range, so a slice of slow combinations (long
+ *   protection, many fires) doesn't leave cores idle at the tail.
+ *
+ * OUTPUT (stdout, JSONL):
+ *   One "pareto" line per front point, lowest outage time first, then a
+ *   "sweep_summary" line.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <sqlite3.h>
+
+#include "engine.h"
+#include "json.h"
+#include "sim.h"
+
+#define DEFAULT_RATE_MBPS   5.0
+#define SWEEP_MAX_VALUES    16
+#define SWEEP_MAX_THREADS   256
+
+/* Refuse grids that would run for days by accident */
+#define SWEEP_MAX_COMBOS    1000000
+
+/* Progress line on stderr at most this often */
+#define SWEEP_PROGRESS_SEC  5
+
+/*=============================================================================
+ * Grid
+ *===========================================================================*/
+
+typedef struct {
+    const char* key;                /* Config JSON key */
+    size_t      offset;             /* Field in config_t */
+    bool        is_double;
+    int         n;
+    double      v[SWEEP_MAX_VALUES];
+} sweep_param_t;
+
+static sweep_param_t SWEEP_PARAMS[] = {
+    {"rtt_step_threshold_ms",   offsetof(config_t, rtt_step_ms),        false, 3, {60, 80, 120}},
+    {"probe_miss_count",        offsetof(config_t, probe_miss_count),   false, 2, {2, 3}},
+    {"preroll_ms",              offsetof(config_t, preroll_ms),         false, 3, {0, 250, 500}},
+    {"min_hold_sec",            offsetof(config_t, min_hold_sec),       false, 3, {4, 8, 15}},
+    {"clean_exit_sec",          offsetof(config_t, clean_exit_sec),     false, 3, {3, 5, 10}},
+    {"predict_lead_sec",        offsetof(config_t, predict_lead_sec),   false, 3, {0, 5, 10}},
+    {"handover_prob_threshold", offsetof(config_t, ho_prob),            true,  2, {0.5, 0.8}},
+};
+#define SWEEP_NPARAMS   (int)(sizeof(SWEEP_PARAMS) / sizeof(SWEEP_PARAMS[0]))
+
+/* --grid KEY=v1,v2,...; a single value pins the parameter */
+static int grid_override(const char* arg) {
+    const char* eq = strchr(arg, '=');
+    if (!eq) return -1;
+    for (int p = 0; p < SWEEP_NPARAMS; p++) {
+        sweep_param_t* sp = &SWEEP_PARAMS[p];
+        if (strlen(sp->key) != (size_t)(eq - arg) || strncmp(sp->key, arg, eq - arg) != 0) continue;
+
+        int n = 0;
+        const char* s = eq + 1;
+        while (*s && n < SWEEP_MAX_VALUES) {
+            char* end;
+            sp->v[n++] = strtod(s, &end);
+            if (end == s) return -1;
+            s = (*end == ',') ? end + 1 : end;
+            if (*end && *end != ',') return -1;
+        }
+        if (n == 0 || *s) return -1;
+        sp->n = n;
+        return 0;
+    }
+    return -1;
+}
+
+/* Combination idx -> config, mixed radix with the last parameter fastest */
+static void grid_apply(config_t* cfg, size_t idx) {
+    for (int p = SWEEP_NPARAMS - 1; p >= 0; p--) {
+        const sweep_param_t* sp = &SWEEP_PARAMS[p];
+        double v = sp->v[idx % sp->n];
+        idx /= sp->n;
+        char* field = (char*)cfg + sp->offset;
+        if (sp->is_double) *(double*)field = v;
+        else *(int*)field = (int)v;
+    }
+}
+
+/*=============================================================================
+ * Work-stealing pool
+ *===========================================================================*/
+
+/* Unclaimed jobs [lo, hi) of one worker */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t          lo;
+    size_t          hi;
+} sweep_deque_t;
+
+typedef struct {
+    double          outage_sec;
+    double          dup_pct;        /* Share of drive time duplicated */
+    sim_result_t    res;
+} sweep_point_t;
+
+typedef struct {
+    const sim_trace_t*  tr;
+    const config_t*     base;
+    const sim_opts_t*   opt;
+    sweep_deque_t*      dq;
+    int                 nthreads;
+    sweep_point_t*      pts;
+    atomic_size_t       done;
+    atomic_int          steals;
+} sweep_t;
+
+typedef struct {
+    sweep_t*    sw;
+    int         id;
+} sweep_worker_t;
+
+static bool deque_pop(sweep_deque_t* d, size_t* job) {
+    bool ok = false;
+    pthread_mutex_lock(&d->lock);
+    if (d->lo < d->hi) {
+        *job = d->lo++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/* Move the upper half of the largest other range into ours */
+static bool deque_steal(sweep_t* sw, int self) {
+    for (;;) {
+        int victim = -1;
+        size_t most = 0;
+        for (int k = 1; k < sw->nthreads; k++) {
+            int v = (self + k) % sw->nthreads;
+            pthread_mutex_lock(&sw->dq[v].lock);
+            size_t left = sw->dq[v].hi - sw->dq[v].lo;
+            pthread_mutex_unlock(&sw->dq[v].lock);
+            if (left > most) {
+                most = left;
+                victim = v;
+            }
+        }
+        if (victim < 0) return false;
+
+        sweep_deque_t* d = &sw->dq[victim];
+        size_t lo = 0, hi = 0;
+        pthread_mutex_lock(&d->lock);
+        if (d->lo < d->hi) {
+            hi = d->hi;
+            lo = d->hi - (d->hi - d->lo + 1) / 2;
+            d->hi = lo;
+        }
+        pthread_mutex_unlock(&d->lock);
+        if (lo == hi) continue;     /* Drained since we looked, look again */
+
+        sweep_deque_t* own = &sw->dq[self];
+        pthread_mutex_lock(&own->lock);
+        own->lo = lo;
+        own->hi = hi;
+        pthread_mutex_unlock(&own->lock);
+        atomic_fetch_add(&sw->steals, 1);
+        return true;
+    }
+}
+
+static void* sweep_worker(void* arg) {
+    sweep_worker_t* w = arg;
+    sweep_t* sw = w->sw;
+    size_t job;
+
+    for (;;) {
+        if (!deque_pop(&sw->dq[w->id], &job)) {
+            if (!deque_steal(sw, w->id)) break;
+            continue;
+        }
+
+        config_t cfg = *sw->base;
+        grid_apply(&cfg, job);
+
+        sweep_point_t* pt = &sw->pts[job];
+        sim_run(sw->tr, &cfg, sw->opt, &pt->res);
+        pt->outage_sec = pt->res.outage_sec;
+        pt->dup_pct = pt->res.sim_sec > 0 ? 100.0 * pt->res.dup_sec / pt->res.sim_sec : 0;
+        atomic_fetch_add(&sw->done, 1);
+    }
+    return NULL;
+}
+
+/*=============================================================================
+ * Pareto front
+ *===========================================================================*/
+
+static const sweep_point_t* g_sort_pts;
+
+static int point_cmp(const void* a, const void* b) {
+    const sweep_point_t* pa = &g_sort_pts[*(const size_t*)a];
+    const sweep_point_t* pb = &g_sort_pts[*(const size_t*)b];
+    if (pa->outage_sec != pb->outage_sec) return pa->outage_sec < pb->outage_sec ? -1 : 1;
+    if (pa->dup_pct != pb->dup_pct) return pa->dup_pct < pb->dup_pct ? -1 : 1;
+    return *(const size_t*)a < *(const size_t*)b ? -1 : 1;
+}
+
+/* Indices of non-dominated points, lowest outage first; returns count */
+static size_t pareto_front(const sweep_point_t* pts, size_t n, size_t* front) {
+    size_t* order = malloc(n * sizeof(size_t));
+    if (!order) return 0;
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    g_sort_pts = pts;
+    qsort(order, n, sizeof(size_t), point_cmp);
+
+    /* Sorted by outage: a point is on the front iff it duplicates less than all before it */
+    size_t m = 0;
+    double best_dup = 1e300;
+    for (size_t i = 0; i < n; i++) {
+        if (pts[order[i]].dup_pct < best_dup) {
+            best_dup = pts[order[i]].dup_pct;
+            front[m++] = order[i];
+        }
+    }
+    free(order);
+    return m;
+}
+
+/*=============================================================================
+ * Output
+ *===========================================================================*/
+
+static void print_params(FILE* f, size_t idx) {
+    config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    grid_apply(&cfg, idx);
+    for (int p = 0; p < SWEEP_NPARAMS; p++) {
+        const sweep_param_t* sp = &SWEEP_PARAMS[p];
+        const char* field = (const char*)&cfg + sp->offset;
+        if (sp->is_double) fprintf(f, "%s\"%s\":%g", p ? "," : "", sp->key, *(const double*)field);
+        else fprintf(f, "%s\"%s\":%d", p ? "," : "", sp->key, *(const int*)field);
+    }
+}
+
+static void print_point(int rank, size_t idx, const sweep_point_t* pt) {
+    const sim_result_t* r = &pt->res;
+    printf("{\"event\":\"pareto\",\"data\":{\"rank\":%d,\"combo\":%zu,\"outage_sec\":%.1f,"
+           "\"outages\":%d,\"outages_missed\":%d,\"dup_pct\":%.2f,\"dup_mb\":%.1f,"
+           "\"protect_pct\":%.2f,\"fires\":%d,\"switches\":%d,\"config\":{",
+           rank, idx, pt->outage_sec, r->outages, r->outages_missed, pt->dup_pct,
+           r->dup_bytes / 1e6, r->sim_sec > 0 ? 100.0 * r->protect_sec / r->sim_sec : 0.0,
+           r->fires, r->switches);
+    print_params(stdout, idx);
+    printf("}}}\n");
+}
+
+/*
+ * Set key to a number in a config JSON text: in place where the top-level
+ * key already is (the one json_get_* reads), else appended to the top
+ * level object. Returns the new text, NULL on error (text is freed).
+ */
+static char* config_set(char* text, const char* key, const char* value) {
+    size_t len = strlen(text);
+    size_t at, cut;
+    char ins[160];
+    const char* p = json_find(text, key);
+
+    if (p) {
+        at = p - text;
+        cut = json_value_len(p);
+        snprintf(ins, sizeof(ins), "%s", value);
+    } else {
+        const char* close = strrchr(text, '}');
+        if (!close) {
+            free(text);
+            return NULL;
+        }
+        const char* prev = close;
+        while (prev > text && (prev[-1] == ' ' || prev[-1] == '\t' || prev[-1] == '\n' || prev[-1] == '\r')) prev--;
+        bool empty = (prev > text && prev[-1] == '{');
+        at = prev - text;
+        cut = 0;
+        snprintf(ins, sizeof(ins), "%s\n    \"%s\": %s", empty ? "" : ",", key, value);
+        if (close == prev) strncat(ins, "\n", sizeof(ins) - strlen(ins) - 1);
+    }
+
+    size_t n = strlen(ins);
+    char* out = malloc(len - cut + n + 1);
+    if (!out) {
+        free(text);
+        return NULL;
+    }
+    memcpy(out, text, at);
+    memcpy(out + at, ins, n);
+    memcpy(out + at + n, text + at + cut, len - at - cut + 1);
+    free(text);
+    return out;
+}
+
+static int emit_config(const char* path, const char* base_json, size_t idx) {
+    char* text = strdup(base_json ? base_json : "{}");
+    config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    grid_apply(&cfg, idx);
+
+    for (int p = 0; p < SWEEP_NPARAMS && text; p++) {
+        const sweep_param_t* sp = &SWEEP_PARAMS[p];
+        const char* field = (const char*)&cfg + sp->offset;
+        char value[32];
+        if (sp->is_double) snprintf(value, sizeof(value), "%g", *(const double*)field);
+        else snprintf(value, sizeof(value), "%d", *(const int*)field);
+        text = config_set(text, sp->key, value);
+    }
+    if (!text) return -1;
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        free(text);
+        return -1;
+    }
+    size_t len = strlen(text);
+    fputs(text, f);
+    if (len == 0 || text[len - 1] != '\n') fputc('\n', f);
+    free(text);
+    return fclose(f);
+}
+
+/*=============================================================================
+ * Main
+ *===========================================================================*/
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--config PATH] [--db PATH] [--model PATH] [--threads N]\n"
+            "          [--mode tripwire|mirror] [--rate-mbps N] [--grid KEY=v1,v2,...]...\n"
+            "          [--dup-budget PCT] [--emit PATH] [trace.jsonl ...]\n"
+            "Without trace files, the samples table of --db is replayed.\n"
+            "--emit writes --config with the front point of least outage time whose\n"
+            "duplication stays within --dup-budget (%% of drive time, default any).\n",
+            prog);
+    fprintf(stderr, "Grid keys:");
+    for (int p = 0; p < SWEEP_NPARAMS; p++) fprintf(stderr, " %s", SWEEP_PARAMS[p].key);
+    fprintf(stderr, "\n");
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = malloc(size + 1);
+    if (buf) {
+        size_t n = fread(buf, 1, size, f);
+        buf[n] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+static double wall_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const char* config_path = NULL;
+    const char* db_path = NULL;
+    const char* model_path = NULL;
+    const char* emit_path = NULL;
+    double dup_budget = -1;
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    sim_opts_t opt = {
+        .mode = MODE_TRIPWIRE,
+        .rate_mbps = DEFAULT_RATE_MBPS,
+    };
+    int first_trace = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "--db") == 0 && i + 1 < argc) {
+            db_path = argv[++i];
+        } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model_path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            nthreads = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            const char* m = argv[++i];
+            if (strcmp(m, "tripwire") == 0) opt.mode = MODE_TRIPWIRE;
+            else if (strcmp(m, "mirror") == 0) opt.mode = MODE_MIRROR;
+            else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--rate-mbps") == 0 && i + 1 < argc) {
+            opt.rate_mbps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            if (grid_override(argv[++i]) != 0) {
+                fprintf(stderr, "Bad --grid %s\n", argv[i]);
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--dup-budget") == 0 && i + 1 < argc) {
+            dup_budget = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--emit") == 0 && i + 1 < argc) {
+            emit_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            first_trace = i;
+            break;
+        }
+    }
+    if (first_trace == argc && !db_path) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > SWEEP_MAX_THREADS) nthreads = SWEEP_MAX_THREADS;
+
+    size_t combos = 1;
+    for (int p = 0; p < SWEEP_NPARAMS; p++) {
+        combos *= SWEEP_PARAMS[p].n;
+        if (combos > SWEEP_MAX_COMBOS) {
+            fprintf(stderr, "Grid too large (> %d combinations), narrow it with --grid\n",
+                    SWEEP_MAX_COMBOS);
+            return 2;
+        }
+    }
+
+    /* Base config: everything not swept keeps its configured value */
+    config_t base;
+    memset(&base, 0, sizeof(base));
+    char* base_json = config_path ? read_file(config_path) : NULL;
+    if (config_path && !base_json) {
+        fprintf(stderr, "Cannot open config: %s\n", config_path);
+        return 1;
+    }
+    engine_config_load(&base, base_json ? base_json : "{}");
+
+    model_t model;
+    model_defaults(&model);
+    if (model_path && model_load(&model, model_path) != 0) {
+        fprintf(stderr, "Cannot load model: %s\n", model_path);
+        return 1;
+    }
+    model.lr = 0;
+    opt.model = &model;
+
+    /* Corpus, and the learned failure correlation if we have the DB */
+    sim_trace_t tr = {0};
+    corrmap_t corr = {0};
+    sqlite3* db = NULL;
+    if (db_path && sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "Cannot open %s: %s\n", db_path, sqlite3_errmsg(db));
+        return 1;
+    }
+    if (db && corrmap_init(&corr, CORRMAP_CAPACITY) == 0) {
+        const char* names[UPLINK_COUNT] = {"cell_a", "cell_b", "sl_a", "sl_b", "fa", "fb"};
+        if (corrmap_load(&corr, db, names, UPLINK_COUNT) > 0) opt.corr = &corr;
+    }
+
+    for (int i = first_trace; i < argc; i++) {
+        if (sim_load_jsonl(&tr, argv[i]) < 0) {
+            fprintf(stderr, "Cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (first_trace == argc && sim_load_db(&tr, db) < 0) return 1;
+    if (db) sqlite3_close(db);
+
+    if (tr.n == 0) {
+        fprintf(stderr, "No trace records (enable \"trace_log\" in the daemon config)\n");
+        return 1;
+    }
+    if ((size_t)nthreads > combos) nthreads = combos;
+
+    sweep_t sw = {
+        .tr = &tr,
+        .base = &base,
+        .opt = &opt,
+        .nthreads = nthreads,
+    };
+    sw.dq = calloc(nthreads, sizeof(sweep_deque_t));
+    sw.pts = calloc(combos, sizeof(sweep_point_t));
+    size_t* front = malloc(combos * sizeof(size_t));
+    sweep_worker_t* workers = calloc(nthreads, sizeof(sweep_worker_t));
+    pthread_t* tids = calloc(nthreads, sizeof(pthread_t));
+    if (!sw.dq || !sw.pts || !front || !workers || !tids) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    atomic_init(&sw.done, 0);
+    atomic_init(&sw.steals, 0);
+
+    for (int t = 0; t < nthreads; t++) {
+        pthread_mutex_init(&sw.dq[t].lock, NULL);
+        sw.dq[t].lo = combos * t / nthreads;
+        sw.dq[t].hi = combos * (t + 1) / nthreads;
+    }
+
+    fprintf(stderr, "Sweeping %zu combinations over %zu records on %ld threads\n",
+            combos, tr.n, nthreads);
+
+    double t0 = wall_sec();
+    int started = 0;
+    for (int t = 0; t < nthreads; t++) {
+        workers[t].sw = &sw;
+        workers[t].id = t;
+        if (pthread_create(&tids[t], NULL, sweep_worker, &workers[t]) != 0) break;
+        started++;
+    }
+    if (started == 0) {
+        /* No threads: do it here */
+        workers[0].sw = &sw;
+        workers[0].id = 0;
+        sweep_worker(&workers[0]);
+    }
+
+    /* Idle workers steal from live ones, so any one started drains everything */
+    double last = t0;
+    while (atomic_load(&sw.done) < combos) {
+        usleep(100000);
+        double now = wall_sec();
+        if (now - last >= SWEEP_PROGRESS_SEC) {
+            size_t done = atomic_load(&sw.done);
+            fprintf(stderr, "  %zu/%zu (%.0f/s)\n", done, combos, done / (now - t0));
+            last = now;
+        }
+    }
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    double wall = wall_sec() - t0;
+
+    size_t m = pareto_front(sw.pts, combos, front);
+    for (size_t r = 0; r < m; r++) print_point(r, front[r], &sw.pts[front[r]]);
+
+    printf("{\"event\":\"sweep_summary\",\"data\":{\"combos\":%zu,\"front\":%zu,\"threads\":%ld,"
+           "\"steals\":%d,\"records\":%zu,\"sim_sec\":%.1f,\"wall_sec\":%.2f,\"combos_per_sec\":%.1f,"
+           "\"mode\":\"%s\"}}\n",
+           combos, m, nthreads, atomic_load(&sw.steals), tr.n, sw.pts[0].res.sim_sec, wall,
+           wall > 0 ? combos / wall : 0.0, MODE_NAMES[opt.mode]);
+
+    int rc = 0;
+    if (emit_path && m > 0) {
+        /* Front is sorted by outage, so the first within budget is the pick */
+        size_t pick = front[m - 1];
+        for (size_t r = 0; r < m; r++) {
+            if (dup_budget < 0 || sw.pts[front[r]].dup_pct <= dup_budget) {
+                pick = front[r];
+                break;
+            }
+        }
+        if (emit_config(emit_path, base_json, pick) != 0) {
+            fprintf(stderr, "Cannot write %s\n", emit_path);
+            rc = 1;
+        } else {
+            fprintf(stderr, "Wrote %s (combo %zu: outage %.1fs, duplication %.2f%%)\n",
+                    emit_path, pick, sw.pts[pick].outage_sec, sw.pts[pick].dup_pct);
+        }
+    }
+
+    for (int t = 0; t < nthreads; t++) pthread_mutex_destroy(&sw.dq[t].lock);
+    free(tids);
+    free(workers);
+    free(front);
+    free(sw.pts);
+    free(sw.dq);
+    free(base_json);
+    corrmap_free(&corr);
+    sim_trace_free(&tr);
+    return rc;
+}
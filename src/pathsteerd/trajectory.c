@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * trajectory.c - PathSteer Guardian Vehicle Trajectory Projection
+ *
+ * See trajectory.h for the overview. Distances use a local flat-earth
+ * approximation, which is well under a meter off over a 30 s horizon.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "trajectory.h"
+
+#define DEG2RAD         (M_PI / 180.0)
+#define M_PER_DEG_LAT   111320.0
+
+/* Turn rate smoothing (GPS track is noisy at low speed) */
+#define TURN_EMA_ALPHA  0.5
+
+static double wrap180(double d) {
+    while (d > 180.0) d -= 360.0;
+    while (d < -180.0) d += 360.0;
+    return d;
+}
+
+void traj_reset(traj_t* t) {
+    memset(t, 0, sizeof(*t));
+}
+
+void traj_update(traj_t* t, const traj_fix_t* fix) {
+    if (t->valid && fix->t_us > t->last.t_us &&
+        fix->speed_mps >= TRAJ_MIN_SPEED_MPS && t->last.speed_mps >= TRAJ_MIN_SPEED_MPS) {
+        double dt = (fix->t_us - t->last.t_us) / 1e6;
+        double rate = wrap180(fix->heading - t->last.heading) / dt;
+        if (rate > TRAJ_MAX_TURN_DPS) rate = TRAJ_MAX_TURN_DPS;
+        if (rate < -TRAJ_MAX_TURN_DPS) rate = -TRAJ_MAX_TURN_DPS;
+        t->turn_rate_dps = t->turn_rate_dps * (1.0 - TURN_EMA_ALPHA) + rate * TURN_EMA_ALPHA;
+    } else if (fix->speed_mps < TRAJ_MIN_SPEED_MPS) {
+        t->turn_rate_dps = 0;
+    }
+
+    t->last = *fix;
+    t->valid = true;
+}
+
+double traj_age_sec(const traj_t* t, int64_t now_us) {
+    if (!t->valid) return INFINITY;
+    return (now_us - t->last.t_us) / 1e6;
+}
+
+bool traj_project(const traj_t* t, double dt_sec,
+                  double* lat, double* lon, double* heading) {
+    if (!t->valid) return false;
+
+    const traj_fix_t* f = &t->last;
+    double v = f->speed_mps < TRAJ_MIN_SPEED_MPS ? 0 : f->speed_mps;
+
+    /* Limit the turn so a brief wobble doesn't project a U-turn */
+    double w = t->turn_rate_dps;
+    if (fabs(w * dt_sec) > TRAJ_MAX_TURN_DEG) {
+        w = copysign(TRAJ_MAX_TURN_DEG / dt_sec, w);
+    }
+
+    double h0 = f->heading * DEG2RAD;
+    double h1 = (f->heading + w * dt_sec) * DEG2RAD;
+    double dn, de;
+
+    if (fabs(w) < 0.1) {
+        /* Straight line */
+        dn = v * dt_sec * cos(h0);
+        de = v * dt_sec * sin(h0);
+    } else {
+        /* Constant-turn arc, radius v / omega */
+        double r = v / (w * DEG2RAD);
+        dn = r * (sin(h1) - sin(h0));
+        de = r * (cos(h0) - cos(h1));
+    }
+
+    double coslat = cos(f->lat * DEG2RAD);
+    if (coslat < 0.01) coslat = 0.01;
+
+    if (lat) *lat = f->lat + dn / M_PER_DEG_LAT;
+    if (lon) *lon = f->lon + de / (M_PER_DEG_LAT * coslat);
+    if (heading) {
+        double h = fmod(f->heading + w * dt_sec, 360.0);
+        *heading = h < 0 ? h + 360.0 : h;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * trajectory.h - PathSteer Guardian Vehicle Trajectory Projection
+ *
+ * PURPOSE:
+ *   Where will the vehicle be in N seconds? Used by the predictor to walk
+ *   the risk index along the road ahead.
+ *
+ * MODEL:
+ *   Constant speed + constant turn rate from the last GPS fix. Between fixes
+ *   (or when gpsd stops delivering) the same model dead-reckons the current
+ *   position, up to TRAJ_DR_MAX_SEC.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_TRAJECTORY_H
+#define PATHSTEER_TRAJECTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Give up dead reckoning after this long without a fix */
+#define TRAJ_DR_MAX_SEC         10.0
+
+/* Below this speed heading is noise - no turn rate, no projection */
+#define TRAJ_MIN_SPEED_MPS      2.0
+
+/* Clamp turn rate and total projected turn (vehicles don't orbit) */
+#define TRAJ_MAX_TURN_DPS       15.0
+#define TRAJ_MAX_TURN_DEG       90.0
+
+typedef struct {
+    double      lat;
+    double      lon;
+    double      heading;        /* Degrees from north */
+    double      speed_mps;
+    int64_t     t_us;           /* When the fix was taken */
+} traj_fix_t;
+
+typedef struct {
+    traj_fix_t  last;           /* Last real fix */
+    double      turn_rate_dps;  /* Smoothed heading change, deg/s */
+    bool        valid;
+} traj_t;
+
+void traj_reset(traj_t* t);
+void traj_update(traj_t* t, const traj_fix_t* fix);
+
+/* Projected position dt_sec after the last fix. Returns false if unusable. */
+bool traj_project(const traj_t* t, double dt_sec,
+                  double* lat, double* lon, double* heading);
+
+/* Seconds since the last fix (for dead reckoning) */
+double traj_age_sec(const traj_t* t, int64_t now_us);
+
+#endif /* PATHSTEER_TRAJECTORY_H */
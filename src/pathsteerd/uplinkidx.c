@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * uplinkidx.c - PathSteer Guardian Uplink Lookup Index
+ *
+ * See uplinkidx.h for the overview.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "uplinkidx.h"
+
+#if UPLINKIDX_SLOTS < 2 * MAX_UPLINKS || (UPLINKIDX_SLOTS & (UPLINKIDX_SLOTS - 1))
+#error "UPLINKIDX_SLOTS must be a power of two of at least 2 * MAX_UPLINKS"
+#endif
+
+#define SLOT_MASK   (UPLINKIDX_SLOTS - 1)
+
+static uint32_t name_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (uint8_t)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int uplinkidx_build(uplinkidx_t* ix, const uplink_t* uplinks, int n) {
+    int ret = 0;
+
+    ix->uplinks = uplinks;
+    memset(ix->by_name, -1, sizeof(ix->by_name));
+
+    for (int i = 0; i < n && i < MAX_UPLINKS; i++) {
+        if (uplinkidx_name(ix, uplinks[i].name) >= 0) {
+            ret = -1;
+        } else {
+            uint32_t h = name_hash(uplinks[i].name);
+            while (ix->by_name[h & SLOT_MASK] >= 0) h++;
+            ix->by_name[h & SLOT_MASK] = (int8_t)i;
+        }
+    }
+    return ret;
+}
+
+int uplinkidx_name(const uplinkidx_t* ix, const char* name) {
+    uint32_t h = name_hash(name);
+
+    for (int k = 0; k < UPLINKIDX_SLOTS; k++, h++) {
+        int i = ix->by_name[h & SLOT_MASK];
+        if (i < 0) return -1;
+        if (strcmp(ix->uplinks[i].name, name) == 0) return i;
+    }
+    return -1;
+}
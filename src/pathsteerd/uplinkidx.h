@@ -0,0 +1,37 @@
+/*******************************************************************************
+ * uplinkidx.h - PathSteer Guardian Uplink Lookup Index
+ *
+ * PURPOSE:
+ *   The uplink table comes from config.json, so its size and names are only
+ *   known at startup. Commands, chaos injection and the return path name an
+ *   uplink. This hashes the name to the table index once, instead of a
+ *   strcmp walk per lookup.
+ *
+ * LAYOUT:
+ *   One open-addressed table of UPLINKIDX_SLOTS (at least twice
+ *   MAX_UPLINKS), FNV-1a with linear probing. Built once after the
+ *   uplink table is, read-only after.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_UPLINKIDX_H
+#define PATHSTEER_UPLINKIDX_H
+
+#include "pathsteer.h"
+
+#define UPLINKIDX_SLOTS         32          /* Power of two */
+
+typedef struct {
+    const uplink_t* uplinks;
+    int8_t          by_name[UPLINKIDX_SLOTS];       /* -1 = empty */
+} uplinkidx_t;
+
+/* Index the n uplinks by name. A later duplicate
+ * name is not indexed; -1 then, 0 otherwise. */
+int  uplinkidx_build(uplinkidx_t* ix, const uplink_t* uplinks, int n);
+
+/* Table index, -1 = unknown */
+int  uplinkidx_name(const uplinkidx_t* ix, const char* name);
+
+#endif /* PATHSTEER_UPLINKIDX_H */
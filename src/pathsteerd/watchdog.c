@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * watchdog.c - PathSteer Guardian Control Loop Watchdog
+ *
+ * See watchdog.h.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "watchdog.h"
+
+const char* const WD_PHASE_NAMES[] = {
+    "probe", "gps", "predict", "maint", "state", "commands", "status", "observe"
+};
+
+/* Default budgets, us. A probe round is six sequential pings plus the
+ * modem and dish polls; the pings are bounded waits (watchdog_wait()) and
+ * not charged here. The rest is in-process work or one short exec. */
+static const int64_t DEFAULT_BUDGET_US[WD_PHASE_COUNT] = {
+    [WD_PROBE]    = 500000,
+    [WD_GPS]      = 200000,
+    [WD_PREDICT]  = 20000,
+    [WD_MAINT]    = 200000,
+    [WD_STATE]    = 5000,
+    [WD_COMMANDS] = 100000,
+    [WD_STATUS]   = 20000,
+    [WD_OBSERVE]  = 20000,
+};
+
+static int64_t mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void atomic_max(_Atomic int64_t* v, int64_t x) {
+    int64_t cur = atomic_load_explicit(v, memory_order_relaxed);
+    while (x > cur && !atomic_compare_exchange_weak_explicit(v, &cur, x, memory_order_relaxed,
+                                                             memory_order_relaxed)) {
+    }
+}
+
+/*=============================================================================
+ * LOOP SIDE
+ *===========================================================================*/
+
+static void phase_end(watchdog_t* wd, int phase, int64_t now) {
+    int64_t took = now - atomic_load_explicit(&wd->phase_start_us, memory_order_relaxed);
+    int64_t waited = wd->waited_us;
+    wd->waited_us = 0;
+    atomic_max(&wd->max_us[phase], took);
+    if (took - waited <= wd->budget_us[phase]) return;
+
+    atomic_fetch_add_explicit(&wd->overruns[phase], 1, memory_order_relaxed);
+    if (now - wd->reported_us[phase] < WATCHDOG_REPORT_MS * 1000LL) {
+        wd->suppressed[phase]++;
+        return;
+    }
+    if (wd->on_event) {
+        char json[256];
+        snprintf(json, sizeof(json),
+                 "{\"phase\":\"%s\",\"ms\":%.1f,\"waited_ms\":%.1f,\"budget_ms\":%.1f,\"suppressed\":%llu}",
+                 WD_PHASE_NAMES[phase], took / 1000.0, waited / 1000.0, wd->budget_us[phase] / 1000.0,
+                 (unsigned long long)wd->suppressed[phase]);
+        wd->on_event(wd->ctx, "loop_overrun", json);
+    }
+    wd->reported_us[phase] = now;
+    wd->suppressed[phase] = 0;
+}
+
+void watchdog_phase(watchdog_t* wd, wd_phase_t phase) {
+    int64_t now = mono_us();
+    int prev = atomic_load_explicit(&wd->phase, memory_order_relaxed);
+    if (prev != WD_IDLE) phase_end(wd, prev, now);
+
+    atomic_store_explicit(&wd->phase_start_us, now, memory_order_relaxed);
+    atomic_store_explicit(&wd->phase, phase, memory_order_release);
+}
+
+/* Blind since: the last decision or the end of a bounded wait, the later */
+static int64_t blind_since(const watchdog_t* wd) {
+    int64_t fresh = atomic_load(&wd->fresh_us);
+    int64_t wait = atomic_load(&wd->wait_until_us);
+    return wait > fresh ? wait : fresh;
+}
+
+void watchdog_fresh(watchdog_t* wd) {
+    int64_t now = mono_us();
+    atomic_max(&wd->max_blind_us, now - blind_since(wd));
+    atomic_store(&wd->fresh_us, now);
+    if (atomic_exchange(&wd->acted, false)) atomic_store(&wd->recovered, true);
+}
+
+void watchdog_wait(watchdog_t* wd, int64_t bound_us) {
+    int64_t now = mono_us();
+    if (bound_us > 0) {
+        wd->wait_start_us = now;
+        wd->wait_bound_us = bound_us;
+        atomic_store(&wd->wait_until_us, now + bound_us);
+        return;
+    }
+    if (!wd->wait_start_us) return;
+
+    /* Returned: the blind clock restarts here, or at the bound it ran past */
+    int64_t took = now - wd->wait_start_us;
+    wd->waited_us += took < wd->wait_bound_us ? took : wd->wait_bound_us;
+    wd->wait_start_us = 0;
+    if (took < wd->wait_bound_us) atomic_store(&wd->wait_until_us, now);
+}
+
+bool watchdog_recovered(watchdog_t* wd) {
+    return atomic_exchange(&wd->recovered, false);
+}
+
+/*=============================================================================
+ * DEADLINE THREAD
+ *===========================================================================*/
+
+static void* watchdog_thread(void* arg) {
+    watchdog_t* wd = arg;
+    struct timespec tick = { 0, WATCHDOG_TICK_MS * 1000000L };
+
+    while (atomic_load(&wd->running)) {
+        nanosleep(&tick, NULL);
+        if (wd->blind_us <= 0 || atomic_load(&wd->acted)) continue;
+
+        int64_t now = mono_us();
+        int64_t blind = now - blind_since(wd);
+        if (blind <= wd->blind_us) continue;
+
+        /* The loop may be anywhere; the phase and its start are a best-effort pair */
+        int phase = atomic_load_explicit(&wd->phase, memory_order_acquire);
+        int64_t in_phase = now - atomic_load_explicit(&wd->phase_start_us, memory_order_relaxed);
+        atomic_store(&wd->acted, true);
+        atomic_fetch_add(&wd->blind_spells, 1);
+
+        if (wd->on_event) {
+            char json[256];
+            snprintf(json, sizeof(json), "{\"phase\":\"%s\",\"phase_ms\":%.1f,\"blind_ms\":%.1f}",
+                     phase == WD_IDLE ? "idle" : WD_PHASE_NAMES[phase], in_phase / 1000.0, blind / 1000.0);
+            wd->on_event(wd->ctx, "watchdog_blind", json);
+        }
+        if (wd->on_blind) wd->on_blind(wd->ctx, (wd_phase_t)phase, blind);
+    }
+    return NULL;
+}
+
+void watchdog_init(watchdog_t* wd) {
+    memset(wd, 0, sizeof(*wd));
+    memcpy(wd->budget_us, DEFAULT_BUDGET_US, sizeof(wd->budget_us));
+    atomic_store(&wd->phase, WD_IDLE);
+    atomic_store(&wd->fresh_us, mono_us());
+}
+
+int watchdog_start(watchdog_t* wd, int blind_ms, watchdog_event_cb on_event, watchdog_blind_cb on_blind, void* ctx) {
+    wd->blind_us = (int64_t)blind_ms * 1000;
+    wd->on_event = on_event;
+    wd->on_blind = on_blind;
+    wd->ctx = ctx;
+    atomic_store(&wd->fresh_us, mono_us());
+
+    atomic_store(&wd->running, true);
+    int rc = pthread_create(&wd->thread, NULL, watchdog_thread, wd);
+    if (rc != 0) {
+        atomic_store(&wd->running, false);
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+void watchdog_stop(watchdog_t* wd) {
+    if (!atomic_load(&wd->running)) return;
+    atomic_store(&wd->running, false);
+    pthread_join(wd->thread, NULL);
+}
+
+void watchdog_json(const watchdog_t* wd, char* out, size_t len) {
+    size_t n = snprintf(out, len, "{\"blind_ms\": %lld, \"blind_spells\": %llu, \"max_blind_ms\": %.1f, \"phases\": {",
+                        (long long)(wd->blind_us / 1000),
+                        (unsigned long long)atomic_load(&wd->blind_spells),
+                        atomic_load(&wd->max_blind_us) / 1000.0);
+    for (int i = 0; i < WD_PHASE_COUNT && n < len; i++) {
+        n += snprintf(out + n, len - n, "%s\"%s\": {\"budget_ms\": %.1f, \"overruns\": %llu, \"max_ms\": %.1f}",
+                      i ? ", " : "", WD_PHASE_NAMES[i], wd->budget_us[i] / 1000.0,
+                      (unsigned long long)atomic_load(&wd->overruns[i]),
+                      atomic_load(&wd->max_us[i]) / 1000.0);
+    }
+    if (n < len) snprintf(out + n, len - n, "}}");
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * watchdog.h - PathSteer Guardian Control Loop Watchdog
+ *
+ * PURPOSE:
+ *   The main loop runs everything through popen()/system(): ping -W2,
+ *   grpcurl with a 2 s timeout, gpspipe, tc. When one of those hangs the
+ *   loop stalls and nothing notices - not the tripwire, not the status
+ *   file. The watchdog makes that visible and bounds what it costs.
+ *
+ * PHASES:
+ *   The loop marks each phase it enters (watchdog_phase()). A phase that
+ *   ends over its budget is an overrun: counted, its worst time kept, and
+ *   logged as "loop_overrun" with the phase that blew it (at most once per
+ *   second per phase, with how many were suppressed).
+ *
+ * HARD DEADLINE:
+ *   The loop calls watchdog_fresh() whenever the engine has decided on new
+ *   probe data. A thread checks every WATCHDOG_TICK_MS how long ago that
+ *   was; past the blind deadline it logs "watchdog_blind" with the phase
+ *   the loop is stuck in and calls on_blind once for that spell - the
+ *   daemon duplicates onto the standby there, from this thread, since the
+ *   loop can't. When fresh data arrives again watchdog_recovered() says so
+ *   once, and the loop hands the duplicate back to the engine.
+ *
+ * BOUNDED WAITS:
+ *   A probe round is sequential pings, each allowed its own timeout, so a
+ *   healthy round can outlast the deadline. The loop brackets a call with
+ *   a known bound in watchdog_wait(): while it is inside that bound the
+ *   loop is waiting, not stuck - blindness counts from the later of the
+ *   last decision and the end of the wait (or its bound, if it hangs), and
+ *   the time is not charged against the phase budget.
+ *
+ * Copyright (c) 2025 PathSteer Networks
+ ******************************************************************************/
+
+#ifndef PATHSTEER_WATCHDOG_H
+#define PATHSTEER_WATCHDOG_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WATCHDOG_TICK_MS        10          /* Deadline check period */
+#define WATCHDOG_REPORT_MS      1000        /* loop_overrun events, per phase */
+
+/* Main loop phases, in loop order */
+typedef enum {
+    WD_PROBE,               /* Probe round: pings, modem and dish polls */
+    WD_GPS,                 /* gpspipe, trajectory */
+    WD_PREDICT,             /* Prediction tick, risk index, correlation */
+    WD_MAINT,               /* Risk write-back, route and model reload */
+    WD_STATE,               /* engine_step(), shadow policies */
+    WD_COMMANDS,            /* UI commands */
+    WD_STATUS,              /* status.json */
+    WD_OBSERVE,             /* Flight recorder, monitors, metrics */
+    WD_PHASE_COUNT,
+    WD_IDLE = WD_PHASE_COUNT    /* Sleeping between iterations */
+} wd_phase_t;
+
+extern const char* const WD_PHASE_NAMES[];
+
+/* Events: "loop_overrun" from the loop thread, "watchdog_blind" from the watchdog */
+typedef void (*watchdog_event_cb)(void* ctx, const char* type, const char* json);
+
+/* Blind past the deadline, stuck in phase: take the safe action (watchdog thread) */
+typedef void (*watchdog_blind_cb)(void* ctx, wd_phase_t phase, int64_t blind_us);
+
+typedef struct {
+    int64_t             budget_us[WD_PHASE_COUNT];
+    int64_t             blind_us;           /* Hard deadline, 0 = no safe action */
+    watchdog_event_cb   on_event;
+    watchdog_blind_cb   on_blind;
+    void*               ctx;
+    pthread_t           thread;
+    _Atomic bool        running;
+
+    /* Written by the loop, read by the watchdog */
+    _Atomic int         phase;
+    _Atomic int64_t     phase_start_us;     /* CLOCK_MONOTONIC */
+    _Atomic int64_t     fresh_us;
+    _Atomic int64_t     wait_until_us;      /* Bounded wait: not blind before this */
+    _Atomic bool        acted;              /* on_blind called this spell */
+    _Atomic bool        recovered;          /* ... and fresh data since */
+
+    /* Counters, read by status.json and metrics */
+    _Atomic uint64_t    overruns[WD_PHASE_COUNT];
+    _Atomic int64_t     max_us[WD_PHASE_COUNT];
+    _Atomic uint64_t    blind_spells;
+    _Atomic int64_t     max_blind_us;
+
+    /* Loop thread only */
+    int64_t             wait_start_us;      /* Current bounded wait, 0 = none */
+    int64_t             wait_bound_us;
+    int64_t             waited_us;          /* Within bounds, this phase */
+    int64_t             reported_us[WD_PHASE_COUNT];
+    uint64_t            suppressed[WD_PHASE_COUNT];
+} watchdog_t;
+
+/* Zero wd with the default budgets; watchdog_stop() is then a no-op */
+void watchdog_init(watchdog_t* wd);
+
+/* Start the deadline thread. -1 with errno on failure. */
+int  watchdog_start(watchdog_t* wd, int blind_ms, watchdog_event_cb on_event, watchdog_blind_cb on_blind, void* ctx);
+
+/* The loop enters phase (WD_IDLE: iteration done), ending the previous one */
+void watchdog_phase(watchdog_t* wd, wd_phase_t phase);
+
+/* The engine has decided on new probe data */
+void watchdog_fresh(watchdog_t* wd);
+
+/* The loop blocks in a call bounded by bound_us (a ping's -W); 0 = it returned */
+void watchdog_wait(watchdog_t* wd, int64_t bound_us);
+
+/* True once after a blind spell the safe action was taken for has ended */
+bool watchdog_recovered(watchdog_t* wd);
+
+void watchdog_stop(watchdog_t* wd);
+
+/* {"blind_ms":..,"blind_spells":..,"phases":{"probe":{"budget_ms":..,"overruns":..,"max_ms":..},..}} */
+void watchdog_json(const watchdog_t* wd, char* out, size_t len);
+
+#endif /* PATHSTEER_WATCHDOG_H */
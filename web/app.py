@@ -23,21 +23,29 @@ from diagnostics import diag_bp
 
 app = Flask(__name__)
 
-# Map GUI uplink names to daemon internal names
-UPLINK_MAP = {'fa': 'fiber1', 'fb': 'fiber2', 'cell_a': 'cell_a', 'cell_b': 'cell_b', 'sl_a': 'sl_a', 'sl_b': 'sl_b'}
-UPLINK_MAP_REV = {v: k for k, v in UPLINK_MAP.items()}
-
-def map_uplink(name):
-    """Convert GUI name to daemon name"""
-    return UPLINK_MAP.get(name, name)
-
-
 # Paths
 STATUS_PATH = '/run/pathsteer/status.json'
 COMMAND_PATH = '/run/pathsteer/command'
 CONFIG_PATH = os.environ.get('CONFIG_FILE', '/etc/pathsteer/config.json')
 DB_PATH = '/opt/pathsteer/data/training.db'
 
+# The GUI's FA/FB buttons are the first and second fiber uplink, whatever
+# the config names them (config.terrestrial.json: fiber1/fiber2)
+GUI_FIBERS = ['fa', 'fb']
+
+def map_uplink(name):
+    """Convert GUI name to daemon name, from the uplinks in status.json"""
+    try:
+        with open(STATUS_PATH) as f:
+            uplinks = json.load(f).get('uplinks', [])
+    except Exception:
+        return name
+    if name not in GUI_FIBERS or any(u.get('name') == name for u in uplinks):
+        return name
+    fibers = [u.get('name') for u in uplinks if u.get('type') == 'fiber']
+    i = GUI_FIBERS.index(name)
+    return fibers[i] if i < len(fibers) else name
+
 def get_config():
     """Load configuration"""
     try:
@@ -169,6 +177,16 @@ def api_status():
 def api_config():
     return jsonify(get_config())
 
+@app.route('/api/metrics/latency')
+def api_metrics_latency():
+    """Hot-path latency histograms (us) from the daemon, without the rest of status"""
+    try:
+        with open(STATUS_PATH) as f:
+            status = json.load(f)
+        return jsonify({'run_id': status.get('run_id'), 'latency': status.get('latency', {})})
+    except Exception as e:
+        return jsonify({'error': str(e)}), 503
+
 @app.route('/api/stream')
 def api_stream():
     """Server-sent events for real-time updates"""
@@ -295,10 +313,14 @@ def api_risk_zones():
     try:
         conn = sqlite3.connect(DB_PATH)
         cursor = conn.cursor()
-        cursor.execute('''
+        # <uplink>_ho / <uplink>_hogap rows are the daemon's handover
+        # probabilities and gap lengths, not outage risk
+        cursor.execute(r'''
             SELECT latitude, longitude, uplink, risk_score, sample_count,
                    heading_min, heading_max
             FROM risk_zones WHERE risk_score > 0.3
+              AND uplink NOT LIKE '%\_ho' ESCAPE '\'
+              AND uplink NOT LIKE '%\_hogap' ESCAPE '\'
             ORDER BY risk_score DESC LIMIT 500
         ''')
         rows = cursor.fetchall()
@@ -322,10 +344,14 @@ def toggle_uplink():
         with open(config_path, 'r') as f:
             config = json.load(f)
         new_state = False
-        if name in config.get('uplinks', {}):
-            current = config['uplinks'][name].get('enabled', True)
-            config['uplinks'][name]['enabled'] = not current
-            new_state = config['uplinks'][name]['enabled']
+        uplinks = config.get('uplinks', [])
+        if isinstance(uplinks, dict):
+            entry = uplinks.get(name)
+        else:
+            entry = next((u for u in uplinks if u.get('name') == name), None)
+        if entry is not None:
+            entry['enabled'] = not entry.get('enabled', True)
+            new_state = entry['enabled']
             with open(config_path, 'w') as f:
                 json.dump(config, f, indent=2)
             # Write command for daemon
@@ -360,11 +386,11 @@ def api_chaos_inject():
         rtt = data.get('rtt', 0)
         jitter = data.get('jitter', 0)
         loss = data.get('loss', 0)
-        chaos_state[uplink] = {'rtt': rtt, 'jitter': jitter, 'loss': loss}
+        chaos_state[map_uplink(uplink)] = {'rtt': rtt, 'jitter': jitter, 'loss': loss}
     else:
         for ul, vals in data.items():
             if isinstance(vals, dict):
-                chaos_state[ul] = {'rtt': vals.get('rtt_add', vals.get('rtt', 0)), 'jitter': vals.get('jitter', 0), 'loss': vals.get('loss_add', vals.get('loss', 0))}
+                chaos_state[map_uplink(ul)] = {'rtt': vals.get('rtt_add', vals.get('rtt', 0)), 'jitter': vals.get('jitter', 0), 'loss': vals.get('loss_add', vals.get('loss', 0))}
     
     # Write to file for daemon to read
     chaos_file = '/run/pathsteer/chaos.json'
@@ -420,6 +446,20 @@ def api_pcap_stop():
     
     return jsonify({'status': 'stopped', 'file': pcap_file})
 
+@app.route('/api/pcap/list')
+def api_pcap_list():
+    """Captures, newest first: manual (chaos_*) and flight recorder slices (fr_*)"""
+    pcap_dir = '/opt/pathsteer/data/pcaps'
+    files = []
+    if os.path.isdir(pcap_dir):
+        for name in os.listdir(pcap_dir):
+            if name.endswith('.pcap'):
+                st = os.stat(os.path.join(pcap_dir, name))
+                files.append({'file': name, 'bytes': st.st_size, 'mtime': int(st.st_mtime),
+                              'source': 'flightrec' if name.startswith('fr_') else 'manual'})
+    files.sort(key=lambda f: f['mtime'], reverse=True)
+    return jsonify({'files': files})
+
 @app.route('/api/pcap/download/<filename>')
 def api_pcap_download(filename):
     """Download PCAP file"""
@@ -666,11 +706,31 @@ def api_llm_status():
 
 @app.route('/api/flows')
 def api_flows():
+    """Flows from pathsteerd (conntrack), SIP calls from flow-monitor.py"""
     try:
         with open('/run/pathsteer/flows.json', 'r') as f:
+            flows = json.load(f)
+    except:
+        flows = {'active_flows': 0, 'flows': []}
+    try:
+        with open('/run/pathsteer/sip.json', 'r') as f:
+            sip = json.load(f)
+    except:
+        sip = {}
+    flows['active_sip_calls'] = sip.get('active_calls', 0)
+    flows['sip_calls'] = sip.get('calls', [])
+    flows['sip_regs'] = sip.get('regs', [])
+    flows['registrations'] = len(flows['sip_regs'])
+    return jsonify(flows)
+
+@app.route('/api/rtp')
+def api_rtp():
+    """RTP streams, MOS and per-switch voice loss from pathsteerd"""
+    try:
+        with open('/run/pathsteer/rtp.json', 'r') as f:
             return jsonify(json.load(f))
     except:
-        return jsonify({'active_flows': 0, 'flows': [], 'sip_calls': []})
+        return jsonify({'streams': [], 'switches': []})
 
 @app.route('/api/sip/status')
 def api_sip_status():